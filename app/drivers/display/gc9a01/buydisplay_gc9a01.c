@@ -31,6 +31,9 @@
 #include <zephyr/pm/pm.h>
 #include <zephyr/pm/device.h>
 #include <zephyr/pm/policy.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
 
 LOG_MODULE_REGISTER(gc9a01, CONFIG_DISPLAY_LOG_LEVEL);
 
@@ -191,8 +194,50 @@ struct gc9a01_frame {
 
 static struct gc9a01_frame frame = {{0, 0}, {DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1}};
 
-static inline int gc9a01_write_cmd(const struct device *dev, uint8_t cmd,
-                                   const uint8_t *data, size_t len)
+static void gc9a01_bus_suspend_work_handler(struct k_work *work);
+
+K_MUTEX_DEFINE(bus_mutex);
+K_WORK_DELAYABLE_DEFINE(bus_suspend_work, gc9a01_bus_suspend_work_handler);
+static bool bus_active;
+
+/* Must be called with bus_mutex held */
+static void gc9a01_bus_resume(const struct device *dev)
+{
+    const struct gc9a01_config *config = dev->config;
+    int rc;
+
+    if (!bus_active) {
+        rc = pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_RESUME);
+        if (rc != 0 && rc != -EALREADY) {
+            LOG_ERR("Failed resume SPI Bus: %d", rc);
+        }
+        bus_active = true;
+    }
+}
+
+/* Must be called with bus_mutex held */
+static void gc9a01_bus_suspend(const struct device *dev)
+{
+    const struct gc9a01_config *config = dev->config;
+    int rc;
+
+    if (bus_active) {
+        rc = pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_SUSPEND);
+        if (rc != 0 && rc != -EALREADY) {
+            LOG_ERR("Failed suspend SPI Bus: %d", rc);
+        }
+        bus_active = false;
+    }
+}
+
+static void gc9a01_bus_suspend_work_handler(struct k_work *work)
+{
+    k_mutex_lock(&bus_mutex, K_FOREVER);
+    gc9a01_bus_suspend(DEVICE_DT_INST_GET(0));
+    k_mutex_unlock(&bus_mutex);
+}
+
+static int gc9a01_write_cmd_bufs(const struct device *dev, uint8_t cmd, const struct spi_buf_set *data)
 {
     const struct gc9a01_config *config = dev->config;
     struct spi_buf buf = {.buf = &cmd, .len = sizeof(cmd)};
@@ -203,11 +248,9 @@ static inline int gc9a01_write_cmd(const struct device *dev, uint8_t cmd,
         return -EIO;
     }
 
-    if (data != NULL && len != 0) {
-        buf.buf = (void *)data;
-        buf.len = len;
+    if (data != NULL && data->count != 0) {
         gpio_pin_set_dt(&config->dc_gpio, 1);
-        if (spi_write_dt(&config->bus, &buf_set) != 0) {
+        if (spi_write_dt(&config->bus, data) != 0) {
             LOG_ERR("Failed sending data");
             return -EIO;
         }
@@ -216,6 +259,15 @@ static inline int gc9a01_write_cmd(const struct device *dev, uint8_t cmd,
     return 0;
 }
 
+static inline int gc9a01_write_cmd(const struct device *dev, uint8_t cmd,
+                                   const uint8_t *data, size_t len)
+{
+    struct spi_buf buf = {.buf = (void *)data, .len = len};
+    struct spi_buf_set buf_set = {.buffers = &buf, .count = (data != NULL && len != 0) ? 1 : 0};
+
+    return gc9a01_write_cmd_bufs(dev, cmd, &buf_set);
+}
+
 static void gc9a01_set_frame(const struct device *dev, struct gc9a01_frame frame)
 {
     uint8_t data[4];
@@ -243,12 +295,131 @@ static int gc9a01_blanking_on(const struct device *dev)
     return gc9a01_write_cmd(dev, GC9A01A_DISPOFF, NULL, 0);
 }
 
+#ifdef CONFIG_GC9A01_ROUND_CLIP
+/* Visible columns of each row, for a circle touching all four panel edges */
+static uint8_t row_first_x[DISPLAY_HEIGHT];
+static uint8_t row_last_x[DISPLAY_HEIGHT];
+static struct spi_buf row_bufs[DISPLAY_HEIGHT];
+
+static struct {
+    uint64_t area_bytes;
+    uint64_t sent_bytes;
+    uint32_t areas;
+    uint32_t windows;
+} clip_stats;
+
+static void gc9a01_round_clip_init(void)
+{
+    const float radius = DISPLAY_WIDTH / 2.0f;
+    float dy;
+    float half_width;
+
+    BUILD_ASSERT(DISPLAY_WIDTH == DISPLAY_HEIGHT, "Round clipping needs a square panel");
+    BUILD_ASSERT(DISPLAY_WIDTH <= 256, "Row spans are stored as uint8_t");
+
+    for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+        // Use the row edge closest to the center, so partly covered pixels are kept.
+        dy = (y < DISPLAY_HEIGHT / 2) ? (DISPLAY_HEIGHT / 2 - (y + 1)) : (y - DISPLAY_HEIGHT / 2);
+        half_width = sqrtf(MAX(radius * radius - dy * dy, 0.0f));
+        row_first_x[y] = CLAMP((int)floorf(radius - half_width), 0, DISPLAY_WIDTH - 1);
+        row_last_x[y] = CLAMP((int)ceilf(radius + half_width) - 1, 0, DISPLAY_WIDTH - 1);
+    }
+}
+
+static void gc9a01_write_window(const struct device *dev, uint16_t x_start, uint16_t x_end, uint16_t y_start,
+                                uint16_t y_end, const struct display_buffer_descriptor *desc, const uint8_t *buf)
+{
+    struct spi_buf_set buf_set = {.buffers = row_bufs};
+    size_t row_len = (x_end - x_start + 1) * 2;
+
+    frame.start.X = x_start;
+    frame.end.X = x_end;
+    frame.start.Y = y_start;
+    frame.end.Y = y_end;
+    gc9a01_set_frame(dev, frame);
+
+    if (row_len == desc->pitch * 2) {
+        // Full rows are contiguous in the buffer
+        row_bufs[0].buf = (void *)buf;
+        row_bufs[0].len = row_len * (y_end - y_start + 1);
+        buf_set.count = 1;
+    } else {
+        for (int i = 0; i <= y_end - y_start; i++) {
+            row_bufs[i].buf = (void *)(buf + i * desc->pitch * 2);
+            row_bufs[i].len = row_len;
+        }
+        buf_set.count = y_end - y_start + 1;
+    }
+
+    gc9a01_write_cmd_bufs(dev, GC9A01A_RAMWR, &buf_set);
+
+    clip_stats.sent_bytes += row_len * (y_end - y_start + 1);
+    clip_stats.windows++;
+}
+
+/*
+ * Split the area into bands of rows with similar visible spans and send only
+ * the visible part of each band, in one SPI transaction per band. The span
+ * starts, and the span ends, of the rows in a band are all within
+ * CONFIG_GC9A01_ROUND_CLIP_MERGE_PX of each other, so no row sends more than
+ * that many invisible pixels on either side.
+ */
+static void gc9a01_write_round(const struct device *dev, const uint16_t x, const uint16_t y,
+                               const struct display_buffer_descriptor *desc, const uint8_t *buf)
+{
+    uint16_t x_end_idx = x + desc->width - 1;
+    uint16_t y_end_idx = y + desc->height - 1;
+    int band_start_y = -1;
+    uint16_t band_first_x = 0;      // Smallest span start in the band
+    uint16_t band_first_x_max = 0;  // Largest span start in the band
+    uint16_t band_last_x = 0;       // Largest span end in the band
+    uint16_t band_last_x_min = 0;   // Smallest span end in the band
+    uint16_t first_x = 0;
+    uint16_t last_x = 0;
+
+    for (uint16_t row = y; row <= y_end_idx + 1; row++) {
+        bool visible = false;
+
+        if (row <= y_end_idx) {
+            first_x = MAX(x, row_first_x[row]);
+            last_x = MIN(x_end_idx, row_last_x[row]);
+            visible = first_x <= last_x;
+        }
+
+        if (band_start_y >= 0 && visible &&
+            MAX(band_first_x_max, first_x) - MIN(band_first_x, first_x) <= CONFIG_GC9A01_ROUND_CLIP_MERGE_PX &&
+            MAX(band_last_x, last_x) - MIN(band_last_x_min, last_x) <= CONFIG_GC9A01_ROUND_CLIP_MERGE_PX) {
+            band_first_x = MIN(band_first_x, first_x);
+            band_first_x_max = MAX(band_first_x_max, first_x);
+            band_last_x = MAX(band_last_x, last_x);
+            band_last_x_min = MIN(band_last_x_min, last_x);
+            continue;
+        }
+
+        if (band_start_y >= 0) {
+            gc9a01_write_window(dev, band_first_x, band_last_x, band_start_y, row - 1, desc,
+                                buf + ((band_start_y - y) * desc->pitch + (band_first_x - x)) * 2);
+            band_start_y = -1;
+        }
+
+        if (visible) {
+            band_start_y = row;
+            band_first_x = first_x;
+            band_first_x_max = first_x;
+            band_last_x = last_x;
+            band_last_x_min = last_x;
+        }
+    }
+
+    clip_stats.area_bytes += desc->width * desc->height * 2;
+    clip_stats.areas++;
+}
+#endif
+
 static int gc9a01_write(const struct device *dev, const uint16_t x, const uint16_t y,
                         const struct display_buffer_descriptor *desc,
                         const void *buf)
 {
-    const struct gc9a01_config *config = dev->config;
-    __ASSERT(pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_RESUME) == 0, "Failed resume SPI Bus");
 #ifdef GC9A01_SPI_PROFILING
     uint32_t start_time;
     uint32_t stop_time;
@@ -258,11 +429,10 @@ static int gc9a01_write(const struct device *dev, const uint16_t x, const uint16
     uint16_t x_end_idx = x + desc->width - 1;
     uint16_t y_end_idx = y + desc->height - 1;
 
-    frame.start.X = x;
-    frame.end.X = x_end_idx;
-    frame.start.Y = y;
-    frame.end.Y = y_end_idx;
-    gc9a01_set_frame(dev, frame);
+    // The bus stays resumed for the remaining areas of the frame, see CONFIG_GC9A01_BUS_SUSPEND_DELAY_MS.
+    k_mutex_lock(&bus_mutex, K_FOREVER);
+    k_work_cancel_delayable(&bus_suspend_work);
+    gc9a01_bus_resume(dev);
 
     size_t len = (x_end_idx + 1 - x) * (y_end_idx + 1 - y) * 16 / 8;
     //printk("x_start: %d, y_start: %d, x_end: %d, y_end: %d, buf_size: %d, pitch: %d len: %d\n", x, y, x_end_idx, y_end_idx, desc->buf_size, desc->pitch, len);
@@ -270,14 +440,29 @@ static int gc9a01_write(const struct device *dev, const uint16_t x, const uint16
 #ifdef GC9A01_SPI_PROFILING
     start_time = k_cycle_get_32();
 #endif
+#ifdef CONFIG_GC9A01_ROUND_CLIP
+    gc9a01_write_round(dev, x, y, desc, buf);
+#else
+    frame.start.X = x;
+    frame.end.X = x_end_idx;
+    frame.start.Y = y;
+    frame.end.Y = y_end_idx;
+    gc9a01_set_frame(dev, frame);
     gc9a01_write_cmd(dev, GC9A01A_RAMWR, buf, len);
+#endif
 #ifdef GC9A01_SPI_PROFILING
     stop_time = k_cycle_get_32();
     cycles_spent = stop_time - start_time;
     nanoseconds_spent = k_cyc_to_ns_ceil32(cycles_spent);
-    LOG_DBG("%d =>: %dns", len, nanoseconds_spent);
+    LOG_DBG("%d =>: %dns (%d kB/s)", len, nanoseconds_spent,
+            nanoseconds_spent ? (uint32_t)(((uint64_t)len * 1000000) / nanoseconds_spent) : 0);
 #endif
-    __ASSERT(pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_SUSPEND) == 0, "Failed suspend SPI Bus");
+    if (CONFIG_GC9A01_BUS_SUSPEND_DELAY_MS == 0) {
+        gc9a01_bus_suspend(dev);
+    } else {
+        k_work_reschedule(&bus_suspend_work, K_MSEC(CONFIG_GC9A01_BUS_SUSPEND_DELAY_MS));
+    }
+    k_mutex_unlock(&bus_mutex);
     return 0;
 }
 
@@ -334,7 +519,6 @@ static int gc9a01_set_pixel_format(const struct device *dev,
 
 static int gc9a01_controller_init(const struct device *dev)
 {
-    int rc;
     int i = 0;
     uint8_t cmd, x, numArgs;
     const uint8_t *addr;
@@ -345,8 +529,8 @@ static int gc9a01_controller_init(const struct device *dev)
     k_msleep(5);
     gpio_pin_set_dt(&config->reset_gpio, 1);
     k_msleep(150);
-    rc = pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_RESUME);
-    __ASSERT(rc == -EALREADY || rc == 0, "Failed resume SPI Bus");
+    k_mutex_lock(&bus_mutex, K_FOREVER);
+    gc9a01_bus_resume(dev);
 
     addr = initcmd;
     while ((cmd = *addr++) > 0) {
@@ -360,7 +544,8 @@ static int gc9a01_controller_init(const struct device *dev)
         i++;
     }
 
-    __ASSERT(pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_SUSPEND) == 0, "Failed suspend SPI Bus");
+    gc9a01_bus_suspend(dev);
+    k_mutex_unlock(&bus_mutex);
     return 0;
 }
 
@@ -388,6 +573,9 @@ static int gc9a01_init(const struct device *dev)
 
     // Default to 0 brightness
     gpio_pin_configure_dt(&config->bl_gpio, GPIO_OUTPUT_INACTIVE);
+#ifdef CONFIG_GC9A01_ROUND_CLIP
+    gc9a01_round_clip_init();
+#endif
     return gc9a01_controller_init(dev);
 }
 
@@ -395,8 +583,10 @@ static int gc9a01_pm_action(const struct device *dev,
                             enum pm_device_action action)
 {
     int err = 0;
-    const struct gc9a01_config *config = dev->config;
-    __ASSERT(pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_RESUME) == 0, "Failed resume SPI Bus");
+
+    k_mutex_lock(&bus_mutex, K_FOREVER);
+    k_work_cancel_delayable(&bus_suspend_work);
+    gc9a01_bus_resume(dev);
 
     switch (action) {
         case PM_DEVICE_ACTION_RESUME:
@@ -417,12 +607,8 @@ static int gc9a01_pm_action(const struct device *dev,
             err = -ENOTSUP;
     }
 
-    err = pm_device_action_run(config->bus.bus, PM_DEVICE_ACTION_SUSPEND);
-    __ASSERT(err == 0 || err == -EALREADY, "Failed suspend SPI Bus");
-
-    if (err == -EALREADY) {
-        err = 0;
-    }
+    gc9a01_bus_suspend(dev);
+    k_mutex_unlock(&bus_mutex);
 
     if (err < 0) {
         LOG_ERR("%s: failed to set power mode", dev->name);
@@ -431,6 +617,32 @@ static int gc9a01_pm_action(const struct device *dev,
     return err;
 }
 
+#if defined(CONFIG_GC9A01_ROUND_CLIP) && defined(CONFIG_SHELL)
+static int cmd_gc9a01_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    k_mutex_lock(&bus_mutex, K_FOREVER);
+    shell_print(sh, "Areas:      %u", clip_stats.areas);
+    shell_print(sh, "Windows:    %u", clip_stats.windows);
+    shell_print(sh, "Area bytes: %llu", clip_stats.area_bytes);
+    shell_print(sh, "Sent bytes: %llu (%u%%)", clip_stats.sent_bytes,
+                clip_stats.area_bytes ? (uint32_t)((clip_stats.sent_bytes * 100) / clip_stats.area_bytes) : 0);
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        memset(&clip_stats, 0, sizeof(clip_stats));
+    }
+    k_mutex_unlock(&bus_mutex);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_gc9a01,
+                               SHELL_CMD_ARG(stats, NULL, "Show round clipping statistics: gc9a01 stats [reset]",
+                                             cmd_gc9a01_stats, 1, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(gc9a01, &sub_gc9a01, "GC9A01 display driver commands", NULL);
+#endif
+
 static const struct gc9a01_config gc9a01_config = {
     .bus = SPI_DT_SPEC_INST_GET(0, SPI_OP_MODE_MASTER | SPI_WORD_SET(8), 0),
     .reset_gpio = GPIO_DT_SPEC_INST_GET(0, reset_gpios),
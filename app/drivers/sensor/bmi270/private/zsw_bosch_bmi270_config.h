@@ -77,6 +77,11 @@
 #define BOSCH_BMI270_REG_PWR_CTRL        0x7D
 #define BOSCH_BMI270_REG_CMD             0x7E
 
+#define BOSCH_BMI270_CMD_FIFO_FLUSH      0xB0
+
+#define BOSCH_BMI270_PWR_CTRL_GYR_EN     BIT(1)
+#define BOSCH_BMI270_PWR_CTRL_ACC_EN     BIT(2)
+
 /** @brief
  *  @param p_dev
  *  @param p_data
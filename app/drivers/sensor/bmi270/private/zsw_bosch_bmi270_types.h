@@ -25,6 +25,10 @@
 #include "bmi2.h"
 #include "bmi270.h"
 
+/** @brief Size of a FIFO frame with header, accelerometer and gyroscope data.
+*/
+#define BOSCH_BMI270_FIFO_FRAME_SIZE    13
+
 /** @brief
 */
 struct bmi270_config {
@@ -55,6 +59,7 @@ struct bmi270_data {
     sensor_trigger_handler_t gesture;
     sensor_trigger_handler_t stationary;
     sensor_trigger_handler_t motion;
+    sensor_trigger_handler_t fifo_wm;
 #endif
 
 #if defined(CONFIG_ZSW_BMI270_TRIGGER_OWN_THREAD)
@@ -76,4 +81,12 @@ struct bmi270_data {
     uint8_t gyr_odr;
     uint8_t gyr_osr;
     struct bmi2_dev bmi2;
+
+#ifdef CONFIG_ZSW_BMI270_FIFO
+    bool fifo_enabled;
+    uint8_t fifo_saved_gyr_odr;
+    uint8_t fifo_buf[CONFIG_ZSW_BMI270_FIFO_MAX_FRAMES * BOSCH_BMI270_FIFO_FRAME_SIZE + 1];
+    struct bmi2_sens_axes_data fifo_acc[CONFIG_ZSW_BMI270_FIFO_MAX_FRAMES];
+    struct bmi2_sens_axes_data fifo_gyr[CONFIG_ZSW_BMI270_FIFO_MAX_FRAMES];
+#endif
 };
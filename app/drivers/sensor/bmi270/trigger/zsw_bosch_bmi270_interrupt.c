@@ -92,6 +92,26 @@ static void bmi2_process_int(const struct device *p_dev)
 
     LOG_DBG("Status: %u", status);
 
+    if (status & BMI2_FWM_INT_STATUS_MASK) {
+        struct sensor_trigger fifo_trigger = {
+            .type = SENSOR_TRIG_FIFO_WATERMARK,
+            .chan = SENSOR_CHAN_ACCEL_XYZ,
+        };
+
+        LOG_DBG("BMI2_FWM_INT_STATUS_MASK");
+
+        if (data->fifo_wm) {
+            data->fifo_wm(p_dev, &fifo_trigger);
+        }
+
+        // The rest is only for feature interrupts, don't poll steps every FIFO watermark.
+        status &= ~BMI2_FWM_INT_STATUS_MASK;
+        if (status == 0) {
+            bmi2_enable_int(p_dev, true);
+            return;
+        }
+    }
+
     if (status & BMI270_SIG_MOT_STATUS_MASK) {
         LOG_DBG("BMI270_SIG_MOT_STATUS_MASK");
 
@@ -286,7 +306,8 @@ int bmi270_trigger_set(const struct device *p_dev, const struct sensor_trigger *
     struct bmi270_data *data = p_dev->data;
     const struct bmi270_config *config = p_dev->config;
 
-    if ((!config->int_gpio.port) || ((p_trig->chan != SENSOR_CHAN_GESTURE) && (p_trig->chan != SENSOR_CHAN_ALL))) {
+    if ((!config->int_gpio.port) || ((p_trig->chan != SENSOR_CHAN_GESTURE) && (p_trig->chan != SENSOR_CHAN_ALL) &&
+                                     (p_trig->chan != SENSOR_CHAN_ACCEL_XYZ))) {
         return -ENOTSUP;
     }
 
@@ -319,6 +340,9 @@ int bmi270_trigger_set(const struct device *p_dev, const struct sensor_trigger *
             case SENSOR_TRIG_MOTION:
                 data->motion = handler;
                 break;
+            case SENSOR_TRIG_FIFO_WATERMARK:
+                data->fifo_wm = handler;
+                break;
             default:
                 return -ENOTSUP;
         }
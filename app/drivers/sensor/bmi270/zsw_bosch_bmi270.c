@@ -245,6 +245,11 @@ static int bmi270_attr_set(const struct device *p_dev, enum sensor_channel chann
         //  - Measurement range
         switch (attribute) {
             case SENSOR_ATTR_SAMPLING_FREQUENCY:
+#ifdef CONFIG_ZSW_BMI270_FIFO
+                if (((struct bmi270_data *)p_dev->data)->fifo_enabled) {
+                    return -EBUSY;
+                }
+#endif
                 return bmi2_set_accel_odr(p_dev, p_value);
             case SENSOR_ATTR_OVERSAMPLING:
                 return bmi2_set_accel_osr(p_dev, p_value);
@@ -269,6 +274,11 @@ static int bmi270_attr_set(const struct device *p_dev, enum sensor_channel chann
         //  - Measurement range
         switch (attribute) {
             case SENSOR_ATTR_SAMPLING_FREQUENCY:
+#ifdef CONFIG_ZSW_BMI270_FIFO
+                if (((struct bmi270_data *)p_dev->data)->fifo_enabled) {
+                    return -EBUSY;
+                }
+#endif
                 return bmi2_set_gyro_odr(p_dev, p_value);
             case SENSOR_ATTR_OVERSAMPLING:
                 return bmi2_set_gyro_osr(p_dev, p_value);
@@ -436,6 +446,157 @@ static int bmi270_channel_get(const struct device *p_dev, enum sensor_channel ch
     return 0;
 }
 
+#ifdef CONFIG_ZSW_BMI270_FIFO
+/** @brief          Stop the FIFO and give the gyroscope back its sampling frequency from before it was enabled.
+ *  @param p_dev
+ *  @return         0 when successful
+*/
+static int bmi2_fifo_disable(const struct device *p_dev)
+{
+    struct bmi270_data *data = p_dev->data;
+    struct sensor_value odr;
+    int ret = 0;
+
+    if ((bmi2_set_fifo_config(BMI2_FIFO_ALL_EN, BMI2_DISABLE, &data->bmi2) != BMI2_OK) ||
+        (bmi2_map_data_int(BMI2_FWM_INT, BMI2_INT_NONE, &data->bmi2) != BMI2_OK)) {
+        ret = -EFAULT;
+    }
+
+    if (data->fifo_enabled) {
+        data->fifo_enabled = false;
+        odr.val1 = data->fifo_saved_gyr_odr;
+        odr.val2 = 0;
+        if (bmi2_set_gyro_odr(p_dev, &odr) != 0) {
+            ret = -EFAULT;
+        }
+    }
+
+    LOG_DBG("FIFO disabled");
+
+    return ret;
+}
+
+int bosch_bmi270_fifo_configure(const struct device *p_dev, uint16_t watermark_frames)
+{
+    struct bmi270_data *data = p_dev->data;
+    struct sensor_value odr;
+    uint8_t cmd = BOSCH_BMI270_CMD_FIFO_FLUSH;
+    uint8_t pwr_ctrl;
+    enum bmi2_hw_int_pin int_pin = BMI2_INT_NONE;
+    int ret;
+
+    if (watermark_frames > CONFIG_ZSW_BMI270_FIFO_MAX_FRAMES) {
+        return -EINVAL;
+    }
+
+    ret = bmi2_fifo_disable(p_dev);
+    if ((ret != 0) || (watermark_frames == 0)) {
+        return ret;
+    }
+
+    // Frames are read as BOSCH_BMI270_FIFO_FRAME_SIZE bytes, which needs both sensors in every frame.
+    if (data->bmi2.read(BOSCH_BMI270_REG_PWR_CTRL, &pwr_ctrl, 1, data->bmi2.intf_ptr) != BMI2_OK) {
+        return -EFAULT;
+    }
+    if ((pwr_ctrl & (BOSCH_BMI270_PWR_CTRL_ACC_EN | BOSCH_BMI270_PWR_CTRL_GYR_EN)) !=
+        (BOSCH_BMI270_PWR_CTRL_ACC_EN | BOSCH_BMI270_PWR_CTRL_GYR_EN)) {
+        LOG_ERR("FIFO needs the accelerometer and gyroscope enabled");
+        return -EINVAL;
+    }
+
+    // Both sensors must also run at the same rate, ACC and GYR ODR codes are the same for the same frequency.
+    data->fifo_saved_gyr_odr = data->gyr_odr;
+    odr.val1 = data->acc_odr;
+    odr.val2 = 0;
+    if (bmi2_set_gyro_odr(p_dev, &odr) != 0) {
+        return -ENOTSUP;
+    }
+    data->fifo_enabled = true;
+
+    if ((bmi2_set_fifo_config(BMI2_FIFO_ACC_EN | BMI2_FIFO_GYR_EN | BMI2_FIFO_HEADER_EN, BMI2_ENABLE,
+                              &data->bmi2) != BMI2_OK) ||
+        (bmi2_set_fifo_wm(watermark_frames * BOSCH_BMI270_FIFO_FRAME_SIZE, &data->bmi2) != BMI2_OK) ||
+        (data->bmi2.write(BOSCH_BMI270_REG_CMD, &cmd, 1, data->bmi2.intf_ptr) != BMI2_OK)) {
+        bmi2_fifo_disable(p_dev);
+        return -EFAULT;
+    }
+
+#ifdef CONFIG_ZSW_BMI270_TRIGGER
+    int_pin = IS_ENABLED(CONFIG_ZSW_BMI270_USE_INT1) ? BMI2_INT1 : BMI2_INT2;
+#endif
+
+    if (bmi2_map_data_int(BMI2_FWM_INT, int_pin, &data->bmi2) != BMI2_OK) {
+        bmi2_fifo_disable(p_dev);
+        return -EFAULT;
+    }
+
+    LOG_DBG("FIFO enabled, watermark %u frames", watermark_frames);
+
+    return 0;
+}
+
+int bosch_bmi270_fifo_read(const struct device *p_dev, struct bosch_bmi270_fifo_frame *p_frames, uint16_t max_frames,
+                           uint32_t *p_period_us, uint16_t *p_remaining)
+{
+    struct bmi270_data *data = p_dev->data;
+    struct bmi2_fifo_frame fifo = { 0 };
+    struct sensor_value value;
+    uint16_t fifo_length;
+    uint16_t num_acc;
+    uint16_t num_gyr;
+
+    __ASSERT_NO_MSG(p_frames != NULL);
+    __ASSERT_NO_MSG(p_period_us != NULL);
+    __ASSERT_NO_MSG(p_remaining != NULL);
+
+    // ODR codes are 1600 Hz divided by a power of two.
+    *p_period_us = 625U << (BOSCH_BMI270_ACC_ODR_1600_HZ - data->acc_odr);
+    *p_remaining = 0;
+
+    if (bmi2_get_fifo_length(&fifo_length, &data->bmi2) != BMI2_OK) {
+        return -EFAULT;
+    }
+
+    // Only read whole frames, a partial frame would be lost.
+    max_frames = MIN(max_frames, CONFIG_ZSW_BMI270_FIFO_MAX_FRAMES);
+    max_frames = MIN(max_frames, fifo_length / BOSCH_BMI270_FIFO_FRAME_SIZE);
+    if (max_frames == 0) {
+        return 0;
+    }
+    *p_remaining = fifo_length / BOSCH_BMI270_FIFO_FRAME_SIZE - max_frames;
+
+    fifo.data = data->fifo_buf;
+    fifo.length = max_frames * BOSCH_BMI270_FIFO_FRAME_SIZE + data->bmi2.dummy_byte;
+
+    if (bmi2_read_fifo_data(&fifo, &data->bmi2) != BMI2_OK) {
+        return -EFAULT;
+    }
+
+    num_acc = max_frames;
+    num_gyr = max_frames;
+    if ((bmi2_extract_accel(data->fifo_acc, &num_acc, &fifo, &data->bmi2) < BMI2_OK) ||
+        (bmi2_extract_gyro(data->fifo_gyr, &num_gyr, &fifo, &data->bmi2) < BMI2_OK)) {
+        return -EFAULT;
+    }
+
+    for (int i = 0; i < MIN(num_acc, num_gyr); i++) {
+        const int16_t acc[3] = { data->fifo_acc[i].x, data->fifo_acc[i].y, data->fifo_acc[i].z };
+        const int16_t gyr[3] = { data->fifo_gyr[i].x, data->fifo_gyr[i].y, data->fifo_gyr[i].z };
+
+        for (int axis = 0; axis < 3; axis++) {
+            bmi2_raw2accel_convert(&value, acc[axis], data->acc_range);
+            p_frames[i].acc[axis] = value.val1 * 1000000 + value.val2;
+            bmi2_raw2gyro_convert(&value, gyr[axis], data->gyr_range);
+            p_frames[i].gyr[axis] = value.val1 * 1000000 + value.val2;
+        }
+    }
+
+    LOG_DBG("Read %u FIFO frames", MIN(num_acc, num_gyr));
+
+    return MIN(num_acc, num_gyr);
+}
+#endif
+
 static const struct sensor_driver_api bmi270_driver_api = {
     .attr_set = bmi270_attr_set,
     .sample_fetch = bmi270_sample_fetch,
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <zephyr/device.h>
+
 /** @brief Step counting sensor channel.
 */
 #define SENSOR_CHAN_STEPS               (SENSOR_CHAN_PRIV_START + 1)
@@ -176,3 +178,33 @@
 #define BOSCH_BMI270_GYR_OSR4           0x00
 #define BOSCH_BMI270_GYR_OSR2           0x01
 #define BOSCH_BMI270_GYR_OSR1           0x02
+
+/** @brief One sample from the FIFO, accelerometer in micro m/s^2 and gyroscope in micro rad/s.
+*/
+struct bosch_bmi270_fifo_frame {
+    int32_t acc[3];
+    int32_t gyr[3];
+};
+
+/** @brief                  Start collecting accelerometer and gyroscope samples in the FIFO, or stop it.
+ *                          The accelerometer and gyroscope must be enabled. The gyroscope is set to the accelerometer
+ *                          sampling frequency, so every frame holds both, and set back when the FIFO is disabled.
+ *                          Sampling frequencies can't be changed while the FIFO is enabled.
+ *                          A SENSOR_TRIG_FIFO_WATERMARK trigger on SENSOR_CHAN_ACCEL_XYZ is called when
+ *                          watermark_frames are in the FIFO.
+ *  @param p_dev
+ *  @param watermark_frames Number of frames for the watermark interrupt, 0 disables the FIFO
+ *  @return                 0 when successful
+*/
+int bosch_bmi270_fifo_configure(const struct device *p_dev, uint16_t watermark_frames);
+
+/** @brief              Read the frames in the FIFO, oldest first.
+ *  @param p_dev
+ *  @param p_frames     Frames output
+ *  @param max_frames   Size of p_frames, frames that don't fit stay in the FIFO
+ *  @param p_period_us  Time between frames output
+ *  @param p_remaining  Number of frames left in the FIFO after the read output, newer than the frames read
+ *  @return             Number of frames read, or a negative error code
+*/
+int bosch_bmi270_fifo_read(const struct device *p_dev, struct bosch_bmi270_fifo_frame *p_frames, uint16_t max_frames,
+                           uint32_t *p_period_us, uint16_t *p_remaining);
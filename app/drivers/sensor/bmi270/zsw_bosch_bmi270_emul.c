@@ -0,0 +1,649 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2025 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Register level emulator of the BMI270, enough for the Bosch SensorAPI and the driver to run unmodified.
+ *
+ * Samples come from a trace file of CSV lines, empty lines and lines starting with '#' are skipped:
+ *
+ *   time_ms, ax, ay, az, gx, gy, gz[, steps[, activity[, gesture[, wakeup]]]]
+ *
+ * Acceleration is in m/s^2 and angular rate in rad/s. steps is the total step count, activity the
+ * BMI270 step activity (0 still, 1 walking, 2 running) and gesture the BMI270 wrist gesture, which
+ * is raised once when its line is reached. A non zero wakeup raises a wrist wake-up. Missing columns
+ * keep the previous step count and activity. Each line is held until the uptime reaches the time of
+ * the next one, so a trace replays in real time, or as fast as possible with the native_sim --no-rt
+ * option. At the end of the trace the last line is held, or the trace restarts with --bmi270_trace_loop.
+ *
+ * Without a trace the watch lies still and flat.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_sensor.h>
+#include <zephyr/drivers/i2c_emul.h>
+
+#ifdef CONFIG_GPIO_EMUL
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#endif
+
+#ifdef CONFIG_ARCH_POSIX
+#include "cmdline.h"
+#include "soc.h"
+#endif
+
+#include "private/zsw_bosch_bmi270_config.h"
+
+#define DT_DRV_COMPAT                       zswatch_bmi270
+
+#define BMI270_CHIP_ID_VALUE                0x24
+#define BMI270_CMD_SOFT_RESET               0xB6
+#define BMI270_INTERNAL_STATUS_INIT_OK      0x01
+#define BMI270_STATUS_DRDY                  0xD0
+#define BMI270_PWR_CTRL_GYR_EN              BIT(1)
+#define BMI270_PWR_CTRL_ACC_EN              BIT(2)
+#define BMI270_INT_MAP_DATA_FWM             (BIT(1) | BIT(5))
+
+#define BMI270_REG_INT_STATUS_1             0x1D
+#define BMI270_REG_FIFO_CONFIG_1            0x49
+
+#define BMI270_FIFO_CONFIG_1_HEADER_EN      BIT(4)
+#define BMI270_FIFO_CONFIG_1_ACC_EN         BIT(6)
+#define BMI270_FIFO_CONFIG_1_GYR_EN         BIT(7)
+#define BMI270_FIFO_HEADER_REGULAR          0x80
+#define BMI270_FIFO_HEADER_GYR              BIT(3)
+#define BMI270_FIFO_HEADER_ACC              BIT(2)
+#define BMI270_FIFO_EMPTY                   0x80
+#define BMI270_FIFO_SIZE                    2048
+
+#define BMI270_NUM_REGS                     0x80
+#define BMI270_NUM_FEAT_PAGES               8
+#define BMI270_FEAT_PAGE_SIZE               16
+#define BMI270_FEAT_OUT_STEP_COUNTER        0x00
+#define BMI270_FEAT_OUT_STEP_ACTIVITY       0x04
+#define BMI270_FEAT_OUT_WRIST_GESTURE       0x06
+
+#define BMI270_SENSORTIME_MASK              0xFFFFFF
+#define BMI270_DEFAULT_PERIOD_US            10000
+#define BMI270_TRACE_LINE_MAX               192
+
+#define STANDARD_GRAVITY                    9.80665f
+
+LOG_MODULE_REGISTER(zsw_bosch_bmi270_emul, CONFIG_SENSOR_LOG_LEVEL);
+
+struct bmi270_emul_sample {
+    int64_t time_ms;
+    float acc[3];
+    float gyr[3];
+    uint32_t steps;
+    uint8_t activity;
+    uint8_t gesture;
+    bool wakeup;
+};
+
+struct bmi270_emul_data {
+    struct k_mutex lock;
+    struct k_work_delayable dwork;
+    const struct emul *target;
+    uint8_t regs[BMI270_NUM_REGS];
+    uint8_t feat_pages[BMI270_NUM_FEAT_PAGES][BMI270_FEAT_PAGE_SIZE];
+    uint8_t current_register;
+    uint16_t int_status;
+    uint8_t fifo[BMI270_FIFO_SIZE];
+    uint16_t fifo_length;
+    struct bmi270_emul_sample sample;
+#ifdef CONFIG_ZSW_BMI270_EMUL_TRACE
+    FILE *trace;
+    struct bmi270_emul_sample next;
+    bool next_valid;
+    int64_t trace_start_ms;
+    uint32_t step_offset;
+#endif
+};
+
+struct bmi270_emul_cfg {
+    struct gpio_dt_spec int_gpio;
+};
+
+#ifdef CONFIG_ZSW_BMI270_EMUL_TRACE
+static char *trace_path;
+static bool trace_loop;
+
+/* Reads the next line into data->next, the step count and activity default to the previous line */
+static bool bmi270_emul_trace_read(struct bmi270_emul_data *data)
+{
+    struct bmi270_emul_sample *next = &data->next;
+    char line[BMI270_TRACE_LINE_MAX];
+    unsigned int activity;
+    unsigned int gesture;
+    unsigned int wakeup;
+    long long time_ms;
+    int num;
+
+    while (fgets(line, sizeof(line), data->trace)) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        activity = next->activity;
+        gesture = 0;
+        wakeup = 0;
+        num = sscanf(line, "%lld ,%f ,%f ,%f ,%f ,%f ,%f ,%u ,%u ,%u ,%u", &time_ms, &next->acc[0], &next->acc[1],
+                     &next->acc[2], &next->gyr[0], &next->gyr[1], &next->gyr[2], &next->steps, &activity, &gesture,
+                     &wakeup);
+        if (num < 7) {
+            LOG_WRN("Skipping trace line: %s", line);
+            continue;
+        }
+        next->time_ms = time_ms;
+        next->activity = activity;
+        next->gesture = gesture;
+        next->wakeup = wakeup != 0;
+
+        return true;
+    }
+
+    return false;
+}
+
+static void bmi270_emul_trace_open(struct bmi270_emul_data *data)
+{
+    const char *path = trace_path ? trace_path : CONFIG_ZSW_BMI270_EMUL_TRACE_FILE;
+
+    if (strlen(path) == 0) {
+        return;
+    }
+
+    data->trace = fopen(path, "r");
+    if (data->trace == NULL) {
+        LOG_ERR("Failed to open trace %s", path);
+        return;
+    }
+
+    data->trace_start_ms = k_uptime_get();
+    data->next_valid = bmi270_emul_trace_read(data);
+    LOG_INF("Replaying trace %s", path);
+}
+
+/* Returns true if a new trace line was reached */
+static bool bmi270_emul_trace_advance(struct bmi270_emul_data *data)
+{
+    int64_t elapsed_ms;
+    bool new_line = false;
+
+    if (data->trace == NULL) {
+        return false;
+    }
+
+    elapsed_ms = k_uptime_get() - data->trace_start_ms;
+    while (data->next_valid && data->next.time_ms <= elapsed_ms) {
+        data->sample = data->next;
+        data->sample.steps += data->step_offset;
+        data->next_valid = bmi270_emul_trace_read(data);
+        new_line = true;
+
+        if (!data->next_valid && trace_loop && data->sample.time_ms > 0) {
+            // Step counts of the trace are totals, keep counting from where the last pass ended
+            data->step_offset = data->sample.steps;
+            data->trace_start_ms += data->sample.time_ms;
+            elapsed_ms -= data->sample.time_ms;
+            rewind(data->trace);
+            data->next_valid = bmi270_emul_trace_read(data);
+        }
+    }
+
+    return new_line;
+}
+#endif /* CONFIG_ZSW_BMI270_EMUL_TRACE */
+
+/* Sample period of an ACC_CONF or GYR_CONF value, 0 if its ODR is invalid */
+static uint32_t bmi270_emul_odr_period_us(uint8_t conf, uint8_t max_odr)
+{
+    uint8_t odr = conf & 0x0F;
+
+    if (odr == 0 || odr > max_odr) {
+        return 0;
+    }
+
+    // ODR n is 25 Hz * 2^(n - 6), i.e. 0x0C is 1600 Hz
+    return 2560000U >> odr;
+}
+
+/* Samples are made at the rate of the faster enabled sensor */
+static uint32_t bmi270_emul_period_us(struct bmi270_emul_data *data)
+{
+    uint8_t pwr_ctrl = data->regs[BOSCH_BMI270_REG_PWR_CTRL];
+    uint32_t acc_us = 0;
+    uint32_t gyr_us = 0;
+
+    if (pwr_ctrl & BMI270_PWR_CTRL_ACC_EN) {
+        acc_us = bmi270_emul_odr_period_us(data->regs[BOSCH_BMI270_REG_ACC_CONF], 0x0C);
+    }
+    if (pwr_ctrl & BMI270_PWR_CTRL_GYR_EN) {
+        gyr_us = bmi270_emul_odr_period_us(data->regs[BOSCH_BMI270_REG_GYR_CONF], 0x0D);
+    }
+
+    if (acc_us != 0 && gyr_us != 0) {
+        return MIN(acc_us, gyr_us);
+    }
+    if (acc_us != 0 || gyr_us != 0) {
+        return acc_us != 0 ? acc_us : gyr_us;
+    }
+
+    // Only the features run with both sensors off
+    return BMI270_DEFAULT_PERIOD_US;
+}
+
+static int16_t bmi270_emul_to_raw(float value, float full_scale)
+{
+    float raw = roundf(value * INT16_MAX / full_scale);
+
+    return (int16_t)CLAMP(raw, INT16_MIN, INT16_MAX);
+}
+
+static void bmi270_emul_update_data(struct bmi270_emul_data *data)
+{
+    uint8_t *acc = &data->regs[BOSCH_BMI270_REG_ACC_X_LSB];
+    uint8_t *gyr = &data->regs[BOSCH_BMI270_REG_GYR_X_LSB];
+    float acc_range = (2 << (data->regs[BOSCH_BMI270_REG_ACC_RANGE] & 0x03)) * STANDARD_GRAVITY;
+    float gyr_range = (2000 >> MIN(data->regs[BOSCH_BMI270_REG_GYR_RANGE] & 0x07, 4)) * (float)M_PI / 180.0f;
+    uint32_t sensortime = k_ticks_to_us_floor64(k_uptime_ticks()) * 16 / 625;
+
+    for (int i = 0; i < 3; i++) {
+        sys_put_le16(bmi270_emul_to_raw(data->sample.acc[i], acc_range), &acc[i * 2]);
+        sys_put_le16(bmi270_emul_to_raw(data->sample.gyr[i], gyr_range), &gyr[i * 2]);
+    }
+
+    sys_put_le24(sensortime & BMI270_SENSORTIME_MASK, &data->regs[BOSCH_BMI270_REG_SENSORTIME_0]);
+    data->regs[BOSCH_BMI270_REG_STATUS] = BMI270_STATUS_DRDY;
+}
+
+static void bmi270_emul_update_features(struct bmi270_emul_data *data, bool new_line)
+{
+    uint8_t *out = data->feat_pages[0];
+    uint32_t steps = sys_get_le32(&out[BMI270_FEAT_OUT_STEP_COUNTER]);
+
+    if (data->sample.steps != steps) {
+        sys_put_le32(data->sample.steps, &out[BMI270_FEAT_OUT_STEP_COUNTER]);
+        sys_put_le16(data->sample.steps, &data->regs[BOSCH_BMI270_REG_SC_OUT_0]);
+        data->int_status |= BMI270_STEP_CNT_STATUS_MASK;
+    }
+
+    if (data->sample.activity != out[BMI270_FEAT_OUT_STEP_ACTIVITY]) {
+        out[BMI270_FEAT_OUT_STEP_ACTIVITY] = data->sample.activity;
+        data->int_status |= BMI270_STEP_ACT_STATUS_MASK;
+    }
+
+    if (new_line && data->sample.gesture != 0) {
+        out[BMI270_FEAT_OUT_WRIST_GESTURE] = data->sample.gesture;
+        data->int_status |= BMI270_WRIST_GEST_STATUS_MASK;
+    }
+
+    if (new_line && data->sample.wakeup) {
+        data->int_status |= BMI270_WRIST_WAKE_UP_STATUS_MASK;
+    }
+
+    data->regs[BOSCH_BMI270_REG_WR_GEST_ACT] = (out[BMI270_FEAT_OUT_WRIST_GESTURE] & 0x07) |
+                                              ((out[BMI270_FEAT_OUT_STEP_ACTIVITY] & 0x03) << 3);
+}
+
+static void bmi270_emul_fifo_set_length(struct bmi270_emul_data *data, uint16_t length)
+{
+    data->fifo_length = length;
+    sys_put_le16(length, &data->regs[BOSCH_BMI270_REG_FIFO_LENGTH_0]);
+}
+
+static void bmi270_emul_fifo_push(struct bmi270_emul_data *data)
+{
+    uint8_t config = data->regs[BMI270_REG_FIFO_CONFIG_1];
+    uint16_t watermark = sys_get_le16(&data->regs[BOSCH_BMI270_REG_FIFO_WTM_0]);
+    uint8_t frame[13];
+    size_t len = 0;
+
+    if (!(config & (BMI270_FIFO_CONFIG_1_ACC_EN | BMI270_FIFO_CONFIG_1_GYR_EN))) {
+        return;
+    }
+
+    if (config & BMI270_FIFO_CONFIG_1_HEADER_EN) {
+        frame[len++] = BMI270_FIFO_HEADER_REGULAR |
+                       ((config & BMI270_FIFO_CONFIG_1_GYR_EN) ? BMI270_FIFO_HEADER_GYR : 0) |
+                       ((config & BMI270_FIFO_CONFIG_1_ACC_EN) ? BMI270_FIFO_HEADER_ACC : 0);
+    }
+    if (config & BMI270_FIFO_CONFIG_1_GYR_EN) {
+        memcpy(&frame[len], &data->regs[BOSCH_BMI270_REG_GYR_X_LSB], 6);
+        len += 6;
+    }
+    if (config & BMI270_FIFO_CONFIG_1_ACC_EN) {
+        memcpy(&frame[len], &data->regs[BOSCH_BMI270_REG_ACC_X_LSB], 6);
+        len += 6;
+    }
+
+    // Like the FIFO in stream mode, drop the oldest frame when full
+    if (data->fifo_length + len > sizeof(data->fifo)) {
+        memmove(data->fifo, &data->fifo[len], data->fifo_length - len);
+        data->fifo_length -= len;
+    }
+    memcpy(&data->fifo[data->fifo_length], frame, len);
+    bmi270_emul_fifo_set_length(data, data->fifo_length + len);
+
+    if (watermark > 0 && data->fifo_length >= watermark) {
+        data->int_status |= BMI2_FWM_INT_STATUS_MASK;
+    }
+}
+
+static uint8_t bmi270_emul_fifo_pop(struct bmi270_emul_data *data)
+{
+    uint8_t value;
+
+    if (data->fifo_length == 0) {
+        return BMI270_FIFO_EMPTY;
+    }
+
+    value = data->fifo[0];
+    memmove(data->fifo, &data->fifo[1], data->fifo_length - 1);
+    bmi270_emul_fifo_set_length(data, data->fifo_length - 1);
+
+    return value;
+}
+
+static bool bmi270_emul_int_mapped(struct bmi270_emul_data *data, uint16_t status)
+{
+    uint8_t feat_map = data->regs[BOSCH_BMI270_REG_INT1_MAP_FEAT] | data->regs[BOSCH_BMI270_REG_INT2_MAP_FEAT];
+
+    if ((status & 0xFF) & feat_map) {
+        return true;
+    }
+
+    return (status & BMI2_FWM_INT_STATUS_MASK) &&
+           (data->regs[BOSCH_BMI270_REG_INT_MAP_DATA] & BMI270_INT_MAP_DATA_FWM);
+}
+
+static void bmi270_emul_raise_int(const struct emul *target)
+{
+#ifdef CONFIG_GPIO_EMUL
+    const struct bmi270_emul_cfg *cfg = target->cfg;
+
+    if (cfg->int_gpio.port == NULL) {
+        return;
+    }
+
+    // The driver triggers on the rising edge
+    gpio_emul_input_set(cfg->int_gpio.port, cfg->int_gpio.pin, 1);
+    gpio_emul_input_set(cfg->int_gpio.port, cfg->int_gpio.pin, 0);
+#endif
+}
+
+static void bmi270_emul_worker(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct bmi270_emul_data *data = CONTAINER_OF(dwork, struct bmi270_emul_data, dwork);
+    uint16_t prev_status;
+    bool new_line = false;
+    bool raise;
+
+    k_mutex_lock(&data->lock, K_FOREVER);
+    prev_status = data->int_status;
+
+#ifdef CONFIG_ZSW_BMI270_EMUL_TRACE
+    new_line = bmi270_emul_trace_advance(data);
+#endif
+    bmi270_emul_update_features(data, new_line);
+
+    if (data->regs[BOSCH_BMI270_REG_PWR_CTRL] & (BMI270_PWR_CTRL_ACC_EN | BMI270_PWR_CTRL_GYR_EN)) {
+        bmi270_emul_update_data(data);
+        bmi270_emul_fifo_push(data);
+    }
+
+    raise = bmi270_emul_int_mapped(data, data->int_status & ~prev_status);
+    k_work_schedule(dwork, K_USEC(bmi270_emul_period_us(data)));
+    k_mutex_unlock(&data->lock);
+
+    if (raise) {
+        bmi270_emul_raise_int(data->target);
+    }
+}
+
+static void bmi270_emul_reset(struct bmi270_emul_data *data)
+{
+    memset(data->regs, 0, sizeof(data->regs));
+    memset(data->feat_pages, 0, sizeof(data->feat_pages));
+
+    /* Apply the reset values from the datasheet */
+    data->regs[BOSCH_BMI270_REG_CHIP_ID] = BMI270_CHIP_ID_VALUE;
+    data->regs[BOSCH_BMI270_REG_STATUS] = BMI270_STATUS_DRDY;
+    data->regs[BOSCH_BMI270_REG_ACC_CONF] = 0xA8;
+    data->regs[BOSCH_BMI270_REG_ACC_RANGE] = 0x02;
+    data->regs[BOSCH_BMI270_REG_GYR_CONF] = 0xA9;
+    data->regs[BOSCH_BMI270_REG_FIFO_WTM_0] = 0x00;
+    data->regs[BOSCH_BMI270_REG_FIFO_WTM_0 + 1] = 0x02;
+    data->regs[BOSCH_BMI270_REG_FIFO_CONFIG_0] = 0x02;
+    data->regs[BMI270_REG_FIFO_CONFIG_1] = BMI270_FIFO_CONFIG_1_HEADER_EN;
+    data->regs[BOSCH_BMI270_REG_PWR_CONF] = 0x03;
+
+    data->int_status = 0;
+    bmi270_emul_fifo_set_length(data, 0);
+}
+
+static uint8_t bmi270_emul_read_byte(struct bmi270_emul_data *data, uint8_t reg)
+{
+    uint8_t value;
+
+    if (reg >= BOSCH_BMI270_REG_FEATURES_0 && reg < BOSCH_BMI270_REG_FEATURES_0 + BMI270_FEAT_PAGE_SIZE) {
+        return data->feat_pages[data->regs[BOSCH_BMI270_REG_FEAT_PAGE] & 0x07][reg - BOSCH_BMI270_REG_FEATURES_0];
+    }
+
+    switch (reg) {
+        case BOSCH_BMI270_REG_INT_STATUS_0:
+            // Interrupt status is cleared on read
+            value = data->int_status & 0xFF;
+            data->int_status &= 0xFF00;
+            return value;
+        case BMI270_REG_INT_STATUS_1:
+            value = data->int_status >> 8;
+            data->int_status &= 0x00FF;
+            return value;
+        default:
+            return reg < BMI270_NUM_REGS ? data->regs[reg] : 0;
+    }
+}
+
+static void bmi270_emul_reg_read(struct bmi270_emul_data *data, uint8_t reg, uint8_t *out, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        // A burst read of the FIFO data register streams the FIFO instead of reading the following registers
+        if (reg == BOSCH_BMI270_REG_FIFO_DATA) {
+            out[i] = bmi270_emul_fifo_pop(data);
+        } else {
+            out[i] = bmi270_emul_read_byte(data, reg + i);
+        }
+    }
+}
+
+static void bmi270_emul_write_byte(struct bmi270_emul_data *data, uint8_t reg, uint8_t value)
+{
+    if (reg >= BOSCH_BMI270_REG_FEATURES_0 && reg < BOSCH_BMI270_REG_FEATURES_0 + BMI270_FEAT_PAGE_SIZE) {
+        data->feat_pages[data->regs[BOSCH_BMI270_REG_FEAT_PAGE] & 0x07][reg - BOSCH_BMI270_REG_FEATURES_0] = value;
+        return;
+    }
+
+    switch (reg) {
+        case BOSCH_BMI270_REG_CMD:
+            if (value == BMI270_CMD_SOFT_RESET) {
+                LOG_DBG("Soft reset");
+                bmi270_emul_reset(data);
+            } else if (value == BOSCH_BMI270_CMD_FIFO_FLUSH) {
+                bmi270_emul_fifo_set_length(data, 0);
+            }
+            break;
+        case BOSCH_BMI270_REG_INIT_CTRL:
+            data->regs[reg] = value;
+            // The config file is not run, report it as loaded as soon as the upload ends
+            if (value & 0x01) {
+                data->regs[BOSCH_BMI270_REG_INTERNAL_STATUS] = BMI270_INTERNAL_STATUS_INIT_OK;
+            }
+            break;
+        default:
+            if (reg < BMI270_NUM_REGS) {
+                data->regs[reg] = value;
+            }
+            break;
+    }
+}
+
+static void bmi270_emul_reg_write(struct bmi270_emul_data *data, uint8_t reg, const uint8_t *in, uint32_t length)
+{
+    // The config file upload is not needed by the emulator
+    if (reg == BOSCH_BMI270_REG_INIT_DATA) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        bmi270_emul_write_byte(data, reg + i, in[i]);
+    }
+}
+
+static int bmi270_emul_transfer_i2c(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr)
+{
+    struct bmi270_emul_data *data = target->data;
+
+    k_mutex_lock(&data->lock, K_FOREVER);
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+
+        if (msg->flags & I2C_MSG_READ) {
+            bmi270_emul_reg_read(data, data->current_register, msg->buf, msg->len);
+        } else if (i == 0) {
+            // The register address, possibly followed by data in the same message
+            data->current_register = msg->buf[0];
+            if (msg->len > 1) {
+                bmi270_emul_reg_write(data, data->current_register, &msg->buf[1], msg->len - 1);
+            }
+        } else {
+            bmi270_emul_reg_write(data, data->current_register, msg->buf, msg->len);
+        }
+    }
+    k_mutex_unlock(&data->lock);
+
+    return 0;
+}
+
+static int bmi270_emul_set_channel(const struct emul *target, struct sensor_chan_spec ch, const q31_t *value,
+                                   int8_t shift)
+{
+    struct bmi270_emul_data *data = target->data;
+    float fvalue = ldexpf((float)*value, shift - 31);
+    int ret = 0;
+
+    k_mutex_lock(&data->lock, K_FOREVER);
+    switch (ch.chan_type) {
+        case SENSOR_CHAN_ACCEL_X:
+        case SENSOR_CHAN_ACCEL_Y:
+        case SENSOR_CHAN_ACCEL_Z:
+            data->sample.acc[ch.chan_type - SENSOR_CHAN_ACCEL_X] = fvalue;
+            break;
+        case SENSOR_CHAN_GYRO_X:
+        case SENSOR_CHAN_GYRO_Y:
+        case SENSOR_CHAN_GYRO_Z:
+            data->sample.gyr[ch.chan_type - SENSOR_CHAN_GYRO_X] = fvalue;
+            break;
+        default:
+            ret = -ENOTSUP;
+            break;
+    }
+    k_mutex_unlock(&data->lock);
+
+    return ret;
+}
+
+static int bmi270_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct bmi270_emul_data *data = target->data;
+
+    data->target = target;
+    k_mutex_init(&data->lock);
+    bmi270_emul_reset(data);
+
+    /* Lying still and flat until the trace says otherwise */
+    data->sample.acc[2] = STANDARD_GRAVITY;
+
+#ifdef CONFIG_ZSW_BMI270_EMUL_TRACE
+    bmi270_emul_trace_open(data);
+#endif
+
+    k_work_init_delayable(&data->dwork, bmi270_emul_worker);
+    k_work_schedule(&data->dwork, K_USEC(bmi270_emul_period_us(data)));
+
+    LOG_INF("Initialization done");
+
+    return 0;
+}
+
+#ifdef CONFIG_ZSW_BMI270_EMUL_TRACE
+static void bmi270_emul_options(void)
+{
+    static struct args_struct_t options[] = {
+        {
+            .option = "bmi270_trace",
+            .name = "path",
+            .type = 's',
+            .dest = (void *) &trace_path,
+            .descript = "CSV trace of accelerometer, gyroscope, step and gesture data replayed by the BMI270 "
+                        "emulator, overrides CONFIG_ZSW_BMI270_EMUL_TRACE_FILE"
+        },
+        {
+            .is_switch = true,
+            .option = "bmi270_trace_loop",
+            .type = 'b',
+            .dest = (void *) &trace_loop,
+            .descript = "Restart the BMI270 trace when it ends instead of holding the last line"
+        },
+        ARG_TABLE_ENDMARKER
+    };
+
+    native_add_command_line_opts(options);
+}
+
+NATIVE_TASK(bmi270_emul_options, PRE_BOOT_1, 1);
+#endif
+
+static struct i2c_emul_api bmi270_emul_api_i2c = {
+    .transfer = bmi270_emul_transfer_i2c,
+};
+
+static const struct emul_sensor_driver_api bmi270_emul_sensor_driver_api = {
+    .set_channel = bmi270_emul_set_channel,
+};
+
+#define BMI270(inst)                                                                                            \
+    static struct bmi270_emul_data bmi270_emul_data_##inst;                                                     \
+    static const struct bmi270_emul_cfg bmi270_emul_cfg_##inst = {                                              \
+        .int_gpio = GPIO_DT_SPEC_INST_GET_OR(inst, int_gpios, {0}),                                             \
+    };                                                                                                          \
+    EMUL_DT_INST_DEFINE(inst, bmi270_emul_init, &bmi270_emul_data_##inst, &bmi270_emul_cfg_##inst,              \
+                        &bmi270_emul_api_i2c, &bmi270_emul_sensor_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(BMI270)
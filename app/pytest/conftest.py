@@ -1,5 +1,7 @@
 import os
 import pytest
+import shutil
+import subprocess
 import utils
 import logging
 import yaml
@@ -7,6 +9,8 @@ import serial
 import time
 from ppk2_helper import setup_ppk2
 
+ZEPHYR_HOST_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools", "zephyr_host")
+
 logging.basicConfig(level=logging.INFO)
 
 
@@ -19,6 +23,18 @@ def ppk2_instance(device_config, prepare_device):
     return device_config["ppk2"]
 
 
+@pytest.fixture(scope="session")
+def zephyr_host(tmp_path_factory):
+    """Builds the host programs of app/tools/zephyr_host once, returns their build directory"""
+    if shutil.which("cmake") is None:
+        pytest.skip("cmake is needed to build app/tools/zephyr_host")
+
+    build = tmp_path_factory.mktemp("zephyr_host")
+    subprocess.run(["cmake", "-S", ZEPHYR_HOST_DIR, "-B", str(build)], check=True, capture_output=True)
+    subprocess.run(["cmake", "--build", str(build)], check=True, capture_output=True)
+    return build
+
+
 def get_all_devices():
     base_dir = os.path.dirname(os.path.abspath(__file__))
     local_path = os.path.join(base_dir, "devices_local.yaml")
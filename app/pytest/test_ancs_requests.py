@@ -0,0 +1,66 @@
+"""
+ANCS attribute request test on the host.
+
+Runs ancs_host from app/tools/zephyr_host, which runs app/src/ble/ble_ancs.c
+against a simulated iPhone, and checks that a burst of notifications, as sent
+by iOS on reconnect, reaches the app with the right attributes. Once with a
+response split over many small notifications, and once with a response that
+is lost and has to time out.
+
+The NCS ANCS client is replaced by a model in zephyr_shim.h, written from the
+client of NCS v3.3.0-preview1, the sdk-nrf revision in app/west.yml. Check the
+model against the NCS sources when that revision changes.
+
+Usage::
+
+    pytest test_ancs_requests.py -s
+"""
+
+import subprocess
+
+import pytest
+
+NUM_NOTIFICATIONS = 12  # fits CONFIG_ZSW_ANCS_REQUEST_QUEUE_SIZE with the app name requests
+
+
+# ── Override conftest autouse fixtures ────────────────────────
+# No device is used, the ANCS client runs in a host process.
+
+@pytest.fixture(autouse=True)
+def prepare_device():
+    yield
+
+
+@pytest.fixture(autouse=True)
+def reset_device():
+    yield
+
+
+@pytest.fixture(scope="function", autouse=True)
+def uart_logs():
+    yield None
+
+
+@pytest.mark.linux_only
+class TestAncsRequests:
+    @pytest.fixture
+    def ancs_host(self, zephyr_host):
+        return str(zephyr_host / "ancs_host")
+
+    def _run(self, ancs_host, *args):
+        result = subprocess.run([ancs_host, "-n", str(NUM_NOTIFICATIONS), *args], capture_output=True, text=True)
+        print(result.stdout)
+        assert result.returncode == 0, result.stdout + result.stderr
+        assert f"Delivered {NUM_NOTIFICATIONS}/{NUM_NOTIFICATIONS} notifications, 0 wrong" in result.stdout
+        return result
+
+    @pytest.mark.parametrize("mtu", [23, 185])
+    def test_burst(self, ancs_host, mtu):
+        """Every notification of a burst is delivered once, with its own attributes."""
+        result = self._run(ancs_host, "-m", str(mtu))
+        assert "timed out" not in result.stderr
+
+    def test_lost_response(self, ancs_host):
+        """A lost response times out and is requested again, without stalling the others."""
+        result = self._run(ancs_host, "-l", "3")
+        assert "Attribute request timed out, sending it again" in result.stderr
@@ -0,0 +1,81 @@
+"""
+L2CAP file server protocol test on the host.
+
+Runs l2cap_fs_host from app/tools/zephyr_host, which runs
+app/src/ble/zsw_l2cap_file_server.c on a Unix socket, and runs the test command
+of app/scripts/l2cap_file_transfer.py against it: read and write, a CRC-failed
+window sent again, a NACKed window, resuming reads and writes after a
+disconnect, an already complete write and an empty file.
+
+The channel is the Zephyr shim of app/tools/zephyr_host, not the Zephyr host
+stack. TestNativeSimBLE::test_l2cap_file_transfer in test_native_app.py runs
+the same client against native_sim, when two Bluetooth adapters are available.
+
+Usage::
+
+    pytest test_l2cap_file_server.py -s
+"""
+
+import os
+import subprocess
+
+import pytest
+
+APP_DIR = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+CLIENT = os.path.join(APP_DIR, "scripts", "l2cap_file_transfer.py")
+TEST_TIMEOUT = 60  # seconds
+
+
+# ── Override conftest autouse fixtures ────────────────────────
+# No device is used, the server runs in a host process.
+
+@pytest.fixture(autouse=True)
+def prepare_device():
+    yield
+
+
+@pytest.fixture(autouse=True)
+def reset_device():
+    yield
+
+
+@pytest.fixture(scope="function", autouse=True)
+def uart_logs():
+    yield None
+
+
+@pytest.mark.linux_only
+class TestL2capFileServer:
+    @pytest.fixture
+    def server(self, zephyr_host, tmp_path):
+        root = tmp_path / "root"
+        (root / "user").mkdir(parents=True)
+        sock = str(tmp_path / "l2cap.sock")
+        proc = subprocess.Popen(
+            [str(zephyr_host / "l2cap_fs_host"), sock, str(root)],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            text=True,
+        )
+        line = proc.stdout.readline()
+        if not line.startswith("Listening"):
+            proc.kill()
+            pytest.fail(f"l2cap_fs_host failed to start: {line}{proc.stdout.read()}")
+
+        yield sock
+
+        proc.kill()
+        print(proc.communicate()[0])
+
+    def test_transfers(self, server):
+        """Runs every transfer, retry and resume case of the host client."""
+        result = subprocess.run(
+            ["python3", CLIENT, "--unix", server, "test"],
+            capture_output=True,
+            text=True,
+            timeout=TEST_TIMEOUT,
+        )
+        print(result.stdout)
+        assert result.returncode == 0, result.stderr
+        # One corrupted write window and one NACKed read window
+        assert "All transfers OK, 2 windows retried" in result.stdout
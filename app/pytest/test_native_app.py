@@ -1,10 +1,13 @@
 """
 Native simulator tests — boot verification, app testing, and BLE integration.
 
-Tests are organized into two classes:
+Tests are organized into three classes:
 
   TestNativeSim     — Core tests (boot, app launch/close, screenshot). No BLE.
+  TestNativeSimIMU  — Replays a recorded IMU trace through the BMI270 emulator.
   TestNativeSimBLE  — BLE boot verification. Requires BLEAK_ADAPTER env var.
+                      The L2CAP file transfer test also needs a second adapter
+                      in L2CAP_CLIENT_ADAPTER, to connect to the watch from BlueZ.
 
 Usage examples::
 
@@ -20,9 +23,15 @@ Usage examples::
     # All non-BLE tests
     pytest test_native_app.py::TestNativeSim -s --app Calc
 
+    # IMU trace replay (traces/bmi270_walk_and_raise.csv)
+    pytest test_native_app.py::TestNativeSimIMU -s
+
     # BLE boot verification (requires BLEAK_ADAPTER env var)
     BLEAK_ADAPTER=hci0 pytest test_native_app.py::TestNativeSimBLE -s
 
+    # L2CAP file transfer through the Zephyr host stack, from a second adapter
+    BLEAK_ADAPTER=hci0 L2CAP_CLIENT_ADAPTER=hci1 pytest test_native_app.py::TestNativeSimBLE -s
+
 Options:
     --app NAME          Application name to launch (e.g. "Calculator")
     --exe-path PATH     Path to zephyr.exe (auto-detected if not provided)
@@ -30,6 +39,7 @@ Options:
 """
 
 import os
+import re
 import subprocess
 import time
 
@@ -40,6 +50,13 @@ BOOT_TIMEOUT = 15  # seconds
 # Boot marker: fired by zsw_ui_controller after the watchface is up.
 BOOT_MARKER = "UI Controller initialized"
 
+IMU_TRACE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "traces", "bmi270_walk_and_raise.csv")
+IMU_TRACE_DURATION = 10  # seconds, last timestamp in IMU_TRACE
+IMU_TRACE_STEPS = 10  # step counter at the end of IMU_TRACE
+
+L2CAP_CLIENT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "scripts", "l2cap_file_transfer.py")
+L2CAP_TEST_TIMEOUT = 120  # seconds
+
 # ── Override conftest autouse fixtures ────────────────────────
 # The global conftest.py has autouse fixtures (prepare_device, reset_device,
 # uart_logs) that depend on device_config, which triggers device parametrization.
@@ -177,6 +194,55 @@ class TestNativeSim:
 
 # ── BLE tests ────────────────────────────────────────────────
 
+@pytest.mark.linux_only
+class TestNativeSimIMU:
+    """Replays IMU_TRACE through the BMI270 emulator. No BLE.
+
+    Reads the received events with "imu stats", enabled by CONFIG_ZSW_IMU_STATS in native_sim_64.conf.
+    """
+
+    @pytest.fixture(scope="class")
+    def sim(self, request):
+        exe = _find_exe(request)
+        if not exe:
+            pytest.skip("No native_sim executable found (build or provide --exe-path)")
+
+        device = NativeSimDevice(exe_path=exe, extra_args=[f"--bmi270_trace={IMU_TRACE}"])
+        device.start()
+
+        booted = device.wait_for_log(BOOT_MARKER, timeout=BOOT_TIMEOUT)
+        if not booted:
+            logs = device.get_logs()
+            device.stop()
+            pytest.fail(
+                f"native_sim failed to boot within {BOOT_TIMEOUT}s.\n"
+                f"Last 30 log lines:\n" + "\n".join(logs.splitlines()[-30:])
+            )
+
+        yield device
+        device.stop()
+
+    def test_trace_replays(self, sim):
+        """Verify the trace is replayed and its steps and wrist gesture reach zsw_imu."""
+        assert f"Replaying trace {IMU_TRACE}" in sim.get_logs()
+
+        time.sleep(IMU_TRACE_DURATION + 1)
+
+        logs = sim.get_logs()
+        assert "Skipping trace line" not in logs
+        assert not sim.has_crash()
+
+        sim.shell_command("imu stats")
+        time.sleep(0.5)
+        output = sim.get_shell_output()
+        print(f"\n=== Shell output ===\n{output}")
+
+        # The driver reports one event per interrupt, so the wake-up raised together with
+        # the gesture at the end of the trace is delivered as the gesture.
+        assert re.search(rf"Steps:\s+{IMU_TRACE_STEPS} \(", output), "Walked steps did not reach zsw_imu"
+        assert re.search(r"Gestures:\s+[1-9]\d*, last pivot_up", output), "Wrist raise did not reach zsw_imu"
+
+
 @pytest.mark.linux_only
 class TestNativeSimBLE:
     """BLE boot verification — requires BLEAK_ADAPTER env var."""
@@ -233,3 +299,29 @@ class TestNativeSimBLE:
         assert "Start Apple Media Service" in logs
         assert "Disable Pairable" in logs
         assert not sim.has_crash()
+
+    def test_l2cap_file_transfer(self, sim):
+        """Runs every transfer, retry and resume case of the L2CAP file server over the Zephyr host stack."""
+        client_adapter = os.environ.get("L2CAP_CLIENT_ADAPTER")
+        if not client_adapter:
+            pytest.skip("L2CAP test requires a second adapter in L2CAP_CLIENT_ADAPTER")
+
+        # Logged by the Zephyr host when Bluetooth is enabled
+        identity = re.search(r"Identity: ([0-9A-F:]{17}) \((public|random)\)", sim.get_logs())
+        assert identity, "No identity address in the logs"
+
+        # BLEAK_ADAPTER is down and owned by Zephyr, so BlueZ connects through the client adapter.
+        # Pairing is disabled in native_sim, the channel is opened without security.
+        subprocess.run(["sudo", "hciconfig", client_adapter, "up"], capture_output=True)
+        result = subprocess.run(
+            ["python3", L2CAP_CLIENT, "--address", identity.group(1), "--address-type", identity.group(2),
+             "--security", "low", "test"],
+            capture_output=True,
+            text=True,
+            timeout=L2CAP_TEST_TIMEOUT,
+        )
+        print(result.stdout)
+        assert result.returncode == 0, result.stderr
+        # One corrupted write window and one NACKed read window
+        assert "All transfers OK, 2 windows retried" in result.stdout
+        assert not sim.has_crash()
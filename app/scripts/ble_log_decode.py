@@ -0,0 +1,88 @@
+# Copyright (c) 2025 ZSWatch Project
+# SPDX-License-Identifier: Apache-2.0
+
+"""
+Print logs sent by the ZSWatch BLE log backend.
+
+Text logs arrive in <BLELOG></BLELOG> frames. Dictionary logs
+(CONFIG_ZSW_BLE_LOG_FORMAT_DICTIONARY) arrive base64 encoded in
+<BLELOGD></BLELOGD> frames and are decoded with Zephyr's dictionary log parser
+and build/app/zephyr/log_dictionary.json from the same build.
+"""
+
+import argparse
+import asyncio
+import base64
+import os
+import re
+import sys
+
+from bleak import BleakClient
+
+from zswatch_ble_control import UART_RX_CHAR_UUID, UART_TX_CHAR_UUID
+
+FRAME_RE = re.compile(rb"<(BLELOGD?)>(.*?)</\1>", re.DOTALL)
+
+
+def load_dictionary_parser(database_file):
+    zephyr_base = os.environ.get("ZEPHYR_BASE")
+    if zephyr_base is None:
+        sys.exit("ZEPHYR_BASE must be set to decode dictionary logs")
+    sys.path.insert(0, os.path.join(zephyr_base, "scripts", "logging", "dictionary"))
+
+    import dictionary_parser
+    from dictionary_parser.log_database import LogDatabase
+
+    database = LogDatabase.read_json_database(database_file)
+    if database is None:
+        sys.exit("Failed to read dictionary database " + database_file)
+    return dictionary_parser.get_parser(database)
+
+
+class FrameDecoder:
+    def __init__(self, log_parser):
+        self.log_parser = log_parser
+        self.buf = b""
+
+    def feed(self, data):
+        self.buf += data
+        end = 0
+        for match in FRAME_RE.finditer(self.buf):
+            end = match.end()
+            if match.group(1) == b"BLELOG":
+                sys.stdout.write(match.group(2).decode("utf-8", errors="replace"))
+            elif self.log_parser is not None:
+                # Frames always end between messages, so each one can be parsed on its own
+                self.log_parser.parse_log_data(base64.b64decode(match.group(2)))
+            else:
+                print("<dictionary log frame, no database given>")
+        # Keep data after the last frame, the next notification may complete it.
+        # Anything else on the NUS stream (Gadgetbridge messages) is ignored.
+        self.buf = self.buf[end:]
+        start = self.buf.find(b"<BLELOG")
+        self.buf = self.buf[start:] if start >= 0 else b""
+        sys.stdout.flush()
+
+
+async def run(address, decoder):
+    async with BleakClient(address, timeout=30.0) as client:
+        print("Connected to", address)
+        await client.start_notify(UART_TX_CHAR_UUID, lambda _, data: decoder.feed(bytes(data)))
+        await client.write_gatt_char(UART_RX_CHAR_UUID, b'GB({"t":"log","status":true})\n')
+        while client.is_connected:
+            await asyncio.sleep(1)
+    print("Disconnected")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Print logs from the ZSWatch BLE log backend.")
+    parser.add_argument("--address", required=True, help="Mac of the ZSWatch")
+    parser.add_argument(
+        "--database",
+        required=False,
+        help="log_dictionary.json from the build, needed for dictionary logs",
+    )
+    args = parser.parse_args()
+
+    log_parser = load_dictionary_parser(args.database) if args.database else None
+    asyncio.run(run(args.address, FrameDecoder(log_parser)))
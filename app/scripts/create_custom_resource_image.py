@@ -8,6 +8,24 @@ from struct import *
 MAX_FILE_NAME = 32
 FILE_TABLE_MAX_LEN = 32000
 TABLE_MAGIC = 0x0A0A0A0A
+
+# LVGL v9 binary image format, see lv_image_header_t and lv_image_compressed_t
+LV_IMAGE_HEADER_MAGIC = 0x19
+LV_IMAGE_HEADER_SIZE = 12
+LV_IMAGE_FLAGS_COMPRESSED = 0x0008
+LV_IMAGE_COMPRESS_RLE = 1
+LV_IMAGE_COMPRESS_LZ4 = 2
+LV_COLOR_FORMAT_BPP = {
+    0x12: 16,  # RGB565
+    0x14: 16,  # RGB565A8
+    0x0F: 24,  # RGB888
+    0x10: 32,  # ARGB8888
+    0x11: 32,  # XRGB8888
+    0x06: 8,  # L8
+    0x0E: 8,  # A8
+}
+RLE_MAX_COUNT = 127
+RLE_THRESHOLD = 16
 """
 magic_number:uint32
 header_len:uint32
@@ -22,12 +40,101 @@ len:uint32
 ...
 [file data]
 table_magic:uint32
+
+File headers are sorted by filename (byte order).
 """
 
 
-def create_custom_raw_fs_image(img_filename, source_dir, block_size=4096):
+def rle_compress(data, blk_size):
+    """Same encoding as LVGL's LVGLImage.py, decoded by lv_rle_decompress()."""
+    # The decoder tolerates the last block overshooting the output, pad to whole blocks.
+    data = bytes(data) + bytes((-len(data)) % blk_size)
+    blocks = [data[i : i + blk_size] for i in range(0, len(data), blk_size)]
+    out = bytearray()
+    index = 0
+    while index < len(blocks):
+        repeat = 1
+        while (
+            index + repeat < len(blocks)
+            and blocks[index + repeat] == blocks[index]
+            and repeat < RLE_MAX_COUNT
+        ):
+            repeat += 1
+        if repeat >= RLE_THRESHOLD:
+            out.append(repeat)
+            out += blocks[index]
+            index += repeat
+            continue
+
+        # Copy blocks literally until the next long enough run starts.
+        literal = 0
+        run = 1
+        while index + literal < len(blocks) and literal < RLE_MAX_COUNT:
+            if (
+                literal > 0
+                and blocks[index + literal] == blocks[index + literal - 1]
+            ):
+                run += 1
+                if run >= RLE_THRESHOLD:
+                    literal -= run - 1
+                    break
+            else:
+                run = 1
+            literal += 1
+        out.append(0x80 | literal)
+        out += b"".join(blocks[index : index + literal])
+        index += literal
+    return bytes(out)
+
+
+def compress_lvgl_image(image, method, max_size):
+    """Compress the pixel data of an LVGL v9 .bin image. Returns the image unchanged if not worth it."""
+    if len(image) <= LV_IMAGE_HEADER_SIZE or image[0] != LV_IMAGE_HEADER_MAGIC:
+        return image
+    magic, cf, flags, w, h, stride, reserved = unpack(
+        "<BBHHHHH", image[:LV_IMAGE_HEADER_SIZE]
+    )
+    data = image[LV_IMAGE_HEADER_SIZE:]
+    # Compressed images are decoded to RAM as a whole, instead of read line by line.
+    if flags & LV_IMAGE_FLAGS_COMPRESSED or len(data) > max_size:
+        return image
+
+    if method == "rle":
+        if cf not in LV_COLOR_FORMAT_BPP:
+            return image
+        compressed = rle_compress(data, (LV_COLOR_FORMAT_BPP[cf] + 7) // 8)
+        method_id = LV_IMAGE_COMPRESS_RLE
+    elif method == "lz4":
+        import lz4.block
+
+        compressed = lz4.block.compress(data, store_size=False)
+        method_id = LV_IMAGE_COMPRESS_LZ4
+    else:
+        return image
+
+    # Not worth decompressing on every decode for small savings.
+    if len(compressed) + LV_IMAGE_HEADER_SIZE > len(data) * 3 // 4:
+        return image
+
+    header = pack(
+        "<BBHHHHH",
+        magic,
+        cf,
+        flags | LV_IMAGE_FLAGS_COMPRESSED,
+        w,
+        h,
+        stride,
+        reserved,
+    )
+    return header + pack("<III", method_id, len(compressed), len(data)) + compressed
+
+
+def create_custom_raw_fs_image(
+    img_filename, source_dir, block_size=4096, compress="none", compress_max_size=16384
+):
     table = {}
     offset = 0
+    raw_size = 0
     files_image = bytearray()
     header_images = bytearray()
     for root, dirs, files in os.walk(source_dir):
@@ -37,20 +144,31 @@ def create_custom_raw_fs_image(img_filename, source_dir, block_size=4096):
             relpath = os.path.relpath(path, start=source_dir)
             print(f"Adding {path}")
             with open(path, "rb") as infile:
-                files_image.extend(infile.read())
-                table[filename] = {"offset": offset, "len": infile.tell()}
-                offset = offset + infile.tell()
+                content = infile.read()
+            raw_size = raw_size + len(content)
+            if compress != "none" and filename.endswith(".bin"):
+                content = compress_lvgl_image(content, compress, compress_max_size)
+            files_image.extend(content)
+            table[filename] = {"offset": offset, "len": len(content)}
+            offset = offset + len(content)
     print(table)
-    for name, data in table.items():
-        if len(name) <= MAX_FILE_NAME:
-            header_images = header_images + pack(
-                f"<{MAX_FILE_NAME}sII",
-                bytes(name, "utf-8"),
-                data["offset"],
-                data["len"],
-            )
-        else:
+    if compress != "none":
+        print(
+            f"Compressed ({compress}) files from {raw_size} to {len(files_image)} bytes"
+        )
+    for name in list(table.keys()):
+        if len(bytes(name, "utf-8")) > MAX_FILE_NAME:
             print("Filename to long, skipping", name, len(name))
+            del table[name]
+
+    # Entries are sorted by their encoded name so the firmware can binary search the table.
+    for name, data in sorted(table.items(), key=lambda item: bytes(item[0], "utf-8")):
+        header_images = header_images + pack(
+            f"<{MAX_FILE_NAME}sII",
+            bytes(name, "utf-8"),
+            data["offset"],
+            data["len"],
+        )
 
     # Insert dummy values as header length and total length so we can get the size of the header
     fake_header = header_image = (
@@ -97,6 +215,18 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--img-filename", default="littlefs.img")
     parser.add_argument("--block-size", type=int, default=4096)
+    parser.add_argument(
+        "--compress",
+        choices=["none", "rle", "lz4"],
+        default="none",
+        help="Compress LVGL .bin images, requires CONFIG_LV_USE_RLE or CONFIG_LV_USE_LZ4_INTERNAL",
+    )
+    parser.add_argument(
+        "--compress-max-size",
+        type=int,
+        default=16384,
+        help="Only compress images with at most this many bytes of pixel data, they are decoded to RAM",
+    )
     parser.add_argument("source")
     args = parser.parse_args()
 
@@ -104,4 +234,6 @@ if __name__ == "__main__":
     block_size = args.block_size
     source_dir = args.source
 
-    create_custom_raw_fs_image(img_filename, source_dir, block_size)
+    create_custom_raw_fs_image(
+        img_filename, source_dir, block_size, args.compress, args.compress_max_size
+    )
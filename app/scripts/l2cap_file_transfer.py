@@ -0,0 +1,364 @@
+# Copyright (c) 2026 ZSWatch Project
+# SPDX-License-Identifier: Apache-2.0
+
+"""
+Transfer files to and from the ZSWatch L2CAP file server.
+
+The protocol is described in app/src/ble/zsw_l2cap_file_server.h. bleak has no
+support for L2CAP connection oriented channels, so a Linux (BlueZ) L2CAP socket
+is used instead.
+
+The test command writes and reads back files on the watch with corrupted
+windows, NACKed windows and disconnects in the middle of transfers, to exercise
+the retry and resume paths. `l2cap_fs stats` on the watch shell shows the
+retries counted by the watch.
+
+--unix connects to app/tools/zephyr_host/l2cap_fs_host instead, which runs the file server
+on the host.
+"""
+
+import argparse
+import ctypes
+import errno
+import os
+import select
+import socket
+import struct
+import sys
+import zlib
+
+OP_READ_START = 0x01
+OP_WRITE_START = 0x02
+OP_ACK = 0x03
+OP_ABORT = 0x04
+OP_START_RSP = 0x05
+OP_DATA = 0x81
+OP_WINDOW_END = 0x82
+
+DATA_HDR_SIZE = 5
+WINDOWS_IN_FLIGHT = 2
+TIMEOUT_S = 5.0
+IDLE_TIMEOUT_S = 0.5
+
+# From BlueZ <bluetooth/bluetooth.h>
+SOL_BLUETOOTH = 274
+BT_SECURITY = 4
+BT_SECURITY_LOW = 1
+BT_SECURITY_MEDIUM = 2
+BT_SNDMTU = 12
+BT_RCVMTU = 13
+BDADDR_LE_PUBLIC = 1
+BDADDR_LE_RANDOM = 2
+
+TEST_PATH = "/user/l2cap_test.bin"
+TEST_EMPTY_PATH = "/user/l2cap_test_empty.bin"
+
+
+class TransferError(Exception):
+    def __init__(self, what, status, value=0):
+        super().__init__(f"{what} failed: {os.strerror(-status)} ({status})")
+        self.status = status
+        self.value = value
+
+
+def sockaddr_l2(address, address_type, psm):
+    bdaddr = bytes(reversed(bytes.fromhex(address.replace(":", ""))))
+    return struct.pack("<HH6sHBx", socket.AF_BLUETOOTH, psm, bdaddr, 0, address_type)
+
+
+def connect(address, address_type, psm, mtu, security=BT_SECURITY_MEDIUM):
+    sock = socket.socket(socket.AF_BLUETOOTH, socket.SOCK_SEQPACKET, socket.BTPROTO_L2CAP)
+    sock.setsockopt(SOL_BLUETOOTH, BT_SECURITY, struct.pack("BB", security, 0))
+    sock.setsockopt(SOL_BLUETOOTH, BT_RCVMTU, struct.pack("<H", mtu))
+
+    # The socket module has no way to give the LE address type, so bind() and connect() go through libc
+    libc = ctypes.CDLL(None, use_errno=True)
+    local = sockaddr_l2("00:00:00:00:00:00", BDADDR_LE_PUBLIC, 0)
+    remote = sockaddr_l2(address, address_type, psm)
+    if (
+        libc.bind(sock.fileno(), local, len(local)) != 0
+        or libc.connect(sock.fileno(), remote, len(remote)) != 0
+    ):
+        err = ctypes.get_errno()
+        sock.close()
+        raise OSError(err, os.strerror(err))
+
+    send_mtu = struct.unpack("<H", sock.getsockopt(SOL_BLUETOOTH, BT_SNDMTU, 2))[0]
+    return sock, min(send_mtu, mtu)
+
+
+def connect_unix(path, mtu):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
+    try:
+        sock.connect(path)
+    except OSError:
+        sock.close()
+        raise
+    return sock, mtu
+
+
+class FileClient:
+    def __init__(self, sock, send_mtu, window_size):
+        self.sock = sock
+        self.chunk_size = send_mtu - DATA_HDR_SIZE
+        self.window_size = window_size
+        self.retries = 0
+
+    def close(self):
+        self.sock.close()
+
+    def send(self, sdu):
+        self.sock.send(sdu)
+
+    def recv(self, timeout=TIMEOUT_S):
+        ready, _, _ = select.select([self.sock], [], [], timeout)
+        if not ready:
+            raise TimeoutError("No response from the watch")
+        sdu = self.sock.recv(65535)
+        if not sdu:
+            raise ConnectionError("Channel closed")
+        return sdu
+
+    def expect_idle(self):
+        """Checks that the watch sends nothing more, i.e. the transfer has ended."""
+        try:
+            sdu = self.recv(IDLE_TIMEOUT_S)
+        except TimeoutError:
+            return
+        raise AssertionError(f"Unexpected opcode 0x{sdu[0]:02x} after the transfer ended")
+
+    def start(self, sdu):
+        self.send(sdu)
+        while True:
+            rsp = self.recv()
+            # Anything else is left over from an earlier transfer
+            if rsp[0] == OP_START_RSP:
+                return struct.unpack_from("<bI", rsp, 1)
+
+    def read(self, path, offset=0, nack_windows=(), stop_after=None):
+        """
+        Reads path from offset. Windows numbered in nack_windows (from 1) are NACKed once.
+        Returns early once stop_after bytes are acknowledged.
+        """
+        status, size = self.start(struct.pack("<BI", OP_READ_START, offset) + path.encode())
+        if status != 0:
+            raise TransferError("Read start", status)
+
+        data = bytearray()
+        window = bytearray()
+        window_start = offset
+        windows = 0
+        while window_start < size:
+            sdu = self.recv()
+            if sdu[0] == OP_DATA:
+                pos = struct.unpack_from("<I", sdu, 1)[0]
+                # Ignores the rest of a window in flight after a NACK
+                if pos == window_start + len(window):
+                    window += sdu[DATA_HDR_SIZE:]
+            elif sdu[0] == OP_WINDOW_END:
+                end, crc = struct.unpack_from("<II", sdu, 1)
+                if not window:
+                    continue
+                windows += 1
+                ok = end == window_start + len(window) and zlib.crc32(window) == crc and windows not in nack_windows
+                if ok:
+                    data += window
+                    window_start = end
+                else:
+                    self.retries += 1
+                window.clear()
+                self.send(struct.pack("<BbI", OP_ACK, 0 if ok else -errno.EIO, window_start))
+                if stop_after is not None and len(data) >= stop_after:
+                    break
+
+        return bytes(data), size
+
+    def write(self, path, data, offset=0, corrupt_windows=(), stop_after=None):
+        """
+        Writes data to path from offset. Windows numbered in corrupt_windows (from 1) are sent
+        once with a bad CRC. Returns the acknowledged offset, early once stop_after bytes are acknowledged.
+        """
+        status, current_size = self.start(
+            struct.pack("<BII", OP_WRITE_START, offset, len(data)) + path.encode()
+        )
+        if status != 0:
+            raise TransferError("Write start", status, current_size)
+
+        acked = offset
+        next_offset = offset
+        in_flight = []
+        windows = 0
+        while acked < len(data):
+            while len(in_flight) < WINDOWS_IN_FLIGHT and next_offset < len(data):
+                end = min(next_offset + self.window_size, len(data))
+                for pos in range(next_offset, end, self.chunk_size):
+                    chunk = data[pos : min(pos + self.chunk_size, end)]
+                    self.send(struct.pack("<BI", OP_DATA, pos) + chunk)
+                windows += 1
+                crc = zlib.crc32(data[next_offset:end])
+                if windows in corrupt_windows:
+                    crc ^= 0xFFFFFFFF
+                self.send(struct.pack("<BII", OP_WINDOW_END, end, crc))
+                in_flight.append(end)
+                next_offset = end
+
+            rsp = self.recv()
+            if rsp[0] != OP_ACK:
+                continue
+            status, pos = struct.unpack_from("<bI", rsp, 1)
+            if status == 0:
+                acked = pos
+                in_flight = [end for end in in_flight if end > pos]
+            elif status == -errno.EIO:
+                # The watch ignores the windows in flight after a failed one, send from its offset again
+                self.retries += 1
+                acked = pos
+                next_offset = pos
+                in_flight.clear()
+            else:
+                raise TransferError(f"Write at {pos}", status)
+            if stop_after is not None and acked - offset >= stop_after:
+                break
+
+        return acked
+
+
+def run_test(connect_client, window_size):
+    data = os.urandom(5 * window_size + 123)
+    new_data = os.urandom(4 * window_size + 45)
+    retries = 0
+
+    def step(name):
+        print(f"{name}...")
+
+    client = connect_client()
+    try:
+        step("Write with a corrupted window")
+        client.write(TEST_PATH, data, corrupt_windows=(2,))
+        client.expect_idle()
+
+        step("Read with a NACKed window")
+        read, size = client.read(TEST_PATH, nack_windows=(3,))
+        assert size == len(data) and read == data, "Read back data differs"
+
+        step("Write interrupted by a disconnect")
+        client.write(TEST_PATH, new_data, stop_after=2 * window_size)
+    finally:
+        retries += client.retries
+        client.close()
+
+    client = connect_client()
+    try:
+        step("Resume the write")
+        try:
+            # Starting beyond the stored data fails with the size to resume from
+            client.write(TEST_PATH, new_data, offset=len(new_data))
+            raise AssertionError("Write start beyond the stored data did not fail")
+        except TransferError as e:
+            if e.status != -errno.EINVAL:
+                raise
+            resume_offset = e.value
+        assert 0 < resume_offset < len(new_data), f"Unexpected resume offset {resume_offset}"
+        client.write(TEST_PATH, new_data, offset=resume_offset)
+        client.expect_idle()
+
+        step("Resume an already complete write")
+        client.write(TEST_PATH, new_data, offset=len(new_data))
+        client.expect_idle()
+
+        step("Read interrupted by a disconnect")
+        first, _ = client.read(TEST_PATH, stop_after=window_size)
+    finally:
+        retries += client.retries
+        client.close()
+
+    client = connect_client()
+    try:
+        step("Resume the read")
+        rest, _ = client.read(TEST_PATH, offset=len(first))
+        assert first + rest == new_data, "Resumed read data differs"
+
+        step("Read from the end of the file")
+        read, _ = client.read(TEST_PATH, offset=len(new_data))
+        assert read == b""
+        client.expect_idle()
+
+        step("Write and read an empty file")
+        client.write(TEST_EMPTY_PATH, b"")
+        client.expect_idle()
+        read, size = client.read(TEST_EMPTY_PATH)
+        assert size == 0 and read == b""
+        client.expect_idle()
+    finally:
+        retries += client.retries
+        client.close()
+
+    print(f"All transfers OK, {retries} windows retried")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Transfer files with the ZSWatch L2CAP file server.")
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--address", help="Mac of the ZSWatch")
+    target.add_argument("--unix", metavar="PATH", help="Socket of app/tools/zephyr_host/l2cap_fs_host")
+    parser.add_argument("--address-type", choices=["public", "random"], default="random")
+    parser.add_argument(
+        "--security", choices=["low", "medium"], default="medium",
+        help="low without pairing, for builds with CONFIG_BLE_DISABLE_PAIRING_REQUIRED"
+    )
+    parser.add_argument("--psm", type=lambda x: int(x, 0), default=0x80, help="CONFIG_ZSW_L2CAP_FILE_SERVER_PSM")
+    parser.add_argument("--mtu", type=int, default=1024, help="CONFIG_ZSW_L2CAP_FILE_SERVER_MTU")
+    parser.add_argument(
+        "--window-size", type=int, default=4096, help="CONFIG_ZSW_L2CAP_FILE_SERVER_WINDOW_SIZE"
+    )
+    subparsers = parser.add_subparsers(dest="command", required=True)
+    read_parser = subparsers.add_parser("read", help="Read a file from the watch")
+    read_parser.add_argument("remote", help="Path on the watch, e.g. /user/memo.bin")
+    read_parser.add_argument("local")
+    write_parser = subparsers.add_parser("write", help="Write a file to the watch")
+    write_parser.add_argument("local")
+    write_parser.add_argument("remote", help="Path on the watch, e.g. /user/background.bin")
+    write_parser.add_argument("--resume", action="store_true", help="Continue an interrupted write")
+    subparsers.add_parser("test", help="Exercise the retry and resume paths")
+    args = parser.parse_args()
+
+    address_type = BDADDR_LE_RANDOM if args.address_type == "random" else BDADDR_LE_PUBLIC
+    security = BT_SECURITY_LOW if args.security == "low" else BT_SECURITY_MEDIUM
+
+    def connect_client():
+        if args.unix:
+            sock, send_mtu = connect_unix(args.unix, args.mtu)
+        else:
+            sock, send_mtu = connect(args.address, address_type, args.psm, args.mtu, security)
+        return FileClient(sock, send_mtu, args.window_size)
+
+    if args.command == "test":
+        run_test(connect_client, args.window_size)
+        sys.exit(0)
+
+    client = connect_client()
+    try:
+        if args.command == "read":
+            data, _ = client.read(args.remote)
+            with open(args.local, "wb") as f:
+                f.write(data)
+        else:
+            with open(args.local, "rb") as f:
+                data = f.read()
+            offset = 0
+            if args.resume:
+                try:
+                    client.write(args.remote, data, offset=len(data))
+                    offset = len(data)
+                except TransferError as e:
+                    if e.status != -errno.EINVAL:
+                        raise
+                    # A larger file on the watch is not the one being written, start over
+                    offset = e.value if e.value < len(data) else 0
+            if offset < len(data):
+                client.write(args.remote, data, offset=offset)
+        print(f"Done, {client.retries} windows retried")
+    except TransferError as e:
+        sys.exit(str(e))
+    finally:
+        client.close()
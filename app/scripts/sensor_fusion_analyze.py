@@ -3,6 +3,7 @@
 
 import pylink
 import argparse
+import asyncio
 import sys
 import time
 import os
@@ -18,6 +19,12 @@ logged_data = []
 
 num_discard = 5
 
+# Sensor stream characteristic, see app/src/ble/zsw_gatt_sensor_server.h
+SENSOR_STREAM_CHAR_UUID = "5a570101-8f2c-4d1e-9b6a-2e7c51d0a3f4"
+RECORD_IMU = 0x01
+RECORD_MAG = 0x02
+RECORD_PRESSURE = 0x03
+
 
 def run_fusion(data_list):
     sample_rate = 100  # 100 Hz
@@ -221,6 +228,73 @@ def read_from_rtt_log(jlink, num_samples):
         raise
 
 
+def save_and_run_fusion(data_list):
+    now = datetime.now()
+    date_time = now.strftime("%d_%m_%Y-%H-%M")
+    np.savetxt("collected_{}.csv".format(date_time), data_list, delimiter=",")
+
+    run_fusion(data_list)
+
+
+class SensorStreamDecoder:
+    """Turns sensor stream notifications into rows in the same format as the RTT log."""
+
+    def __init__(self):
+        self.rows = []
+        self.mag = [0.0, 0.0, 0.0]
+        self.pressure = None
+        self.seq = None
+        self.num_lost = 0
+
+    def feed(self, data):
+        seq, time_ms = unpack_from("<BI", data, 0)
+        if self.seq is not None and seq != (self.seq + 1) & 0xFF:
+            self.num_lost += (seq - self.seq - 1) & 0xFF
+            print("Lost %d packets" % ((seq - self.seq - 1) & 0xFF))
+        self.seq = seq
+
+        index = 5
+        while index + 2 <= len(data):
+            record_type, dt_ms = unpack_from("<BB", data, index)
+            index += 2
+            time_ms += dt_ms
+            if record_type == RECORD_IMU:
+                imu = unpack_from("<6h", data, index)
+                index += 12
+                accel = [v / 1000 for v in imu[0:3]]
+                gyro = [v / 10 for v in imu[3:6]]
+                # Timestamp, no euler angles from the watch, gyro (dps), accel (g), mag (uT)
+                self.rows.append([time_ms / 1000, 0, 0, 0] + gyro + accel + self.mag)
+            elif record_type == RECORD_MAG:
+                self.mag = [v / 10 for v in unpack_from("<3h", data, index)]
+                index += 6
+            elif record_type == RECORD_PRESSURE:
+                self.pressure = unpack_from("<H", data, index)[0] * 2
+                index += 2
+            else:
+                print("Unknown record type %d" % record_type)
+                return
+
+
+async def ble_read(address, num_samples):
+    from bleak import BleakClient
+
+    decoder = SensorStreamDecoder()
+    async with BleakClient(address, timeout=30.0) as client:
+        print("Connected to", address)
+        await client.start_notify(
+            SENSOR_STREAM_CHAR_UUID, lambda _, data: decoder.feed(bytes(data))
+        )
+        while client.is_connected and len(decoder.rows) < num_samples:
+            await asyncio.sleep(0.5)
+            print("%d samples, pressure %s Pa" % (len(decoder.rows), decoder.pressure))
+        if client.is_connected:
+            await client.stop_notify(SENSOR_STREAM_CHAR_UUID)
+
+    print("Collected %d samples, %d packets lost" % (len(decoder.rows), decoder.num_lost))
+    return np.array(decoder.rows[:num_samples], dtype=np.float64)
+
+
 def rtt_run_read(target_device, num_samples):
     jlink = pylink.JLink()
     print("Connecting to JLink...")
@@ -272,11 +346,7 @@ def rtt_run_read(target_device, num_samples):
         data_list = np.char.strip(data_list)
         data_list = data_list.astype(np.float64)
 
-        now = datetime.now()
-        date_time = now.strftime("%d_%m_%Y-%H-%M")
-        np.savetxt("collected_{}.csv".format(date_time), data_list, delimiter=",")
-
-        run_fusion(data_list)
+        save_and_run_fusion(data_list)
 
     except KeyboardInterrupt:
         print("ctrl-c detected, exiting...")
@@ -303,8 +373,19 @@ if __name__ == "__main__":
         "--data", type=str, help="Don't collect data, use data from file instead."
     )
 
+    parser.add_argument(
+        "--ble",
+        type=str,
+        metavar="ADDRESS",
+        help="Collect data from the sensor stream characteristic over BLE instead of RTT.",
+    )
+
     args = parser.parse_args()
 
+    if args.ble:
+        save_and_run_fusion(asyncio.run(ble_read(args.ble, args.samples)))
+        sys.exit(0)
+
     if args.data:
         data_list = np.genfromtxt(args.data, delimiter=",")
         run_fusion(data_list)
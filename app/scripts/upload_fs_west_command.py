@@ -82,6 +82,15 @@ class UploadFsWestCommand(WestCommand):
             help="Upload using RTT, needed for v3 watches without QSPI flash",
         )
 
+        parser.add_argument(
+            "--compress",
+            type=str,
+            choices=["none", "rle", "lz4"],
+            default="none",
+            help="Compress small LVGL images in the raw image, decoded by LVGL on load. "
+            "The firmware needs the matching CONFIG_ZSW_RAWFS_IMAGE_COMPRESSION",
+        )
+
         parser.add_argument(
             "--generate_only",
             action="store_true",
@@ -189,7 +198,9 @@ class UploadFsWestCommand(WestCommand):
             if args.type == "raw":
                 source_dir = f"{images_path}/S"
                 partition = partition if partition else "lvgl_raw_partition"
-                create_custom_raw_fs_image(filename, source_dir, block_size)
+                create_custom_raw_fs_image(
+                    filename, source_dir, block_size, args.compress
+                )
                 qspi_flash_address = qspi_flash_address + 0x520000
                 print("lvgl_raw_partition partition address:", qspi_flash_address)
             elif args.type == "lfs":
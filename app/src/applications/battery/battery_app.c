@@ -70,7 +70,9 @@ static application_t app = {
 
 static void battery_app_start(lv_obj_t *root, lv_group_t *group)
 {
-    zsw_battery_sample_t sample;
+    const zsw_battery_sample_t *p_samples;
+    zsw_history_span_t spans[ZSW_HISTORY_MAX_SPANS];
+    uint32_t num_spans;
     struct battery_sample_event initial_sample;
 
 #if CONFIG_DT_HAS_NORDIC_NPM1300_ENABLED
@@ -79,9 +81,13 @@ static void battery_app_start(lv_obj_t *root, lv_group_t *group)
     battery_ui_show(root, on_battery_hist_clear_cb, zsw_history_samples(&battery_context) + 1, false);
 #endif
 
-    for (int i = 0; i < zsw_history_samples(&battery_context); i++) {
-        zsw_history_get(&battery_context, &sample, i);
-        battery_ui_add_measurement(sample.percent, decompress_voltage_from_byte(sample.mv_with_decimals));
+    num_spans = zsw_history_get_spans(&battery_context, 0, zsw_history_samples(&battery_context), spans);
+    for (uint32_t i = 0; i < num_spans; i++) {
+        p_samples = spans[i].samples;
+        for (uint32_t j = 0; j < spans[i].num_samples; j++) {
+            battery_ui_add_measurement(p_samples[j].percent,
+                                       decompress_voltage_from_byte(p_samples[j].mv_with_decimals));
+        }
     }
 
     if (zbus_chan_read(&battery_sample_data_chan, &initial_sample, K_MSEC(100)) == 0) {
@@ -18,6 +18,7 @@
 #include <zephyr/kernel.h>
 #include <zephyr/init.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/timeutil.h>
 
 #include "fitness_ui.h"
 #include "managers/zsw_app_manager.h"
@@ -39,6 +40,10 @@ LOG_MODULE_REGISTER(fitness_app, LOG_LEVEL_INF);
 #define SAMPLE_INTERVAL_MIN         60
 #define SAMPLE_INTERVAL_MS          (SAMPLE_INTERVAL_MIN * 60 * 1000)
 #define MAX_SAMPLES                 (7 * 24) // One week of hourly samples
+#define ROLLUP_HOURLY_SAMPLES       (2 * 24)
+#define ROLLUP_DAILY_SAMPLES        (5 * 7)
+#define ROLLUP_WEEKLY_SAMPLES       53
+#define SECONDS_PER_DAY             (24 * 60 * 60)
 
 typedef struct minimal_zsw_timeval {
     // Same structure as zsw_timeval_t, but with smaller types and without tm_isdst and nanoseconds
@@ -74,6 +79,16 @@ static application_t app = {
 
 static zsw_history_t fitness_history_context;
 static zsw_step_sample_t samples[MAX_SAMPLES];
+static zsw_history_rollups_t fitness_rollups;
+static zsw_history_rollup_t rollup_hourly[ROLLUP_HOURLY_SAMPLES];
+static zsw_history_rollup_t rollup_daily[ROLLUP_DAILY_SAMPLES];
+static zsw_history_rollup_t rollup_weekly[ROLLUP_WEEKLY_SAMPLES];
+static zsw_history_rollup_t *const rollup_storage[ZSW_HISTORY_ROLLUP_NUM_TIERS] = {
+    rollup_hourly, rollup_daily, rollup_weekly
+};
+static const uint32_t rollup_num_samples[ZSW_HISTORY_ROLLUP_NUM_TIERS] = {
+    ROLLUP_HOURLY_SAMPLES, ROLLUP_DAILY_SAMPLES, ROLLUP_WEEKLY_SAMPLES
+};
 
 K_WORK_DELAYABLE_DEFINE(sample_step_work, step_sample_work);
 
@@ -151,17 +166,59 @@ static void step_sample_work(struct k_work *work)
     k_work_reschedule(&sample_step_work, K_SECONDS(next_sample_seconds));
 }
 
+static int32_t step_sample_rollup_value(const void *p_sample, uint32_t *p_time)
+{
+    const zsw_step_sample_t *p_step_sample = p_sample;
+    struct tm tm = {
+        .tm_sec = p_step_sample->time.tm_sec,
+        .tm_min = p_step_sample->time.tm_min,
+        .tm_hour = p_step_sample->time.tm_hour,
+        .tm_mday = p_step_sample->time.tm_mday,
+        .tm_mon = p_step_sample->time.tm_mon,
+        .tm_year = p_step_sample->time.tm_year - 1900,
+    };
+
+    *p_time = (uint32_t)timeutil_timegm(&tm);
+
+    return p_step_sample->steps;
+}
+
+static int rollup_weekday(uint32_t day_start)
+{
+    // 1970-01-01 was a Thursday
+    return ((day_start / SECONDS_PER_DAY) + 4) % DAYS_IN_WEEK;
+}
+
 static void get_steps_per_day(uint16_t weekdays[DAYS_IN_WEEK])
 {
-    int day;
-    int num_samples = zsw_history_samples(&fitness_history_context);
-
-    for (int i = 0; i < num_samples; i++) {
-        zsw_step_sample_t sample;
-        zsw_history_get(&fitness_history_context, &sample, i);
-        day = sample.time.tm_wday;
-        LOG_DBG("Day: %d, HH: %d, Steps: %d", day, sample.time.tm_hour, sample.steps);
-        weekdays[day] = MAX(sample.steps, weekdays[day]);
+    uint32_t first_day;
+    uint32_t num_days;
+    uint32_t num_spans;
+    zsw_history_rollup_t today;
+    const zsw_history_rollup_t *p_day;
+    const zsw_history_t *p_daily;
+    zsw_history_span_t spans[ZSW_HISTORY_MAX_SPANS];
+
+    // Step samples are the running count of the day, so the max of a day is the steps of that day.
+    if (zsw_history_rollup_get_current(&fitness_history_context, ZSW_HISTORY_ROLLUP_DAILY, &today) != 0) {
+        return;
+    }
+
+    weekdays[rollup_weekday(today.start)] = today.max;
+    first_day = today.start - (DAYS_IN_WEEK - 1) * SECONDS_PER_DAY;
+
+    p_daily = zsw_history_rollup_tier(&fitness_history_context, ZSW_HISTORY_ROLLUP_DAILY);
+    num_days = zsw_history_samples(p_daily);
+    num_spans = zsw_history_get_spans(p_daily, num_days > DAYS_IN_WEEK ? num_days - DAYS_IN_WEEK : 0,
+                                      DAYS_IN_WEEK, spans);
+    for (uint32_t i = 0; i < num_spans; i++) {
+        p_day = spans[i].samples;
+        for (uint32_t j = 0; j < spans[i].num_samples; j++, p_day++) {
+            if ((p_day->start >= first_day) && (p_day->start < today.start)) {
+                LOG_DBG("Day: %d, Steps: %d", rollup_weekday(p_day->start), p_day->max);
+                weekdays[rollup_weekday(p_day->start)] = p_day->max;
+            }
+        }
     }
 }
 
@@ -223,6 +280,7 @@ static void fitness_app_stop(void)
 static int fitness_app_add(void)
 {
     int num_hist_samples;
+    zsw_step_sample_t last_sample;
     zsw_timeval_t time;
     int next_sample_seconds = 0;
     zsw_app_manager_add_application(&app);
@@ -247,6 +305,8 @@ static int fitness_app_add(void)
 #endif
 
     zsw_history_init(&fitness_history_context, MAX_SAMPLES, sizeof(zsw_step_sample_t), samples, SETTING_FITNESS_HIST_KEY);
+    zsw_history_rollups_init(&fitness_history_context, &fitness_rollups, step_sample_rollup_value, rollup_storage,
+                             rollup_num_samples);
 
     if (zsw_history_load(&fitness_history_context)) {
         LOG_ERR("Error during settings_load_subtree!");
@@ -258,8 +318,10 @@ static int fitness_app_add(void)
     zsw_clock_get_time(&time);
 
     // If watch was reset the step counter restarts at 0, so we need to update the offset.
-    if (num_hist_samples > 0 && time.tm.tm_mday == samples[num_hist_samples - 1].time.tm_mday) {
-        zsw_imu_set_step_offset(samples[num_hist_samples - 1].steps);
+    if (num_hist_samples > 0 &&
+        zsw_history_get_range(&fitness_history_context, &last_sample, num_hist_samples - 1, 1) == 1 &&
+        time.tm.tm_mday == last_sample.time.tm_mday) {
+        zsw_imu_set_step_offset(last_sample.steps);
     }
 
     // Try to sample about every full hour
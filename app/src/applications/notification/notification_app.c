@@ -50,13 +50,14 @@ static application_t app = {
 
 static void notification_app_zbus_notification_callback(const struct zbus_channel *chan)
 {
-    zsw_not_mngr_notification_t *not;
+    static char strings[ZSW_NOTIFICATION_MGR_MAX_STRINGS_LEN];
+    zsw_not_mngr_notification_t not;
 
     LOG_DBG("New notification available");
 
-    if (app.current_state == ZSW_APP_STATE_UI_VISIBLE) {
-        not = zsw_notification_manager_get_newest();
-        notifications_ui_add_notification(not, notification_group);
+    if (app.current_state == ZSW_APP_STATE_UI_VISIBLE &&
+        zsw_notification_manager_get_newest(&not, strings, sizeof(strings)) == 0) {
+        notifications_ui_add_notification(&not, notification_group);
     }
 }
 
@@ -86,23 +87,20 @@ static void notification_app_on_ui_available(void)
     notification_app_start(root_obj, notification_group);
 }
 
-static void notification_app_start(lv_obj_t *root, lv_group_t *group)
+static void add_stored_notification(const zsw_not_mngr_notification_t *not, void *user_data)
 {
-    static uint32_t num_notifications;
-
-    // TODO: Can we remove this buffer in some way because we already have one notification buffer?
-    static zsw_not_mngr_notification_t notifications[ZSW_NOTIFICATION_MGR_MAX_STORED];
+    // The labels keep their own copy of the text, so the stored strings are only used during the call
+    notifications_ui_add_notification(not, user_data);
+}
 
+static void notification_app_start(lv_obj_t *root, lv_group_t *group)
+{
     notification_group = group;
     root_obj = root;
 
-    zsw_notification_manager_get_all(notifications, &num_notifications);
     notifications_ui_page_init(on_notification_page_notification_close);
     notifications_ui_page_create(root_obj, notification_group);
-
-    for (uint32_t i = 0; i < num_notifications; i++) {
-        notifications_ui_add_notification(&notifications[i], notification_group);
-    }
+    zsw_notification_manager_foreach(add_stored_notification, notification_group);
 }
 
 static void notification_app_stop(void)
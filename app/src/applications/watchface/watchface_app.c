@@ -36,6 +36,7 @@
 #include "watchface_app.h"
 #include "zsw_settings.h"
 #include "ui/utils/zsw_ui_utils.h"
+#include "ui/utils/zsw_image_cache.h"
 #include "events/accel_event.h"
 #include "events/battery_event.h"
 #include "events/activity_event.h"
@@ -267,6 +268,8 @@ void watchface_app_start(lv_obj_t *root_screen, lv_group_t *group, watchface_app
     watchface_evt_cb = evt_cb;
     watchface_views_created = false;
 
+    zsw_image_cache_warm(watchfaces[watchface_settings.watchface_index]->cached_images);
+
     lv_obj_add_event_cb(watchface_root_screen, watchface_gesture_cb, LV_EVENT_GESTURE, NULL);
 
     general_work_item.type = OPEN_WATCHFACE;
@@ -286,6 +289,7 @@ void watchface_app_stop(void)
         watchfaces[watchface_settings.watchface_index]->remove();
         zsw_watchface_dropdown_ui_remove();
     }
+    zsw_image_cache_release_all();
 
     if (watchface_root_screen != NULL && lv_obj_is_valid(watchface_root_screen)) {
         lv_obj_remove_event_cb(watchface_root_screen, watchface_gesture_cb);
@@ -306,6 +310,7 @@ void watchface_change(int index)
     }
 
     watchfaces[watchface_settings.watchface_index]->remove();
+    zsw_image_cache_release_all();
 
     // Make sure we have the latest settings
     int err = settings_load_subtree_direct(ZSW_SETTINGS_WATCHFACE, settings_load_handler_watchface, &watchface_settings);
@@ -320,6 +325,7 @@ void watchface_change(int index)
         LOG_ERR("Failed saving watchface settings");
     }
     if (running) {
+        zsw_image_cache_warm(watchfaces[watchface_settings.watchface_index]->cached_images);
         general_work_item.type = OPEN_WATCHFACE;
         __ASSERT(0 <= k_work_schedule(&general_work_item.work, K_MSEC(100)), "FAIL schedule");
     }
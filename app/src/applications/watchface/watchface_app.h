@@ -73,6 +73,7 @@ typedef struct watchface_ui_api_t {
     void (*ui_invalidate_cached)(void);
     void (*set_watchface_bg)(const void *bg_img);
     const void *(*get_preview_img)(void);
+    const void *const *cached_images; /* NULL terminated, kept in RAM while the watchface is shown */
     const char *name;
 } watchface_ui_api_t;
 
@@ -31,10 +31,12 @@
 
 LOG_MODULE_REGISTER(weather_app, LOG_LEVEL_DBG);
 
-#define HTTP_REQUEST_URL_FMT "https://api.open-meteo.com/v1/forecast?latitude=%f&longitude=%f&current=wind_speed_10m,temperature_2m,apparent_temperature,weather_code&daily=weather_code,temperature_2m_max,temperature_2m_min,apparent_temperature_max,apparent_temperature_min,precipitation_sum,rain_sum,precipitation_probability_max&wind_speed_unit=ms&timezone=auto&forecast_days=%d"
+#define HTTP_REQUEST_URL_FMT "https://api.open-meteo.com/v1/forecast?latitude=%.2f&longitude=%.2f&current=wind_speed_10m,temperature_2m,apparent_temperature,weather_code&daily=weather_code,temperature_2m_max,temperature_2m_min,apparent_temperature_max,apparent_temperature_min,precipitation_sum,rain_sum,precipitation_probability_max&wind_speed_unit=ms&timezone=auto&forecast_days=%d"
 
 #define MAX_GPS_AGED_TIME_MS 30 * 60 * 1000
 #define WEATHER_BACKGROUND_FETCH_INTERVAL_S (30 * 60)
+// Reuse a response when the app is opened shortly after a fetch, shorter than the fetch interval to not skip one
+#define WEATHER_CACHE_MAX_AGE_S (10 * 60)
 
 // Functions needed for all applications
 static void weather_app_start(lv_obj_t *root, lv_group_t *group);
@@ -71,7 +73,7 @@ static application_t app = {
     .category = ZSW_APP_CATEGORY_ROOT
 };
 
-static void http_rsp_cb(ble_http_status_code_t status, char *response)
+static void http_rsp_cb(ble_http_status_code_t status, char *response, bool from_cache)
 {
     zsw_timeval_t time_now;
     weather_ui_current_weather_data_t current_weather;
@@ -125,9 +127,12 @@ static void http_rsp_cb(ble_http_status_code_t status, char *response)
         strncpy(last_weather.report_text, current_weather.text, sizeof(last_weather.report_text));
 
         cJSON_Delete(parsed_response);
-        last_update_weather_time = k_uptime_get();
 
-        k_work_submit(&weather_app_publish);
+        // A cached response was already published when it was fetched
+        if (!from_cache) {
+            last_update_weather_time = k_uptime_get();
+            k_work_submit(&weather_app_publish);
+        }
     } else {
         LOG_ERR("HTTP request failed\n");
         if (app.current_state == ZSW_APP_STATE_UI_VISIBLE) {
@@ -148,7 +153,7 @@ static void fetch_weather_data(double lat, double lon)
 {
     char weather_url[512];
     snprintf(weather_url, sizeof(weather_url), HTTP_REQUEST_URL_FMT, lat, lon, WEATHER_UI_NUM_FORECASTS);
-    int ret = zsw_ble_http_get(weather_url, http_rsp_cb);
+    int ret = zsw_ble_http_get_cached(weather_url, http_rsp_cb, WEATHER_CACHE_MAX_AGE_S);
     if (ret != 0 && ret != -EBUSY) {
         LOG_ERR("Failed to send HTTP request: %d", ret);
         if (app.current_state == ZSW_APP_STATE_UI_VISIBLE) {
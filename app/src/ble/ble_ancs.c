@@ -27,6 +27,9 @@
 #include <bluetooth/services/gattp.h>
 
 #include <zephyr/settings/settings.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
 
 #include "ble/ble_comm.h"
 #include "events/ble_event.h"
@@ -45,8 +48,54 @@ static struct bt_gattp gattp;
 
 static atomic_t discovery_flags;
 
-/* Local copy to keep track of the newest arriving notifications. */
-static struct bt_ancs_evt_notif notification_latest;
+typedef enum {
+    ANCS_REQUEST_NOTIF_ATTRS,
+    ANCS_REQUEST_APP_ATTRS,
+} ancs_request_type_t;
+
+typedef struct {
+    ancs_request_type_t type;
+    uint8_t retries;
+    uint32_t sent_ms;
+    union {
+        struct bt_ancs_evt_notif notif;
+        char app_id[BT_ANCS_ATTR_DATA_MAX];
+    };
+} ancs_request_t;
+
+typedef struct {
+    char app_id[BT_ANCS_ATTR_DATA_MAX];
+    char display_name[BT_ANCS_ATTR_DATA_MAX];
+    uint32_t last_used;
+} ancs_app_cache_entry_t;
+
+/* Attribute requests, oldest first. The first is written to the Control Point when the previous response
+ * has been parsed, and its response on the Data Source is matched by notification UID or app identifier.
+ */
+static ancs_request_t requests[CONFIG_ZSW_ANCS_REQUEST_QUEUE_SIZE];
+static uint8_t requests_head;
+static uint8_t num_requests;
+/* The first request has been written and waits for its response. The client parses all responses with one
+ * state, counting down the attributes of the last request written, so only one request can be in flight.
+ */
+static bool request_in_flight;
+/* A Control Point write is waiting for its response, only one can be pending at a time. */
+static bool cp_write_pending;
+/* A response is being received on the Data Source, or the client has not returned from its last attribute yet. */
+static bool response_in_progress;
+/* The request queue is used from the Bluetooth callbacks and the request timeout. */
+static K_MUTEX_DEFINE(request_mutex);
+
+static struct {
+    uint32_t responses;
+    uint32_t latency_sum_ms;
+    uint32_t latency_max_ms;
+    uint32_t timeouts;
+} request_stats;
+
+/* App identifier to display name, least recently used entries are replaced. */
+static ancs_app_cache_entry_t app_cache[CONFIG_ZSW_ANCS_APP_CACHE_SIZE];
+static uint32_t app_cache_clock;
 /* Local copy of the newest notification attribute. */
 static struct bt_ancs_attr notif_attr_latest;
 /* Local copy of the newest app attribute. */
@@ -101,8 +150,13 @@ static void bt_ancs_notification_source_handler(struct bt_ancs_client *ancs_c, i
 static void bt_ancs_data_source_handler(struct bt_ancs_client *ancs_c, const struct bt_ancs_attr_response *response);
 static void bt_ancs_write_response_handler(struct bt_ancs_client *ancs_c, uint8_t err);
 static void gatt_discover_retry_handle(struct k_work *item);
+static void request_timeout_handle(struct k_work *item);
+static void request_next_handle(struct k_work *item);
+static void request_next(void);
 
 K_WORK_DELAYABLE_DEFINE(gatt_discover_retry, gatt_discover_retry_handle);
+K_WORK_DELAYABLE_DEFINE(request_timeout_work, request_timeout_handle);
+K_WORK_DEFINE(request_next_work, request_next_handle);
 ZBUS_CHAN_DECLARE(ble_comm_data_chan);
 
 static void enable_ancs_notifications(struct bt_ancs_client *ancs_c)
@@ -332,6 +386,14 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     if (current_conn) {
         bt_conn_unref(current_conn);
     }
+
+    k_mutex_lock(&request_mutex, K_FOREVER);
+    k_work_cancel_delayable(&request_timeout_work);
+    num_requests = 0;
+    request_in_flight = false;
+    cp_write_pending = false;
+    response_in_progress = false;
+    k_mutex_unlock(&request_mutex);
 }
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
@@ -396,9 +458,219 @@ static void notif_attr_print(const struct bt_ancs_attr *attr)
     }
 }
 
-static int parse_notify(const struct bt_ancs_attr *attr)
+static ancs_request_t *request_at(uint8_t index)
+{
+    return &requests[(requests_head + index) % ARRAY_SIZE(requests)];
+}
+
+static int request_add(const ancs_request_t *request)
+{
+    if (num_requests == ARRAY_SIZE(requests)) {
+        return -ENOMEM;
+    }
+
+    *request_at(num_requests) = *request;
+    num_requests++;
+
+    return 0;
+}
+
+/* Remove a request, later requests keep their order. */
+static void request_remove(uint8_t index)
+{
+    for (uint8_t i = index; i + 1 < num_requests; i++) {
+        *request_at(i) = *request_at(i + 1);
+    }
+    num_requests--;
+}
+
+/* Remove the request in flight, when it is answered or timed out. */
+static void request_pop(void)
+{
+    requests_head = (requests_head + 1) % ARRAY_SIZE(requests);
+    num_requests--;
+    request_in_flight = false;
+    k_work_cancel_delayable(&request_timeout_work);
+}
+
+/* Complete the request in flight, when its response has been received. */
+static void request_complete(void)
+{
+    uint32_t latency_ms;
+
+    latency_ms = k_uptime_get_32() - request_at(0)->sent_ms;
+    request_stats.responses++;
+    request_stats.latency_sum_ms += latency_ms;
+    request_stats.latency_max_ms = MAX(request_stats.latency_max_ms, latency_ms);
+
+    request_pop();
+}
+
+/* A response belongs to the request in flight if it has its notification UID or app identifier. */
+static bool request_matches(const struct bt_ancs_attr_response *response)
+{
+    ancs_request_t *request = request_at(0);
+
+    if (!request_in_flight) {
+        return false;
+    }
+
+    if (response->command_id == BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES) {
+        return request->type == ANCS_REQUEST_NOTIF_ATTRS && request->notif.notif_uid == response->notif_uid;
+    }
+
+    return request->type == ANCS_REQUEST_APP_ATTRS && strcmp(request->app_id, (const char *)response->app_id) == 0;
+}
+
+static void request_timeout_handle(struct k_work *item)
+{
+    ancs_request_t request;
+
+    k_mutex_lock(&request_mutex, K_FOREVER);
+
+    // The response may have completed the request while waiting for the lock
+    if (!request_in_flight || k_work_delayable_is_pending(&request_timeout_work)) {
+        k_mutex_unlock(&request_mutex);
+        return;
+    }
+
+    // A lost response may have been cut off, don't wait for its end. Should it still arrive, it only matches
+    // the request if it has been sent again, otherwise it is dropped.
+    request = *request_at(0);
+    request_stats.timeouts++;
+    response_in_progress = false;
+    request_pop();
+
+    if (request.retries == 0) {
+        LOG_WRN("Attribute request timed out, sending it again");
+        request.retries++;
+        if (request_add(&request) != 0) {
+            LOG_WRN("Request queue full, request dropped");
+        }
+    } else {
+        LOG_WRN("Attribute request timed out again, dropped");
+    }
+
+    request_next();
+    k_mutex_unlock(&request_mutex);
+}
+
+/* Write the next request once the client is done with a response, not from within its callback. */
+static void request_next_handle(struct k_work *item)
+{
+    k_mutex_lock(&request_mutex, K_FOREVER);
+    response_in_progress = false;
+    request_next();
+    k_mutex_unlock(&request_mutex);
+}
+
+static bool app_request_queued(const char *app_id)
+{
+    for (uint8_t i = 0; i < num_requests; i++) {
+        ancs_request_t *request = request_at(i);
+
+        if (request->type == ANCS_REQUEST_APP_ATTRS && strcmp(request->app_id, app_id) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Write the next request to the Control Point, once the previous one is answered and its response parsed. */
+static void request_next(void)
+{
+    ancs_request_t *request;
+    int err;
+
+    while (!request_in_flight && !cp_write_pending && !response_in_progress && num_requests > 0) {
+        request = request_at(0);
+
+        if (request->type == ANCS_REQUEST_NOTIF_ATTRS) {
+            err = bt_ancs_request_attrs(&ancs_c, &request->notif, bt_ancs_write_response_handler);
+        } else {
+            err = bt_ancs_request_app_attr(&ancs_c, (const uint8_t *)request->app_id, strlen(request->app_id),
+                                           bt_ancs_write_response_handler);
+        }
+
+        if (err) {
+            LOG_ERR("Failed to request attributes (err %d)", err);
+            request_remove(0);
+            continue;
+        }
+
+        cp_write_pending = true;
+        request->sent_ms = k_uptime_get_32();
+        request_in_flight = true;
+        k_work_reschedule(&request_timeout_work, K_MSEC(CONFIG_ZSW_ANCS_REQUEST_TIMEOUT_MS));
+    }
+}
+
+static const char *app_cache_get(const char *app_id)
+{
+    for (int i = 0; i < ARRAY_SIZE(app_cache); i++) {
+        if (app_cache[i].app_id[0] != '\0' && strcmp(app_cache[i].app_id, app_id) == 0) {
+            app_cache[i].last_used = ++app_cache_clock;
+            return app_cache[i].display_name;
+        }
+    }
+
+    return NULL;
+}
+
+static void app_cache_put(const char *app_id, const char *display_name, size_t display_name_len)
+{
+    ancs_app_cache_entry_t *entry = &app_cache[0];
+
+    for (int i = 0; i < ARRAY_SIZE(app_cache); i++) {
+        if (strcmp(app_cache[i].app_id, app_id) == 0) {
+            entry = &app_cache[i];
+            break;
+        }
+        // Empty entries have last_used 0, so they are used first
+        if (app_cache[i].last_used < entry->last_used) {
+            entry = &app_cache[i];
+        }
+    }
+
+    strncpy(entry->app_id, app_id, sizeof(entry->app_id) - 1);
+    entry->app_id[sizeof(entry->app_id) - 1] = '\0';
+    display_name_len = MIN(display_name_len, sizeof(entry->display_name) - 1);
+    memcpy(entry->display_name, display_name, display_name_len);
+    entry->display_name[display_name_len] = '\0';
+    entry->last_used = ++app_cache_clock;
+}
+
+/* Notification source for an app, its display name if known. Otherwise the last part of the
+ * app identifier, e.g. Messenger from com.facebook.Messenger, and the display name is requested.
+ */
+static const char *app_source_get(const char *app_id)
+{
+    const char *source = app_cache_get(app_id);
+    ancs_request_t request = {
+        .type = ANCS_REQUEST_APP_ATTRS,
+    };
+
+    if (source != NULL) {
+        return source;
+    }
+
+    if (app_id[0] != '\0' && !app_request_queued(app_id)) {
+        strncpy(request.app_id, app_id, sizeof(request.app_id) - 1);
+        if (request_add(&request) != 0) {
+            LOG_WRN("Request queue full, display name of %s not requested", app_id);
+        }
+    }
+
+    source = strrchr(app_id, '.');
+
+    return source ? source + 1 : app_id;
+}
+
+static int parse_notify(uint32_t notif_uid, const struct bt_ancs_attr *attr)
 {
     static struct ble_data_event evt = {0};
+    static char src[BT_ANCS_ATTR_DATA_MAX];
 
     switch (attr->attr_id) {
         case ATTR_ID_TITLE:
@@ -411,11 +683,13 @@ static int parse_notify(const struct bt_ancs_attr *attr)
             evt.data.data.notify.body_len = attr->attr_len;
             break;
 
+        // The first attribute of a response, don't keep anything of a response that was cut off
         case ATTR_ID_APP_ID:
-            // This comes as example com.facebook.Messenger
-            evt.data.data.notify.src = strrchr(attr->attr_data, '.') + 1;
-            evt.data.data.notify.src_len = strlen(evt.data.data.notify.src);
-            evt.data.data.notify.id = notification_latest.notif_uid;
+            memset(&evt, 0, sizeof(evt));
+            strncpy(src, app_source_get((const char *)attr->attr_data), sizeof(src) - 1);
+            evt.data.data.notify.src = src;
+            evt.data.data.notify.src_len = strlen(src);
+            evt.data.data.notify.id = notif_uid;
             break;
 
         // the last message is Negative action label, send only when all data is received;
@@ -442,54 +716,120 @@ static int parse_notify(const struct bt_ancs_attr *attr)
 static void bt_ancs_notification_source_handler(struct bt_ancs_client *ancs_c,
                                                 int err, const struct bt_ancs_evt_notif *notif)
 {
-    if (!err) {
-        notification_latest = *notif;
+    ancs_request_t request = {
+        .type = ANCS_REQUEST_NOTIF_ATTRS,
+    };
 
-        if (notification_latest.evt_id == BT_ANCS_EVENT_ID_NOTIFICATION_REMOVED) {
-            struct ble_data_event evt_notif_rem = {
-                .data.type = BLE_COMM_DATA_TYPE_NOTIFY_REMOVE,
-                .data.data.notify_remove.id = notification_latest.notif_uid,
-            };
+    if (err) {
+        return;
+    }
 
-            LOG_DBG("Remove notification %d", evt_notif_rem.data.data.notify_remove.id);
+    k_mutex_lock(&request_mutex, K_FOREVER);
 
-            zbus_chan_pub(&ble_comm_data_chan, &evt_notif_rem, K_MSEC(250));
+    if (notif->evt_id == BT_ANCS_EVENT_ID_NOTIFICATION_REMOVED) {
+        struct ble_data_event evt_notif_rem = {
+            .data.type = BLE_COMM_DATA_TYPE_NOTIFY_REMOVE,
+            .data.data.notify_remove.id = notif->notif_uid,
+        };
 
-            return;
+        // No need to fetch the attributes of a notification that is already gone
+        for (uint8_t i = request_in_flight ? 1 : 0; i < num_requests; i++) {
+            if (request_at(i)->type == ANCS_REQUEST_NOTIF_ATTRS && request_at(i)->notif.notif_uid == notif->notif_uid) {
+                request_remove(i);
+                break;
+            }
         }
 
-        bt_ancs_request_attrs(ancs_c, &notification_latest, bt_ancs_write_response_handler);
+        k_mutex_unlock(&request_mutex);
+
+        LOG_DBG("Remove notification %d", evt_notif_rem.data.data.notify_remove.id);
+
+        zbus_chan_pub(&ble_comm_data_chan, &evt_notif_rem, K_MSEC(250));
+
+        return;
     }
+
+    request.notif = *notif;
+    if (request_add(&request) != 0) {
+        LOG_WRN("Request queue full, notification %u dropped", notif->notif_uid);
+    } else {
+        request_next();
+    }
+
+    k_mutex_unlock(&request_mutex);
 }
 
 static void bt_ancs_data_source_handler(struct bt_ancs_client *ancs_c,
                                         const struct bt_ancs_attr_response *response)
 {
+    bool last_attr;
+    bool matched;
+
+    k_mutex_lock(&request_mutex, K_FOREVER);
+
+    // Attributes arrive in the order they were requested, the last one ends the response
     switch (response->command_id) {
         case BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES:
-            notif_attr_latest = response->attr;
-            notif_attr_print(&notif_attr_latest);
-            parse_notify(&notif_attr_latest);
-            if (response->attr.attr_id ==
-                BT_ANCS_NOTIF_ATTR_ID_APP_IDENTIFIER) {
-                notif_attr_app_id_latest = response->attr;
-            }
+            last_attr = response->attr.attr_id == BT_ANCS_NOTIF_ATTR_ID_NEGATIVE_ACTION_LABEL;
             break;
 
         case BT_ANCS_COMMAND_ID_GET_APP_ATTRIBUTES:
-            app_attr_print(&response->attr);
+            last_attr = true;
             break;
 
         default:
             /* No implementation needed. */
-            break;
+            k_mutex_unlock(&request_mutex);
+            return;
+    }
+
+    response_in_progress = true;
+
+    matched = request_matches(response);
+    if (!matched) {
+        LOG_WRN("Attribute response for no request in flight dropped");
+    } else if (response->command_id == BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES) {
+        notif_attr_latest = response->attr;
+        notif_attr_print(&notif_attr_latest);
+        parse_notify(response->notif_uid, &notif_attr_latest);
+        if (response->attr.attr_id == BT_ANCS_NOTIF_ATTR_ID_APP_IDENTIFIER) {
+            notif_attr_app_id_latest = response->attr;
+        }
+    } else {
+        app_attr_print(&response->attr);
+        if (response->attr.attr_len > 0) {
+            app_cache_put(request_at(0)->app_id, (const char *)response->attr.attr_data, response->attr.attr_len);
+        }
     }
+
+    if (last_attr) {
+        if (matched) {
+            request_complete();
+        }
+        k_work_submit(&request_next_work);
+    }
+
+    k_mutex_unlock(&request_mutex);
 }
 
 static void bt_ancs_write_response_handler(struct bt_ancs_client *ancs_c,
                                            uint8_t err)
 {
-    err_code_print(err);
+    k_mutex_lock(&request_mutex, K_FOREVER);
+
+    cp_write_pending = false;
+
+    if (err) {
+        err_code_print(err);
+        // No response will come for the failed request
+        if (request_in_flight) {
+            request_pop();
+        }
+    }
+
+    request_next();
+
+    k_mutex_unlock(&request_mutex);
 }
 
 static int gattp_init(void)
@@ -592,3 +932,33 @@ int ble_ancs_init(void)
 
     return err;
 }
+
+#ifdef CONFIG_SHELL
+static int cmd_ancs_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    k_mutex_lock(&request_mutex, K_FOREVER);
+
+    shell_print(sh, "Queued:    %u, %u in flight", num_requests, request_in_flight);
+    shell_print(sh, "Responses: %u", request_stats.responses);
+    shell_print(sh, "Latency:   avg %u ms, max %u ms",
+                request_stats.responses ? request_stats.latency_sum_ms / request_stats.responses : 0,
+                request_stats.latency_max_ms);
+    shell_print(sh, "Timeouts:  %u", request_stats.timeouts);
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        memset(&request_stats, 0, sizeof(request_stats));
+    }
+
+    k_mutex_unlock(&request_mutex);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_ancs,
+                               SHELL_CMD_ARG(stats, NULL, "Show ANCS attribute request statistics: ancs stats [reset]",
+                                             cmd_ancs_stats, 1, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(ancs, &sub_ancs, "ANCS client commands", NULL);
+#endif
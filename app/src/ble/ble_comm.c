@@ -26,10 +26,15 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <zephyr/zbus/zbus.h>
+#include <zephyr/sys/ring_buffer.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
 
 #include "ui/zsw_ui.h"
 #include "gadgetbridge/ble_gadgetbridge.h"
 #include "chronos/ble_chronos.h"
+#include "zsw_l2cap_file_server.h"
 
 #ifdef CONFIG_BT_AMS_CLIENT
 #include <bluetooth/services/ams_client.h>
@@ -42,11 +47,29 @@ LOG_MODULE_REGISTER(ble_comm, CONFIG_ZSW_BLE_LOG_LEVEL);
 #define BLE_COMM_LONG_INT_MIN_MS                (400 / 1.25)
 #define BLE_COMM_LONG_INT_MAX_MS                (500 / 1.25)
 #define BLE_COMM_CONN_INT_UPDATE_TIMEOUT_MS     5000
+#define BLE_COMM_TX_RETRY_DELAY_MS              10
+
+typedef struct {
+    uint16_t len;
+    bool coalesce;
+    uint32_t enqueued_ms;
+} tx_msg_hdr_t;
+
+typedef struct {
+    struct ring_buf ring;
+    uint32_t msgs;
+    uint32_t bytes;
+    uint32_t dropped;
+    uint32_t latency_sum_ms;
+    uint32_t latency_max_ms;
+} tx_lane_t;
 
 static void ble_connected(struct bt_conn *conn, uint8_t err);
 static void ble_disconnected(struct bt_conn *conn, uint8_t reason);
 static void ble_recycled(void);
 static void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data, uint16_t len);
+static void bt_sent_cb(struct bt_conn *conn);
+static void tx_work_handler(struct k_work *work);
 static void update_conn_interval_slow_handler(struct k_work *item);
 static void update_conn_interval_short_handler(struct k_work *item);
 static int update_adv_interval(uint16_t interval_min, uint16_t interval_max);
@@ -89,6 +112,7 @@ static struct bt_le_adv_param adv_param = {
 
 K_WORK_DELAYABLE_DEFINE(conn_interval_slow_work, update_conn_interval_slow_handler);
 K_WORK_DELAYABLE_DEFINE(conn_interval_fast_work, update_conn_interval_short_handler);
+K_WORK_DELAYABLE_DEFINE(tx_work, tx_work_handler);
 
 ZBUS_CHAN_DECLARE(ble_comm_data_chan);
 ZBUS_CHAN_DECLARE(music_control_data_chan);
@@ -100,8 +124,33 @@ static int pairing_enabled;
 
 static struct ble_transport_cb ble_transport_callbacks = {
     .data_receive = bt_receive_cb,
+    .data_sent = bt_sent_cb,
 };
 
+static uint8_t tx_high_buf[CONFIG_ZSW_BLE_COMM_TX_HIGH_QUEUE_SIZE];
+static uint8_t tx_normal_buf[CONFIG_ZSW_BLE_COMM_TX_NORMAL_QUEUE_SIZE];
+static uint8_t tx_bulk_buf[CONFIG_ZSW_BLE_COMM_TX_BULK_QUEUE_SIZE];
+static tx_lane_t tx_lanes[BLE_COMM_TX_PRIO_NUM];
+static struct k_spinlock tx_lock;
+static atomic_t tx_credits;
+
+// Message currently being sent, lanes are only switched between messages.
+static tx_lane_t *tx_cur_lane;
+static tx_msg_hdr_t tx_cur_msg;
+static uint16_t tx_cur_remaining;
+
+// PDU that could not be handed to the stack yet
+static uint8_t tx_pdu[CONFIG_BT_L2CAP_TX_MTU];
+static uint16_t tx_pdu_len;
+
+static struct {
+    uint32_t pdus;
+    uint32_t bytes;
+    uint32_t retries;
+    uint32_t errors;
+    uint32_t start_ms;
+} tx_stats;
+
 static void auth_cancel(struct bt_conn *conn)
 {
     LOG_ERR("Pairing cancelled");
@@ -170,12 +219,21 @@ int ble_comm_init(void)
 
     ble_comm_set_pairable(false);
 
+    ring_buf_init(&tx_lanes[BLE_COMM_TX_PRIO_HIGH].ring, sizeof(tx_high_buf), tx_high_buf);
+    ring_buf_init(&tx_lanes[BLE_COMM_TX_PRIO_NORMAL].ring, sizeof(tx_normal_buf), tx_normal_buf);
+    ring_buf_init(&tx_lanes[BLE_COMM_TX_PRIO_BULK].ring, sizeof(tx_bulk_buf), tx_bulk_buf);
+    tx_stats.start_ms = k_uptime_get_32();
+
     int err = ble_transport_init(&ble_transport_callbacks);
     if (err) {
         LOG_ERR("Failed to initialize UART service (err: %d)", err);
         return err;
     }
 
+#ifdef CONFIG_ZSW_L2CAP_FILE_SERVER
+    zsw_l2cap_file_server_init();
+#endif
+
     err = bt_le_adv_start(&adv_param, ad, ARRAY_SIZE(ad), ad_nus, ARRAY_SIZE(ad_nus));
     if (err) {
         LOG_ERR("Advertising failed to start (err %d)", err);
@@ -186,24 +244,121 @@ int ble_comm_init(void)
     return err;
 }
 
+static int tx_enqueue(const uint8_t *data, uint16_t len, ble_comm_tx_prio_t prio, bool coalesce)
+{
+    tx_lane_t *lane = &tx_lanes[prio];
+    tx_msg_hdr_t hdr = {
+        .len = len,
+        .coalesce = coalesce,
+        .enqueued_ms = k_uptime_get_32(),
+    };
+    k_spinlock_key_t key;
+
+    __ASSERT(prio < BLE_COMM_TX_PRIO_NUM, "Invalid TX priority %d", prio);
+
+    if (len == 0) {
+        return 0;
+    }
+
+    if (!ble_transport_is_subscribed(current_conn)) {
+        return -EINVAL;
+    }
+
+    // No logging on failure, the log backend sends through here.
+    key = k_spin_lock(&tx_lock);
+    if (sizeof(hdr) + len > ring_buf_capacity_get(&lane->ring)) {
+        lane->dropped++;
+        k_spin_unlock(&tx_lock, key);
+        return -EMSGSIZE;
+    }
+    if (ring_buf_space_get(&lane->ring) < sizeof(hdr) + len) {
+        lane->dropped++;
+        k_spin_unlock(&tx_lock, key);
+        return -ENOMEM;
+    }
+    ring_buf_put(&lane->ring, (const uint8_t *)&hdr, sizeof(hdr));
+    ring_buf_put(&lane->ring, data, len);
+    k_spin_unlock(&tx_lock, key);
+
+    k_work_reschedule(&tx_work, K_NO_WAIT);
+
+    return 0;
+}
+
 int ble_comm_send(const uint8_t *data, uint16_t len)
 {
-    uint16_t offset = 0;
-    int ret = 0;
+    return tx_enqueue(data, len, BLE_COMM_TX_PRIO_NORMAL, true);
+}
+
+int ble_comm_send_prio(const uint8_t *data, uint16_t len, ble_comm_tx_prio_t prio)
+{
+    return tx_enqueue(data, len, prio, true);
+}
+
+int ble_comm_send_packet(const uint8_t *data, uint16_t len)
+{
+    return tx_enqueue(data, len, BLE_COMM_TX_PRIO_NORMAL, false);
+}
 
-    while (offset < len) {
-        uint16_t chunk_len = len - offset;
-        if (chunk_len > max_send_len) {
-            chunk_len = max_send_len;
+static tx_lane_t *tx_next_lane(void)
+{
+    for (int i = 0; i < ARRAY_SIZE(tx_lanes); i++) {
+        if (!ring_buf_is_empty(&tx_lanes[i].ring)) {
+            return &tx_lanes[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Fill a PDU with as much queued data as fits. Small messages are merged, as Gadgetbridge
+ * reads the notifications as a stream. Messages that must not be merged start a new PDU.
+ */
+static uint16_t tx_fill_pdu(uint8_t *pdu, uint16_t max_len)
+{
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+    tx_msg_hdr_t hdr;
+    uint16_t len = 0;
+    uint32_t chunk;
+    uint32_t latency;
+
+    while (len < max_len) {
+        if (tx_cur_lane == NULL) {
+            tx_cur_lane = tx_next_lane();
+            if (tx_cur_lane == NULL) {
+                break;
+            }
+            ring_buf_peek(&tx_cur_lane->ring, (uint8_t *)&hdr, sizeof(hdr));
+            if (len > 0 && !hdr.coalesce) {
+                tx_cur_lane = NULL;
+                break;
+            }
+            ring_buf_get(&tx_cur_lane->ring, NULL, sizeof(hdr));
+            tx_cur_msg = hdr;
+            tx_cur_remaining = hdr.len;
         }
 
-        ret = ble_transport_send(current_conn, data + offset, chunk_len);
-        if (ret < 0) {
-            return ret;
+        chunk = ring_buf_get(&tx_cur_lane->ring, &pdu[len], MIN(tx_cur_remaining, max_len - len));
+        len += chunk;
+        tx_cur_remaining -= chunk;
+
+        if (tx_cur_remaining == 0) {
+            latency = k_uptime_get_32() - tx_cur_msg.enqueued_ms;
+            tx_cur_lane->msgs++;
+            tx_cur_lane->bytes += tx_cur_msg.len;
+            tx_cur_lane->latency_sum_ms += latency;
+            tx_cur_lane->latency_max_ms = MAX(tx_cur_lane->latency_max_ms, latency);
+            tx_cur_lane = NULL;
+            if (!tx_cur_msg.coalesce) {
+                break;
+            }
         }
-        offset += chunk_len;
     }
-    return 0;
+
+    k_spin_unlock(&tx_lock, key);
+
+    return len;
 }
 
 void ble_comm_set_pairable(bool pairable)
@@ -299,6 +454,66 @@ int ble_comm_request_gps_status(bool enable)
     return ble_comm_send(gps_status, len);
 }
 
+static void tx_work_handler(struct k_work *work)
+{
+    int rc;
+
+    while (atomic_get(&tx_credits) > 0) {
+        if (tx_pdu_len == 0) {
+            tx_pdu_len = tx_fill_pdu(tx_pdu, MIN(max_send_len, sizeof(tx_pdu)));
+            if (tx_pdu_len == 0) {
+                break;
+            }
+        }
+
+        atomic_dec(&tx_credits);
+        rc = ble_transport_send(current_conn, tx_pdu, tx_pdu_len);
+        if (rc == -ENOMEM || rc == -ENOBUFS) {
+            // Stack is out of buffers, keep the PDU and try again shortly.
+            atomic_inc(&tx_credits);
+            tx_stats.retries++;
+            k_work_schedule(&tx_work, K_MSEC(BLE_COMM_TX_RETRY_DELAY_MS));
+            break;
+        } else if (rc < 0) {
+            // Not subscribed or disconnected, the data can't be delivered.
+            atomic_inc(&tx_credits);
+            tx_stats.errors++;
+            tx_pdu_len = 0;
+            break;
+        }
+
+        tx_stats.pdus++;
+        tx_stats.bytes += tx_pdu_len;
+        tx_pdu_len = 0;
+    }
+}
+
+static void tx_flush(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(tx_lanes); i++) {
+        ring_buf_reset(&tx_lanes[i].ring);
+    }
+    tx_cur_lane = NULL;
+    tx_pdu_len = 0;
+    atomic_set(&tx_credits, CONFIG_ZSW_BLE_COMM_TX_CREDITS);
+
+    k_spin_unlock(&tx_lock, key);
+}
+
+static void bt_sent_cb(struct bt_conn *conn)
+{
+    ARG_UNUSED(conn);
+
+    if (atomic_inc(&tx_credits) < CONFIG_ZSW_BLE_COMM_TX_CREDITS) {
+        k_work_reschedule(&tx_work, K_NO_WAIT);
+    } else {
+        // Completion from before the credits were reset on a new connection
+        atomic_dec(&tx_credits);
+    }
+}
+
 static int update_adv_interval(uint16_t interval_min, uint16_t interval_max)
 {
     int err;
@@ -382,6 +597,7 @@ static void ble_connected(struct bt_conn *conn, uint8_t err)
     }
     current_conn = bt_conn_ref(conn);
     max_send_len = 20;
+    tx_flush();
 
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     LOG_INF("Connected %s", addr);
@@ -420,6 +636,9 @@ static void ble_disconnected(struct bt_conn *conn, uint8_t reason)
         current_conn = NULL;
     }
 
+    k_work_cancel_delayable(&tx_work);
+    tx_flush();
+
     ble_chronos_state(false);
 }
 
@@ -474,3 +693,52 @@ static void bt_receive_cb(struct bt_conn *conn, const uint8_t *const data, uint1
 
     ble_chronos_input(data, len);
 }
+
+#ifdef CONFIG_SHELL
+static int cmd_ble_tx_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    static const char *const lane_names[] = {"high", "normal", "bulk"};
+    uint32_t elapsed_ms = k_uptime_get_32() - tx_stats.start_ms;
+
+    shell_print(sh, "%-8s %8s %8s %8s %8s %8s %8s", "Lane", "Queued", "Msgs", "Bytes", "Dropped", "Avg ms", "Max ms");
+    for (int i = 0; i < ARRAY_SIZE(tx_lanes); i++) {
+        tx_lane_t *lane = &tx_lanes[i];
+
+        shell_print(sh, "%-8s %8u %8u %8u %8u %8u %8u", lane_names[i], ring_buf_size_get(&lane->ring),
+                    lane->msgs, lane->bytes, lane->dropped, lane->msgs ? lane->latency_sum_ms / lane->msgs : 0,
+                    lane->latency_max_ms);
+    }
+
+    shell_print(sh, "PDUs:       %u, avg %u / %u bytes", tx_stats.pdus,
+                tx_stats.pdus ? tx_stats.bytes / tx_stats.pdus : 0, max_send_len);
+    shell_print(sh, "Throughput: %u B/s", elapsed_ms ? (uint32_t)(((uint64_t)tx_stats.bytes * 1000) / elapsed_ms) : 0);
+    shell_print(sh, "Credits:    %ld / %d", atomic_get(&tx_credits), CONFIG_ZSW_BLE_COMM_TX_CREDITS);
+    shell_print(sh, "Retries:    %u", tx_stats.retries);
+    shell_print(sh, "Errors:     %u", tx_stats.errors);
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        k_spinlock_key_t key = k_spin_lock(&tx_lock);
+
+        for (int i = 0; i < ARRAY_SIZE(tx_lanes); i++) {
+            tx_lanes[i].msgs = 0;
+            tx_lanes[i].bytes = 0;
+            tx_lanes[i].dropped = 0;
+            tx_lanes[i].latency_sum_ms = 0;
+            tx_lanes[i].latency_max_ms = 0;
+        }
+        k_spin_unlock(&tx_lock, key);
+        memset(&tx_stats, 0, sizeof(tx_stats));
+        tx_stats.start_ms = k_uptime_get_32();
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_ble_tx,
+                               SHELL_CMD_ARG(stats, NULL, "Show BLE TX queue statistics: ble_tx stats [reset]",
+                                             cmd_ble_tx_stats, 1, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(ble_tx, &sub_ble_tx, "BLE TX queue commands", NULL);
+#endif
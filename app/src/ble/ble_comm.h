@@ -131,18 +131,44 @@ typedef struct ble_comm_cb_data {
 
 typedef void(*on_data_cb_t)(ble_comm_cb_data_t *data);
 
+typedef enum {
+    BLE_COMM_TX_PRIO_HIGH,      // User actions, e.g. notification actions and music control
+    BLE_COMM_TX_PRIO_NORMAL,
+    BLE_COMM_TX_PRIO_BULK,      // Logs and large transfers
+    BLE_COMM_TX_PRIO_NUM,
+} ble_comm_tx_prio_t;
+
 /** @brief
  *  @return 0 when successful
 */
 int ble_comm_init(void);
 
-/** @brief
+/** @brief Queue data to send to the phone with normal priority.
+ *
+ *  Data is copied, and may be merged with other queued messages into the same notification.
  *  @param data
  *  @param len
- *  @return     0 when successful
+ *  @return     0 when successful, -EINVAL if the phone is not subscribed, -ENOMEM if the queue is full
 */
 int ble_comm_send(const uint8_t *data, uint16_t len);
 
+/** @brief Queue data to send to the phone.
+ *
+ *  Higher priority messages go out first, but a message that has started sending is never interrupted.
+ *  @param data
+ *  @param len
+ *  @param prio
+ *  @return     0 when successful, -EINVAL if the phone is not subscribed, -ENOMEM if the queue is full
+*/
+int ble_comm_send_prio(const uint8_t *data, uint16_t len, ble_comm_tx_prio_t prio);
+
+/** @brief Queue data that must start and end its own notification, for packet based protocols.
+ *  @param data
+ *  @param len
+ *  @return     0 when successful, -EINVAL if the phone is not subscribed, -ENOMEM if the queue is full
+*/
+int ble_comm_send_packet(const uint8_t *data, uint16_t len);
+
 /** @brief
  *  @param pairable
  *  @return         0 when successful
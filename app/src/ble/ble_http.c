@@ -13,97 +13,380 @@ LOG_MODULE_REGISTER(ble_http, LOG_LEVEL_DBG);
 
 #define HTTP_TIMEOUT_SECONDS 10
 
+typedef struct {
+    char *url;
+    ble_http_callback cb;
+    bool cache;
+} http_request_t;
+
+typedef struct {
+    http_request_t request;
+    uint16_t id;
+    bool active;
+    struct k_work_delayable timeout_work;
+} http_pending_t;
+
+// A copy of a cached response, waiting for its callback to be called
+typedef struct {
+    ble_http_callback cb;
+    char *response;
+} http_cache_hit_t;
+
+typedef struct {
+    char *url; // Allocated together with the response, which follows the url
+    char *response;
+    int64_t fetched_ms;
+} http_cache_entry_t;
+
 static void zbus_ble_comm_data_callback(const struct zbus_channel *chan);
 static void ble_http_timeout_handler(struct k_work *work);
+static void cache_hit_work_handler(struct k_work *work);
 
 ZBUS_LISTENER_DEFINE(ble_http_lis, zbus_ble_comm_data_callback);
 ZBUS_CHAN_DECLARE(ble_comm_data_chan);
 ZBUS_CHAN_ADD_OBS(ble_comm_data_chan, ble_http_lis, 1);
 
-static bool request_pending;
+K_MUTEX_DEFINE(ble_http_mutex);
+K_HEAP_DEFINE(ble_http_cache_heap, CONFIG_ZSW_BLE_HTTP_CACHE_SIZE);
+K_WORK_DEFINE(cache_hit_work, cache_hit_work_handler);
+
 static uint16_t request_id;
-static ble_http_callback ble_http_cb;
+static http_pending_t pending[CONFIG_ZSW_BLE_HTTP_MAX_PENDING];
+static bool pending_initialized;
 
-K_WORK_DELAYABLE_DEFINE(ble_http_timeout_work, ble_http_timeout_handler);
+// Requests waiting for a free pending slot, oldest first
+static http_request_t queue[CONFIG_ZSW_BLE_HTTP_QUEUE_SIZE];
+static uint8_t queue_head;
+static uint8_t queue_count;
 
-static void ble_http_timeout_handler(struct k_work *work)
+static http_cache_entry_t cache[CONFIG_ZSW_BLE_HTTP_CACHE_ENTRIES];
+
+static http_cache_hit_t cache_hits[CONFIG_ZSW_BLE_HTTP_QUEUE_SIZE];
+static uint8_t cache_hits_head;
+static uint8_t cache_hits_count;
+
+static void cache_free(http_cache_entry_t *entry)
 {
-    LOG_WRN("HTTP Timeout");
-    request_pending = false;
-    ble_http_cb(BLE_HTTP_STATUS_TIMEOUT, NULL);
+    k_heap_free(&ble_http_cache_heap, entry->url);
+    memset(entry, 0, sizeof(*entry));
 }
 
-static void zbus_ble_comm_data_callback(const struct zbus_channel *chan)
+// Finds a free entry if url is NULL
+static http_cache_entry_t *cache_find(const char *url)
 {
-    const struct ble_data_event *event = zbus_chan_const_msg(chan);
+    for (int i = 0; i < ARRAY_SIZE(cache); i++) {
+        if (url == NULL ? (cache[i].url == NULL) : (cache[i].url && strcmp(cache[i].url, url) == 0)) {
+            return &cache[i];
+        }
+    }
 
-    if (event->data.type == BLE_COMM_DATA_TYPE_HTTP) {
-        if (event->data.data.http_response.id != request_id) {
-            LOG_WRN("Not the expected response ID, was: %d, expected: %d", event->data.data.http_response.id, request_id);
-            return;
+    return NULL;
+}
+
+static http_cache_entry_t *cache_oldest(void)
+{
+    http_cache_entry_t *oldest = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(cache); i++) {
+        if (cache[i].url && (oldest == NULL || cache[i].fetched_ms < oldest->fetched_ms)) {
+            oldest = &cache[i];
         }
-        struct k_work_sync sync;
-        k_work_cancel_delayable_sync(&ble_http_timeout_work, &sync);
-        request_pending = false;
-
-        if (strlen(event->data.data.http_response.err) > 0) {
-            LOG_WRN("HTTP request failed: %s", event->data.data.http_response.err);
-        } else if (strlen(event->data.data.http_response.response) > 0) {
-            char *fixed_rsp = k_malloc(strlen(event->data.data.http_response.response) + 1);
-            __ASSERT(fixed_rsp, "Failed to allocate memory for fixed_rsp");
-            // As the response from Gadgetbride contains two characters like this[\\, "] instead of just one character [\"],
-            // we need to remove them for it to be avalid JSON accepted by cJSON
-            int i;
-            int j;
-            for (i = 0, j = 0; i < strlen(event->data.data.http_response.response) - 1;) {
-                if (event->data.data.http_response.response[i] == '\\' && event->data.data.http_response.response[i + 1] == '"') {
-                    fixed_rsp[j] = '\"';
-                    j++;
-                    i += 2;
-                } else {
-                    fixed_rsp[j] = event->data.data.http_response.response[i];
-                    j++;
-                    i++;
-                }
-            }
-            if (j > 0) {
-                fixed_rsp[j - 1] = '\0'; // Remove the last " as it belongs not to the data
-            } else {
-                fixed_rsp[0] = '\0';
-            }
-            ble_http_cb(BLE_HTTP_STATUS_OK, fixed_rsp);
-            k_free(fixed_rsp);
+    }
+
+    return oldest;
+}
+
+static void cache_store(const char *url, const char *response)
+{
+    size_t url_size = strlen(url) + 1;
+    size_t response_size = strlen(response) + 1;
+    http_cache_entry_t *entry;
+    char *data;
+
+    entry = cache_find(url);
+    if (entry) {
+        cache_free(entry);
+    }
+
+    // Evict the oldest responses until the new one fits
+    while ((data = k_heap_alloc(&ble_http_cache_heap, url_size + response_size, K_NO_WAIT)) == NULL) {
+        entry = cache_oldest();
+        if (entry == NULL) {
+            LOG_DBG("Response for %s too large to cache", url);
+            return;
         }
+        cache_free(entry);
+    }
+
+    entry = cache_find(NULL);
+    if (entry == NULL) {
+        entry = cache_oldest();
+        cache_free(entry);
     }
+
+    entry->url = data;
+    entry->response = &data[url_size];
+    entry->fetched_ms = k_uptime_get();
+    memcpy(entry->url, url, url_size);
+    memcpy(entry->response, response, response_size);
 }
 
-int zsw_ble_http_get(char *url, ble_http_callback cb)
+// The response is copied, as the cache entry may be replaced before the callback is called
+static int cache_hit_queue(http_cache_entry_t *entry, ble_http_callback cb)
 {
-    int ret;
-    char *request;
+    http_cache_hit_t *hit;
 
-    if (request_pending) {
-        // TODO implement a queue for requests
+    if (cache_hits_count == ARRAY_SIZE(cache_hits)) {
         return -EBUSY;
     }
 
+    hit = &cache_hits[(cache_hits_head + cache_hits_count) % ARRAY_SIZE(cache_hits)];
+    hit->response = k_malloc(strlen(entry->response) + 1);
+    if (hit->response == NULL) {
+        return -ENOMEM;
+    }
+    strcpy(hit->response, entry->response);
+    hit->cb = cb;
+    cache_hits_count++;
+    k_work_submit(&cache_hit_work);
+
+    return 0;
+}
+
+static void cache_hit_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+    http_cache_hit_t hit;
+
+    k_mutex_lock(&ble_http_mutex, K_FOREVER);
+    while (cache_hits_count > 0) {
+        hit = cache_hits[cache_hits_head];
+        cache_hits_head = (cache_hits_head + 1) % ARRAY_SIZE(cache_hits);
+        cache_hits_count--;
+        k_mutex_unlock(&ble_http_mutex);
+
+        hit.cb(BLE_HTTP_STATUS_OK, hit.response, true);
+        k_free(hit.response);
+
+        k_mutex_lock(&ble_http_mutex, K_FOREVER);
+    }
+    k_mutex_unlock(&ble_http_mutex);
+}
+
+static http_pending_t *pending_find_free(void)
+{
+    for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+        if (!pending[i].active) {
+            return &pending[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool is_requested(const char *url, ble_http_callback cb)
+{
+    for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+        if (pending[i].active && pending[i].request.cb == cb && strcmp(pending[i].request.url, url) == 0) {
+            return true;
+        }
+    }
+
+    for (int i = 0; i < queue_count; i++) {
+        http_request_t *request = &queue[(queue_head + i) % ARRAY_SIZE(queue)];
+        if (request->cb == cb && strcmp(request->url, url) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Takes ownership of request->url
+static int send_request(http_pending_t *slot, http_request_t *request)
+{
+    int ret;
+    char *msg;
+    size_t msg_size = strlen(request->url) + strlen(GB_HTTP_REQUEST_FMT) + 1;
+
     request_id++;
 
-    request = k_calloc(1, strlen(url) + strlen(GB_HTTP_REQUEST_FMT) + 1);
-    __ASSERT(request, "Failed to allocate memory for request URL");
-    memset(request, 0, strlen(url) + strlen(GB_HTTP_REQUEST_FMT) + 1);
+    msg = k_calloc(1, msg_size);
+    if (msg == NULL) {
+        k_free(request->url);
+        return -ENOMEM;
+    }
 
-    snprintf(request, strlen(url) + strlen(GB_HTTP_REQUEST_FMT) + 1, GB_HTTP_REQUEST_FMT, url, request_id);
-    ret = ble_comm_send(request, strlen(request));
-    k_free(request);
+    snprintf(msg, msg_size, GB_HTTP_REQUEST_FMT, request->url, request_id);
+    ret = ble_comm_send(msg, strlen(msg));
+    k_free(msg);
     if (ret != 0) {
+        k_free(request->url);
         return ret;
     }
 
-    ble_http_cb = cb;
-    request_pending = true;
-
-    k_work_schedule(&ble_http_timeout_work, K_SECONDS(HTTP_TIMEOUT_SECONDS));
+    slot->request = *request;
+    slot->id = request_id;
+    slot->active = true;
+    k_work_schedule(&slot->timeout_work, K_SECONDS(HTTP_TIMEOUT_SECONDS));
 
     return 0;
-}
\ No newline at end of file
+}
+
+/*
+ * Send queued requests into the free slot. Requests that fail to send are completed
+ * with an error, their callbacks are collected in failed_cbs to be called without the lock.
+ */
+static int send_queued(http_pending_t *slot, ble_http_callback *failed_cbs)
+{
+    int num_failed = 0;
+    http_request_t request;
+
+    while (queue_count > 0) {
+        request = queue[queue_head];
+        queue_head = (queue_head + 1) % ARRAY_SIZE(queue);
+        queue_count--;
+
+        if (send_request(slot, &request) == 0) {
+            break;
+        }
+        failed_cbs[num_failed++] = request.cb;
+    }
+
+    return num_failed;
+}
+
+static void complete(http_pending_t *slot, ble_http_status_code_t status, char *response)
+{
+    ble_http_callback cb = slot->request.cb;
+    ble_http_callback failed_cbs[CONFIG_ZSW_BLE_HTTP_QUEUE_SIZE];
+    int num_failed;
+
+    if (status == BLE_HTTP_STATUS_OK && slot->request.cache) {
+        cache_store(slot->request.url, response);
+    }
+    k_free(slot->request.url);
+    slot->active = false;
+
+    num_failed = send_queued(slot, failed_cbs);
+    k_mutex_unlock(&ble_http_mutex);
+
+    cb(status, response, false);
+    for (int i = 0; i < num_failed; i++) {
+        failed_cbs[i](BLE_HTTP_STATUS_ERROR, NULL, false);
+    }
+}
+
+static void ble_http_timeout_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    http_pending_t *slot = CONTAINER_OF(dwork, http_pending_t, timeout_work);
+
+    k_mutex_lock(&ble_http_mutex, K_FOREVER);
+    // The response may have completed the request while waiting for the lock, and the slot been reused
+    if (!slot->active || k_work_delayable_is_pending(dwork)) {
+        k_mutex_unlock(&ble_http_mutex);
+        return;
+    }
+
+    LOG_WRN("HTTP Timeout, id: %d", slot->id);
+    complete(slot, BLE_HTTP_STATUS_TIMEOUT, NULL);
+}
+
+static void zbus_ble_comm_data_callback(const struct zbus_channel *chan)
+{
+    const struct ble_data_event *event = zbus_chan_const_msg(chan);
+    http_pending_t *slot = NULL;
+
+    if (event->data.type != BLE_COMM_DATA_TYPE_HTTP) {
+        return;
+    }
+
+    k_mutex_lock(&ble_http_mutex, K_FOREVER);
+    for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+        if (pending[i].active && pending[i].id == event->data.data.http_response.id) {
+            slot = &pending[i];
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        LOG_WRN("No request with response ID: %d", event->data.data.http_response.id);
+        k_mutex_unlock(&ble_http_mutex);
+        return;
+    }
+
+    k_work_cancel_delayable(&slot->timeout_work);
+
+    if (strlen(event->data.data.http_response.err) > 0) {
+        LOG_WRN("HTTP request failed: %s", event->data.data.http_response.err);
+        complete(slot, BLE_HTTP_STATUS_ERROR, NULL);
+    } else {
+        complete(slot, BLE_HTTP_STATUS_OK, (char *)event->data.data.http_response.response);
+    }
+}
+
+static int http_get(char *url, ble_http_callback cb, bool use_cache, uint32_t max_age_s)
+{
+    http_request_t request;
+    http_cache_entry_t *entry;
+    http_pending_t *slot;
+    int ret = 0;
+
+    k_mutex_lock(&ble_http_mutex, K_FOREVER);
+
+    if (!pending_initialized) {
+        for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+            k_work_init_delayable(&pending[i].timeout_work, ble_http_timeout_handler);
+        }
+        pending_initialized = true;
+    }
+
+    if (use_cache) {
+        entry = cache_find(url);
+        if (entry && (k_uptime_get() - entry->fetched_ms) < (int64_t)max_age_s * MSEC_PER_SEC) {
+            LOG_DBG("Cached response for %s", url);
+            ret = cache_hit_queue(entry, cb);
+            goto out;
+        }
+    }
+
+    // The same request is already on its way, the callback will be called when it completes
+    if (is_requested(url, cb)) {
+        goto out;
+    }
+
+    request.url = k_malloc(strlen(url) + 1);
+    if (request.url == NULL) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    strcpy(request.url, url);
+    request.cb = cb;
+    request.cache = use_cache;
+
+    slot = pending_find_free();
+    if (slot) {
+        ret = send_request(slot, &request);
+    } else if (queue_count < ARRAY_SIZE(queue)) {
+        queue[(queue_head + queue_count) % ARRAY_SIZE(queue)] = request;
+        queue_count++;
+    } else {
+        k_free(request.url);
+        ret = -EBUSY;
+    }
+
+out:
+    k_mutex_unlock(&ble_http_mutex);
+    return ret;
+}
+
+int zsw_ble_http_get(char *url, ble_http_callback cb)
+{
+    return http_get(url, cb, false, 0);
+}
+
+int zsw_ble_http_get_cached(char *url, ble_http_callback cb, uint32_t max_age_s)
+{
+    return http_get(url, cb, true, max_age_s);
+}
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdint.h>
 #include "cJSON.h"
 
@@ -5,6 +6,7 @@ typedef enum {
     BLE_HTTP_STATUS_OK,
     BLE_HTTP_STATUS_TIMEOUT,
     BLE_HTTP_STATUS_BUSY,
+    BLE_HTTP_STATUS_ERROR,
 } ble_http_status_code_t;
 
 /**
@@ -12,10 +14,11 @@ typedef enum {
  *
  * This callback function is invoked when an HTTP GET request has been completed.
  *
- * @param status    The status of the HTTP GET request.
- * @param response  The response data.
+ * @param status      The status of the HTTP GET request.
+ * @param response    The response data.
+ * @param from_cache  True if the response is a cached one and not newly fetched.
  */
-typedef void (*ble_http_callback)(ble_http_status_code_t status, char *response);
+typedef void (*ble_http_callback)(ble_http_status_code_t status, char *response, bool from_cache);
 
 /**
  * @brief Sends an HTTP GET request to the specified URL.
@@ -25,8 +28,24 @@ typedef void (*ble_http_callback)(ble_http_status_code_t status, char *response)
  * JSON format. The cJSON object parameter will be deleted automatically after the callback function returns.
  * Hence it shall not attempt to deleted in the callback.
  *
+ * Several requests can be outstanding at once, and more are queued until one completes. A request for
+ * a URL that is already outstanding with the same callback is not sent again.
+ *
+ * @param url The URL to send the GET request to.
+ * @param cb The callback function to invoke when the response is received.
+ * @return Returns 0 on success, -EBUSY if the queue is full, or a negative error code on failure.
+ */
+int zsw_ble_http_get(char *url, ble_http_callback cb);
+
+/**
+ * @brief Same as zsw_ble_http_get(), but the response is cached.
+ *
+ * If a response for the URL was received less than max_age_s ago, no request is sent. The callback is
+ * instead called with the cached response from the system workqueue, with from_cache set.
+ *
  * @param url The URL to send the GET request to.
  * @param cb The callback function to invoke when the response is received.
- * @return Returns 0 on success, or a negative error code on failure.
+ * @param max_age_s Maximum age in seconds of a cached response to use.
+ * @return Returns 0 on success, -EBUSY if the queue is full, or a negative error code on failure.
  */
-int zsw_ble_http_get(char *url, ble_http_callback cb);
\ No newline at end of file
+int zsw_ble_http_get_cached(char *url, ble_http_callback cb, uint32_t max_age_s);
\ No newline at end of file
@@ -23,6 +23,7 @@
 #include <zephyr/logging/log_ctrl.h>
 #include <zephyr/logging/log_output.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/base64.h>
 #include <zephyr/kernel.h>
 
 #include "ble/ble_comm.h"
@@ -35,18 +36,49 @@
 #define BLE_LOG_BACKEND_BUF_SIZE 256
 #define BLE_LOG_PREFIX "<BLELOG>"
 #define BLE_LOG_SUFFIX "</BLELOG>"
+// Dictionary log data is binary, so it's base64 encoded to not break the text based NUS protocol.
+#define BLE_LOG_DICT_PREFIX "<BLELOGD>"
+#define BLE_LOG_DICT_SUFFIX "</BLELOGD>"
+#define BASE64_ENCODED_LEN(len) (4 * DIV_ROUND_UP(len, 3))
+#define BLE_LOG_TAGS_LEN (sizeof(BLE_LOG_PREFIX) - 1 + sizeof(BLE_LOG_SUFFIX) - 1)
+#define BLE_LOG_DICT_TAGS_LEN (sizeof(BLE_LOG_DICT_PREFIX) - 1 + sizeof(BLE_LOG_DICT_SUFFIX) - 1)
+// Replaces the end of a text message that does not fit in the batch
+#define BLE_LOG_TRUNCATED_MARKER "...\r\n"
+// base64_encode() also writes a null terminator, the suffix is copied over it
+#define BLE_LOG_FRAME_SIZE (sizeof(BLE_LOG_DICT_PREFIX) - 1 + BASE64_ENCODED_LEN(CONFIG_ZSW_BLE_LOG_BATCH_SIZE) + \
+                            sizeof(BLE_LOG_DICT_SUFFIX))
 
 // Wait this long after connection before sending logs
 #define BLE_LOG_CONN_DELAY_MS 3000
 
+static void flush_work_handler(struct k_work *work);
+
 static uint8_t output_buf[BLE_LOG_BACKEND_BUF_SIZE];
 static bool panic_mode;
+#ifdef CONFIG_ZSW_BLE_LOG_FORMAT_DICTIONARY
+static uint32_t log_format_current = LOG_OUTPUT_DICT;
+#else
 static uint32_t log_format_current = LOG_OUTPUT_TEXT;
+#endif
 static bool first_enable;
 static bool backend_active;
 static int64_t ble_conn_time_ms;
 static atomic_t ble_connected = ATOMIC_INIT(0);
 
+/*
+ * Formatted log messages are collected here and sent as one frame, instead of one
+ * frame per line. Frames only end between messages, so dictionary data can be decoded
+ * frame by frame on the host.
+ */
+static uint8_t batch_buf[CONFIG_ZSW_BLE_LOG_BATCH_SIZE];
+static size_t batch_len;
+static size_t batch_msg_start;
+static bool batch_truncated;
+static uint8_t frame_buf[BLE_LOG_FRAME_SIZE];
+
+K_MUTEX_DEFINE(batch_mutex);
+K_WORK_DELAYABLE_DEFINE(flush_work, flush_work_handler);
+
 static void ble_log_backend_connected(struct bt_conn *conn, uint8_t err)
 {
     if (err == 0) {
@@ -67,50 +99,163 @@ BT_CONN_CB_DEFINE(ble_log_backend_conn_cb) = {
 
 static const struct log_backend log_backend_ble_comm;
 
+static bool can_send(void)
+{
+    // Too soon after connect the phone is still busy setting up the connection
+    return atomic_get(&ble_connected) && ((k_uptime_get() - ble_conn_time_ms) >= BLE_LOG_CONN_DELAY_MS);
+}
+
+static void send_frame(const uint8_t *data, size_t len)
+{
+    size_t frame_len = 0;
+    size_t encoded_len;
+
+    if (len == 0) {
+        return;
+    }
+
+    if (log_format_current == LOG_OUTPUT_DICT) {
+        memcpy(frame_buf, BLE_LOG_DICT_PREFIX, strlen(BLE_LOG_DICT_PREFIX));
+        frame_len += strlen(BLE_LOG_DICT_PREFIX);
+        if (base64_encode(&frame_buf[frame_len], sizeof(frame_buf) - frame_len, &encoded_len, data, len) != 0) {
+            return;
+        }
+        frame_len += encoded_len;
+        memcpy(&frame_buf[frame_len], BLE_LOG_DICT_SUFFIX, strlen(BLE_LOG_DICT_SUFFIX));
+        frame_len += strlen(BLE_LOG_DICT_SUFFIX);
+    } else {
+        memcpy(frame_buf, BLE_LOG_PREFIX, strlen(BLE_LOG_PREFIX));
+        frame_len += strlen(BLE_LOG_PREFIX);
+        memcpy(&frame_buf[frame_len], data, len);
+        frame_len += len;
+        memcpy(&frame_buf[frame_len], BLE_LOG_SUFFIX, strlen(BLE_LOG_SUFFIX));
+        frame_len += strlen(BLE_LOG_SUFFIX);
+    }
+
+    // Logs are dropped if the queue is full, nothing else can be done about it here.
+    if (can_send()) {
+        ble_comm_send_prio(frame_buf, frame_len, BLE_COMM_TX_PRIO_BULK);
+    }
+}
+
+// Must be called with batch_mutex held
+static void flush_complete_messages(void)
+{
+    send_frame(batch_buf, batch_msg_start);
+    memmove(batch_buf, &batch_buf[batch_msg_start], batch_len - batch_msg_start);
+    batch_len -= batch_msg_start;
+    batch_msg_start = 0;
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_mutex_lock(&batch_mutex, K_FOREVER);
+    flush_complete_messages();
+    k_mutex_unlock(&batch_mutex);
+}
+
 static int line_out(uint8_t *data, size_t length, void *ctx)
 {
     ARG_UNUSED(ctx);
 
-    if (!atomic_get(&ble_connected)) {
-        // Not connected, pretend to send all
+    if (batch_truncated) {
         return length;
     }
-    int64_t now = k_uptime_get();
-    if ((now - ble_conn_time_ms) < BLE_LOG_CONN_DELAY_MS) {
-        // Too soon after connect, pretend to send all
-        return length;
+
+    if (batch_len + length > sizeof(batch_buf)) {
+        flush_complete_messages();
     }
 
-    const size_t capped_len = MIN(length, (size_t)UINT16_MAX);
+    if (batch_len + length > sizeof(batch_buf)) {
+        // A single message larger than the batch, keep its start and drop the rest of it
+        memcpy(&batch_buf[batch_len], data, sizeof(batch_buf) - batch_len);
+        batch_len = sizeof(batch_buf);
+        batch_truncated = true;
+        return length;
+    }
 
-    ble_comm_send((const uint8_t *)BLE_LOG_PREFIX, strlen(BLE_LOG_PREFIX));
-    ble_comm_send(data, (uint16_t)capped_len);
-    ble_comm_send((const uint8_t *)BLE_LOG_SUFFIX, strlen(BLE_LOG_SUFFIX));
+    memcpy(&batch_buf[batch_len], data, length);
+    batch_len += length;
 
     return length;
 }
 
+// Must be called with batch_mutex held, after the whole message was output
+static void end_truncated_message(void)
+{
+    if (log_format_current == LOG_OUTPUT_DICT) {
+        // Part of a dictionary message can't be decoded, drop all of it
+        batch_len = batch_msg_start;
+    } else {
+        batch_len = MAX(batch_msg_start, sizeof(batch_buf) - strlen(BLE_LOG_TRUNCATED_MARKER));
+        memcpy(&batch_buf[batch_len], BLE_LOG_TRUNCATED_MARKER, sizeof(batch_buf) - batch_len);
+        batch_len = sizeof(batch_buf);
+    }
+    batch_truncated = false;
+}
+
+// Largest batch that is sent in a single notification once the frame tags are added
+static size_t frame_payload_max(int mtu)
+{
+    // 3 bytes of ATT header
+    int space = mtu - 3;
+
+    if (log_format_current == LOG_OUTPUT_DICT) {
+        space = ((space - (int)BLE_LOG_DICT_TAGS_LEN) / 4) * 3;
+    } else {
+        space -= BLE_LOG_TAGS_LEN;
+    }
+
+    return MAX(space, 1);
+}
+
 LOG_OUTPUT_DEFINE(log_output_ble_comm, line_out, output_buf, sizeof(output_buf));
 
 static void process(const struct log_backend *const backend, union log_msg_generic *msg)
 {
     ARG_UNUSED(backend);
+    int mtu;
 
     if (panic_mode) {
         return;
     }
 
+    if (!can_send()) {
+        return;
+    }
+
     uint32_t flags = LOG_OUTPUT_FLAG_LEVEL | LOG_OUTPUT_FLAG_TIMESTAMP;
     log_format_func_t log_output_func = log_format_func_t_get(log_format_current);
 
+    k_mutex_lock(&batch_mutex, K_FOREVER);
     log_output_func(&log_output_ble_comm, &msg->log, flags);
+    if (batch_truncated) {
+        end_truncated_message();
+    }
+    batch_msg_start = batch_len;
+
+    // Send right away if a notification can be filled, otherwise wait for more messages
+    mtu = ble_comm_get_mtu();
+    if ((mtu > 0) && (batch_len >= frame_payload_max(mtu))) {
+        flush_complete_messages();
+        k_work_cancel_delayable(&flush_work);
+    } else if (batch_len > 0) {
+        k_work_schedule(&flush_work, K_MSEC(CONFIG_ZSW_BLE_LOG_FLUSH_INTERVAL_MS));
+    }
+    k_mutex_unlock(&batch_mutex);
 }
 
 static int format_set(const struct log_backend *const backend, uint32_t log_type)
 {
     ARG_UNUSED(backend);
 
+    k_mutex_lock(&batch_mutex, K_FOREVER);
+    flush_complete_messages();
     log_format_current = log_type;
+    k_mutex_unlock(&batch_mutex);
+
     return 0;
 }
 
@@ -42,6 +42,15 @@ static ssize_t on_receive(struct bt_conn *conn,
     return len;
 }
 
+static void on_sent(struct bt_conn *conn, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    if (callbacks->data_sent) {
+        callbacks->data_sent(conn);
+    }
+}
+
 BT_GATT_SERVICE_DEFINE(nus_service,
                        BT_GATT_PRIMARY_SERVICE(BLE_TRANSPORT_UUID_SERVICE),
                        BT_GATT_CHARACTERISTIC(BLE_TRANSPORT_UUID_TX,
@@ -87,10 +96,16 @@ int ble_transport_send(struct bt_conn *connection, const uint8_t *data, uint16_t
     params.attr = attr;
     params.data = data;
     params.len = length;
+    params.func = on_sent;
 
-    if (connection && bt_gatt_is_subscribed(connection, attr, BT_GATT_CCC_NOTIFY)) {
+    if (ble_transport_is_subscribed(connection)) {
         return bt_gatt_notify_cb(connection, &params);
     } else {
         return -EINVAL;
     }
 }
+
+bool ble_transport_is_subscribed(struct bt_conn *connection)
+{
+    return connection && bt_gatt_is_subscribed(connection, &nus_service.attrs[2], BT_GATT_CCC_NOTIFY);
+}
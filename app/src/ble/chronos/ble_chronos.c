@@ -3,6 +3,7 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/kernel.h>
 #include <zephyr/zbus/zbus.h>
+#include <zephyr/sys/ring_buffer.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
@@ -23,12 +24,23 @@ LOG_MODULE_REGISTER(ble_chronos, CONFIG_ZSW_BLE_LOG_LEVEL);
 
 // static void parse_time(char *data);
 static void music_control_event_callback(const struct zbus_channel *chan);
+static void rx_work_handler(struct k_work *work);
 
 ZBUS_CHAN_DECLARE(ble_comm_data_chan);
 ZBUS_LISTENER_DEFINE(android_music_control_lis_chronos, music_control_event_callback);
 
 static chronos_data_t incoming; // variable to store incoming data
 
+// Fragments prefixed with their length, single producer (NUS RX callback) and single consumer (rx_work).
+RING_BUF_DECLARE(rx_ring, CONFIG_ZSW_CHRONOS_RX_RING_SIZE);
+static K_WORK_DEFINE(rx_work, rx_work_handler);
+static uint32_t rx_dropped_fragments;
+// Set by a disconnect, the producer queues RX_DISCONNECT_LEN before the data of the next connection
+static atomic_t rx_disconnected;
+
+// Queued in place of a fragment length where the connection was lost, larger than any real fragment
+#define RX_DISCONNECT_LEN       UINT16_MAX
+
 static chronos_notification_t notifications[CH_NOTIF_SIZE];
 static int notificationIndex = -1;
 
@@ -160,11 +172,53 @@ static int parse_weather()
     return 0;
 }
 
+static void rx_work_handler(struct k_work *work)
+{
+    static uint8_t fragment[CH_DATA_SIZE];
+    uint16_t len;
+
+    ARG_UNUSED(work);
+
+    // Fragments that arrived while a packet was handled are still queued in the ring.
+    // The length and the data are two puts, a fragment is only taken once all of it is queued.
+    while (ring_buf_peek(&rx_ring, (uint8_t *)&len, sizeof(len)) == sizeof(len)) {
+        if (len == RX_DISCONNECT_LEN) {
+            ring_buf_get(&rx_ring, NULL, sizeof(len));
+            // The packet being assembled belongs to the old connection, drop it
+            incoming.length = 0;
+            continue;
+        }
+
+        if (ring_buf_size_get(&rx_ring) < sizeof(len) + len) {
+            break;
+        }
+
+        ring_buf_get(&rx_ring, NULL, sizeof(len));
+        ring_buf_get(&rx_ring, fragment, len);
+        ble_chronos_on_receive_data(fragment, len);
+    }
+}
+
 void ble_chronos_input(const uint8_t *const data, uint16_t len)
 {
+    static const uint16_t disconnect_len = RX_DISCONNECT_LEN;
+
     // LOG_HEXDUMP_DBG(data, len, "RX");
     // LOG_INF("Data received, length %d", len);
-    ble_chronos_on_receive_data(data, len);
+    // Fragments always leave room for the disconnect marker, so it is never dropped
+    if (atomic_cas(&rx_disconnected, 1, 0)) {
+        ring_buf_put(&rx_ring, (const uint8_t *)&disconnect_len, sizeof(disconnect_len));
+    }
+
+    if (len > CH_DATA_SIZE || ring_buf_space_get(&rx_ring) < 2 * sizeof(len) + len) {
+        rx_dropped_fragments++;
+        LOG_ERR("Dropped %u byte fragment (%u total)", len, rx_dropped_fragments);
+    } else {
+        ring_buf_put(&rx_ring, (const uint8_t *)&len, sizeof(len));
+        ring_buf_put(&rx_ring, data, len);
+    }
+
+    k_work_submit(&rx_work);
 }
 
 void ble_chronos_state(bool connect)
@@ -176,7 +230,9 @@ void ble_chronos_state(bool connect)
         ble_chronos_send_info(); // needed to detect watch type on Chronos app
         ble_chronos_set_notify_battery(true); // needed for navigation to work
     } else {
-        // disconnected
+        // disconnected, rx_work drops the packet being assembled when it reaches this point in the ring
+        atomic_set(&rx_disconnected, 1);
+
         if (navigation.active) {
             navigation.active = false;
             if (configuration_callback != NULL) {
@@ -207,7 +263,7 @@ void ble_chronos_send_command(uint8_t *command, size_t length)
     // LOG_HEXDUMP_DBG(command, length, "Chronos TX");
     // LOG_INF("Data sent, length %d", length);
 
-    ble_comm_send(command, length);
+    ble_comm_send_packet(command, length);
 }
 
 void ble_chronos_music_control(chronos_control_t command)
@@ -417,64 +473,67 @@ const char *ble_chronos_get_app_name(int id)
 
 /* DATA FROM CHRONOS APP FUNCTIONS */
 
-// Chronos received commands (data[0] is 0xAB or 0xEA or <= 0x19) on RX characteristic.
-// this function assembles data packets that are split over multiple transmissions
+static void incoming_complete(void)
+{
+    ble_chronos_data_received();
+    incoming.length = 0;
+}
+
+// Chronos received commands (data[0] is 0xAB or 0xEA, or a fragment index) on RX characteristic.
+// This function assembles packets that are split over multiple writes. The first fragment is as large as
+// the app's writes allow, depending on the MTU, and continuation fragments start with their index.
 void ble_chronos_on_receive_data(const uint8_t *data, uint16_t len)
 {
+    int mtu = ble_comm_get_mtu();
+    int offset;
+
     // LOG_HEXDUMP_DBG(data, len, "Chronos RX");
-    if (len > 0) {
-
-        // Chronos app sends data starting with either AB or EA for the first packet and FE or FF at index 3
-        if ((data[0] == 0xAB || data[0] == 0xEA) && (data[3] == 0xFE || data[3] == 0xFF)) {
-            // start of data, assign length from packet
-            incoming.length = data[1] * 256 + data[2] + 3;
-            // copy data to incomingBuffer
-            for (int i = 0; i < len; i++) {
-                incoming.data[i] = data[i];
-            }
+    if (len == 0) {
+        return;
+    }
 
-            if (incoming.length <= len) {
-                // complete packet assembled
-                ble_chronos_data_received();
-                // Reset state after processing complete packet
-                incoming.length = 0;
-            } else {
-                // data is still being assembled
-                // LOG_INF("Incomplete");
-            }
-        } else if (data[0] < 0x19 && incoming.length > 0) {
-            // Only process subsequent packets if we have a valid ongoing Chronos data stream
-            // subsequent packets start with 0 (max anticipated is 25 -> 0x19)
-            int j = 20 + (data[0] * 19); // data packet position
-
-            // Bounds check to prevent buffer overflow
-            if (j + len - 1 <= sizeof(incoming.data) && j + len <= incoming.length) {
-                // copy data to incomingBuffer
-                for (int i = 0; i < len; i++) {
-                    incoming.data[j + i] = data[i + 1];
-                }
+    if (mtu > 3 && len > mtu - 3) {
+        LOG_WRN("Fragment of %d bytes larger than MTU %d", len, mtu);
+    }
 
-                if (incoming.length <= len + j - 1) {
-                    // complete packet assembled
-                    ble_chronos_data_received();
-                    // Reset state after processing complete packet
-                    incoming.length = 0;
-                } else {
-                    // data is still being assembled
-                    // LOG_INF("Incomplete");
-                }
-            } else {
-                LOG_WRN("Buffer bounds check failed or invalid packet sequence, resetting");
-                incoming.length = 0;  // Reset to prevent further issues
-            }
-        } else {
-            // Not Chronos data or no active session
-            if (data[0] < 0x19 && incoming.length == 0) {
-                LOG_DBG("Ignoring packet - no active Chronos session");
-            } else {
-                LOG_DBG("Not Chronos data");
-            }
+    // Chronos app sends data starting with either AB or EA for the first packet and FE or FF at index 3
+    if (len >= 4 && (data[0] == 0xAB || data[0] == 0xEA) && (data[3] == 0xFE || data[3] == 0xFF)) {
+        if (incoming.length > 0) {
+            LOG_WRN("Incomplete packet of %d bytes dropped, new packet started", incoming.length);
         }
+
+        incoming.length = data[1] * 256 + data[2] + 3;
+        if (incoming.length > sizeof(incoming.data)) {
+            LOG_WRN("Packet of %d bytes too large, dropped", incoming.length);
+            incoming.length = 0;
+            return;
+        }
+
+        memcpy(incoming.data, data, MIN(len, incoming.length));
+        incoming.fragment_size = len;
+        incoming.next_index = 0;
+
+        if (incoming.length <= len) {
+            incoming_complete();
+        }
+    } else if (incoming.length > 0) {
+        // Continuation fragments start with their index, followed by fragment_size - 1 bytes of data
+        offset = incoming.fragment_size + data[0] * (incoming.fragment_size - 1);
+
+        if (data[0] != incoming.next_index || offset + len - 1 > incoming.length) {
+            LOG_WRN("Unexpected fragment %d, expected %d, packet dropped", data[0], incoming.next_index);
+            incoming.length = 0;
+            return;
+        }
+
+        memcpy(&incoming.data[offset], &data[1], len - 1);
+        incoming.next_index++;
+
+        if (offset + len - 1 == incoming.length) {
+            incoming_complete();
+        }
+    } else {
+        LOG_DBG("Ignoring packet - no active Chronos session");
     }
 }
 
@@ -38,6 +38,8 @@ typedef enum chronos_control {
 typedef struct chronos_data {
     int length;
     uint8_t data[CH_DATA_SIZE];
+    uint16_t fragment_size; // Size of the first fragment, all but the last fragment have the same size
+    uint8_t next_index;     // Index of the next continuation fragment
 } chronos_data_t;
 
 typedef struct chronos_time {
@@ -1,13 +1,13 @@
-#include <zephyr/sys/base64.h>
 #include <zephyr/sys/reboot.h>
 #include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/kernel.h>
 #include <zephyr/zbus/zbus.h>
+#include <zephyr/sys/ring_buffer.h>
 #include <string.h>
 #include <stdio.h>
-#include <ctype.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <math.h>
@@ -24,6 +24,7 @@
 #include "managers/zsw_power_manager.h"
 #include "managers/zsw_smp_manager.h"
 #include "ble_gadgetbridge.h"
+#include "gb_tokenizer.h"
 #include "app_version.h"
 
 #ifdef CONFIG_APPLICATIONS_USE_VOICE_MEMO
@@ -33,23 +34,60 @@
 
 LOG_MODULE_REGISTER(ble_gadgetbridge, CONFIG_ZSW_BLE_LOG_LEVEL);
 
+#define MESSAGE_TYPE_HASH_SIZE  32
+#define MAX_COMMAND_LINE_LENGTH 64
+// Queued where bytes are missing from the stream, never part of the UTF-8 text Gadgetbridge sends
+#define RX_RESYNC_BYTE          0xFF
+
 typedef enum parse_state {
-    WAIT_GB,
-    WAIT_END,
-    PARSE_STATE_DONE,
+    WAIT_GB,        // Outside a frame, collecting a command line such as setTime(...)
+    WAIT_END,       // Inside GB(...), collecting the JSON object
+    DISCARD_FRAME,  // Frame does not fit in receive_buf, skipping to its end
 } parse_state_t;
 
+typedef struct gb_message_handler {
+    const char *type;
+    int (*handler)(const gb_message_t *msg);
+} gb_message_handler_t;
+
 static uint8_t num_parsed_brackets;
+static bool in_string;
+static bool in_escape;
+static uint8_t gb_start_matched; // Number of bytes of "GB(" matched so far
 static parse_state_t parse_state = WAIT_GB;
 static uint16_t parsed_data_index = 0;
 static uint8_t receive_buf[MAX_GB_PACKET_LENGTH];
+static char command_line[MAX_COMMAND_LINE_LENGTH];
+static uint8_t command_line_len;
+// Index + 1 into message_handlers, 0 when no type hashes to the slot
+static uint8_t message_type_table[MESSAGE_TYPE_HASH_SIZE];
 
 static void music_control_event_callback(const struct zbus_channel *chan);
 static void parse_time_zone(char *offset);
+static void rx_work_handler(struct k_work *work);
+
+// Single producer (NUS RX callback) and single consumer (rx_work), so no locking is needed.
+RING_BUF_DECLARE(rx_ring, CONFIG_ZSW_GADGETBRIDGE_RX_RING_SIZE);
+static K_WORK_DEFINE(rx_work, rx_work_handler);
+static uint32_t rx_dropped_bytes;
+// Fragments are being dropped, only the first drop of a burst is logged as a warning
+static bool rx_dropping;
+// Set by a disconnect, the producer queues RX_RESYNC_BYTE before the data of the next connection
+static atomic_t rx_disconnected;
 
 ZBUS_CHAN_DECLARE(ble_comm_data_chan);
 ZBUS_LISTENER_DEFINE(android_music_control_lis, music_control_event_callback);
 
+static void ble_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    // A frame cut by the disconnect is never finished, start the next connection clean
+    atomic_set(&rx_disconnected, 1);
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+    .disconnected = ble_disconnected,
+};
+
 #ifdef CONFIG_APPLICATIONS_USE_VOICE_MEMO
 static void on_ble_recording_event(const struct zbus_channel *chan);
 ZBUS_CHAN_DECLARE(voice_memo_recording_chan);
@@ -126,7 +164,7 @@ static void music_control_event_callback(const struct zbus_channel *chan)
             break;
     }
     if (msg_len > 0) {
-        ble_comm_send(buf, msg_len);
+        ble_comm_send_prio(buf, msg_len, BLE_COMM_TX_PRIO_HIGH);
     }
 }
 
@@ -176,364 +214,39 @@ static void parse_time_zone(char *offset)
     }
 }
 
-static char *extract_value_str(char *key, char *data, int *value_len)
-{
-    bool base64 = false;
-    char *start;
-    char *end;
-    char *str = strstr(data, key);
-    *value_len = 0;
-    if (str == NULL) {
-        return NULL;
-    }
-    str += strlen(key);
-
-    if (strncmp(str, "atob(", strlen("atob(")) == 0) {
-        str += strlen("atob(");
-        base64 = true;
-    }
-
-    if (*str != '\"') {
-        return NULL; // Seems to be an INT?
-    }
-    str++;
-    if (*str == '\0') {
-        return NULL; // Got end of data
-    }
-    end = strstr(str, "\"");
-    if (end == NULL) {
-        return NULL; // No end of value
-    }
-
-    start = str;
-    if (base64) {
-        // Since the size of the decoded result is 33% smaller, the decoded result can be stored in the original text buffer
-        size_t msg_size = end - start;
-        size_t decoded_len;
-        base64_decode(str, msg_size, &decoded_len, str, msg_size);
-        *value_len = decoded_len;
-    } else {
-        *value_len = end - start;
-    }
-
-    return start;
-}
-
-static uint32_t extract_value_uint32(char *key, char *data)
-{
-    char *start;
-    char *str = strstr(data, key);
-    char *end;
-    uint32_t id;
-
-    if (str == NULL) {
-        return 0;
-    }
-    str += strlen(key);
-    if (!isdigit((int) * str)) {
-        return 0; // No number found
-    }
-    start = str;
-    id = strtol(str, &end, 10);
-    // TODO error checking
-    return id;
-}
-
-static int32_t extract_value_int32(char *key, char *data)
-{
-    char *start;
-    char *str = strstr(data, key);
-    char *end;
-    int32_t id;
-
-    if (str == NULL) {
-        return 0;
-    }
-    str += strlen(key);
-    if (!isdigit((int) * str)) {
-        return 0; // No number found
-    }
-    start = str;
-    id = strtol(str, &end, 10);
-    // TODO error checking
-    return id;
-}
-
-static bool is_valid_utf8(const char *data, int len)
-{
-    int i = 0;
-    while (i < len && data[i] != '\0') {
-        // Check for Gadgetbridge's "\xNN" string escape pattern
-        if (data[i] == '\\' && i + 3 < len && data[i + 1] == 'x') {
-            return false; // Contains Gadgetbridge-style escape sequences
-        }
-
-        uint8_t byte = (uint8_t)data[i];
-        if (byte <= 0x7F) {
-            // ASCII - valid single byte
-            i++;
-        } else if ((byte & 0xE0) == 0xC0) {
-            // 2-byte UTF-8 sequence (0xC0-0xDF)
-            if (i + 1 >= len || ((uint8_t)data[i + 1] & 0xC0) != 0x80) {
-                return false; // Invalid continuation byte
-            }
-            i += 2;
-        } else if ((byte & 0xF0) == 0xE0) {
-            // 3-byte UTF-8 sequence (0xE0-0xEF)
-            if (i + 2 >= len ||
-                ((uint8_t)data[i + 1] & 0xC0) != 0x80 ||
-                ((uint8_t)data[i + 2] & 0xC0) != 0x80) {
-                return false;
-            }
-            i += 3;
-        } else if ((byte & 0xF8) == 0xF0) {
-            // 4-byte UTF-8 sequence (0xF0-0xF7)
-            if (i + 3 >= len ||
-                ((uint8_t)data[i + 1] & 0xC0) != 0x80 ||
-                ((uint8_t)data[i + 2] & 0xC0) != 0x80 ||
-                ((uint8_t)data[i + 3] & 0xC0) != 0x80) {
-                return false;
-            }
-            i += 4;
-        } else {
-            // Invalid UTF-8 start byte (0x80-0xBF or 0xF8-0xFF)
-            // This includes Gadgetbridge's raw high bytes like 0xF6 for 'ö'
-            return false;
-        }
-    }
-    return true;
-}
-
-static void convert_to_encoded_text(char *data, int len, char *out_data, int out_buf_len)
-{
-    int i = 0, j = 0;
-    // https://www.utf8-chartable.de/
-    uint8_t basic_latin_utf16_to_utf8_table[0x80][3] = {
-        // utf-16 => 2 byte utf-8
-        {0x80, 0xc2, 0x80},
-        {0x81, 0xc2, 0x81},
-        {0x82, 0xc2, 0x82},
-        {0x83, 0xc2, 0x83},
-        {0x84, 0xc2, 0x84},
-        {0x85, 0xc2, 0x85},
-        {0x86, 0xc2, 0x86},
-        {0x87, 0xc2, 0x87},
-        {0x88, 0xc2, 0x88},
-        {0x89, 0xc2, 0x89},
-        {0x8A, 0xc2, 0x8a},
-        {0x8B, 0xc2, 0x8b},
-        {0x8C, 0xc2, 0x8c},
-        {0x8D, 0xc2, 0x8d},
-        {0x8E, 0xc2, 0x8e},
-        {0x8F, 0xc2, 0x8f},
-        {0x90, 0xc2, 0x90},
-        {0x91, 0xc2, 0x91},
-        {0x92, 0xc2, 0x92},
-        {0x93, 0xc2, 0x93},
-        {0x94, 0xc2, 0x94},
-        {0x95, 0xc2, 0x95},
-        {0x96, 0xc2, 0x96},
-        {0x97, 0xc2, 0x97},
-        {0x98, 0xc2, 0x98},
-        {0x99, 0xc2, 0x99},
-        {0x9A, 0xc2, 0x9a},
-        {0x9B, 0xc2, 0x9b},
-        {0x9C, 0xc2, 0x9c},
-        {0x9D, 0xc2, 0x9d},
-        {0x9E, 0xc2, 0x9e},
-        {0x9F, 0xc2, 0x9f},
-        {0xA0, 0xc2, 0xa0},
-        {0xA1, 0xc2, 0xa1},
-        {0xA2, 0xc2, 0xa2},
-        {0xA3, 0xc2, 0xa3},
-        {0xA4, 0xc2, 0xa4},
-        {0xA5, 0xc2, 0xa5},
-        {0xA6, 0xc2, 0xa6},
-        {0xA7, 0xc2, 0xa7},
-        {0xA8, 0xc2, 0xa8},
-        {0xA9, 0xc2, 0xa9},
-        {0xAA, 0xc2, 0xaa},
-        {0xAB, 0xc2, 0xab},
-        {0xAC, 0xc2, 0xac},
-        {0xAD, 0xc2, 0xad},
-        {0xAE, 0xc2, 0xae},
-        {0xAF, 0xc2, 0xaf},
-        {0xB0, 0xc2, 0xb0},
-        {0xB1, 0xc2, 0xb1},
-        {0xB2, 0xc2, 0xb2},
-        {0xB3, 0xc2, 0xb3},
-        {0xB4, 0xc2, 0xb4},
-        {0xB5, 0xc2, 0xb5},
-        {0xB6, 0xc2, 0xb6},
-        {0xB7, 0xc2, 0xb7},
-        {0xB8, 0xc2, 0xb8},
-        {0xB9, 0xc2, 0xb9},
-        {0xBA, 0xc2, 0xba},
-        {0xBB, 0xc2, 0xbb},
-        {0xBC, 0xc2, 0xbc},
-        {0xBD, 0xc2, 0xbd},
-        {0xBE, 0xc2, 0xbe},
-        {0xBF, 0xc2, 0xbf},
-        {0xC0, 0xc3, 0x80},
-        {0xC1, 0xc3, 0x81},
-        {0xC2, 0xc3, 0x82},
-        {0xC3, 0xc3, 0x83},
-        {0xC4, 0xc3, 0x84},
-        {0xC5, 0xc3, 0x85},
-        {0xC6, 0xc3, 0x86},
-        {0xC7, 0xc3, 0x87},
-        {0xC8, 0xc3, 0x88},
-        {0xC9, 0xc3, 0x89},
-        {0xCA, 0xc3, 0x8a},
-        {0xCB, 0xc3, 0x8b},
-        {0xCC, 0xc3, 0x8c},
-        {0xCD, 0xc3, 0x8d},
-        {0xCE, 0xc3, 0x8e},
-        {0xCF, 0xc3, 0x8f},
-        {0xD0, 0xc3, 0x90},
-        {0xD1, 0xc3, 0x91},
-        {0xD2, 0xc3, 0x92},
-        {0xD3, 0xc3, 0x93},
-        {0xD4, 0xc3, 0x94},
-        {0xD5, 0xc3, 0x95},
-        {0xD6, 0xc3, 0x96},
-        {0xD7, 0xc3, 0x97},
-        {0xD8, 0xc3, 0x98},
-        {0xD9, 0xc3, 0x99},
-        {0xDA, 0xc3, 0x9a},
-        {0xDB, 0xc3, 0x9b},
-        {0xDC, 0xc3, 0x9c},
-        {0xDD, 0xc3, 0x9d},
-        {0xDE, 0xc3, 0x9e},
-        {0xDF, 0xc3, 0x9f},
-        {0xE0, 0xc3, 0xa0},
-        {0xE1, 0xc3, 0xa1},
-        {0xE2, 0xc3, 0xa2},
-        {0xE3, 0xc3, 0xa3},
-        {0xE4, 0xc3, 0xa4},
-        {0xE5, 0xc3, 0xa5},
-        {0xE6, 0xc3, 0xa6},
-        {0xE7, 0xc3, 0xa7},
-        {0xE8, 0xc3, 0xa8},
-        {0xE9, 0xc3, 0xa9},
-        {0xEA, 0xc3, 0xaa},
-        {0xEB, 0xc3, 0xab},
-        {0xEC, 0xc3, 0xac},
-        {0xED, 0xc3, 0xad},
-        {0xEE, 0xc3, 0xae},
-        {0xEF, 0xc3, 0xaf},
-        {0xF0, 0xc3, 0xb0},
-        {0xF1, 0xc3, 0xb1},
-        {0xF2, 0xc3, 0xb2},
-        {0xF3, 0xc3, 0xb3},
-        {0xF4, 0xc3, 0xb4},
-        {0xF5, 0xc3, 0xb5},
-        {0xF6, 0xc3, 0xb6},
-        {0xF7, 0xc3, 0xb7},
-        {0xF8, 0xc3, 0xb8},
-        {0xF9, 0xc3, 0xb9},
-        {0xFA, 0xc3, 0xba},
-        {0xFB, 0xc3, 0xbb},
-        {0xFC, 0xc3, 0xbc},
-        {0xFD, 0xc3, 0xbd},
-        {0xFE, 0xc3, 0xbe},
-        {0xFF, 0xc3, 0xbf},
-    };
-
-    // For none ascii characters Gadgetbridge encodes them in a strange utf-16 way.
-    // For example Gadgetbridge sends ö as just 0xF6 byte, but then it sends ä as "\xe4" (4 bytes) string.
-    // Which is very strange.
-    // LVGL works with ascii, and properly formatted utf-8.
-    while (data[i] != '\0' && i < len - 3 && j < out_buf_len - 3) {
-        if (data[i] == '\\' && data[i + 1] == 'x') {
-            // Parse string "\xe4" as 0xe4
-            char hex[3] = {data[i + 2], data[i + 3], '\0'};
-            int value = strtol(hex, NULL, 16);
-            if (value < 0x80) {
-                // Character encoded in a string, but it's an normal ascii, just copy it.
-                out_data[j] = value;
-            } else {
-                // Character encoded as "\xe4" (4 bytes)
-                out_data[j] = basic_latin_utf16_to_utf8_table[value - 0x80][1];
-                j++;
-                out_data[j] = basic_latin_utf16_to_utf8_table[value - 0x80][2];
-                j++;
-            }
-            i += 4;
-        } else if (data[i] >= 0x80) {
-            // Character encoded as utf-16, but in a single byte and the value is not ascii.
-            out_data[j] = basic_latin_utf16_to_utf8_table[data[i] - 0x80][1];
-            j++;
-            out_data[j] = basic_latin_utf16_to_utf8_table[data[i] - 0x80][2];
-            j++;
-            i++;
-        } else {
-            // Ascii character, just copy it.
-            out_data[j] = data[i];
-            i++;
-            j++;
-        }
-    }
-    // Copy the rest of the data
-    for (; i < len; i++) {
-        out_data[j] = data[i];
-        j++;
-    }
-    out_data[j] = '\0';
-}
-
-static int parse_notify(char *data, int len)
+static int parse_notify(const gb_message_t *msg)
 {
     struct ble_data_event cb;
     memset(&cb, 0, sizeof(cb));
 
+    // All string values are decoded and null terminated in place by the tokenizer.
     cb.data.type = BLE_COMM_DATA_TYPE_NOTIFY;
-    cb.data.data.notify.id = extract_value_uint32("\"id\":", data);
-    cb.data.data.notify.src = extract_value_str("\"src\":", data, &cb.data.data.notify.src_len);
-    cb.data.data.notify.sender = extract_value_str("\"sender\":", data, &cb.data.data.notify.sender_len);
-    cb.data.data.notify.title = extract_value_str("\"title\":", data, &cb.data.data.notify.title_len);
-    cb.data.data.notify.subject = extract_value_str("\"subject\":", data, &cb.data.data.notify.subject_len);
-    cb.data.data.notify.body = extract_value_str("\"body\":", data, &cb.data.data.notify.body_len);
-
-    // Little hack since we know it's JSON, we can terminate all values in the data
-    // which saves us some hassle and we can just pass all values null terminated
-    // to the callback. Make sure to do it after finish parsing!
-    if (cb.data.data.notify.src) {
-        cb.data.data.notify.src[cb.data.data.notify.src_len] = '\0';
-    }
-    if (cb.data.data.notify.sender) {
-        cb.data.data.notify.sender[cb.data.data.notify.sender_len] = '\0';
-    }
-    if (cb.data.data.notify.title) {
-        cb.data.data.notify.title[cb.data.data.notify.title_len] = '\0';
-    }
-
-    if (cb.data.data.notify.subject) {
-        cb.data.data.notify.subject[cb.data.data.notify.subject_len] = '\0';
-    }
-    if (cb.data.data.notify.body) {
-        cb.data.data.notify.body[cb.data.data.notify.body_len] = '\0';
-    }
+    cb.data.data.notify.id = gb_message_get_uint32(msg, "id");
+    cb.data.data.notify.src = gb_message_get_str(msg, "src", &cb.data.data.notify.src_len);
+    cb.data.data.notify.sender = gb_message_get_str(msg, "sender", &cb.data.data.notify.sender_len);
+    cb.data.data.notify.title = gb_message_get_str(msg, "title", &cb.data.data.notify.title_len);
+    cb.data.data.notify.subject = gb_message_get_str(msg, "subject", &cb.data.data.notify.subject_len);
+    cb.data.data.notify.body = gb_message_get_str(msg, "body", &cb.data.data.notify.body_len);
 
     send_ble_data_event(&cb);
 
     return 0;
 }
 
-static int parse_notify_delete(char *data, int len)
+static int parse_notify_delete(const gb_message_t *msg)
 {
     struct ble_data_event cb;
     memset(&cb, 0, sizeof(cb));
 
     cb.data.type = BLE_COMM_DATA_TYPE_NOTIFY_REMOVE;
-    cb.data.data.notify.id = extract_value_uint32("\"id\":", data);
+    cb.data.data.notify.id = gb_message_get_uint32(msg, "id");
 
     send_ble_data_event(&cb);
 
     return 0;
 }
 
-static int parse_weather(char *data, int len)
+static int parse_weather(const gb_message_t *msg)
 {
     //{t:"weather",temp:268,hum:97,code:802,txt:"slightly cloudy",wind:2.0,wdir:14,loc:"MALMO"
     int temp_len;
@@ -543,15 +256,15 @@ static int parse_weather(char *data, int len)
     memset(&cb, 0, sizeof(cb));
 
     cb.data.type = BLE_COMM_DATA_TYPE_WEATHER;
-    int32_t temperature_k = extract_value_uint32("\"temp\":", data);
-    cb.data.data.weather.humidity = extract_value_uint32("\"hum\":", data);
-    cb.data.data.weather.weather_code = extract_value_uint32("\"code\":", data);
-    cb.data.data.weather.wind = extract_value_uint32("\"wind\":", data);
-    cb.data.data.weather.wind_direction = extract_value_uint32("\"wdir\":", data);
-    temp_value = extract_value_str("\"txt\":", data, &temp_len);
-
-    strncpy(cb.data.data.weather.report_text, temp_value, MIN(temp_len, MAX_WEATHER_REPORT_TEXT_LENGTH - 1));
-    cb.data.data.weather.report_text[MAX_WEATHER_REPORT_TEXT_LENGTH - 1] = '\0';
+    int32_t temperature_k = gb_message_get_uint32(msg, "temp");
+    cb.data.data.weather.humidity = gb_message_get_uint32(msg, "hum");
+    cb.data.data.weather.weather_code = gb_message_get_uint32(msg, "code");
+    cb.data.data.weather.wind = gb_message_get_uint32(msg, "wind");
+    cb.data.data.weather.wind_direction = gb_message_get_uint32(msg, "wdir");
+    temp_value = gb_message_get_str(msg, "txt", &temp_len);
+    if (temp_value) {
+        strncpy(cb.data.data.weather.report_text, temp_value, MIN(temp_len, MAX_WEATHER_REPORT_TEXT_LENGTH - 1));
+    }
 
     // App sends temperature in Kelvin
     temperature = temperature_k - 273.15f;
@@ -562,58 +275,60 @@ static int parse_weather(char *data, int len)
     return 0;
 }
 
-static int parse_musicinfo(char *data, int len)
+static void copy_str(const gb_message_t *msg, const char *key, char *dst, size_t dst_size)
+{
+    int len;
+    char *value = gb_message_get_str(msg, key, &len);
+
+    if (value) {
+        strncpy(dst, value, MIN(len, dst_size - 1));
+    }
+}
+
+static int parse_musicinfo(const gb_message_t *msg)
 {
     // {t:"musicinfo",artist:"Ava Max",album:"Heaven & Hell",track:"Sweet but Psycho",dur:187,c:-1,n:-1}
-    char *temp_value;
-    int temp_len;
     struct ble_data_event cb;
     memset(&cb, 0, sizeof(cb));
 
     cb.data.type = BLE_COMM_DATA_TYPE_MUSIC_INFO;
-    cb.data.data.music_info.duration = extract_value_int32("\"dur\":", data);
-    cb.data.data.music_info.track_count = extract_value_int32("\"c\":", data);
-    cb.data.data.music_info.track_num = extract_value_int32("\"n\":", data);
-    temp_value = extract_value_str("\"artist\":", data, &temp_len);
-    strncpy(cb.data.data.music_info.artist, temp_value, MIN(temp_len, MAX_MUSIC_FIELD_LENGTH));
-    temp_value = extract_value_str("\"album\":", data, &temp_len);
-    strncpy(cb.data.data.music_info.album, temp_value, MIN(temp_len, MAX_MUSIC_FIELD_LENGTH));
-    temp_value = extract_value_str("\"track\":", data, &temp_len);
-    strncpy(cb.data.data.music_info.track_name, temp_value, MIN(temp_len, MAX_MUSIC_FIELD_LENGTH));
+    cb.data.data.music_info.duration = gb_message_get_int32(msg, "dur");
+    cb.data.data.music_info.track_count = gb_message_get_int32(msg, "c");
+    cb.data.data.music_info.track_num = gb_message_get_int32(msg, "n");
+    copy_str(msg, "artist", cb.data.data.music_info.artist, sizeof(cb.data.data.music_info.artist));
+    copy_str(msg, "album", cb.data.data.music_info.album, sizeof(cb.data.data.music_info.album));
+    copy_str(msg, "track", cb.data.data.music_info.track_name, sizeof(cb.data.data.music_info.track_name));
 
     send_ble_data_event(&cb);
 
     return 0;
 }
 
-static int parse_musicstate(char *data, int len)
+static int parse_musicstate(const gb_message_t *msg)
 {
-    // {t:"musicinfo",artist:"Ava Max",album:"Heaven & Hell",track:"Sweet but Psycho",dur:187,c:-1,n:-1}
+    // {t:"musicstate",state:"play",position:0,shuffle:1,repeat:1}
     char *temp_value;
     int temp_len;
     struct ble_data_event cb;
     memset(&cb, 0, sizeof(cb));
 
     cb.data.type = BLE_COMM_DATA_TYPE_MUSIC_STATE;
-    cb.data.data.music_state.position = extract_value_int32("\"position\":", data);
-    cb.data.data.music_state.shuffle = extract_value_int32("\"shuffle\":", data);
-    cb.data.data.music_state.repeat = extract_value_int32("\"repeat\":", data);
+    cb.data.data.music_state.position = gb_message_get_int32(msg, "position");
+    cb.data.data.music_state.shuffle = gb_message_get_int32(msg, "shuffle");
+    cb.data.data.music_state.repeat = gb_message_get_int32(msg, "repeat");
 
-    temp_value = extract_value_str("\"state\":", data, &temp_len);
-    if (strncmp(temp_value, "play", temp_len) == 0) {
-        cb.data.data.music_state.playing = true;
-    } else {
-        cb.data.data.music_state.playing = false;
-    }
+    temp_value = gb_message_get_str(msg, "state", &temp_len);
+    cb.data.data.music_state.playing = temp_value && strcmp(temp_value, "play") == 0;
 
     send_ble_data_event(&cb);
 
     return 0;
 }
 
-static int parse_httpstate(char *data, int len)
+static int parse_httpstate(const gb_message_t *msg)
 {
     // {"t":"http","resp":"{\"response_code\":0,\"results\":[{\"type\":\"boolean\",\"difficulty\":\"easy\",\"category\":\"Geography\",\"question\":\"Hungary is the only country in the world beginning with H.\",\"correct_answer\":\"False\",\"incorrect_answers\":[\"True\"]}]}"}
+    const gb_token_t *id;
     char *temp_value;
     int temp_len;
     struct ble_data_event cb;
@@ -621,32 +336,31 @@ static int parse_httpstate(char *data, int len)
 
     cb.data.type = BLE_COMM_DATA_TYPE_HTTP;
 
-    temp_value = extract_value_str("\"id\":", data, &temp_len);
-    if (temp_value) {
+    // The request sends the id as a string, which Gadgetbridge echoes back
+    id = gb_message_find(msg, "id");
+    cb.data.data.http_response.id = -1;
+    if (id && (id->type == GB_TOKEN_STRING || id->type == GB_TOKEN_NUMBER)) {
         errno = 0;
         char *end_data;
-        cb.data.data.http_response.id  = strtol(temp_value, &end_data, 10);
-        if (temp_value == end_data || errno != 0) {
+        cb.data.data.http_response.id = strtol(id->value, &end_data, 10);
+        if (id->value == end_data || errno != 0) {
             LOG_WRN("Failed parsing http request id");
             cb.data.data.http_response.id = -1;
         }
-    } else {
-        cb.data.data.http_response.id = -1;
     }
 
     // {"t":"http","err":"Internet access not enabled in this Gadgetbridge build"}
-    temp_value = extract_value_str("\"err\":", data, &temp_len);
+    temp_value = gb_message_get_str(msg, "err", &temp_len);
 
     if (temp_value != NULL) {
         LOG_ERR("HTTP err: %s", temp_value);
-        memcpy(cb.data.data.http_response.err, temp_value, temp_len);
+        memcpy(cb.data.data.http_response.err, temp_value, MIN(temp_len, MAX_HTTP_FIELD_LENGTH));
         send_ble_data_event(&cb);
     } else {
-        temp_value = extract_value_str("\"resp\":", data, &temp_len);
+        temp_value = gb_message_get_str(msg, "resp", &temp_len);
         if (temp_value) {
             LOG_DBG("HTTP response: %s", temp_value);
-            memcpy(cb.data.data.http_response.response, temp_value,
-                   (strlen(temp_value) > MAX_HTTP_FIELD_LENGTH) ? MAX_HTTP_FIELD_LENGTH : strlen(temp_value)); /// @todo cast?
+            memcpy(cb.data.data.http_response.response, temp_value, MIN(temp_len, MAX_HTTP_FIELD_LENGTH));
             send_ble_data_event(&cb);
         }
     }
@@ -654,7 +368,7 @@ static int parse_httpstate(char *data, int len)
     return 0;
 }
 
-static int parse_gps_data(char *data, int len)
+static int parse_gps_data(const gb_message_t *msg)
 {
     //{"t":"gps","lat":55.6135542,"lon":12.9747185,"alt":41.900001525878906,"speed":0.1458607256412506,"time":1717002933835,"satellites":0,"hdop":16.215999603271484,"externalSource":true,"gpsSource":"network"}
     struct ble_data_event cb;
@@ -662,82 +376,52 @@ static int parse_gps_data(char *data, int len)
 
     cb.data.type = BLE_COMM_DATA_TYPE_GPS;
 
-    cJSON *root = cJSON_Parse(data);
-    if (root == NULL) {
-        LOG_ERR("Failed to parse GPS data");
-        return -EINVAL;
-    }
-
-    cJSON *lat = cJSON_GetObjectItem(root, "lat");
-    cJSON *lon = cJSON_GetObjectItem(root, "lon");
-    cJSON *alt = cJSON_GetObjectItem(root, "alt");
-    cJSON *speed = cJSON_GetObjectItem(root, "speed");
-    cJSON *time = cJSON_GetObjectItem(root, "time");
-    cJSON *satellites = cJSON_GetObjectItem(root, "satellites");
-    cJSON *hdop = cJSON_GetObjectItem(root, "hdop");
-
-    cb.data.data.gps.lat = lat != NULL ? lat->valuedouble : -1;
-    cb.data.data.gps.lon = lon != NULL ? lon->valuedouble : -1;
-    cb.data.data.gps.alt = alt != NULL ? alt->valuedouble : -1;
-    cb.data.data.gps.speed = speed != NULL ? speed->valuedouble : -1;
-    cb.data.data.gps.time = time != NULL ? time->valuedouble : -1;
-    cb.data.data.gps.satellites = satellites != NULL ? satellites->valueint : -1;
-    cb.data.data.gps.hdop = hdop != NULL ? hdop->valuedouble : -1;
-
-    cJSON_Delete(root);
+    cb.data.data.gps.lat = gb_message_get_double(msg, "lat", -1);
+    cb.data.data.gps.lon = gb_message_get_double(msg, "lon", -1);
+    cb.data.data.gps.alt = gb_message_get_double(msg, "alt", -1);
+    cb.data.data.gps.speed = gb_message_get_double(msg, "speed", -1);
+    cb.data.data.gps.time = gb_message_get_double(msg, "time", -1);
+    cb.data.data.gps.satellites = gb_message_get_double(msg, "satellites", -1);
+    cb.data.data.gps.hdop = gb_message_get_double(msg, "hdop", -1);
 
     send_ble_data_event(&cb);
 
     return 0;
 }
 
-static int parse_log_command(char *data, int len)
+static int parse_log_command(const gb_message_t *msg)
 {
-    (void) len;
+    bool enabled;
 
-    cJSON *root = cJSON_Parse(data);
-    if (root == NULL) {
-        LOG_ERR("Failed to parse log command");
-        return -EINVAL;
-    }
-
-    cJSON *status = cJSON_GetObjectItem(root, "status");
-    if (!cJSON_IsBool(status)) {
+    if (gb_message_get_bool(msg, "status", &enabled) != 0) {
         LOG_WRN("Log command missing status");
-        cJSON_Delete(root);
         return -EINVAL;
     }
 
-    bool enabled = cJSON_IsTrue(status);
-
     ble_log_backend_set_enabled(enabled);
     LOG_INF("BLE logging %s via command", enabled ? "enabled" : "disabled");
 
-    cJSON_Delete(root);
-
     return 0;
 }
 
-static int parse_smp_command(char *data, int len)
+static int parse_version_request(const gb_message_t *msg)
 {
-    (void)len;
+    ARG_UNUSED(msg);
 
-    cJSON *root = cJSON_Parse(data);
-    if (root == NULL) {
-        LOG_ERR("Failed to parse smp command");
-        return -EINVAL;
-    }
+    ble_gadgetbridge_send_version_info();
 
-    cJSON *status = cJSON_GetObjectItem(root, "status");
-    if (!cJSON_IsBool(status)) {
+    return 0;
+}
+
+static int parse_smp_command(const gb_message_t *msg)
+{
+    bool enable;
+
+    if (gb_message_get_bool(msg, "status", &enable) != 0) {
         LOG_WRN("smp command missing 'status'");
-        cJSON_Delete(root);
         return -EINVAL;
     }
 
-    bool enable = cJSON_IsTrue(status);
-    cJSON_Delete(root);
-
 #ifdef CONFIG_MCUMGR
     int rc;
     if (enable) {
@@ -755,10 +439,9 @@ static int parse_smp_command(char *data, int len)
 }
 
 // {"t":"reset"}
-static int parse_reset_command(char *data, int len)
+static int parse_reset_command(const gb_message_t *msg)
 {
-    ARG_UNUSED(data);
-    ARG_UNUSED(len);
+    ARG_UNUSED(msg);
     LOG_INF("Reboot requested via companion app");
     /* Short delay to let the BLE response/ACK go out */
     k_sleep(K_MSEC(500));
@@ -767,31 +450,21 @@ static int parse_reset_command(char *data, int len)
     return 0;
 }
 
-static int parse_voice_memo_command(char *data, int len)
+static int parse_voice_memo_command(const gb_message_t *msg)
 {
 #ifndef CONFIG_APPLICATIONS_USE_VOICE_MEMO
-    ARG_UNUSED(data);
-    ARG_UNUSED(len);
+    ARG_UNUSED(msg);
     LOG_WRN("voice_memo: app not enabled");
     return -ENOTSUP;
 #else
-    cJSON *root = cJSON_Parse(data);
-    if (root == NULL) {
-        LOG_WRN("voice_memo: JSON parse failed");
-        return -EINVAL;
-    }
-
-    cJSON *action_obj = cJSON_GetObjectItem(root, "action");
-    if (!cJSON_IsString(action_obj)) {
+    int len;
+    const char *action = gb_message_get_str(msg, "action", &len);
+    if (action == NULL) {
         LOG_WRN("voice_memo: missing action");
-        cJSON_Delete(root);
         return -EINVAL;
     }
-    const char *action = action_obj->valuestring;
 
     if (strcmp(action, "list") == 0) {
-        cJSON_Delete(root);
-
         /* Build JSON response with recording list */
         zsw_recording_entry_t entries[50];
         int count = zsw_recording_manager_list(entries, ARRAY_SIZE(entries));
@@ -833,61 +506,56 @@ static int parse_voice_memo_command(char *data, int len)
         return 0;
     }
 
+    const char *filename = gb_message_get_str(msg, "filename", &len);
+
     if (strcmp(action, "delete") == 0) {
-        cJSON *fn_obj = cJSON_GetObjectItem(root, "filename");
-        if (!cJSON_IsString(fn_obj) || fn_obj->valuestring[0] == '\0') {
+        if (filename == NULL || filename[0] == '\0') {
             LOG_WRN("voice_memo delete: missing filename");
-            cJSON_Delete(root);
             return -EINVAL;
         }
 
-        int ret = zsw_recording_manager_delete(fn_obj->valuestring);
+        int ret = zsw_recording_manager_delete(filename);
         if (ret < 0) {
             LOG_ERR("voice_memo: delete failed: %d", ret);
         } else {
-            LOG_INF("voice_memo: deleted '%s'", fn_obj->valuestring);
+            LOG_INF("voice_memo: deleted '%s'", filename);
         }
-        cJSON_Delete(root);
         return ret;
     }
 
     if (strcmp(action, "result") == 0) {
-        cJSON *title_obj = cJSON_GetObjectItem(root, "text");
-        if (!cJSON_IsString(title_obj) || title_obj->valuestring[0] == '\0') {
+        const char *title = gb_message_get_str(msg, "text", &len);
+        if (title == NULL || title[0] == '\0') {
             LOG_WRN("voice_memo result: missing text");
-            cJSON_Delete(root);
             return -EINVAL;
         }
 
-        cJSON *fn_obj = cJSON_GetObjectItem(root, "filename");
-        cJSON *atype_obj = cJSON_GetObjectItem(root, "action_type");
-        cJSON *dt_obj = cJSON_GetObjectItem(root, "datetime");
+        const char *action_type = gb_message_get_str(msg, "action_type", &len);
+        const char *datetime = gb_message_get_str(msg, "datetime", &len);
 
         LOG_DBG("voice_memo: result received, file='%s', type='%s', dt='%s'",
-                cJSON_IsString(fn_obj) ? fn_obj->valuestring : "?",
-                cJSON_IsString(atype_obj) ? atype_obj->valuestring : "?",
-                cJSON_IsString(dt_obj) ? dt_obj->valuestring : "?");
+                filename ? filename : "?",
+                action_type ? action_type : "?",
+                datetime ? datetime : "?");
 
         ZBUS_CHAN_DECLARE(voice_memo_result_chan);
         struct zsw_voice_memo_result_event result_evt = {0};
-        strncpy(result_evt.title, title_obj->valuestring, sizeof(result_evt.title) - 1);
-        if (cJSON_IsString(fn_obj)) {
-            strncpy(result_evt.filename, fn_obj->valuestring, sizeof(result_evt.filename) - 1);
+        strncpy(result_evt.title, title, sizeof(result_evt.title) - 1);
+        if (filename) {
+            strncpy(result_evt.filename, filename, sizeof(result_evt.filename) - 1);
         }
-        if (cJSON_IsString(atype_obj)) {
-            strncpy(result_evt.action_type, atype_obj->valuestring, sizeof(result_evt.action_type) - 1);
+        if (action_type) {
+            strncpy(result_evt.action_type, action_type, sizeof(result_evt.action_type) - 1);
         }
-        if (cJSON_IsString(dt_obj)) {
-            strncpy(result_evt.datetime, dt_obj->valuestring, sizeof(result_evt.datetime) - 1);
+        if (datetime) {
+            strncpy(result_evt.datetime, datetime, sizeof(result_evt.datetime) - 1);
         }
         zbus_chan_pub(&voice_memo_result_chan, &result_evt, K_MSEC(100));
 
-        cJSON_Delete(root);
         return 0;
     }
 
     LOG_WRN("voice_memo: unknown action '%s'", action);
-    cJSON_Delete(root);
     return -ENOTSUP;
 #endif /* CONFIG_APPLICATIONS_USE_VOICE_MEMO */
 }
@@ -937,63 +605,40 @@ static int send_watchface_bg_result(const char *action, int rc)
     return rc;
 }
 
-static int parse_watchface_bg_command(char *data, int len)
+static int parse_watchface_bg_command(const gb_message_t *msg)
 {
-    ARG_UNUSED(len);
-
-    cJSON *root = cJSON_Parse(data);
-    if (root == NULL) {
-        LOG_WRN("watchface_bg: JSON parse failed");
-        return -EINVAL;
-    }
-
-    cJSON *action_obj = cJSON_GetObjectItem(root, "action");
-    if (!cJSON_IsString(action_obj)) {
+    int len;
+    const char *action = gb_message_get_str(msg, "action", &len);
+    if (action == NULL) {
         LOG_WRN("watchface_bg: missing action");
-        cJSON_Delete(root);
         return send_watchface_bg_result("unknown", -EINVAL);
     }
 
     int rc;
-    const char *action = action_obj->valuestring;
     if (strcmp(action, "apply") == 0) {
-        cJSON_Delete(root);
         rc = watchface_app_reload_bg();
         return send_watchface_bg_result("apply", rc);
     }
 
     if (strcmp(action, "reset") == 0) {
-        cJSON_Delete(root);
         rc = watchface_app_reset_bg();
         return send_watchface_bg_result("reset", rc);
     }
 
     LOG_WRN("watchface_bg: unknown action '%s'", action);
-    cJSON_Delete(root);
     return send_watchface_bg_result("unknown", -ENOTSUP);
 }
 
 /* {"t":"find","n":true/false} */
-static int parse_find_command(char *data, int len)
+static int parse_find_command(const gb_message_t *msg)
 {
-    ARG_UNUSED(len);
+    bool find;
 
-    cJSON *root = cJSON_Parse(data);
-    if (root == NULL) {
-        LOG_ERR("Failed to parse find command");
-        return -EINVAL;
-    }
-
-    cJSON *n = cJSON_GetObjectItem(root, "n");
-    if (!cJSON_IsBool(n)) {
+    if (gb_message_get_bool(msg, "n", &find) != 0) {
         LOG_WRN("Find command missing 'n'");
-        cJSON_Delete(root);
         return -EINVAL;
     }
 
-    bool find = cJSON_IsTrue(n);
-    cJSON_Delete(root);
-
     if (find) {
         /* starts the vibration motor and wake display */
         (void)zsw_vibration_run_pattern_loop(ZSW_VIBRATION_PATTERN_FIND);
@@ -1011,189 +656,272 @@ static int parse_find_command(char *data, int len)
     return 0;
 }
 
-static int parse_data(char *data, int len)
+static const gb_message_handler_t message_handlers[] = {
+    {"notify", parse_notify},
+    {"notify-", parse_notify_delete},
+    {"weather", parse_weather},
+    {"musicinfo", parse_musicinfo},
+    {"musicstate", parse_musicstate},
+    {"http", parse_httpstate},
+    {"gps", parse_gps_data},
+    {"log", parse_log_command},
+    {"ver", parse_version_request},
+    {"voice_memo", parse_voice_memo_command},
+    {"watchface_bg", parse_watchface_bg_command},
+    {"smp", parse_smp_command},
+    {"reset", parse_reset_command},
+    {"find", parse_find_command},
+};
+
+// Collision free for all types above, checked when the table is built and by app/tools/gb_parser_bench.
+static inline uint8_t message_type_hash(const char *type, size_t len)
 {
-    int type_len;
-    char *type;
-    uint8_t input_data_utf8[MAX_GB_PACKET_LENGTH];
-
-    // Only convert if data contains Gadgetbridge's non-standard encoding.
-    // Properly UTF-8 encoded data should pass through unchanged.
-    if (!is_valid_utf8(data, len)) {
-        memset(input_data_utf8, 0, sizeof(input_data_utf8));
-        // Convert data from Gadgetbridge into properly encoded text.
-        convert_to_encoded_text(data, len, input_data_utf8, sizeof(input_data_utf8));
-        data = input_data_utf8;
-    }
+    return (((uint8_t)type[0] << 1) ^ (uint8_t)type[len - 1] ^ (len << 1)) & (MESSAGE_TYPE_HASH_SIZE - 1);
+}
 
-    type = extract_value_str("\"t\":", data, &type_len);
-    if (type == NULL) {
-        return -1;
-    }
+static bool message_type_collision;
 
-    if (strlen("notify") == type_len && strncmp(type, "notify", type_len) == 0) {
-        return parse_notify(data, len);
+static void build_message_type_table(void)
+{
+    for (int i = 0; i < ARRAY_SIZE(message_handlers); i++) {
+        const char *type = message_handlers[i].type;
+        uint8_t hash = message_type_hash(type, strlen(type));
+
+        // Also checked in release builds, a type added later must not take over another type's slot
+        if (message_type_table[hash] != 0) {
+            LOG_ERR("Message type hash collision for %s and %s, using a linear search", type,
+                    message_handlers[message_type_table[hash] - 1].type);
+            message_type_collision = true;
+            continue;
+        }
+        message_type_table[hash] = i + 1;
     }
+}
 
-    if (strlen("notify-") == type_len && strncmp(type, "notify-", type_len) == 0) {
-        return parse_notify_delete(data, len);
-    }
+static const gb_message_handler_t *find_message_handler(const char *type, int type_len)
+{
+    uint8_t index = message_type_table[message_type_hash(type, type_len)];
 
-    if (strlen("weather") == type_len && strncmp(type, "weather", type_len) == 0) {
-        return parse_weather(data, len);
+    if (index != 0 && strcmp(message_handlers[index - 1].type, type) == 0) {
+        return &message_handlers[index - 1];
     }
 
-    if (strlen("musicinfo") == type_len && strncmp(type, "musicinfo", type_len) == 0) {
-        return parse_musicinfo(data, len);
+    if (message_type_collision) {
+        for (int i = 0; i < ARRAY_SIZE(message_handlers); i++) {
+            if (strcmp(message_handlers[i].type, type) == 0) {
+                return &message_handlers[i];
+            }
+        }
     }
 
-    if (strlen("musicstate") == type_len && strncmp(type, "musicstate", type_len) == 0) {
-        return parse_musicstate(data, len);
-    }
+    return NULL;
+}
 
-    if (strlen("http") == type_len && strncmp(type, "http", type_len) == 0) {
-        return parse_httpstate(data, len);
+static int parse_data(char *data, int len)
+{
+    static bool message_type_table_built;
+    static gb_message_t msg;
+    const gb_message_handler_t *handler;
+    char *type;
+    int type_len;
+    int rc;
+
+    if (!message_type_table_built) {
+        build_message_type_table();
+        message_type_table_built = true;
     }
 
-    if (strlen("gps") == type_len && strncmp(type, "gps", type_len) == 0) {
-        return parse_gps_data(data, len);
+    // receive_buf is the only caller, so the whole buffer can be used when decoding grows the data.
+    rc = gb_tokenize(data, len, sizeof(receive_buf), &msg);
+    if (rc != 0) {
+        LOG_WRN("Failed to tokenize message: %d", rc);
+        return rc;
     }
 
-    if (strlen("log") == type_len && strncmp(type, "log", type_len) == 0) {
-        return parse_log_command(data, len);
+    type = gb_message_get_str(&msg, "t", &type_len);
+    if (type == NULL || type_len == 0) {
+        return -1;
     }
 
-    if (strlen("ver") == type_len && strncmp(type, "ver", type_len) == 0) {
-        ble_gadgetbridge_send_version_info();
+    handler = find_message_handler(type, type_len);
+    if (handler == NULL) {
         return 0;
     }
 
-    if (strlen("voice_memo") == type_len && strncmp(type, "voice_memo", type_len) == 0) {
-        return parse_voice_memo_command(data, len);
-    }
+    return handler->handler(&msg);
+}
+
+static void parse_command_line(void)
+{
+    char *time_start;
+    char *offset;
 
-    if (strlen("watchface_bg") == type_len && strncmp(type, "watchface_bg", type_len) == 0) {
-        return parse_watchface_bg_command(data, len);
+    command_line[command_line_len] = '\0';
+    command_line_len = 0;
+
+    // setTime(1700556601);E.setTimeZone(1.0);(... is parsed as two commands, each ending at its ')'
+    time_start = strstr(command_line, "setTime(");
+    if (time_start) {
+        parse_time(time_start + strlen("setTime("));
+        return;
     }
 
-    if (strlen("smp") == type_len && strncmp(type, "smp", type_len) == 0) {
-        return parse_smp_command(data, len);
+    // ie. ;E.setTimeZone(1.0);
+    offset = strstr(command_line, ";E.setTimeZone(");
+    if (offset) {
+        parse_time_zone(offset + strlen(";E.setTimeZone("));
     }
+}
 
-    if (strlen("reset") == type_len && strncmp(type, "reset", type_len) == 0) {
-        return parse_reset_command(data, len);
+static void start_frame(void)
+{
+    if (parse_state != WAIT_GB) {
+        LOG_ERR("Parsing error, was waiting end, but got GB");
     }
 
-    if (strlen("find") == type_len && strncmp(type, "find", type_len) == 0) {
-        return parse_find_command(data, len);
+    parse_state = WAIT_END;
+    num_parsed_brackets = 0;
+    parsed_data_index = 0;
+    in_string = false;
+    in_escape = false;
+    command_line_len = 0;
+}
+
+static void end_frame(void)
+{
+    if (parse_state == WAIT_END) {
+        receive_buf[parsed_data_index] = '\0';
+        LOG_DBG("%s", receive_buf);
+        parse_data(receive_buf, parsed_data_index);
     }
 
-    return 0;
+    parse_state = WAIT_GB;
+    in_string = false;
+    in_escape = false;
 }
 
-void ble_gadgetbridge_input(const uint8_t *const data, uint16_t len)
+static void reset_parser(void)
 {
-    LOG_HEXDUMP_DBG(data, len, "RX");
+    parse_state = WAIT_GB;
+    num_parsed_brackets = 0;
+    parsed_data_index = 0;
+    in_string = false;
+    in_escape = false;
+    gb_start_matched = 0;
+    command_line_len = 0;
+}
 
-    // NULL terminate the data to make string parsing easier and safer.
-    char *safe_buf = k_malloc(len + 1);
-    if (safe_buf == NULL) {
-        LOG_ERR("Failed to allocate %u bytes for NUS parse buffer", len + 1);
-        return;
+static void parse_byte(char c)
+{
+    // A new frame inside an unfinished one means the rest of that frame was lost.
+    // Strings are only tracked inside a frame, a quote in a command line must not hide the next GB(.
+    if (parse_state == WAIT_GB || !in_string) {
+        gb_start_matched = (c == "GB("[gb_start_matched]) ? gb_start_matched + 1 : (c == 'G');
+        if (gb_start_matched == strlen("GB(")) {
+            gb_start_matched = 0;
+            start_frame();
+            return;
+        }
     }
-    memcpy(safe_buf, data, len);
-    safe_buf[len] = '\0';
 
-    char *gb_start = strstr(safe_buf, "GB(");
-    if (gb_start && parse_state != WAIT_GB) {
-        LOG_ERR("Parsing error, was waiting end, but got GB");
-        parse_state = WAIT_GB;
+    if (parse_state == WAIT_GB) {
+        if (c != '\n') {
+            // Text that is not a command we parse, start over rather than lose the next command
+            if (command_line_len >= sizeof(command_line) - 1) {
+                command_line_len = 0;
+            }
+            command_line[command_line_len++] = c;
+        }
+        // A command is complete at its closing parenthesis, phones don't always end the line with '\n'
+        if (c == '\n' || c == ')') {
+            parse_command_line();
+        }
+        return;
     }
 
-    char *time_start = strstr(safe_buf, "setTime(");
-    if (time_start && parse_state == WAIT_GB) {
-        time_start += strlen("setTime(");
-        parse_time(time_start);
-        goto done;
+    if (parse_state == WAIT_END) {
+        // Keep one byte for the null terminator
+        if (parsed_data_index >= sizeof(receive_buf) - 1) {
+            LOG_ERR("Data from Gadgetbridge does not fit in receive_buf (%zu)", sizeof(receive_buf));
+            parse_state = DISCARD_FRAME;
+        } else {
+            receive_buf[parsed_data_index++] = c;
+        }
     }
 
-    // ie. ;E.setTimeZone(1.0);
-    char *offset = strstr(safe_buf, ";E.setTimeZone(");
-    if (offset && parse_state == WAIT_GB) {
-        offset += strlen(";E.setTimeZone(");
-        parse_time_zone(offset);
-        goto done;
+    // Braces inside strings, e.g. in a notification body, don't end the frame.
+    if (in_string) {
+        if (in_escape) {
+            in_escape = false;
+        } else if (c == '\\') {
+            in_escape = true;
+        } else if (c == '"') {
+            in_string = false;
+        }
+    } else if (c == '"') {
+        in_string = true;
+    } else if (c == '{') {
+        num_parsed_brackets++;
+    } else if (c == '}' && num_parsed_brackets > 0) {
+        num_parsed_brackets--;
+        if (num_parsed_brackets == 0) {
+            end_frame();
+        }
     }
+}
 
-    size_t receive_buf_capacity = sizeof(receive_buf);
-
-    switch (parse_state) {
-        case WAIT_GB: {
-            if (gb_start) {
-                gb_start += 3;
-                parse_state = WAIT_END;
-                num_parsed_brackets = 0;
-                parsed_data_index = 0;
-                memset(receive_buf, 0, sizeof(receive_buf));
-                uint32_t index = gb_start - safe_buf;
-                for (int i = index; i < len; i++) {
-                    if (parsed_data_index >= receive_buf_capacity) {
-                        LOG_ERR("Data from Gadgetbridge does not fit in receive_buf (%zu)", receive_buf_capacity);
-                        parse_state = WAIT_GB;
-                        break;
-                    }
-                    receive_buf[parsed_data_index] = safe_buf[i];
-                    parsed_data_index++;
-                    if (safe_buf[i] == '{') {
-                        num_parsed_brackets++;
-                    } else if (safe_buf[i] == '}') {
-                        num_parsed_brackets--;
-                        if (num_parsed_brackets == 0) {
-                            parse_state = PARSE_STATE_DONE;
-                            break;
-                        }
-                    }
-                }
-            }
-            break;
-        }
-        case WAIT_END: {
-            for (int i = 0; i < len; i++) {
-                if (parsed_data_index >= receive_buf_capacity) {
-                    LOG_ERR("Data from Gadgetbridge does not fit in receive_buf (%zu)", receive_buf_capacity);
-                    parse_state = WAIT_GB;
-                    break;
-                }
-                receive_buf[parsed_data_index] = safe_buf[i];
-                parsed_data_index++;
-                if (safe_buf[i] == '{') {
-                    num_parsed_brackets++;
-                } else if (safe_buf[i] == '}') {
-                    num_parsed_brackets--;
-                    if (num_parsed_brackets == 0) {
-                        parse_state = PARSE_STATE_DONE;
-                        break;
-                    }
-                }
+static void rx_work_handler(struct k_work *work)
+{
+    uint8_t *data;
+    uint32_t len;
+
+    ARG_UNUSED(work);
+
+    // Frames that arrived while the previous one was parsed are still queued in the ring.
+    while ((len = ring_buf_get_claim(&rx_ring, &data, CONFIG_ZSW_GADGETBRIDGE_RX_RING_SIZE)) > 0) {
+        for (uint32_t i = 0; i < len; i++) {
+            // The frame being parsed lost its next bytes, drop it rather than join it to what follows
+            if (data[i] == RX_RESYNC_BYTE) {
+                reset_parser();
+            } else {
+                parse_byte(data[i]);
             }
-            break;
-        }
-        case PARSE_STATE_DONE: {
-            LOG_WRN("Busy parsing, ingnoring...");
-            break;
         }
-        default:
-            LOG_WRN("Unhandled state");
-            break;
+        ring_buf_get_finish(&rx_ring, len);
     }
-    if (parse_state == PARSE_STATE_DONE) {
-        parse_state = WAIT_GB;
-        LOG_DBG("%s", receive_buf);
-        parse_data(receive_buf, parsed_data_index);
+}
+
+static void rx_put_resync(void)
+{
+    static const uint8_t resync = RX_RESYNC_BYTE;
+
+    // Data always leaves a byte free, a full ring already ends with a resync byte
+    if (ring_buf_space_get(&rx_ring) > 0) {
+        ring_buf_put(&rx_ring, &resync, 1);
+    }
+}
+
+void ble_gadgetbridge_input(const uint8_t *const data, uint16_t len)
+{
+    if (atomic_cas(&rx_disconnected, 1, 0)) {
+        rx_put_resync();
+    }
+
+    // Fragments are dropped whole, a partial one would be glued to the next and look valid.
+    // One byte is kept free for the resync byte that marks where the data is missing.
+    if (ring_buf_space_get(&rx_ring) < len + 1) {
+        rx_dropped_bytes += len;
+        rx_put_resync();
+        if (!rx_dropping) {
+            LOG_WRN("RX ring full, dropping fragments (%u bytes dropped in total)", rx_dropped_bytes);
+        }
+        rx_dropping = true;
+    } else {
+        ring_buf_put(&rx_ring, data, len);
+        rx_dropping = false;
     }
 
-done:
-    k_free(safe_buf);
+    k_work_submit(&rx_work);
 }
 
 void ble_gadgetbridge_send_version_info(void)
@@ -1240,7 +968,7 @@ void ble_gadgetbridge_send_notification_action(uint32_t id, ble_comm_notify_acti
 
     if (len > 0 && len < sizeof(buf)) {
         LOG_DBG("Sending notification action: %s", buf);
-        ble_comm_send(buf, len);
+        ble_comm_send_prio(buf, len, BLE_COMM_TX_PRIO_HIGH);
     } else {
         LOG_WRN("Failed to format notification action for id %u", id);
     }
@@ -0,0 +1,629 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2025 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gb_tokenizer.h"
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t size;
+    size_t pos;
+} gb_parser_t;
+
+#ifndef BIT
+#define BIT(n)  (1UL << (n))
+#endif
+
+#define CHAR_SPACE      BIT(0)
+#define CHAR_KEY        BIT(1)
+#define CHAR_STRING     BIT(2) // Needs handling inside a string
+#define CHAR_VALUE_END  BIT(3)
+#define CHAR_KEY_END    BIT(4) // Ends a quoted key
+
+// One lookup per byte in the scanning loops instead of a chain of compares.
+// The data is null terminated while parsing, '\0' stops every scanning loop so they need no length check.
+static const uint8_t char_class[256] = {
+    ['\0'] = CHAR_STRING | CHAR_VALUE_END | CHAR_KEY_END,
+    [' '] = CHAR_SPACE | CHAR_VALUE_END,
+    ['\t'] = CHAR_SPACE | CHAR_VALUE_END,
+    ['\r'] = CHAR_SPACE | CHAR_VALUE_END,
+    ['\n'] = CHAR_SPACE | CHAR_VALUE_END,
+    [','] = CHAR_VALUE_END,
+    ['}'] = CHAR_VALUE_END,
+    ['"'] = CHAR_STRING | CHAR_KEY_END,
+    ['\\'] = CHAR_STRING,
+    ['0' ... '9'] = CHAR_KEY,
+    ['a' ... 'z'] = CHAR_KEY,
+    ['A' ... 'Z'] = CHAR_KEY,
+    ['_'] = CHAR_KEY,
+    ['-'] = CHAR_KEY,
+    ['$'] = CHAR_KEY,
+    [0x80 ... 0xFF] = CHAR_STRING,
+};
+
+static inline bool char_is(char c, uint8_t class)
+{
+    return char_class[(uint8_t)c] & class;
+}
+
+static inline int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static int parse_hex(const char *str, int num_digits)
+{
+    int value = 0;
+
+    for (int i = 0; i < num_digits; i++) {
+        int digit = hex_value(str[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = (value << 4) | digit;
+    }
+
+    return value;
+}
+
+#define BASE64_END  -2 // Closing quote or end of data
+
+// Sextet of each base64 character, -1 for padding and anything else that is skipped.
+static const int8_t base64_values[128] = {
+    -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -2, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+};
+
+static inline int base64_value(char c)
+{
+    return (uint8_t)c < 0x80 ? base64_values[(uint8_t)c] : -1;
+}
+
+static inline void skip_space(gb_parser_t *p)
+{
+    while (char_is(p->buf[p->pos], CHAR_SPACE)) {
+        p->pos++;
+    }
+}
+
+/* Number of bytes in a valid UTF-8 sequence at str, 0 if not valid. */
+static int utf8_sequence_len(const uint8_t *str, size_t avail)
+{
+    int seq_len;
+
+    if ((str[0] & 0xE0) == 0xC0) {
+        seq_len = 2;
+    } else if ((str[0] & 0xF0) == 0xE0) {
+        seq_len = 3;
+    } else if ((str[0] & 0xF8) == 0xF0) {
+        seq_len = 4;
+    } else {
+        return 0;
+    }
+
+    if (seq_len > avail) {
+        return 0;
+    }
+
+    for (int i = 1; i < seq_len; i++) {
+        if ((str[i] & 0xC0) != 0x80) {
+            return 0;
+        }
+    }
+
+    return seq_len;
+}
+
+static int utf8_encode(uint32_t code, char *out)
+{
+    if (code < 0x80) {
+        out[0] = code;
+        return 1;
+    } else if (code < 0x800) {
+        out[0] = 0xC0 | (code >> 6);
+        out[1] = 0x80 | (code & 0x3F);
+        return 2;
+    } else if (code < 0x10000) {
+        out[0] = 0xE0 | (code >> 12);
+        out[1] = 0x80 | ((code >> 6) & 0x3F);
+        out[2] = 0x80 | (code & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (code >> 18);
+    out[1] = 0x80 | ((code >> 12) & 0x3F);
+    out[2] = 0x80 | ((code >> 6) & 0x3F);
+    out[3] = 0x80 | (code & 0x3F);
+    return 4;
+}
+
+/*
+ * Decode the string starting after the opening quote, writing the result over the input.
+ * Escapes only shrink the data. Gadgetbridge sends some characters as raw Latin-1 bytes
+ * though, which grow to two UTF-8 bytes, if no escape has made room the rest of the data
+ * is moved one byte.
+ */
+static int parse_string(gb_parser_t *p, char **value, uint16_t *value_len)
+{
+    char *buf = p->buf;
+    size_t write = p->pos;
+    char utf8[4];
+    int utf8_len;
+
+    *value = &buf[write];
+
+    while (p->pos < p->len) {
+        uint8_t c = buf[p->pos];
+
+        if (!char_is(c, CHAR_STRING)) {
+            // Plain ASCII, only moved when an earlier escape shrunk the string. Runs between escapes are
+            // short, e.g. in escaped JSON, so they are copied while scanning instead of with memmove().
+            if (write == p->pos) {
+                while (!char_is(buf[++p->pos], CHAR_STRING)) {
+                }
+                write = p->pos;
+            } else {
+                do {
+                    buf[write++] = buf[p->pos++];
+                } while (!char_is(buf[p->pos], CHAR_STRING));
+            }
+            continue;
+        }
+
+        if (c == '"') {
+            *value_len = write - (*value - buf);
+            buf[write] = '\0';
+            p->pos++;
+            return 0;
+        }
+
+        if (c == '\\' && p->pos + 1 < p->len) {
+            char esc = buf[p->pos + 1];
+            int code = -1;
+            int escape_len = 2;
+
+            switch (esc) {
+                case 'n':
+                    code = '\n';
+                    break;
+                case 't':
+                    code = '\t';
+                    break;
+                case 'r':
+                    code = '\r';
+                    break;
+                case 'b':
+                    code = '\b';
+                    break;
+                case 'f':
+                    code = '\f';
+                    break;
+                case 'x':
+                    if (p->pos + 3 < p->len) {
+                        code = parse_hex(&buf[p->pos + 2], 2);
+                        escape_len = 4;
+                    }
+                    break;
+                case 'u':
+                    if (p->pos + 5 < p->len) {
+                        code = parse_hex(&buf[p->pos + 2], 4);
+                        escape_len = 6;
+                    }
+                    if (code >= 0xD800 && code < 0xDC00 && p->pos + 11 < p->len &&
+                        buf[p->pos + 6] == '\\' && buf[p->pos + 7] == 'u') {
+                        int low = parse_hex(&buf[p->pos + 8], 4);
+                        if (low >= 0xDC00 && low < 0xE000) {
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                            escape_len = 12;
+                        }
+                    }
+                    break;
+                default:
+                    // \" \\ \/ and anything unknown is the character itself
+                    code = (uint8_t)esc;
+                    break;
+            }
+
+            if (code < 0) {
+                return -EINVAL;
+            }
+
+            // Longest output is 4 bytes from a 12 byte surrogate pair, always fits.
+            write += utf8_encode(code, &buf[write]);
+            p->pos += escape_len;
+            continue;
+        }
+
+        if (c < 0x80) {
+            // Backslash as the last byte
+            return -EINVAL;
+        }
+
+        utf8_len = utf8_sequence_len((const uint8_t *)&buf[p->pos], p->len - p->pos);
+        if (utf8_len > 0) {
+            memmove(&buf[write], &buf[p->pos], utf8_len);
+            write += utf8_len;
+            p->pos += utf8_len;
+            continue;
+        }
+
+        // Raw Latin-1 byte
+        utf8_len = utf8_encode(c, utf8);
+        if (write + utf8_len > p->pos + 1) {
+            if (p->len + 1 >= p->size) {
+                return -ENOMEM;
+            }
+            // Including the null terminator
+            memmove(&buf[p->pos + 1], &buf[p->pos], p->len - p->pos + 1);
+            p->len++;
+            p->pos++;
+        }
+        memcpy(&buf[write], utf8, utf8_len);
+        write += utf8_len;
+        p->pos++;
+    }
+
+    return -EINVAL;
+}
+
+/* Decode atob("...") in place. Base64 never contains escapes and decodes to less data. */
+static int parse_base64(gb_parser_t *p, char **value, uint16_t *value_len)
+{
+    char *buf = p->buf;
+    size_t write = p->pos;
+    uint32_t bits = 0;
+    int num_bits = 0;
+
+    *value = &buf[write];
+
+    while (true) {
+        int sextet = base64_value(buf[p->pos]);
+
+        // Whole groups of four characters at a time, up to the padding
+        if (num_bits == 0 && sextet >= 0) {
+            int s1 = base64_value(buf[p->pos + 1]);
+            int s2 = s1 >= 0 ? base64_value(buf[p->pos + 2]) : -1;
+            int s3 = s2 >= 0 ? base64_value(buf[p->pos + 3]) : -1;
+
+            if (s3 >= 0) {
+                bits = (sextet << 18) | (s1 << 12) | (s2 << 6) | s3;
+                buf[write++] = bits >> 16;
+                buf[write++] = (bits >> 8) & 0xFF;
+                buf[write++] = bits & 0xFF;
+                p->pos += 4;
+                continue;
+            }
+        }
+
+        if (sextet == BASE64_END) {
+            break;
+        }
+        p->pos++;
+        if (sextet < 0) {
+            continue; // Padding
+        }
+        bits = (bits << 6) | sextet;
+        num_bits += 6;
+        if (num_bits >= 8) {
+            num_bits -= 8;
+            buf[write++] = (bits >> num_bits) & 0xFF;
+        }
+    }
+
+    if (p->pos + 1 >= p->len || buf[p->pos + 1] != ')') {
+        return -EINVAL;
+    }
+
+    *value_len = write - (*value - buf);
+    buf[write] = '\0';
+    p->pos += 2;
+
+    return 0;
+}
+
+/* Skip over a nested object or array, only used as a raw span. */
+static int skip_nested(gb_parser_t *p)
+{
+    int depth = 0;
+    bool in_string = false;
+
+    while (p->pos < p->len) {
+        char c = p->buf[p->pos++];
+
+        if (in_string) {
+            if (c == '\\') {
+                p->pos++;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                return 0;
+            }
+        }
+    }
+
+    return -EINVAL;
+}
+
+static inline bool literal_is(const char *str, size_t len, const char *literal, size_t literal_len)
+{
+    return len == literal_len && memcmp(str, literal, len) == 0;
+}
+
+static int parse_value(gb_parser_t *p, gb_token_t *token)
+{
+    char *buf = p->buf;
+    size_t start = p->pos;
+    size_t len;
+    int rc;
+
+    switch (buf[p->pos]) {
+        case '"':
+            p->pos++;
+            token->type = GB_TOKEN_STRING;
+            return parse_string(p, &token->value, &token->value_len);
+        case 'a':
+            if (p->len - p->pos > 6 && memcmp(&buf[p->pos], "atob(\"", 6) == 0) {
+                p->pos += 6;
+                token->type = GB_TOKEN_STRING;
+                return parse_base64(p, &token->value, &token->value_len);
+            }
+            return -EINVAL;
+        case '{':
+        case '[':
+            rc = skip_nested(p);
+            if (rc != 0) {
+                return rc;
+            }
+            token->type = GB_TOKEN_RAW;
+            break;
+        default:
+            while (!char_is(buf[p->pos], CHAR_VALUE_END)) {
+                p->pos++;
+            }
+            len = p->pos - start;
+            if (len == 0) {
+                return -EINVAL;
+            }
+
+            if (literal_is(&buf[start], len, "true", 4)) {
+                token->type = GB_TOKEN_TRUE;
+            } else if (literal_is(&buf[start], len, "false", 5)) {
+                token->type = GB_TOKEN_FALSE;
+            } else if (literal_is(&buf[start], len, "null", 4)) {
+                token->type = GB_TOKEN_NULL;
+            } else {
+                token->type = GB_TOKEN_NUMBER;
+            }
+            break;
+    }
+
+    token->value = &buf[start];
+    token->value_len = p->pos - start;
+
+    return 0;
+}
+
+int gb_tokenize(char *buf, size_t len, size_t buf_size, gb_message_t *msg)
+{
+    gb_parser_t parser = {.buf = buf, .len = len, .size = buf_size, .pos = 0};
+    gb_parser_t *p = &parser;
+    gb_token_t extra_token;
+    gb_token_t *token;
+    size_t value_end;
+    char delimiter;
+    int rc;
+
+    msg->num_tokens = 0;
+
+    if (len >= buf_size) {
+        return -ENOMEM;
+    }
+    buf[len] = '\0';
+
+    skip_space(p);
+    if (p->pos >= p->len || buf[p->pos] != '{') {
+        return -EINVAL;
+    }
+    p->pos++;
+
+    while (true) {
+        skip_space(p);
+        if (p->pos >= p->len) {
+            return -EINVAL;
+        }
+        if (buf[p->pos] == '}') {
+            return 0;
+        }
+
+        // Filled in place, keys after the first GB_TOKENIZER_MAX_TOKENS are parsed but not kept
+        token = msg->num_tokens < GB_TOKENIZER_MAX_TOKENS ? &msg->tokens[msg->num_tokens] : &extra_token;
+
+        // Key, quoted or a bare identifier
+        if (buf[p->pos] == '"') {
+            token->key = &buf[++p->pos];
+            while (!char_is(buf[p->pos], CHAR_KEY_END)) {
+                p->pos++;
+            }
+            token->key_len = &buf[p->pos] - token->key;
+            if (p->pos >= p->len) {
+                return -EINVAL;
+            }
+            p->pos++;
+        } else {
+            token->key = &buf[p->pos];
+            while (char_is(buf[p->pos], CHAR_KEY)) {
+                p->pos++;
+            }
+            token->key_len = &buf[p->pos] - token->key;
+        }
+
+        skip_space(p);
+        if (token->key_len == 0 || p->pos >= p->len || buf[p->pos] != ':') {
+            return -EINVAL;
+        }
+        p->pos++;
+        skip_space(p);
+        if (p->pos >= p->len) {
+            return -EINVAL;
+        }
+
+        rc = parse_value(p, token);
+        if (rc != 0) {
+            return rc;
+        }
+
+        value_end = token->value + token->value_len - buf;
+        skip_space(p);
+        if (p->pos >= p->len) {
+            return -EINVAL;
+        }
+        delimiter = buf[p->pos++];
+        if (delimiter != ',' && delimiter != '}') {
+            return -EINVAL;
+        }
+
+        // The delimiter is consumed, so non string values can be terminated in place as well.
+        buf[value_end] = '\0';
+
+        if (token != &extra_token) {
+            msg->num_tokens++;
+        }
+
+        if (delimiter == '}') {
+            return 0;
+        }
+    }
+}
+
+const gb_token_t *gb_message_find(const gb_message_t *msg, const char *key)
+{
+    size_t key_len = strlen(key);
+
+    for (int i = 0; i < msg->num_tokens; i++) {
+        const gb_token_t *token = &msg->tokens[i];
+
+        if (token->key_len == key_len && token->key[0] == key[0] && memcmp(token->key, key, key_len) == 0) {
+            return token;
+        }
+    }
+
+    return NULL;
+}
+
+char *gb_message_get_str(const gb_message_t *msg, const char *key, int *len)
+{
+    const gb_token_t *token = gb_message_find(msg, key);
+
+    if (token == NULL || token->type != GB_TOKEN_STRING) {
+        *len = 0;
+        return NULL;
+    }
+
+    *len = token->value_len;
+    return token->value;
+}
+
+/* Number value of key if it starts with a digit, or with a minus sign followed by one if signed */
+static const char *get_digits(const gb_message_t *msg, const char *key, bool is_signed)
+{
+    const gb_token_t *token = gb_message_find(msg, key);
+    const char *digits;
+
+    if (token == NULL || token->type != GB_TOKEN_NUMBER) {
+        return NULL;
+    }
+
+    digits = token->value;
+    if (is_signed && digits[0] == '-') {
+        digits++;
+    }
+    if (digits[0] < '0' || digits[0] > '9') {
+        return NULL;
+    }
+
+    return token->value;
+}
+
+uint32_t gb_message_get_uint32(const gb_message_t *msg, const char *key)
+{
+    const char *digits = get_digits(msg, key, false);
+
+    return digits ? strtoul(digits, NULL, 10) : 0;
+}
+
+int32_t gb_message_get_int32(const gb_message_t *msg, const char *key)
+{
+    const char *digits = get_digits(msg, key, true);
+
+    return digits ? strtol(digits, NULL, 10) : 0;
+}
+
+double gb_message_get_double(const gb_message_t *msg, const char *key, double def)
+{
+    const gb_token_t *token = gb_message_find(msg, key);
+    char *end;
+    double value;
+
+    if (token == NULL || token->type != GB_TOKEN_NUMBER) {
+        return def;
+    }
+
+    value = strtod(token->value, &end);
+
+    return end == token->value ? def : value;
+}
+
+int gb_message_get_bool(const gb_message_t *msg, const char *key, bool *value)
+{
+    const gb_token_t *token = gb_message_find(msg, key);
+
+    if (token == NULL) {
+        return -ENOENT;
+    }
+
+    if (token->type == GB_TOKEN_TRUE) {
+        *value = true;
+    } else if (token->type == GB_TOKEN_FALSE) {
+        *value = false;
+    } else {
+        return -EINVAL;
+    }
+
+    return 0;
+}
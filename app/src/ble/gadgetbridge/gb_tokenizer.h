@@ -0,0 +1,97 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2025 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Single pass tokenizer for the JSON objects Gadgetbridge sends inside GB(...).
+ * Has no Zephyr dependencies so it can be built on the host, see app/tools/gb_parser_bench.
+ */
+
+#define GB_TOKENIZER_MAX_TOKENS     24
+
+typedef enum gb_token_type {
+    GB_TOKEN_STRING,
+    GB_TOKEN_NUMBER,
+    GB_TOKEN_TRUE,
+    GB_TOKEN_FALSE,
+    GB_TOKEN_NULL,
+    GB_TOKEN_RAW, // Nested object or array, not decoded
+} gb_token_type_t;
+
+typedef struct gb_token {
+    const char *key;
+    char *value; // Null terminated
+    uint16_t key_len;
+    uint16_t value_len;
+    gb_token_type_t type;
+} gb_token_t;
+
+typedef struct gb_message {
+    gb_token_t tokens[GB_TOKENIZER_MAX_TOKENS];
+    uint8_t num_tokens;
+} gb_message_t;
+
+/**
+ * @brief Index all top level keys of a Gadgetbridge JSON object in one pass.
+ *
+ * Values are decoded in place: string escapes, Gadgetbridge's "\xNN" escapes and raw
+ * Latin-1 bytes are converted to UTF-8, atob("...") values are base64 decoded, and every
+ * value is null terminated. Raw Latin-1 bytes grow to two bytes, which shifts the rest of
+ * the data if there is no room, so buf_size should leave some space after len. buf[len] is
+ * used for a null terminator while parsing, so buf_size must be larger than len.
+ *
+ * @param buf Data to parse, modified in place.
+ * @param len Length of the data.
+ * @param buf_size Size of buf.
+ * @param msg Filled with the found keys.
+ *
+ * @return 0 on success, -EINVAL if the data is not a valid object or -ENOMEM if buf_size is too small
+ *         for the decoded data.
+ */
+int gb_tokenize(char *buf, size_t len, size_t buf_size, gb_message_t *msg);
+
+const gb_token_t *gb_message_find(const gb_message_t *msg, const char *key);
+
+/**
+ * @brief Get a string value, NULL if missing or not a string.
+ */
+char *gb_message_get_str(const gb_message_t *msg, const char *key, int *len);
+
+/**
+ * @brief Get a number value as an integer, 0 if missing or not starting with a digit.
+ */
+uint32_t gb_message_get_uint32(const gb_message_t *msg, const char *key);
+
+/**
+ * @brief Get a number value as a signed integer, 0 if missing or not starting with a digit or '-'.
+ */
+int32_t gb_message_get_int32(const gb_message_t *msg, const char *key);
+
+/**
+ * @brief Get a number value, def if missing or not a number.
+ */
+double gb_message_get_double(const gb_message_t *msg, const char *key, double def);
+
+/**
+ * @return 0 on success, -ENOENT if missing or -EINVAL if not a bool.
+ */
+int gb_message_get_bool(const gb_message_t *msg, const char *key, bool *value);
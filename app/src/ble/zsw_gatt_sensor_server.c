@@ -21,6 +21,9 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/drivers/sensor.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include <math.h>
 
 #include "events/periodic_event.h"
 #include "events/zsw_periodic_event.h"
@@ -42,6 +45,10 @@ static ssize_t on_ccc_cfg_write(struct bt_conn *conn, const struct bt_gatt_attr
 static void disconnected(struct bt_conn *conn, uint8_t reason);
 static void connected(struct bt_conn *conn, uint8_t err);
 
+static void on_stream_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value);
+static void stream_sample_work_handler(struct k_work *work);
+static void stream_batch_ready(void);
+
 static void zbus_periodic_fast_callback(const struct zbus_channel *chan);
 
 ZBUS_CHAN_DECLARE(periodic_event_100ms_chan);
@@ -56,6 +63,19 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 // 1 = 100ms, 5 = 500ms, 10 = 1s etc.
 #define ZSW_GATT_SENSOR_NOTIFY_INTERVAL_PERIODS    2
 
+#define STREAM_PERIOD_MS            (1000 / CONFIG_ZSW_GATT_SENSOR_STREAM_RATE_HZ)
+#define STREAM_PERIOD_US            (USEC_PER_SEC / CONFIG_ZSW_GATT_SENSOR_STREAM_RATE_HZ)
+#define STREAM_HEADER_SIZE          5
+#define STREAM_RECORD_HEADER_SIZE   2
+#define STREAM_MAG_INTERVAL_MS      100
+#define STREAM_PRESSURE_INTERVAL_MS 1000
+// IMU FIFO batches arrive about as often as magnetometer samples are sent
+#define STREAM_BATCH_WATERMARK      MAX(1, CONFIG_ZSW_GATT_SENSOR_STREAM_RATE_HZ * STREAM_MAG_INTERVAL_MS / 1000)
+#define STREAM_BATCH_READ_FRAMES    16
+
+#define MS2_TO_MG                   (1000000000.0f / SENSOR_G)
+#define RADS_TO_DECI_DPS            (1800.0f / (float)M_PI)
+
 #if CONFIG_BLE_DISABLE_PAIRING_REQUIRED
 #define ZSW_GATT_READ_WRITE_PERM    BT_GATT_PERM_READ | BT_GATT_PERM_WRITE
 #else
@@ -133,6 +153,33 @@ BT_GATT_SERVICE_DEFINE(light_service,
                        BT_GATT_CCC_WITH_WRITE_CB(on_ccc_cfg_changed, on_ccc_cfg_write, ZSW_GATT_READ_WRITE_PERM)
                       );
 
+BT_GATT_SERVICE_DEFINE(sensor_stream_service,
+                       BT_GATT_PRIMARY_SERVICE(ZSW_SERVICE_SENSOR_STREAM),
+                       BT_GATT_CHARACTERISTIC(ZSW_CHAR_SENSOR_STREAM,
+                                              BT_GATT_CHRC_NOTIFY,
+                                              BT_GATT_PERM_NONE,
+                                              NULL, NULL, NULL),
+                       BT_GATT_CCC_WITH_WRITE_CB(on_stream_ccc_cfg_changed, on_ccc_cfg_write, ZSW_GATT_READ_WRITE_PERM)
+                      );
+
+static K_WORK_DELAYABLE_DEFINE(stream_sample_work, stream_sample_work_handler);
+
+// Only accessed from the system workqueue, which also runs the BT callbacks
+static struct {
+    bool enabled;
+    bool batching;          // IMU records come from the IMU FIFO, otherwise the IMU is read every STREAM_PERIOD_MS
+    int64_t next_imu_us;
+    zsw_imu_frame_t frames[STREAM_BATCH_READ_FRAMES];
+    uint8_t buf[CONFIG_BT_L2CAP_TX_MTU];
+    uint16_t len;
+    uint8_t seq;
+    uint32_t last_record_ms;
+    uint32_t last_mag_ms;
+    uint32_t last_pressure_ms;
+    uint32_t num_sent;
+    uint32_t num_dropped;
+} stream;
+
 static bool notif_enabled;
 static uint8_t notify_period_counter;
 // Flag to ignore restored CCCDs on first connect after reboot/disconnect
@@ -218,7 +265,9 @@ static ssize_t on_read(struct bt_conn *conn, const struct bt_gatt_attr *attr, vo
     } else if (bt_gatt_attr_get_handle(attr) == bt_gatt_attr_get_handle(&mag_service.attrs[2])) {
         zsw_magnetometer_set_enable(true);
         zsw_magnetometer_get_all(&f_ptr[0], &f_ptr[1], &f_ptr[2]);
-        zsw_magnetometer_set_enable(false);
+        if (!stream.enabled) {
+            zsw_magnetometer_set_enable(false);
+        }
         write_len = 3 * sizeof(float);
     } else if (bt_gatt_attr_get_handle(attr) == bt_gatt_attr_get_handle(&gyro_service.attrs[2])) {
         zsw_imu_fetch_gyro(&x, &y, &z);
@@ -243,6 +292,221 @@ static ssize_t on_read(struct bt_conn *conn, const struct bt_gatt_attr *attr, vo
     return write_len;
 }
 
+static void stream_flush(void)
+{
+    if (stream.len == 0) {
+        return;
+    }
+
+    // The sequence number is used even if the packet fails to send, so the gap shows on the phone
+    if (bt_gatt_notify(NULL, &sensor_stream_service.attrs[2], stream.buf, stream.len) == 0) {
+        stream.num_sent++;
+    } else {
+        stream.num_dropped++;
+    }
+    stream.seq++;
+    stream.len = 0;
+}
+
+static void stream_add_record(uint8_t type, uint32_t time_ms, const uint8_t *payload, size_t payload_len)
+{
+    int mtu = ble_comm_get_mtu();
+    size_t max_len;
+
+    if (mtu <= 3) {
+        return;
+    }
+    max_len = MIN(mtu - 3, sizeof(stream.buf));
+
+    // Magnetometer and pressure records are stamped after an IMU batch was read, the next batch can
+    // start a few ms before them. Records are stored with a positive dt, so never go back in time.
+    if ((int32_t)(time_ms - stream.last_record_ms) < 0) {
+        time_ms = stream.last_record_ms;
+    }
+
+    // Start a new packet when the record doesn't fit, or is too long after the previous one for dt_ms
+    if (stream.len > 0 && (stream.len + STREAM_RECORD_HEADER_SIZE + payload_len > max_len ||
+                           time_ms - stream.last_record_ms > UINT8_MAX)) {
+        stream_flush();
+    }
+
+    if (stream.len == 0) {
+        stream.buf[0] = stream.seq;
+        sys_put_le32(time_ms, &stream.buf[1]);
+        stream.len = STREAM_HEADER_SIZE;
+        stream.last_record_ms = time_ms;
+    }
+
+    if (stream.len + STREAM_RECORD_HEADER_SIZE + payload_len > max_len) {
+        return;
+    }
+
+    stream.buf[stream.len++] = type;
+    stream.buf[stream.len++] = time_ms - stream.last_record_ms;
+    memcpy(&stream.buf[stream.len], payload, payload_len);
+    stream.len += payload_len;
+    stream.last_record_ms = time_ms;
+}
+
+static void put_xyz(uint8_t *buf, const float xyz[3], float scale)
+{
+    for (int i = 0; i < 3; i++) {
+        sys_put_le16((int16_t)CLAMP(xyz[i] * scale, INT16_MIN, INT16_MAX), &buf[i * sizeof(int16_t)]);
+    }
+}
+
+static void stream_add_imu(uint32_t time_ms, const float accel[3], const float gyro[3])
+{
+    uint8_t payload[6 * sizeof(int16_t)];
+
+    put_xyz(&payload[0], accel, MS2_TO_MG);
+    put_xyz(&payload[3 * sizeof(int16_t)], gyro, RADS_TO_DECI_DPS);
+    stream_add_record(ZSW_SENSOR_STREAM_RECORD_IMU, time_ms, payload, sizeof(payload));
+}
+
+static void stream_read_imu_batch(void)
+{
+    const zsw_imu_frame_t *frame;
+    int ret;
+
+    do {
+        ret = zsw_imu_read_batch(stream.frames, ARRAY_SIZE(stream.frames));
+        for (int i = 0; i < ret; i++) {
+            frame = &stream.frames[i];
+            // The FIFO runs at the IMU sampling frequency, only send frames at about the stream rate
+            if (frame->timestamp_us < stream.next_imu_us - STREAM_PERIOD_US / 10) {
+                continue;
+            }
+            if (frame->timestamp_us - stream.next_imu_us > STREAM_PERIOD_US) {
+                stream.next_imu_us = frame->timestamp_us;
+            }
+            stream.next_imu_us += STREAM_PERIOD_US;
+            stream_add_imu(frame->timestamp_us / USEC_PER_MSEC, frame->accel, frame->gyro);
+        }
+    } while (ret == ARRAY_SIZE(stream.frames));
+
+    if (ret < 0) {
+        LOG_WRN("zsw_imu_read_batch err: %d", ret);
+    }
+}
+
+static void stream_sample_work_handler(struct k_work *work)
+{
+    uint32_t start = k_uptime_get_32();
+    uint32_t now;
+    uint32_t elapsed;
+    uint8_t payload[3 * sizeof(int16_t)];
+    float accel[3];
+    float gyro[3];
+    float mag[3];
+    float pressure;
+
+    // A batch may be signalled while the stream stops
+    if (!stream.enabled) {
+        return;
+    }
+
+    if (stream.batching) {
+        stream_read_imu_batch();
+    } else if (zsw_imu_fetch_accel_gyro_f(accel, gyro) == 0) {
+        stream_add_imu(start, accel, gyro);
+    }
+
+    // After the IMU records, which are all sampled before now
+    now = k_uptime_get_32();
+    if (now - stream.last_mag_ms >= STREAM_MAG_INTERVAL_MS) {
+        stream.last_mag_ms = now;
+        if (zsw_magnetometer_get_all(&mag[0], &mag[1], &mag[2]) == 0) {
+            put_xyz(payload, mag, 10.0f);
+            stream_add_record(ZSW_SENSOR_STREAM_RECORD_MAG, now, payload, 3 * sizeof(int16_t));
+        }
+    }
+
+    if (now - stream.last_pressure_ms >= STREAM_PRESSURE_INTERVAL_MS) {
+        stream.last_pressure_ms = now;
+        if (zsw_pressure_sensor_get_pressure(&pressure) == 0) {
+            sys_put_le16((uint16_t)CLAMP(pressure / 2.0f, 0, UINT16_MAX), payload);
+            stream_add_record(ZSW_SENSOR_STREAM_RECORD_PRESSURE, now, payload, sizeof(uint16_t));
+        }
+    }
+
+    if (stream.batching) {
+        // The FIFO watermark reschedules this right away, this keeps the other sensors going without the interrupt
+        k_work_schedule(&stream_sample_work, K_MSEC(STREAM_MAG_INTERVAL_MS));
+        return;
+    }
+
+    elapsed = k_uptime_get_32() - start;
+    k_work_schedule(&stream_sample_work, K_MSEC(elapsed < STREAM_PERIOD_MS ? STREAM_PERIOD_MS - elapsed : 0));
+}
+
+static void stream_batch_ready(void)
+{
+    // Called from the IMU interrupt context, the batch is read on the system workqueue with the rest of the stream
+    k_work_reschedule(&stream_sample_work, K_NO_WAIT);
+}
+
+static void stream_start(void)
+{
+    uint32_t now = k_uptime_get_32();
+    int ret;
+
+    stream.enabled = true;
+    stream.len = 0;
+    stream.num_sent = 0;
+    stream.num_dropped = 0;
+    stream.next_imu_us = 0;
+    stream.last_record_ms = now;
+    // Send magnetometer and pressure with the first sample
+    stream.last_mag_ms = now - STREAM_MAG_INTERVAL_MS;
+    stream.last_pressure_ms = now - STREAM_PRESSURE_INTERVAL_MS;
+
+    zsw_imu_feature_enable(ZSW_IMU_FEATURE_GYRO, false);
+    zsw_magnetometer_set_enable(true);
+
+    // The FIFO gives every sample with its sample time, without waking up for each one
+    ret = zsw_imu_batch_start(STREAM_BATCH_WATERMARK, stream_batch_ready);
+    stream.batching = ret == 0;
+    if (!stream.batching) {
+        LOG_INF("No IMU FIFO (%d), reading the IMU every %d ms", ret, STREAM_PERIOD_MS);
+    }
+    ble_comm_set_short_connection_interval();
+    k_work_schedule(&stream_sample_work, K_NO_WAIT);
+}
+
+static void stream_stop(bool connected)
+{
+    stream.enabled = false;
+    if (stream.batching) {
+        zsw_imu_batch_stop();
+        stream.batching = false;
+    }
+    k_work_cancel_delayable(&stream_sample_work);
+    zsw_imu_feature_disable(ZSW_IMU_FEATURE_GYRO);
+    zsw_magnetometer_set_enable(false);
+    if (connected && !notif_enabled) {
+        ble_comm_set_default_connection_interval();
+    }
+
+    LOG_INF("Sensor stream stopped, %u packets sent, %u dropped", stream.num_sent, stream.num_dropped);
+}
+
+static void on_stream_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    ARG_UNUSED(attr);
+
+    if (ignore_restored_ccc) {
+        LOG_DBG("Ignoring restored CCC value, phone must re-enable notifications");
+        return;
+    }
+
+    if (!stream.enabled && (value & BT_GATT_CCC_NOTIFY)) {
+        stream_start();
+    } else if (stream.enabled && !(value & BT_GATT_CCC_NOTIFY)) {
+        stream_stop(true);
+    }
+}
+
 static ssize_t on_ccc_cfg_write(struct bt_conn *conn, const struct bt_gatt_attr *attr, uint16_t value)
 {
     ARG_UNUSED(conn);
@@ -277,7 +541,9 @@ static void on_ccc_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
         ble_comm_set_short_connection_interval();
         zsw_periodic_chan_add_obs(&periodic_event_100ms_chan, &azsw_gatt_sensor_server_lis);
     } else if (notif_enabled && !notifications_active) {
-        ble_comm_set_default_connection_interval();
+        if (!stream.enabled) {
+            ble_comm_set_default_connection_interval();
+        }
         zsw_periodic_chan_rm_obs(&periodic_event_100ms_chan, &azsw_gatt_sensor_server_lis);
         zsw_imu_feature_disable(ZSW_IMU_FEATURE_GYRO);
         zsw_sensor_fusion_deinit();
@@ -307,6 +573,10 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     // Reset the ignore flag for next connection
     ignore_restored_ccc = false;
 
+    if (stream.enabled) {
+        stream_stop(false);
+    }
+
     if (!notif_enabled || any_notification_enabled(0)) {
         return;
     }
@@ -320,9 +590,8 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 
 static void zbus_periodic_fast_callback(const struct zbus_channel *chan)
 {
-    int16_t x;
-    int16_t y;
-    int16_t z;
+    float accel[3];
+    float gyro[3];
     int write_len;
     float *f_ptr;
     float pressure = 0.0;
@@ -350,25 +619,20 @@ static void zbus_periodic_fast_callback(const struct zbus_channel *chan)
     write_len = sizeof(float);
     bt_gatt_notify(NULL, &pressure_service.attrs[2], &buf, write_len);
 
-    if (zsw_imu_fetch_accel(&x, &y, &z) == 0) {
-        f_ptr[0] = x;
-        f_ptr[1] = y;
-        f_ptr[2] = z;
+    // Accel and gyro from the same sample, with one read from the IMU
+    if (zsw_imu_fetch_accel_gyro_f(accel, gyro) == 0) {
         write_len = 3 * sizeof(float);
+        memcpy(f_ptr, accel, write_len);
         bt_gatt_notify(NULL, &accel_service.attrs[2], &buf, write_len);
-    }
-
-    if (zsw_imu_fetch_gyro(&x, &y, &z) == 0) {
-        f_ptr[0] = x;
-        f_ptr[1] = y;
-        f_ptr[2] = z;
-        write_len = 3 * sizeof(float);
+        memcpy(f_ptr, gyro, write_len);
         bt_gatt_notify(NULL, &gyro_service.attrs[2], &buf, write_len);
     }
 
     if (zsw_magnetometer_set_enable(true) == 0) {
         zsw_magnetometer_get_all(&f_ptr[0], &f_ptr[1], &f_ptr[2]);
-        zsw_magnetometer_set_enable(false);
+        if (!stream.enabled) {
+            zsw_magnetometer_set_enable(false);
+        }
         write_len = 3 * sizeof(float);
         bt_gatt_notify(NULL, &mag_service.attrs[2], &buf, write_len);
     }
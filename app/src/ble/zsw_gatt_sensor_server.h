@@ -52,5 +52,26 @@
 
 #define ADAFRUIT_MEASUREMENT_PERIOD_ID  BT_UUID_DECLARE_128(BT_UUID_128_ENCODE(0xADAF0001, 0xC332, 0x42A8, 0x93BD, 0x25E905756CB8))
 
+/*
+ * Sensor stream, notifications packed with timestamped samples collected at CONFIG_ZSW_GATT_SENSOR_STREAM_RATE_HZ.
+ * IMU samples are read in batches from the IMU FIFO when it is free, and then carry their sample time.
+ * All fields are little endian.
+ *
+ * Notification: u8 seq, u32 t0_ms, records...
+ *   seq increases by one for every notification, a gap means notifications were dropped.
+ *   t0_ms is the uptime of the first record.
+ * Record: u8 type, u8 dt_ms, payload
+ *   dt_ms is the time since the previous record, or since t0_ms for the first one.
+ *   IMU       0x01 i16 accel x, y, z in mg, i16 gyro x, y, z in 0.1 dps
+ *   MAG       0x02 i16 x, y, z in 0.1 uT
+ *   PRESSURE  0x03 u16 pressure in 2 Pa
+ */
+#define ZSW_SERVICE_SENSOR_STREAM       BT_UUID_DECLARE_128(BT_UUID_128_ENCODE(0x5A570100, 0x8F2C, 0x4D1E, 0x9B6A, 0x2E7C51D0A3F4))
+#define ZSW_CHAR_SENSOR_STREAM          BT_UUID_DECLARE_128(BT_UUID_128_ENCODE(0x5A570101, 0x8F2C, 0x4D1E, 0x9B6A, 0x2E7C51D0A3F4))
+
+#define ZSW_SENSOR_STREAM_RECORD_IMU        0x01
+#define ZSW_SENSOR_STREAM_RECORD_MAG        0x02
+#define ZSW_SENSOR_STREAM_RECORD_PRESSURE   0x03
+
 #define BLE_UUID_TRANSPORT_VAL \
     BT_UUID_128_ENCODE(0x6e400001, 0xb5a3, 0xf393, 0xe0a9, 0xe50e24dcca9e)
@@ -0,0 +1,643 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2025 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "ble/ble_comm.h"
+#include "ble/zsw_l2cap_file_server.h"
+#include "drivers/zsw_display_control.h"
+#include "filesystem/zsw_filesystem.h"
+
+LOG_MODULE_REGISTER(zsw_l2cap_file_server, CONFIG_ZSW_BLE_LOG_LEVEL);
+
+#define OP_READ_START           0x01
+#define OP_WRITE_START          0x02
+#define OP_ACK                  0x03
+#define OP_ABORT                0x04
+#define OP_START_RSP            0x05
+#define OP_DATA                 0x81
+#define OP_WINDOW_END           0x82
+
+#define DATA_HDR_SIZE           (1 + sizeof(uint32_t))
+#define ACK_SIZE                (1 + 1 + sizeof(uint32_t))
+#define WINDOW_END_SIZE         (1 + 2 * sizeof(uint32_t))
+#define MAX_PATH_LEN            64
+#define WINDOWS_IN_FLIGHT       2
+#define SEND_TIMEOUT_MS         1000
+
+#define THREAD_STACK_SIZE       2048
+#define THREAD_PRIORITY         K_LOWEST_APPLICATION_THREAD_PRIO
+
+#define TX_BUF_COUNT            3
+#define RX_BUF_COUNT            2
+
+#if CONFIG_BLE_DISABLE_PAIRING_REQUIRED
+#define FILE_SERVER_SEC_LEVEL   BT_SECURITY_L1
+#else
+#define FILE_SERVER_SEC_LEVEL   BT_SECURITY_L2
+#endif
+
+typedef enum {
+    TRANSFER_IDLE,
+    TRANSFER_READ,
+    TRANSFER_WRITE,
+} transfer_state_t;
+
+static int accept(struct bt_conn *conn, struct bt_l2cap_server *server, struct bt_l2cap_chan **chan);
+static void chan_connected(struct bt_l2cap_chan *chan);
+static void chan_disconnected(struct bt_l2cap_chan *chan);
+static struct net_buf *chan_alloc_buf(struct bt_l2cap_chan *chan);
+static int chan_recv(struct bt_l2cap_chan *chan, struct net_buf *buf);
+static void file_server_thread(void *, void *, void *);
+
+NET_BUF_POOL_DEFINE(tx_pool, TX_BUF_COUNT, BT_L2CAP_SDU_BUF_SIZE(CONFIG_ZSW_L2CAP_FILE_SERVER_MTU), 8, NULL);
+NET_BUF_POOL_DEFINE(rx_pool, RX_BUF_COUNT, BT_L2CAP_SDU_BUF_SIZE(CONFIG_ZSW_L2CAP_FILE_SERVER_MTU), 8, NULL);
+
+K_FIFO_DEFINE(rx_fifo);
+K_THREAD_DEFINE(l2cap_file_server_tid, THREAD_STACK_SIZE, file_server_thread, NULL, NULL, NULL, THREAD_PRIORITY, 0, 0);
+
+static const struct bt_l2cap_chan_ops chan_ops = {
+    .alloc_buf = chan_alloc_buf,
+    .recv = chan_recv,
+    .connected = chan_connected,
+    .disconnected = chan_disconnected,
+};
+
+static struct bt_l2cap_le_chan le_chan = {
+    .chan.ops = &chan_ops,
+    .rx.mtu = CONFIG_ZSW_L2CAP_FILE_SERVER_MTU,
+};
+
+static struct bt_l2cap_server server = {
+    .psm = CONFIG_ZSW_L2CAP_FILE_SERVER_PSM,
+    .sec_level = FILE_SERVER_SEC_LEVEL,
+    .accept = accept,
+};
+
+static atomic_t chan_in_use;
+static atomic_t reset_pending;
+
+// Queued behind the data of a disconnected channel, so the thread handles the disconnect after it
+static struct {
+    void *fifo_reserved;
+} disconnect_marker;
+
+// Only touched from the file server thread
+static struct {
+    transfer_state_t state;
+    struct fs_file_t file;
+    uint32_t size;
+    uint32_t start_offset;
+    uint32_t offset;        // Next offset to send or receive
+    uint32_t acked_offset;  // Read: all data before this is confirmed by the phone
+    uint32_t window_start;  // Write: offset of the first byte in window_buf
+    uint32_t window_len;
+    uint32_t start_ms;
+    bool render_blocked;
+} transfer;
+
+static uint8_t window_buf[CONFIG_ZSW_L2CAP_FILE_SERVER_WINDOW_SIZE];
+
+static struct {
+    uint32_t transfers;
+    uint32_t bytes;
+    uint32_t window_retries;
+    uint32_t last_rate_bps;
+} stats;
+
+int zsw_l2cap_file_server_init(void)
+{
+    int ret = bt_l2cap_server_register(&server);
+
+    if (ret) {
+        LOG_ERR("Failed to register L2CAP server: %d", ret);
+    }
+
+    return ret;
+}
+
+static int accept(struct bt_conn *conn, struct bt_l2cap_server *server, struct bt_l2cap_chan **chan)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(server);
+
+    if (!atomic_cas(&chan_in_use, 0, 1)) {
+        return -ENOMEM;
+    }
+
+    *chan = &le_chan.chan;
+
+    return 0;
+}
+
+static void chan_connected(struct bt_l2cap_chan *chan)
+{
+    LOG_INF("File transfer channel connected, TX MTU %u", le_chan.tx.mtu);
+}
+
+static void chan_disconnected(struct bt_l2cap_chan *chan)
+{
+    LOG_INF("File transfer channel disconnected");
+    // accept() refuses a new channel until the thread has handled this, so its data can't be dropped
+    atomic_set(&reset_pending, 1);
+    k_fifo_put(&rx_fifo, &disconnect_marker);
+}
+
+static struct net_buf *chan_alloc_buf(struct bt_l2cap_chan *chan)
+{
+    return net_buf_alloc(&rx_pool, K_NO_WAIT);
+}
+
+static int chan_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+    // Credits are given back when the thread is done with the buffer, which paces the phone
+    k_fifo_put(&rx_fifo, buf);
+
+    return -EINPROGRESS;
+}
+
+static void release_rx_buf(struct net_buf *buf)
+{
+    if (bt_l2cap_chan_recv_complete(&le_chan.chan, buf) != 0) {
+        net_buf_unref(buf);
+    }
+}
+
+static int send_sdu(const uint8_t *hdr, size_t hdr_len, const uint8_t *data, size_t data_len)
+{
+    struct net_buf *buf;
+    int ret;
+
+    buf = net_buf_alloc(&tx_pool, K_MSEC(SEND_TIMEOUT_MS));
+    if (buf == NULL) {
+        return -ETIMEDOUT;
+    }
+
+    net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+    net_buf_add_mem(buf, hdr, hdr_len);
+    if (data_len > 0) {
+        net_buf_add_mem(buf, data, data_len);
+    }
+
+    ret = bt_l2cap_chan_send(&le_chan.chan, buf);
+    if (ret < 0) {
+        net_buf_unref(buf);
+        return ret;
+    }
+
+    return 0;
+}
+
+static int send_status(uint8_t opcode, int status, uint32_t value)
+{
+    uint8_t msg[ACK_SIZE];
+
+    msg[0] = opcode;
+    msg[1] = (uint8_t)(int8_t)status;
+    sys_put_le32(value, &msg[2]);
+
+    return send_sdu(msg, sizeof(msg), NULL, 0);
+}
+
+static int send_window_end(uint32_t offset, uint32_t crc)
+{
+    uint8_t msg[WINDOW_END_SIZE];
+
+    msg[0] = OP_WINDOW_END;
+    sys_put_le32(offset, &msg[1]);
+    sys_put_le32(crc, &msg[5]);
+
+    return send_sdu(msg, sizeof(msg), NULL, 0);
+}
+
+static void transfer_end(const char *reason)
+{
+    uint32_t elapsed_ms;
+    uint32_t transferred;
+
+    if (transfer.state == TRANSFER_IDLE) {
+        return;
+    }
+
+    transferred = (transfer.state == TRANSFER_READ) ? transfer.acked_offset : transfer.offset;
+    elapsed_ms = MAX(k_uptime_get_32() - transfer.start_ms, 1);
+    stats.last_rate_bps = (uint32_t)(((uint64_t)(transferred - transfer.start_offset) * 1000) / elapsed_ms);
+    LOG_INF("Transfer %s at offset %u, %u B/s", reason, transferred, stats.last_rate_bps);
+
+    if (transfer.state == TRANSFER_WRITE && transfer.offset == transfer.size) {
+        fs_truncate(&transfer.file, transfer.size);
+    }
+    fs_close(&transfer.file);
+
+    if (transfer.render_blocked) {
+        zsw_display_control_unblock_render();
+        transfer.render_blocked = false;
+    }
+
+    if (!atomic_get(&reset_pending)) {
+        ble_comm_set_default_connection_interval();
+    }
+    transfer.state = TRANSFER_IDLE;
+}
+
+static void prepare_link(void)
+{
+    struct bt_conn *conn = le_chan.chan.conn;
+
+    // Transfers are short, so use the fastest link settings while one is active
+    if (conn) {
+        bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+        bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    }
+    ble_comm_set_short_connection_interval();
+}
+
+static int parse_path(struct net_buf *buf, char *path)
+{
+    size_t prefix_len = strlen(ZSW_USER_LFS_MOUNT_POINT "/");
+
+    if (buf->len == 0 || buf->len >= MAX_PATH_LEN) {
+        return -EINVAL;
+    }
+
+    memcpy(path, buf->data, buf->len);
+    path[buf->len] = '\0';
+
+    // Only files on the user filesystem can be accessed
+    if (strncmp(path, ZSW_USER_LFS_MOUNT_POINT "/", prefix_len) != 0 || strstr(path, "..") != NULL ||
+        strlen(path) != buf->len) {
+        return -EACCES;
+    }
+
+    return 0;
+}
+
+static int start_read(struct net_buf *buf)
+{
+    char path[MAX_PATH_LEN];
+    struct fs_dirent entry;
+    uint32_t offset;
+    int ret;
+
+    if (buf->len < sizeof(uint32_t)) {
+        send_status(OP_START_RSP, -EINVAL, 0);
+        return -EINVAL;
+    }
+    offset = net_buf_pull_le32(buf);
+
+    ret = parse_path(buf, path);
+    if (ret == 0) {
+        ret = fs_stat(path, &entry);
+    }
+    if (ret == 0 && offset > entry.size) {
+        ret = -EINVAL;
+    }
+    if (ret == 0) {
+        fs_file_t_init(&transfer.file);
+        ret = fs_open(&transfer.file, path, FS_O_READ);
+    }
+    if (ret == 0) {
+        ret = fs_seek(&transfer.file, offset, FS_SEEK_SET);
+        if (ret != 0) {
+            fs_close(&transfer.file);
+        }
+    }
+    if (ret != 0) {
+        LOG_WRN("Read of %s failed: %d", path, ret);
+        send_status(OP_START_RSP, ret, 0);
+        return ret;
+    }
+
+    LOG_INF("Read %s from %u (%u bytes)", path, offset, (uint32_t)entry.size);
+    transfer.state = TRANSFER_READ;
+    transfer.size = entry.size;
+    transfer.start_offset = offset;
+    transfer.offset = offset;
+    transfer.acked_offset = offset;
+    transfer.start_ms = k_uptime_get_32();
+    stats.transfers++;
+    prepare_link();
+
+    ret = send_status(OP_START_RSP, 0, transfer.size);
+    // Reading from the end of the file, there is nothing to send
+    if (transfer.offset == transfer.size) {
+        transfer_end("done");
+    }
+
+    return ret;
+}
+
+static int start_write(struct net_buf *buf)
+{
+    char path[MAX_PATH_LEN];
+    struct fs_dirent entry;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t current_size = 0;
+    int ret;
+
+    if (buf->len < 2 * sizeof(uint32_t)) {
+        send_status(OP_START_RSP, -EINVAL, 0);
+        return -EINVAL;
+    }
+    offset = net_buf_pull_le32(buf);
+    size = net_buf_pull_le32(buf);
+
+    ret = parse_path(buf, path);
+    if (ret == 0 && fs_stat(path, &entry) == 0) {
+        current_size = entry.size;
+    }
+    // A resumed write continues where the previous one stopped
+    if (ret == 0 && (offset > current_size || offset > size)) {
+        ret = -EINVAL;
+    }
+    if (ret == 0) {
+        fs_file_t_init(&transfer.file);
+        ret = fs_open(&transfer.file, path, FS_O_CREATE | FS_O_RDWR);
+    }
+    if (ret == 0) {
+        ret = (offset == 0) ? fs_truncate(&transfer.file, 0) : fs_seek(&transfer.file, offset, FS_SEEK_SET);
+        if (ret != 0) {
+            fs_close(&transfer.file);
+        }
+    }
+    if (ret != 0) {
+        LOG_WRN("Write of %s failed: %d", path, ret);
+        send_status(OP_START_RSP, ret, current_size);
+        return ret;
+    }
+
+    LOG_INF("Write %s from %u (%u bytes)", path, offset, size);
+    transfer.state = TRANSFER_WRITE;
+    transfer.size = size;
+    transfer.start_offset = offset;
+    transfer.offset = offset;
+    transfer.window_start = offset;
+    transfer.window_len = 0;
+    transfer.start_ms = k_uptime_get_32();
+    // Rendering reads images from the same flash, see zsw_smp_manager.c
+    transfer.render_blocked = zsw_display_control_block_render() == 0;
+    stats.transfers++;
+    prepare_link();
+
+    ret = send_status(OP_START_RSP, 0, current_size);
+    // An empty file, or a resumed write that was already complete, gets no data
+    if (transfer.offset == transfer.size) {
+        transfer_end("done");
+    }
+
+    return ret;
+}
+
+static void handle_write_data(struct net_buf *buf)
+{
+    uint32_t offset;
+
+    if (buf->len < sizeof(uint32_t)) {
+        return;
+    }
+    offset = net_buf_pull_le32(buf);
+
+    // Rest of a window in flight after a failed one, the phone sends it again
+    if (offset != transfer.window_start + transfer.window_len) {
+        return;
+    }
+
+    if (transfer.window_len + buf->len > sizeof(window_buf) || offset + buf->len > transfer.size) {
+        LOG_WRN("Write window overflow at %u", offset);
+        transfer.window_len = sizeof(window_buf) + 1;
+        return;
+    }
+
+    memcpy(&window_buf[transfer.window_len], buf->data, buf->len);
+    transfer.window_len += buf->len;
+}
+
+static void handle_write_window_end(struct net_buf *buf)
+{
+    uint32_t end;
+    uint32_t crc;
+    ssize_t written;
+    int status = 0;
+
+    if (buf->len < 2 * sizeof(uint32_t)) {
+        return;
+    }
+    end = net_buf_pull_le32(buf);
+    crc = net_buf_pull_le32(buf);
+
+    if (transfer.window_len == 0) {
+        // End of a window in flight after a failed one, its data was ignored
+        return;
+    }
+
+    if (transfer.window_len > sizeof(window_buf) || end != transfer.window_start + transfer.window_len ||
+        crc32_ieee(window_buf, transfer.window_len) != crc) {
+        status = -EIO;
+    } else {
+        written = fs_write(&transfer.file, window_buf, transfer.window_len);
+        if (written != transfer.window_len) {
+            status = written < 0 ? written : -ENOSPC;
+            fs_seek(&transfer.file, transfer.window_start, FS_SEEK_SET);
+        }
+    }
+
+    if (status == 0) {
+        transfer.window_start = end;
+        transfer.offset = end;
+        stats.bytes += transfer.window_len;
+    } else {
+        stats.window_retries++;
+    }
+    transfer.window_len = 0;
+
+    send_status(OP_ACK, status, transfer.window_start);
+
+    if (status == 0 && transfer.offset == transfer.size) {
+        transfer_end("done");
+    }
+}
+
+static void handle_read_ack(struct net_buf *buf)
+{
+    int8_t status;
+    uint32_t offset;
+
+    if (buf->len < 1 + sizeof(uint32_t)) {
+        return;
+    }
+    status = (int8_t)net_buf_pull_u8(buf);
+    offset = net_buf_pull_le32(buf);
+
+    if (offset < transfer.acked_offset || offset > transfer.offset) {
+        return;
+    }
+
+    stats.bytes += offset - transfer.acked_offset;
+    transfer.acked_offset = offset;
+
+    if (status != 0) {
+        // Go back and send from the failed window again
+        stats.window_retries++;
+        transfer.offset = offset;
+        fs_seek(&transfer.file, offset, FS_SEEK_SET);
+    }
+
+    if (transfer.acked_offset == transfer.size) {
+        transfer_end("done");
+    }
+}
+
+static void send_read_window(void)
+{
+    uint32_t chunk_size = MIN(le_chan.tx.mtu, CONFIG_ZSW_L2CAP_FILE_SERVER_MTU) - DATA_HDR_SIZE;
+    uint8_t hdr[DATA_HDR_SIZE];
+    uint32_t window_start = transfer.offset;
+    uint32_t pos = 0;
+    uint32_t len;
+    ssize_t read;
+    int ret;
+
+    read = fs_read(&transfer.file, window_buf, MIN(sizeof(window_buf), transfer.size - transfer.offset));
+    if (read <= 0) {
+        LOG_ERR("Read failed: %d", (int)read);
+        transfer_end("failed");
+        return;
+    }
+
+    while (pos < read) {
+        len = MIN(chunk_size, read - pos);
+        hdr[0] = OP_DATA;
+        sys_put_le32(window_start + pos, &hdr[1]);
+        ret = send_sdu(hdr, sizeof(hdr), &window_buf[pos], len);
+        if (ret != 0) {
+            LOG_WRN("Send failed: %d", ret);
+            transfer_end("failed");
+            return;
+        }
+        pos += len;
+    }
+
+    transfer.offset += read;
+    send_window_end(transfer.offset, crc32_ieee(window_buf, read));
+}
+
+static void handle_sdu(struct net_buf *buf)
+{
+    uint8_t opcode;
+
+    if (buf->len == 0) {
+        return;
+    }
+    opcode = net_buf_pull_u8(buf);
+
+    switch (opcode) {
+        case OP_READ_START:
+            transfer_end("replaced");
+            start_read(buf);
+            break;
+        case OP_WRITE_START:
+            transfer_end("replaced");
+            start_write(buf);
+            break;
+        case OP_ABORT:
+            transfer_end("aborted");
+            break;
+        case OP_ACK:
+            if (transfer.state == TRANSFER_READ) {
+                handle_read_ack(buf);
+            }
+            break;
+        case OP_DATA:
+            if (transfer.state == TRANSFER_WRITE) {
+                handle_write_data(buf);
+            }
+            break;
+        case OP_WINDOW_END:
+            if (transfer.state == TRANSFER_WRITE) {
+                handle_write_window_end(buf);
+            }
+            break;
+        default:
+            LOG_WRN("Unknown opcode 0x%02x", opcode);
+            break;
+    }
+}
+
+static bool can_send_read_window(void)
+{
+    return transfer.state == TRANSFER_READ && transfer.offset < transfer.size &&
+           transfer.offset - transfer.acked_offset < WINDOWS_IN_FLIGHT * sizeof(window_buf);
+}
+
+static void file_server_thread(void *p1, void *p2, void *p3)
+{
+    struct net_buf *buf;
+
+    while (true) {
+        buf = k_fifo_get(&rx_fifo, can_send_read_window() ? K_NO_WAIT : K_FOREVER);
+
+        if ((void *)buf == &disconnect_marker) {
+            transfer_end("disconnected");
+            atomic_set(&reset_pending, 0);
+            atomic_set(&chan_in_use, 0);
+            continue;
+        }
+
+        if (buf && atomic_get(&reset_pending)) {
+            // The stack releases the channel's buffers on disconnect
+            net_buf_unref(buf);
+        } else if (buf) {
+            handle_sdu(buf);
+            release_rx_buf(buf);
+        } else if (can_send_read_window()) {
+            send_read_window();
+        }
+    }
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_l2cap_fs_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    shell_print(sh, "Channel:   %s", atomic_get(&chan_in_use) ? "connected" : "not connected");
+    shell_print(sh, "Transfers: %u", stats.transfers);
+    shell_print(sh, "Bytes:     %u", stats.bytes);
+    shell_print(sh, "Retries:   %u", stats.window_retries);
+    shell_print(sh, "Last rate: %u B/s", stats.last_rate_bps);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_l2cap_fs,
+                               SHELL_CMD(stats, NULL, "Show L2CAP file transfer statistics", cmd_l2cap_fs_stats),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(l2cap_fs, &sub_l2cap_fs, "L2CAP file transfer commands", NULL);
+#endif
@@ -0,0 +1,51 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2025 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * File transfer over an L2CAP connection oriented channel on PSM CONFIG_ZSW_L2CAP_FILE_SERVER_PSM,
+ * for files under /user such as voice memos and watchface backgrounds.
+ *
+ * Every SDU starts with an opcode, all fields are little endian. Statuses are negative errno values.
+ *
+ * Phone to watch:
+ *   READ_START  0x01 u32 offset, path      Stream a file from offset
+ *   WRITE_START 0x02 u32 offset, u32 size, path
+ *                                          Write a file of size bytes from offset, offset 0 truncates it
+ *   ACK         0x03 i8 status, u32 offset Read window received, status 0 continues from offset,
+ *                                          otherwise the window from offset is sent again
+ *   ABORT       0x04                       Stop the current transfer
+ *   DATA        0x81 u32 offset, data      Write data
+ *   WINDOW_END  0x82 u32 offset, u32 crc   End of a write window, crc is CRC-32 (IEEE) of its data
+ *
+ * Watch to phone:
+ *   START_RSP   0x05 i8 status, u32 size   Size of the file, for a failed write start the size to resume from
+ *   ACK         0x03 i8 status, u32 offset Write window stored, or to be sent again from offset on error
+ *   DATA        0x81 u32 offset, data      Read data
+ *   WINDOW_END  0x82 u32 offset, u32 crc   End of a read window
+ *
+ * Windows are at most CONFIG_ZSW_L2CAP_FILE_SERVER_WINDOW_SIZE bytes and two may be in flight. DATA
+ * not starting at the expected offset, e.g. the rest of a window in flight after a failed one, is ignored.
+ * A transfer can be resumed after a disconnect by starting it again from the last acknowledged offset.
+ * A transfer with nothing to send, e.g. an empty file or a resumed write that was already complete,
+ * ends right after START_RSP.
+ *
+ * app/scripts/l2cap_file_transfer.py is a host client for the protocol.
+ */
+
+int zsw_l2cap_file_server_init(void);
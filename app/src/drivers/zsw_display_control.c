@@ -47,6 +47,20 @@ static void brightness_alarm_run_cb(const struct device *counter_dev, uint8_t ch
 static void brightness_alarm_stop_cb(const struct device *counter_dev, uint8_t chan_id, uint32_t ticks,
                                      void *user_data);
 
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+typedef enum te_state {
+    TE_STATE_IDLE,
+    TE_STATE_WAITING,
+    TE_STATE_FIRED,
+} te_state_t;
+
+static void te_sync_init(void);
+static void te_sync_stop(void);
+static void te_display_event(lv_event_t *e);
+static bool te_sync_wait_for_frame(void);
+static k_timeout_t te_sync_next_frame(int64_t next_update_in_ms);
+#endif
+
 typedef enum display_state {
     DISPLAY_STATE_AWAKE,
     DISPLAY_STATE_SLEEPING,
@@ -72,6 +86,15 @@ static bool first_render_since_poweron;
 static uint8_t last_brightness = 1;
 static struct counter_alarm_cfg bri_alarm_start, bri_alarm_run, bri_alarm_stop;
 
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+static const struct gpio_dt_spec display_te = GPIO_DT_SPEC_GET_OR(DT_CHOSEN(zephyr_display), te_gpios, {0});
+static struct gpio_callback te_cb_data;
+static atomic_t te_state = ATOMIC_INIT(TE_STATE_IDLE);
+// Set when LVGL has invalidated areas, cleared when they have been refreshed
+static atomic_t te_refresh_pending = ATOMIC_INIT(1);
+static uint32_t te_timeouts;
+#endif
+
 uint8_t current_driver_brightness_level = DISPLAY_BRIGHTNESS_LEVELS;
 
 void zsw_display_control_init(void)
@@ -103,6 +126,10 @@ void zsw_display_control_init(void)
         bri_alarm_run.ticks = counter_us_to_ticks(counter_dev, 750);
     }
 
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+    te_sync_init();
+#endif
+
     pm_device_action_run(display_dev, PM_DEVICE_ACTION_SUSPEND);
     if (device_is_ready(touch_dev)) {
         pm_device_action_run(touch_dev, PM_DEVICE_ACTION_SUSPEND);
@@ -128,6 +155,9 @@ int zsw_display_control_sleep_ctrl(bool on)
                 // Or let it finish if it's running.
                 atomic_set(&render_enabled, 0);
                 k_work_cancel_delayable_sync(&lvgl_work, &cancel_work_sync);
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+                te_sync_stop();
+#endif
                 // Since actual flushing the data over SPI to the screen is done in a
                 // thread in the display driver, we need to give it some time to complete
                 // before we power off the display. If not the display will glitch.
@@ -287,6 +317,9 @@ int zsw_display_control_block_render(void)
 
     if (cancel_render_work) {
         k_work_cancel_delayable_sync(&lvgl_work, &cancel_work_sync);
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+        te_sync_stop();
+#endif
     }
 
     return res;
@@ -352,6 +385,12 @@ static void lvgl_render(struct k_work *item)
         return;
     }
 
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+    if (te_sync_wait_for_frame()) {
+        return;
+    }
+#endif
+
     lvgl_lock();
     const int64_t next_update_in_ms = lv_task_handler();
     lvgl_unlock();
@@ -360,10 +399,113 @@ static void lvgl_render(struct k_work *item)
         first_render_since_poweron = false;
     }
     if (atomic_get(&render_enabled)) {
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+        k_work_schedule(&lvgl_work, te_sync_next_frame(next_update_in_ms));
+#else
         k_work_schedule(&lvgl_work, K_MSEC(next_update_in_ms));
+#endif
+    }
+}
+
+#ifdef CONFIG_ZSW_DISPLAY_TE_SYNC
+static void te_isr(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins)
+{
+    if (atomic_cas(&te_state, TE_STATE_WAITING, TE_STATE_FIRED)) {
+        gpio_pin_interrupt_configure_dt(&display_te, GPIO_INT_DISABLE);
+        k_work_reschedule(&lvgl_work, K_NO_WAIT);
+    }
+}
+
+static void te_sync_init(void)
+{
+    if (display_te.port == NULL) {
+        LOG_INF("No display TE pin, using software vsync");
+        return;
+    }
+
+    if (!gpio_is_ready_dt(&display_te)) {
+        LOG_ERR("Display TE GPIO not ready");
+        return;
+    }
+
+    gpio_pin_configure_dt(&display_te, GPIO_INPUT);
+    gpio_init_callback(&te_cb_data, te_isr, BIT(display_te.pin));
+    gpio_add_callback(display_te.port, &te_cb_data);
+
+    lvgl_lock();
+    lv_display_t *disp = lv_display_get_default();
+    if (disp != NULL) {
+        lv_display_add_event_cb(disp, te_display_event, LV_EVENT_INVALIDATE_AREA, NULL);
+        lv_display_add_event_cb(disp, te_display_event, LV_EVENT_REFR_READY, NULL);
+    } else {
+        LOG_WRN("No LVGL display, waiting for TE before every LVGL run");
     }
+    lvgl_unlock();
+}
+
+static void te_display_event(lv_event_t *e)
+{
+    atomic_set(&te_refresh_pending, lv_event_get_code(e) == LV_EVENT_INVALIDATE_AREA);
+}
+
+static void te_sync_stop(void)
+{
+    if (display_te.port != NULL) {
+        gpio_pin_interrupt_configure_dt(&display_te, GPIO_INT_DISABLE);
+    }
+    atomic_set(&te_state, TE_STATE_IDLE);
+}
+
+/*
+ * When LVGL has invalidated areas, first wait for the next TE pulse so the
+ * frame is written while the panel is in vertical blanking. Runs with nothing
+ * to redraw, e.g. timers or input polling, don't wait. The TE interrupt is
+ * only enabled while waiting, so an idle UI doesn't wake up on every pulse.
+ * Returns true if rendering should wait.
+ */
+static bool te_sync_wait_for_frame(void)
+{
+    if (display_te.port == NULL) {
+        return false;
+    }
+
+    if (atomic_get(&te_state) == TE_STATE_IDLE && !atomic_get(&te_refresh_pending)) {
+        return false;
+    }
+
+    if (atomic_cas(&te_state, TE_STATE_IDLE, TE_STATE_WAITING)) {
+        gpio_pin_interrupt_configure_dt(&display_te, GPIO_INT_EDGE_TO_ACTIVE);
+        k_work_schedule(&lvgl_work, K_MSEC(CONFIG_ZSW_DISPLAY_TE_TIMEOUT_MS));
+        return true;
+    }
+
+    if (atomic_set(&te_state, TE_STATE_IDLE) == TE_STATE_WAITING) {
+        gpio_pin_interrupt_configure_dt(&display_te, GPIO_INT_DISABLE);
+        if (te_timeouts++ == 0) {
+            LOG_WRN("No TE pulse within %d ms, rendering without sync", CONFIG_ZSW_DISPLAY_TE_TIMEOUT_MS);
+        }
+    }
+
+    return false;
 }
 
+static k_timeout_t te_sync_next_frame(int64_t next_update_in_ms)
+{
+    int64_t now;
+    int64_t next_frame;
+
+    if (display_te.port != NULL) {
+        return K_MSEC(next_update_in_ms);
+    }
+
+    // Software vsync, round the next refresh up to the frame period.
+    now = k_uptime_get();
+    next_frame = ROUND_UP(now + next_update_in_ms, CONFIG_ZSW_DISPLAY_SW_VSYNC_PERIOD_MS);
+
+    return K_MSEC(next_frame - now);
+}
+#endif
+
 static void set_brightness_level(uint8_t brightness)
 {
     uint8_t npulses;
@@ -26,6 +26,8 @@
 struct zsw_notification_event {
 };
 
+/** @brief  Copy of the removed notification. Its strings are already freed and set to NULL.
+*/
 struct zsw_notification_remove_event {
     zsw_not_mngr_notification_t notification;
 };
@@ -34,6 +34,15 @@
 #include <zephyr/fs/fs.h>
 #include <zephyr/fs/fs_sys.h>
 #include <zephyr/sys/__assert.h>
+#ifdef CONFIG_SHELL
+#include <stdlib.h>
+#include <zephyr/shell/shell.h>
+#include <lvgl_zephyr.h>
+#include <misc/cache/instance/lv_image_cache.h>
+#ifdef CONFIG_ARCH_POSIX
+#include <time.h>
+#endif
+#endif
 
 LOG_MODULE_REGISTER(zsw_fs, LOG_LEVEL_INF);
 
@@ -77,11 +86,22 @@ typedef struct file_table_t {
 typedef struct opened_file_t {
     file_header_t  *header;
     uint32_t        index;
-    bool            is_cached;
-    uint32_t        cache_start;
-    uint32_t        cache_end;
 } opened_file_t;
 
+typedef struct cache_block_t {
+    uint32_t        address;    // Flash area offset, aligned to SPI_FLASH_SECTOR_SIZE
+    uint32_t        len;
+    uint32_t        last_used;
+    bool            valid;
+} cache_block_t;
+
+typedef struct cache_stats_t {
+    uint32_t        hits;
+    uint32_t        misses;
+    uint32_t        bypass_reads;
+    uint64_t        flash_bytes_read;
+} cache_stats_t;
+
 #define FULL_FS_SPECIAL_FILE_NAME "full_fs"
 
 typedef struct fullFsFile_t {
@@ -91,10 +111,14 @@ typedef struct fullFsFile_t {
 } fullFsFile_t;
 
 static file_table_t file_table;
+static bool file_table_sorted;
 static opened_file_t opened_files[MAX_OPENED_FILES];
 
-static uint8_t file_cache_buffer[SPI_FLASH_SECTOR_SIZE];
-static opened_file_t *current_cached_file;
+static uint8_t cache_data[CONFIG_ZSW_RAWFS_CACHE_BLOCKS][SPI_FLASH_SECTOR_SIZE] __aligned(4);
+static cache_block_t cache_blocks[CONFIG_ZSW_RAWFS_CACHE_BLOCKS];
+static uint32_t cache_use_counter;
+static cache_stats_t cache_stats;
+K_MUTEX_DEFINE(cache_mutex);
 
 static const struct flash_area *flash_area;
 
@@ -105,7 +129,7 @@ static struct stream_flash_ctx full_fs_stream_ctx;
 static uint8_t full_fs_stream_buf[512] __aligned(4);
 static bool full_fs_stream_active;
 
-static file_header_t *find_file(const char *name)
+static file_header_t *find_file_linear(const char *name)
 {
     for (int i = 0; i < file_table.num_files; i++) {
         if (strncmp(name, file_table.file_headers[i].filename, MAX_FILE_NAME_LEN) == 0) {
@@ -115,6 +139,125 @@ static file_header_t *find_file(const char *name)
     return NULL;
 }
 
+static file_header_t *find_file_sorted(const char *name)
+{
+    int cmp;
+    uint32_t mid;
+    uint32_t low = 0;
+    uint32_t high = file_table.num_files;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        cmp = strncmp(name, file_table.file_headers[mid].filename, MAX_FILE_NAME_LEN);
+        if (cmp == 0) {
+            return &file_table.file_headers[mid];
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+static file_header_t *find_file(const char *name)
+{
+    if (file_table_sorted) {
+        return find_file_sorted(name);
+    }
+    return find_file_linear(name);
+}
+
+// Images created before the table was sorted by create_custom_resource_image.py still work, just slower.
+static bool is_file_table_sorted(void)
+{
+    for (int i = 1; i < file_table.num_files; i++) {
+        if (strncmp(file_table.file_headers[i - 1].filename, file_table.file_headers[i].filename,
+                    MAX_FILE_NAME_LEN) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void cache_invalidate(void)
+{
+    k_mutex_lock(&cache_mutex, K_FOREVER);
+    memset(cache_blocks, 0, sizeof(cache_blocks));
+    k_mutex_unlock(&cache_mutex);
+}
+
+// Returns the cache block holding the flash block at address, reading it from flash on a miss.
+static int cache_get_block(uint32_t address, cache_block_t **block)
+{
+    int rc;
+    cache_block_t *victim = &cache_blocks[0];
+
+    for (int i = 0; i < CONFIG_ZSW_RAWFS_CACHE_BLOCKS; i++) {
+        if (cache_blocks[i].valid && cache_blocks[i].address == address) {
+            cache_blocks[i].last_used = ++cache_use_counter;
+            cache_stats.hits++;
+            *block = &cache_blocks[i];
+            return 0;
+        }
+        if (!cache_blocks[i].valid) {
+            victim = &cache_blocks[i];
+        } else if (victim->valid && cache_blocks[i].last_used < victim->last_used) {
+            victim = &cache_blocks[i];
+        }
+    }
+
+    cache_stats.misses++;
+    victim->valid = false;
+    victim->address = address;
+    victim->len = MIN(SPI_FLASH_SECTOR_SIZE, flash_area->fa_size - address);
+
+    rc = flash_area_read(flash_area, address, cache_data[victim - cache_blocks], victim->len);
+    if (rc != 0) {
+        return rc;
+    }
+
+    cache_stats.flash_bytes_read += victim->len;
+    victim->valid = true;
+    victim->last_used = ++cache_use_counter;
+    *block = victim;
+
+    return 0;
+}
+
+static int cache_read(uint32_t address, uint8_t *buf, uint32_t len)
+{
+    int rc = 0;
+    uint32_t offset;
+    uint32_t chunk;
+    cache_block_t *block;
+
+    k_mutex_lock(&cache_mutex, K_FOREVER);
+
+    while (len > 0) {
+        rc = cache_get_block(ROUND_DOWN(address, SPI_FLASH_SECTOR_SIZE), &block);
+        if (rc != 0) {
+            break;
+        }
+
+        offset = address - block->address;
+        if (offset >= block->len) {
+            rc = -EINVAL;
+            break;
+        }
+
+        chunk = MIN(len, block->len - offset);
+        memcpy(buf, cache_data[block - cache_blocks] + offset, chunk);
+        buf += chunk;
+        address += chunk;
+        len -= chunk;
+    }
+
+    k_mutex_unlock(&cache_mutex);
+
+    return rc;
+}
+
 static opened_file_t *find_free_opened_file(void)
 {
     for (int i = 0; i < MAX_OPENED_FILES; i++) {
@@ -229,6 +372,7 @@ static int zsw_fs_open(struct fs_file_t *zfp, const char *file_name, fs_mode_t m
 
             full_fs_file.len = 0; // Reset for fresh write
             full_fs_stream_active = true;
+            cache_invalidate();
         }
         full_fs_file.opened = true;
         full_fs_file.index = 0;
@@ -253,7 +397,6 @@ static lv_fs_res_t lvgl_fs_close(struct _lv_fs_drv_t *drv, void *file)
     opened_file_t *open_file = (opened_file_t *)file;
     open_file->header = NULL;
     open_file->index = 0;
-    open_file->is_cached = false;
     return errno_to_lv_fs_res(0);
 }
 
@@ -269,6 +412,7 @@ static int zsw_fs_close(struct fs_file_t *zfp)
                 full_fs_file.len = stream_flash_bytes_written(&full_fs_stream_ctx);
             }
             full_fs_stream_active = false;
+            cache_invalidate();
         }
         LOG_INF("Closing full_fs, total bytes written: %u", full_fs_file.len);
         full_fs_file.opened = false;
@@ -284,10 +428,7 @@ static lv_fs_res_t lvgl_fs_read(struct _lv_fs_drv_t *drv, void *file, void *buf,
                                 uint32_t *br)
 {
     int rc;
-    uint32_t extra_bytes_start;
-    uint32_t extra_bytes_end;
-    uint32_t extra_cache_bytes;
-    uint32_t orig_read_address, read_address;
+    uint32_t read_address;
     opened_file_t *open_file = (opened_file_t *)file;
 
     btr = MIN(btr, open_file->header->len - open_file->index);
@@ -296,62 +437,25 @@ static lv_fs_res_t lvgl_fs_read(struct _lv_fs_drv_t *drv, void *file, void *buf,
         return LV_FS_RES_OK;
     }
 
-    orig_read_address = open_file->header->offset + open_file->index + file_table.header_length;
-
-    if (open_file->is_cached && (orig_read_address >= current_cached_file->cache_start) &&
-        ((orig_read_address + btr) < current_cached_file->cache_end)) {
-        __ASSERT(current_cached_file == open_file, "Cached file mismatch");
-        memcpy(buf, file_cache_buffer + (orig_read_address - current_cached_file->cache_start), btr);
-        *br = btr;
-        open_file->index += btr;
-        return errno_to_lv_fs_res(0);
-    } else if (current_cached_file) {
-        // Cache miss
-        current_cached_file->is_cached = false;
-        current_cached_file = NULL;
-    }
-
-    read_address = ROUND_DOWN(orig_read_address, 4);
+    read_address = open_file->header->offset + open_file->index + file_table.header_length;
 
-    if ((read_address != orig_read_address) && btr < sizeof(file_cache_buffer)) {
-        extra_bytes_start = orig_read_address - read_address;
+    if (btr >= SPI_FLASH_SECTOR_SIZE) {
+        // Large reads such as full image data gain nothing from caching, read straight into the destination.
+        rc = flash_area_read(flash_area, read_address, buf, btr);
+        k_mutex_lock(&cache_mutex, K_FOREVER);
+        cache_stats.bypass_reads++;
+        cache_stats.flash_bytes_read += btr;
+        k_mutex_unlock(&cache_mutex);
     } else {
-        extra_bytes_start = 0;
-        read_address = orig_read_address;
+        rc = cache_read(read_address, buf, btr);
     }
 
-    if (!IS_ALIGNED(btr + extra_bytes_start, 4) && (ROUND_UP(btr + extra_bytes_start, 4) < sizeof(file_cache_buffer))) {
-        extra_bytes_end = ROUND_UP(btr + extra_bytes_start, 4) - (btr + extra_bytes_start);
-    } else {
-        extra_bytes_end = 0;
-    }
-
-    uint32_t cache_max_len = sizeof(file_cache_buffer) - extra_bytes_start - btr - extra_bytes_end;
-    cache_max_len = MIN(cache_max_len, open_file->header->len - open_file->index);
-
-    if (!current_cached_file && btr != 4) {
-        current_cached_file = open_file;
-        current_cached_file->cache_start = read_address;
-        current_cached_file->cache_end = read_address + cache_max_len + btr + extra_bytes_start + extra_bytes_end;
-        current_cached_file->is_cached = true;
-        extra_cache_bytes = cache_max_len;
-    } else {
-        extra_cache_bytes = 0;
-    }
-
-    rc = flash_area_read(flash_area, read_address, (extra_bytes_start || extra_bytes_end ||
-                                                    current_cached_file) ? file_cache_buffer : buf,
-                         btr + extra_bytes_start + extra_bytes_end + extra_cache_bytes);
     if (rc != 0) {
         printk("Flash read failed! %d\n", rc);
         *br = 0;
         return errno_to_lv_fs_res(rc);
     }
 
-    if (extra_bytes_start || current_cached_file) {
-        memcpy(buf, file_cache_buffer + extra_bytes_start, btr);
-    }
-
     *br = btr;
     open_file->index += btr;
     return errno_to_lv_fs_res(0);
@@ -586,7 +690,8 @@ int zsw_filesytem_erase(void)
 {
     memset(opened_files, 0, sizeof(opened_files));
     memset(&file_table, 0, sizeof(file_table));
-    current_cached_file = NULL;
+    file_table_sorted = false;
+    cache_invalidate();
     full_fs_file.len = 0;
     full_fs_file.index = 0;
     full_fs_stream_active = false;
@@ -609,6 +714,210 @@ int zsw_filesytem_erase(void)
     return 0;
 }
 
+#ifdef CONFIG_SHELL
+static uint64_t bench_time_ns(void)
+{
+#ifdef CONFIG_ARCH_POSIX
+    struct timespec ts;
+
+    // Simulated time doesn't advance while code runs, measure with the host clock
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+    return k_ticks_to_ns_floor64(k_uptime_ticks());
+#endif
+}
+
+// Time fs_open and the first read of every file, with the block cache emptied before each open.
+static int bench_open(const struct shell *sh, uint32_t rounds)
+{
+    int rc;
+    ssize_t num_read;
+    uint64_t start;
+    uint64_t total_ns = 0;
+    struct fs_file_t file;
+    uint8_t buf[64];
+    char path[sizeof(ZSW_FS_MOUNT_POINT) + MAX_FILE_NAME_LEN + 1];
+
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (int i = 0; i < file_table.num_files; i++) {
+            snprintf(path, sizeof(path), "%s/%.*s", ZSW_FS_MOUNT_POINT, MAX_FILE_NAME_LEN,
+                     file_table.file_headers[i].filename);
+            fs_file_t_init(&file);
+            cache_invalidate();
+
+            start = bench_time_ns();
+            rc = fs_open(&file, path, FS_O_READ);
+            if (rc < 0) {
+                shell_error(sh, "Failed to open %s: %d", path, rc);
+                return rc;
+            }
+            num_read = fs_read(&file, buf, MIN(sizeof(buf), file_table.file_headers[i].len));
+            total_ns += bench_time_ns() - start;
+
+            fs_close(&file);
+            if (num_read < 0) {
+                shell_error(sh, "Failed to read %s: %d", path, (int)num_read);
+                return num_read;
+            }
+        }
+    }
+
+    shell_print(sh, "Open and first read: %u opens, %u ns per open", rounds * file_table.num_files,
+                (uint32_t)(total_ns / (rounds * file_table.num_files)));
+
+    return 0;
+}
+
+static int cmd_rawfs_bench(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t rounds = 10;
+    uint64_t start;
+    uint64_t linear_ns;
+    uint64_t sorted_ns;
+    uint32_t num_lookups;
+    uint32_t num_found = 0;
+    char name[MAX_FILE_NAME_LEN + 1];
+
+    if (argc > 1) {
+        rounds = MAX(1, strtoul(argv[1], NULL, 10));
+    }
+
+    if ((full_fs_file.len == 0) || (file_table.num_files == 0)) {
+        shell_error(sh, "No raw filesystem image");
+        return -ENOENT;
+    }
+
+    num_lookups = rounds * file_table.num_files;
+
+    start = bench_time_ns();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (int i = 0; i < file_table.num_files; i++) {
+            strncpy(name, file_table.file_headers[i].filename, MAX_FILE_NAME_LEN);
+            name[MAX_FILE_NAME_LEN] = '\0';
+            num_found += (find_file_linear(name) != NULL);
+        }
+    }
+    linear_ns = bench_time_ns() - start;
+
+    shell_print(sh, "Linear lookup: %u lookups, %u ns per lookup", num_lookups, (uint32_t)(linear_ns / num_lookups));
+    if (num_found != num_lookups) {
+        shell_warn(sh, "Only %u files found", num_found);
+    }
+
+    if (file_table_sorted) {
+        num_found = 0;
+        start = bench_time_ns();
+        for (uint32_t round = 0; round < rounds; round++) {
+            for (int i = 0; i < file_table.num_files; i++) {
+                strncpy(name, file_table.file_headers[i].filename, MAX_FILE_NAME_LEN);
+                name[MAX_FILE_NAME_LEN] = '\0';
+                num_found += (find_file_sorted(name) != NULL);
+            }
+        }
+        sorted_ns = bench_time_ns() - start;
+
+        shell_print(sh, "Binary search: %u lookups, %u ns per lookup", num_lookups,
+                    (uint32_t)(sorted_ns / num_lookups));
+        if (num_found != num_lookups) {
+            shell_warn(sh, "Only %u files found", num_found);
+        }
+    } else {
+        shell_print(sh, "File table not sorted, skipping binary search");
+    }
+
+    return bench_open(sh, rounds);
+}
+
+static int cmd_rawfs_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    cache_stats_t stats;
+    uint32_t lookups;
+
+    k_mutex_lock(&cache_mutex, K_FOREVER);
+    stats = cache_stats;
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        memset(&cache_stats, 0, sizeof(cache_stats));
+    }
+    k_mutex_unlock(&cache_mutex);
+
+    lookups = stats.hits + stats.misses;
+
+    shell_print(sh, "Cache blocks:     %d x %d bytes", CONFIG_ZSW_RAWFS_CACHE_BLOCKS, SPI_FLASH_SECTOR_SIZE);
+    shell_print(sh, "Hits:             %u", stats.hits);
+    shell_print(sh, "Misses:           %u", stats.misses);
+    shell_print(sh, "Hit ratio:        %u%%", lookups ? (uint32_t)(((uint64_t)stats.hits * 100) / lookups) : 0);
+    shell_print(sh, "Uncached reads:   %u", stats.bypass_reads);
+    shell_print(sh, "Flash bytes read: %llu", stats.flash_bytes_read);
+
+    return 0;
+}
+
+static int cmd_rawfs_imgload(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t rounds = 10;
+    uint64_t start;
+    uint64_t total_ns = 0;
+    uint64_t flash_bytes_read;
+    lv_image_decoder_dsc_t dsc;
+    lv_result_t res = LV_RESULT_OK;
+    char src[MAX_FILE_NAME_LEN + 4];
+
+    if (argc > 2) {
+        rounds = MAX(1, strtoul(argv[2], NULL, 10));
+    }
+
+    snprintf(src, sizeof(src), "S:%s", argv[1]);
+
+    k_mutex_lock(&cache_mutex, K_FOREVER);
+    flash_bytes_read = cache_stats.flash_bytes_read;
+    k_mutex_unlock(&cache_mutex);
+
+    lvgl_lock();
+    for (uint32_t round = 0; round < rounds; round++) {
+        // Measure the decode from flash, not a hit in LVGL's decoded image cache.
+        lv_image_cache_drop(src);
+        start = bench_time_ns();
+        res = lv_image_decoder_open(&dsc, src, NULL);
+        if (res != LV_RESULT_OK) {
+            break;
+        }
+        total_ns += bench_time_ns() - start;
+        lv_image_decoder_close(&dsc);
+    }
+    lv_image_cache_drop(src);
+    lvgl_unlock();
+
+    if (res != LV_RESULT_OK) {
+        shell_error(sh, "Failed to decode %s", src);
+        return -EIO;
+    }
+
+    k_mutex_lock(&cache_mutex, K_FOREVER);
+    flash_bytes_read = cache_stats.flash_bytes_read - flash_bytes_read;
+    k_mutex_unlock(&cache_mutex);
+
+    shell_print(sh, "%s: %u x %u, %s", src, dsc.header.w, dsc.header.h,
+                (dsc.header.flags & LV_IMAGE_FLAGS_COMPRESSED) ? "compressed" : "raw");
+    shell_print(sh, "Decode: %u us per load", (uint32_t)(total_ns / rounds / 1000));
+    shell_print(sh, "Flash bytes read: %u per load", (uint32_t)(flash_bytes_read / rounds));
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_rawfs,
+                               SHELL_CMD_ARG(bench, NULL, "Benchmark file lookups and opens: rawfs bench [rounds]",
+                                             cmd_rawfs_bench, 1, 1),
+                               SHELL_CMD_ARG(stats, NULL, "Show block cache statistics: rawfs stats [reset]",
+                                             cmd_rawfs_stats, 1, 1),
+                               SHELL_CMD_ARG(imgload, NULL, "Time image decoding: rawfs imgload <file> [rounds]",
+                                             cmd_rawfs_imgload, 2, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(rawfs, &sub_rawfs, "Raw resource filesystem commands", NULL);
+#endif
+
 /* Zephyr File system interface */
 static const struct fs_file_system_t zsw_fs = {
     .open = zsw_fs_open,
@@ -673,7 +982,15 @@ static int zsw_decoder_init(void)
     if (file_table.magic != TABLE_HEADER_MAGIC) {
         LOG_ERR("Invalid file table magic: 0x%08x", file_table.magic);
         full_fs_file.len = 0;
+    } else if (file_table.num_files > ARRAY_SIZE(file_table.file_headers)) {
+        LOG_ERR("Invalid number of files: %u", file_table.num_files);
+        full_fs_file.len = 0;
     } else {
+        file_table_sorted = is_file_table_sorted();
+        if (!file_table_sorted) {
+            LOG_WRN("File table not sorted, using linear lookup");
+        }
+
         uint32_t trailer_magic;
         uint32_t trailer_offset = file_table.total_length - sizeof(trailer_magic); // Last 4 bytes
 
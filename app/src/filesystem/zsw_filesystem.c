@@ -168,4 +168,7 @@ static int zsw_user_lfs_init(void)
 }
 
 SYS_INIT(zsw_filesystem_ls, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
-SYS_INIT(zsw_user_lfs_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+// Mounted before the applications, they load their histories from it in their init.
+BUILD_ASSERT(CONFIG_ZSW_USER_LFS_INIT_PRIORITY < CONFIG_APPLICATION_INIT_PRIORITY,
+             "The user partition must be mounted before the applications are initialized");
+SYS_INIT(zsw_user_lfs_init, APPLICATION, CONFIG_ZSW_USER_LFS_INIT_PRIORITY);
@@ -21,141 +21,63 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
-#include <zephyr/settings/settings.h>
-#ifdef CONFIG_SETTINGS_NVS
-#include <zephyr/fs/nvs.h>
-#endif
 #include "zsw_history.h"
-
-#define ZSW_HISTORY_HEADER_EXTENSION    "head"
-#define ZSW_HISTORY_DATA_EXTENSION      "data"
-
-// Text + 1 byte (_) + 6 byte extension (header) + 1 byte (\0)
-static char key_data[ZSW_HISTORY_MAX_KEY_LENGTH + 8];
-static char key_header[ZSW_HISTORY_MAX_KEY_LENGTH + 8];
+#include "zsw_history_store.h"
+
+#if defined(CONFIG_ZSW_HISTORY_BACKEND_LOG)
+#define history_store_init      zsw_history_log_init
+#define history_store_load      zsw_history_log_load
+#define history_store_save      zsw_history_log_save
+#define history_store_del       zsw_history_log_del
+#else
+#define history_store_init      zsw_history_settings_init
+#define history_store_load      zsw_history_settings_load
+#define history_store_save      zsw_history_settings_save
+#define history_store_del       zsw_history_settings_del
+#endif
 
 LOG_MODULE_REGISTER(zsw_history, CONFIG_ZSW_HISTORY_LOG_LEVEL);
 
-static int zsw_history_load_header_cb(const char *p_key, size_t len, settings_read_cb read_cb, void *p_cb_arg,
-                                      void *p_param)
+static void zsw_history_reset(zsw_history_t *p_history)
 {
-    zsw_history_t *p_history;
-    zsw_history_t temp_stored_history;
-    uint32_t num_bytes_header;
-
-    p_history = (zsw_history_t *)p_param;
-
-    num_bytes_header = read_cb(p_cb_arg, &temp_stored_history, sizeof(zsw_history_t));
-    LOG_DBG("Read %u header bytes, expecting: %d", num_bytes_header, sizeof(zsw_history_t));
-
-    // In case data structure or the user changed either sample size or number of max samples we need to handle that.
-    if ((num_bytes_header == 0) || (num_bytes_header != sizeof(zsw_history_t))) {
-        LOG_ERR("Invalid header. Struct size changed!");
-        zsw_history_del(p_history);
-    } else if (temp_stored_history.max_samples != p_history->max_samples) {
-        LOG_ERR("max_samples does not match what's stored in settings. Erasing history: %d != %d",
-                temp_stored_history.max_samples, p_history->max_samples);
-        zsw_history_del(p_history);
-    } else if (temp_stored_history.sample_size != p_history->sample_size) {
-        LOG_ERR("sample_size does not match what's stored in settings. Erasing history: %d != %d",
-                temp_stored_history.sample_size, p_history->sample_size);
-        zsw_history_del(p_history);
-    } else {
-        // Everything is fine, we can load the history
-        p_history->write_index = temp_stored_history.write_index;
-        p_history->num_samples = temp_stored_history.num_samples;
-    }
-
-    return 0;
-}
-
-static int zsw_history_load_data_cb(const char *p_key, size_t len, settings_read_cb read_cb, void *p_cb_arg,
-                                    void *p_param)
-{
-    zsw_history_t *history;
-    uint32_t num_bytes_data;
-
-    history = (zsw_history_t *)p_param;
-
-    num_bytes_data = read_cb(p_cb_arg, history->samples, len);
-    LOG_DBG("Read %u data bytes", num_bytes_data);
-
-    if ((num_bytes_data == 0) || (num_bytes_data != len) ||
-        (num_bytes_data % history->sample_size) != 0) {
-        LOG_ERR("Invalid data!");
-        return -EFAULT;
-    }
-
-    return 0;
+    memset(p_history->samples, 0, p_history->max_samples * p_history->sample_size);
+    p_history->write_index = 0;
+    p_history->num_samples = 0;
+    p_history->num_unsaved = 0;
 }
 
 int zsw_history_init(zsw_history_t *p_history, uint32_t max_samples, uint8_t sample_size, void *p_samples,
                      const char *p_key)
 {
-    int32_t rc;
-
     __ASSERT((p_history != NULL) && (p_samples != NULL) && (p_key != NULL), "Invalid parameters for zsw_history_init");
 
-    p_history->write_index = 0;
-    p_history->num_samples = 0;
     p_history->max_samples = max_samples;
     p_history->sample_size = sample_size;
     p_history->samples = p_samples;
+    p_history->rollups = NULL;
+    zsw_history_reset(p_history);
 
-    memset(p_samples, 0, max_samples * sample_size);
     strcpy(p_history->key, p_key);
 
-    rc = settings_subsys_init();
-    if (rc) {
-        LOG_ERR("Error during settings initialization! Error: %i", rc);
-        return -EFAULT;
-    }
-
-#ifdef CONFIG_SETTINGS_NVS
-    struct nvs_fs *nvs_storage;
-
-    rc = settings_storage_get((void **)&nvs_storage);
-    __ASSERT(rc == 0, "Error during settings storage get! Error: %d", rc);
-
-    // As long as history is storing all samples as one key, we have a limit of NVS sector size for total size of samples
-    // TODO: Should store history not as one big chunk as it's not very efficient for flash wear.
-#define NVS_ESTIMATED_OVERHEAD 100
-    __ASSERT(max_samples * sample_size < (nvs_storage->sector_size - NVS_ESTIMATED_OVERHEAD),
-             "NVS sector size too small! history of %d has to fit one NVS page of %d", max_samples * sample_size,
-             (nvs_storage->sector_size - NVS_ESTIMATED_OVERHEAD));
-#endif
-    return 0;
+    return history_store_init(p_history);
 }
 
 int zsw_history_del(zsw_history_t *p_history)
 {
     int32_t error;
+    int32_t rollup_error = 0;
 
     __ASSERT(p_history != NULL, "Invalid parameter for zsw_history_del");
 
-    memset(p_history->samples, 0, p_history->max_samples * p_history->sample_size);
-    p_history->write_index = 0;
-    p_history->num_samples = 0;
+    zsw_history_reset(p_history);
 
-    // First: Delete the header
-    sprintf(key_header, "%s/%s", p_history->key, ZSW_HISTORY_HEADER_EXTENSION);
-    error = settings_delete(key_header);
-    if (error) {
-        LOG_ERR("Error during erasing the header! Error: %i", error);
-        return -EFAULT;
-    }
+    error = history_store_del(p_history);
 
-    // Second: Delete the data
-    sprintf(key_data, "%s/%s", p_history->key, ZSW_HISTORY_DATA_EXTENSION);
-    error = settings_delete(key_data);
-    if (error) {
-        LOG_ERR("Error during erasing the data! Error: %i", error);
-        return -EFAULT;
+    if (p_history->rollups != NULL) {
+        rollup_error = zsw_history_rollup_del(p_history);
     }
 
-    zsw_history_save(p_history);
-
-    return 0;
+    return error ? error : rollup_error;
 }
 
 void zsw_history_add(zsw_history_t *p_history, const void *p_sample)
@@ -177,6 +99,11 @@ void zsw_history_add(zsw_history_t *p_history, const void *p_sample)
     }
 
     p_history->num_samples = MIN(p_history->num_samples + 1, p_history->max_samples);
+    p_history->num_unsaved = MIN(p_history->num_unsaved + 1, p_history->max_samples);
+
+    if (p_history->rollups != NULL) {
+        zsw_history_rollup_add(p_history, p_sample);
+    }
 }
 
 void zsw_history_get(const zsw_history_t *p_history, void *p_sample, uint32_t index)
@@ -197,6 +124,67 @@ void zsw_history_get(const zsw_history_t *p_history, void *p_sample, uint32_t in
     memcpy(p_sample, start, p_history->sample_size);
 }
 
+uint32_t zsw_history_get_spans(const zsw_history_t *p_history, uint32_t start, uint32_t count,
+                               zsw_history_span_t spans[ZSW_HISTORY_MAX_SPANS])
+{
+    uint32_t first;
+    uint32_t num_first;
+
+    __ASSERT((p_history != NULL) && (spans != NULL), "Invalid parameters for zsw_history_get_spans");
+
+    if (start >= p_history->num_samples) {
+        return 0;
+    }
+
+    count = MIN(count, p_history->num_samples - start);
+    if (count == 0) {
+        return 0;
+    }
+
+    // Oldest sample is at write_index once the storage has wrapped around.
+    first = start;
+    if (p_history->num_samples == p_history->max_samples) {
+        first += p_history->write_index;
+        if (first >= p_history->max_samples) {
+            first -= p_history->max_samples;
+        }
+    }
+
+    num_first = MIN(count, p_history->max_samples - first);
+    spans[0].samples = (const uint8_t *)p_history->samples + first * p_history->sample_size;
+    spans[0].num_samples = num_first;
+
+    if (num_first == count) {
+        return 1;
+    }
+
+    spans[1].samples = p_history->samples;
+    spans[1].num_samples = count - num_first;
+
+    return 2;
+}
+
+uint32_t zsw_history_get_range(const zsw_history_t *p_history, void *p_samples, uint32_t start, uint32_t count)
+{
+    uint8_t *dest;
+    uint32_t num_spans;
+    uint32_t num_copied = 0;
+    zsw_history_span_t spans[ZSW_HISTORY_MAX_SPANS];
+
+    __ASSERT(p_samples != NULL, "Invalid parameters for zsw_history_get_range");
+
+    dest = p_samples;
+    num_spans = zsw_history_get_spans(p_history, start, count, spans);
+
+    for (uint32_t i = 0; i < num_spans; i++) {
+        memcpy(dest, spans[i].samples, spans[i].num_samples * p_history->sample_size);
+        dest += spans[i].num_samples * p_history->sample_size;
+        num_copied += spans[i].num_samples;
+    }
+
+    return num_copied;
+}
+
 int zsw_history_load(zsw_history_t *p_history)
 {
     int32_t error;
@@ -204,30 +192,31 @@ int zsw_history_load(zsw_history_t *p_history)
     __ASSERT((p_history != NULL) &&
              (strlen(p_history->key) <= ZSW_HISTORY_MAX_KEY_LENGTH), "Invalid parameters for zsw_history_load");
 
-    sprintf(key_header, "%s/%s", p_history->key, ZSW_HISTORY_HEADER_EXTENSION);
-    error = settings_load_subtree_direct(key_header, zsw_history_load_header_cb, p_history);
+    zsw_history_reset(p_history);
 
-    if (error) {
-        LOG_ERR("Error during header loading! Error: %i. Erasing history.", error);
-        zsw_history_del(p_history);
+    error = history_store_load(p_history);
+    if (error == -ENOENT) {
+        LOG_DBG("No stored history for %s", p_history->key);
+        zsw_history_reset(p_history);
+    } else if (error) {
+        LOG_ERR("Error during loading of %s! Error: %i. Erasing history.", p_history->key, error);
+        zsw_history_reset(p_history);
+        history_store_del(p_history);
     }
 
-    LOG_DBG("Load header with key %s", key_header);
+    // Everything loaded is already stored
+    p_history->num_unsaved = 0;
+
+    if (p_history->rollups != NULL) {
+        zsw_history_rollup_load(p_history);
+    }
+
+    LOG_DBG("Loaded history %s", p_history->key);
     LOG_DBG("   Num: %u", p_history->max_samples);
     LOG_DBG("   Sample size: %u", p_history->sample_size);
     LOG_DBG("   Write index: %u", p_history->write_index);
     LOG_DBG("   Num samples: %u", p_history->num_samples);
 
-    // Load the data
-    sprintf(key_data, "%s/%s", p_history->key, ZSW_HISTORY_DATA_EXTENSION);
-    error = settings_load_subtree_direct(key_data, zsw_history_load_data_cb, p_history);
-    LOG_DBG("Load data with key %s", key_data);
-    if (error) {
-        LOG_ERR("Error during data loading! Error: %i", error);
-        zsw_history_del(p_history);
-        return 0;
-    }
-
     return 0;
 }
 
@@ -238,27 +227,21 @@ int zsw_history_save(zsw_history_t *p_history)
     __ASSERT((p_history != NULL) &&
              (strlen(p_history->key) <= ZSW_HISTORY_MAX_KEY_LENGTH), "Invalid parameters for zsw_history_save");
 
-    // First: Store the header
-    sprintf(key_header, "%s/%s", p_history->key, ZSW_HISTORY_HEADER_EXTENSION);
-    LOG_DBG("Storing header with key %s", key_header);
-    error = settings_save_one(key_header, p_history, sizeof(zsw_history_t));
+    error = history_store_save(p_history);
     if (error) {
-        LOG_ERR("Error during saving of history header! Error: %i", error);
-        return -EFAULT;
+        return error;
     }
 
-    // Second: Save the data
-    sprintf(key_data, "%s/%s", p_history->key, ZSW_HISTORY_DATA_EXTENSION);
-    error = settings_save_one(key_data, p_history->samples, p_history->max_samples * p_history->sample_size);
-    if (error) {
-        LOG_ERR("Error during saving of history data! Error: %i", error);
-        return -EFAULT;
+    p_history->num_unsaved = 0;
+
+    if (p_history->rollups != NULL) {
+        return zsw_history_rollup_save(p_history);
     }
 
     return 0;
 }
 
-int zsw_history_samples(zsw_history_t *p_history)
+int zsw_history_samples(const zsw_history_t *p_history)
 {
     __ASSERT(p_history != NULL, "Invalid parameters for zsw_history_samples");
 
@@ -21,6 +21,9 @@
 #include <stddef.h>
 
 #define ZSW_HISTORY_MAX_KEY_LENGTH      64
+#define ZSW_HISTORY_MAX_SPANS           2
+
+struct zsw_history_rollups;
 
 /** @brief ZSWatch history object definition.
 */
@@ -31,19 +34,95 @@ typedef struct {
     uint32_t num_samples;                       /**< Number of valid samples stored. */
     char key[ZSW_HISTORY_MAX_KEY_LENGTH];       /**< */
     void *samples;                              /**< Pointer to sample storage. */
+    uint32_t num_unsaved;                       /**< Number of samples added since the last save. */
+    struct zsw_history_rollups *rollups;        /**< Optional rollup tiers, NULL when not used. */
 } zsw_history_t;
 
+/** @brief ZSWatch history span, a contiguous part of the sample storage.
+*/
+typedef struct {
+    const void *samples;                        /**< Pointer to the first sample of the span. */
+    uint32_t num_samples;                       /**< Number of samples in the span. */
+} zsw_history_span_t;
+
+/** @brief Rollup tiers, each one aggregates the closed periods of the tier below.
+*/
+typedef enum {
+    ZSW_HISTORY_ROLLUP_HOURLY,
+    ZSW_HISTORY_ROLLUP_DAILY,
+    ZSW_HISTORY_ROLLUP_WEEKLY,                  /**< Weeks start on Monday. */
+    ZSW_HISTORY_ROLLUP_NUM_TIERS,
+} zsw_history_rollup_tier_t;
+
+/** @brief Aggregate of all sample values within one period.
+*/
+typedef struct {
+    uint32_t start;                             /**< Start of the period in seconds since 1970, clock time. */
+    int32_t min;                                /**< Smallest value in the period. */
+    int32_t max;                                /**< Largest value in the period. */
+    int32_t sum;                                /**< Sum of all values in the period. */
+    uint32_t count;                             /**< Number of samples in the period. */
+} zsw_history_rollup_t;
+
+/** @brief              Callback returning the value of a sample to aggregate in the rollups.
+ *  @param p_sample     Pointer to the sample
+ *  @param p_time       Output, time of the sample in seconds since 1970, clock time
+ *  @return             Value of the sample
+*/
+typedef int32_t (*zsw_history_rollup_value_cb_t)(const void *p_sample, uint32_t *p_time);
+
+/** @brief ZSWatch history rollups. Periods that are still open are rebuilt on load and not stored.
+*/
+typedef struct zsw_history_rollups {
+    zsw_history_rollup_value_cb_t value_cb;
+    zsw_history_rollup_t open[ZSW_HISTORY_ROLLUP_NUM_TIERS];    /**< Period currently aggregated per tier. */
+    zsw_history_t tiers[ZSW_HISTORY_ROLLUP_NUM_TIERS];          /**< Closed periods per tier. */
+} zsw_history_rollups_t;
+
 /** @brief              Initialize a history object.
  *  @param p_history    History object
  *  @param max_samples  Length of the sample storage in samples
  *  @param sample_size  Size of one sample in the sample storage
  *  @param p_samples    Pointer to the sample storage
- *  @param p_key        Pointer to the NVS key (max. length 64 bytes)
+ *  @param p_key        Pointer to the storage key (max. length 64 bytes)
  *  @return             0 when successful
 */
 int zsw_history_init(zsw_history_t *p_history, uint32_t max_samples, uint8_t sample_size, void *samples,
                      const char *p_key);
 
+/** @brief              Enable rollups for a history. Call after zsw_history_init and before zsw_history_load.
+ *  @details            The rollups are updated in zsw_history_add and stored, loaded and deleted together
+ *                      with the history. The key of the history must leave room for a 2 character suffix.
+ *  @param p_history    History object
+ *  @param p_rollups    Rollup object, must stay valid as long as the history is used
+ *  @param value_cb     Callback returning the value and time of a sample
+ *  @param p_storage    Storage for the closed periods of each tier
+ *  @param num_storage  Length of the storage of each tier in periods
+ *  @return             0 when successful
+*/
+int zsw_history_rollups_init(zsw_history_t *p_history, zsw_history_rollups_t *p_rollups,
+                             zsw_history_rollup_value_cb_t value_cb,
+                             zsw_history_rollup_t *const p_storage[ZSW_HISTORY_ROLLUP_NUM_TIERS],
+                             const uint32_t num_storage[ZSW_HISTORY_ROLLUP_NUM_TIERS]);
+
+/** @brief              Get the closed periods of a rollup tier.
+ *  @details            The returned history can be read with zsw_history_samples, zsw_history_get
+ *                      and zsw_history_get_spans. Each sample is a zsw_history_rollup_t.
+ *  @param p_history    History object
+ *  @param tier         Rollup tier
+ *  @return             History of closed periods, NULL when rollups are not enabled
+*/
+const zsw_history_t *zsw_history_rollup_tier(const zsw_history_t *p_history, zsw_history_rollup_tier_t tier);
+
+/** @brief              Get the aggregate of the newest, still open, period of a rollup tier.
+ *  @param p_history    History object
+ *  @param tier         Rollup tier
+ *  @param p_rollup     Output aggregate
+ *  @return             0 when successful, -ENODATA when no sample was added yet
+*/
+int zsw_history_rollup_get_current(const zsw_history_t *p_history, zsw_history_rollup_tier_t tier,
+                                   zsw_history_rollup_t *p_rollup);
+
 /** @brief              Clear the sample storage and reset the sample counter.
  *  @param p_history    History object
  *  @return             0 when successful
@@ -64,13 +143,36 @@ void zsw_history_add(zsw_history_t *p_history, const void *p_sample);
 */
 void zsw_history_get(const zsw_history_t *p_history, void *p_sample, uint32_t index);
 
-/** @brief              Load a history from the NVS.
+/** @brief              Get a range of samples without copying them.
+ *  @details            The samples are returned oldest first, split in at most two spans
+ *                      where the sample storage wraps around. The spans point into the sample
+ *                      storage and are only valid until the next call to zsw_history_add.
+ *  @param p_history    History object
+ *  @param start        Index of the first sample, 0 is the oldest sample
+ *  @param count        Number of samples
+ *  @param spans        Output spans
+ *  @return             Number of spans filled, 0 when the range is empty
+*/
+uint32_t zsw_history_get_spans(const zsw_history_t *p_history, uint32_t start, uint32_t count,
+                               zsw_history_span_t spans[ZSW_HISTORY_MAX_SPANS]);
+
+/** @brief              Copy a range of samples.
+ *  @param p_history    History object
+ *  @param p_samples    Destination buffer for up to count samples
+ *  @param start        Index of the first sample, 0 is the oldest sample
+ *  @param count        Number of samples
+ *  @return             Number of samples copied
+*/
+uint32_t zsw_history_get_range(const zsw_history_t *p_history, void *p_samples, uint32_t start, uint32_t count);
+
+/** @brief              Load a history from the persistent storage.
  *  @param p_history    History object
  *  @return             0 when successfulconst
 */
 int zsw_history_load(zsw_history_t *p_history);
 
-/** @brief              Writes the history in the NVS.
+/** @brief              Writes the history to the persistent storage.
+ *  @details            With the log backend only the samples added since the last save are written.
  *  @param p_history    History object
  *  @return             0 when successful
 */
@@ -80,4 +182,4 @@ int zsw_history_save(zsw_history_t *p_history);
  *  @param p_history    History object
  *  @return             Number of samples
 */
-int zsw_history_samples(zsw_history_t *p_history);
+int zsw_history_samples(const zsw_history_t *p_history);
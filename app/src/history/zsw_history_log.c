@@ -0,0 +1,511 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Append-only history storage on the user LittleFS partition.
+ *
+ * Every history gets its own directory with a small header file and a sequence of
+ * chunk files, each holding up to CONFIG_ZSW_HISTORY_LOG_CHUNK_SIZE bytes of samples:
+ *
+ *   /user/hist/<escaped key>/head
+ *   /user/hist/<escaped key>/<first_chunk> ... <last_chunk>
+ *
+ * A save only appends the samples added since the last save to the last chunk. When
+ * it is full a new chunk is started and the oldest chunk is deleted once it no longer
+ * holds any of the last max_samples samples. The header is only rewritten when the
+ * set of chunks changes.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include "zsw_history_store.h"
+#include "filesystem/zsw_filesystem.h"
+
+#define HISTORY_LOG_DIR             ZSW_USER_LFS_MOUNT_POINT "/hist"
+#define HISTORY_LOG_HEAD_NAME       "head"
+#define HISTORY_LOG_MAGIC           0x474C485A // "ZHLG"
+#define HISTORY_LOG_VERSION         1
+// Room for every key character being escaped, see dir_path
+#define HISTORY_LOG_PATH_LEN        (sizeof(HISTORY_LOG_DIR) + 3 * ZSW_HISTORY_MAX_KEY_LENGTH + 16)
+
+LOG_MODULE_DECLARE(zsw_history, CONFIG_ZSW_HISTORY_LOG_LEVEL);
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t sample_size;
+    uint8_t reserved;
+    uint32_t max_samples;
+    uint32_t chunk_samples;
+    uint32_t first_chunk;
+    uint32_t last_chunk;
+} zsw_history_log_head_t;
+
+typedef struct {
+    const zsw_history_t *p_history;             // NULL when the slot is free
+    uint32_t first_chunk;                       // Sequence number of the oldest chunk
+    uint32_t last_chunk;                        // Sequence number of the chunk appended to
+    uint32_t chunk_fill;                        // Number of samples stored in the last chunk
+} zsw_history_log_state_t;
+
+static zsw_history_log_state_t log_states[CONFIG_ZSW_HISTORY_LOG_MAX_HISTORIES];
+
+static zsw_history_log_state_t *get_state(const zsw_history_t *p_history)
+{
+    for (int i = 0; i < ARRAY_SIZE(log_states); i++) {
+        if (log_states[i].p_history == p_history) {
+            return &log_states[i];
+        }
+    }
+
+    return NULL;
+}
+
+static uint32_t chunk_samples(const zsw_history_t *p_history)
+{
+    return MAX(1, CONFIG_ZSW_HISTORY_LOG_CHUNK_SIZE / p_history->sample_size);
+}
+
+// Enough chunks to always keep max_samples samples, plus the one currently being filled.
+static uint32_t max_chunks(const zsw_history_t *p_history)
+{
+    return DIV_ROUND_UP(p_history->max_samples, chunk_samples(p_history)) + 1;
+}
+
+static void dir_path(const zsw_history_t *p_history, char *p_path, size_t len)
+{
+    size_t offset;
+
+    offset = snprintf(p_path, len, "%s/", HISTORY_LOG_DIR);
+
+    // Keys are settings style paths, flatten them into a single directory name. '/' and the escape
+    // character itself are percent encoded, so two different keys never share a directory.
+    for (const char *p = p_history->key; (*p != '\0') && (offset + 3 < len); p++) {
+        if ((*p == '/') || (*p == '%')) {
+            offset += snprintf(p_path + offset, len - offset, "%%%02X", *p);
+        } else {
+            p_path[offset++] = *p;
+        }
+    }
+    p_path[offset] = '\0';
+}
+
+static void head_path(const zsw_history_t *p_history, char *p_path, size_t len)
+{
+    dir_path(p_history, p_path, len);
+    strncat(p_path, "/" HISTORY_LOG_HEAD_NAME, len - strlen(p_path) - 1);
+}
+
+static void chunk_path(const zsw_history_t *p_history, uint32_t chunk, char *p_path, size_t len)
+{
+    size_t offset;
+
+    dir_path(p_history, p_path, len);
+    offset = strlen(p_path);
+    snprintf(p_path + offset, len - offset, "/%08x", chunk);
+}
+
+static int make_dir(const char *p_path)
+{
+    int rc;
+
+    rc = fs_mkdir(p_path);
+    if ((rc < 0) && (rc != -EEXIST)) {
+        LOG_ERR("Failed to create %s: %d", p_path, rc);
+        return rc;
+    }
+
+    return 0;
+}
+
+static int write_head(const zsw_history_t *p_history, const zsw_history_log_state_t *p_state)
+{
+    int rc;
+    ssize_t written;
+    struct fs_file_t file;
+    char path[HISTORY_LOG_PATH_LEN];
+    zsw_history_log_head_t head = {
+        .magic = HISTORY_LOG_MAGIC,
+        .version = HISTORY_LOG_VERSION,
+        .sample_size = p_history->sample_size,
+        .max_samples = p_history->max_samples,
+        .chunk_samples = chunk_samples(p_history),
+        .first_chunk = p_state->first_chunk,
+        .last_chunk = p_state->last_chunk,
+    };
+
+    head_path(p_history, path, sizeof(path));
+
+    fs_file_t_init(&file);
+    rc = fs_open(&file, path, FS_O_CREATE | FS_O_WRITE);
+    if (rc < 0) {
+        LOG_ERR("Failed to open %s: %d", path, rc);
+        return rc;
+    }
+
+    written = fs_write(&file, &head, sizeof(head));
+    rc = fs_close(&file);
+
+    if (written != sizeof(head)) {
+        LOG_ERR("Failed to write %s: %d", path, (int)written);
+        return written < 0 ? (int)written : -EIO;
+    }
+
+    return rc;
+}
+
+static int read_head(const zsw_history_t *p_history, zsw_history_log_head_t *p_head)
+{
+    int rc;
+    ssize_t num_read;
+    struct fs_file_t file;
+    char path[HISTORY_LOG_PATH_LEN];
+
+    head_path(p_history, path, sizeof(path));
+
+    fs_file_t_init(&file);
+    rc = fs_open(&file, path, FS_O_READ);
+    if (rc < 0) {
+        return rc;
+    }
+
+    num_read = fs_read(&file, p_head, sizeof(*p_head));
+    fs_close(&file);
+
+    if (num_read != sizeof(*p_head)) {
+        LOG_ERR("Invalid header size %d", (int)num_read);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int create_log(zsw_history_t *p_history, zsw_history_log_state_t *p_state)
+{
+    int rc;
+    char path[HISTORY_LOG_PATH_LEN];
+
+    rc = make_dir(HISTORY_LOG_DIR);
+    if (rc < 0) {
+        return rc;
+    }
+
+    dir_path(p_history, path, sizeof(path));
+    rc = make_dir(path);
+    if (rc < 0) {
+        return rc;
+    }
+
+    p_state->first_chunk = 0;
+    p_state->last_chunk = 0;
+    p_state->chunk_fill = 0;
+
+    return write_head(p_history, p_state);
+}
+
+/* Read a chunk into the sample ring, straight into the sample storage without intermediate copies. */
+static int read_chunk(zsw_history_t *p_history, uint32_t chunk, uint32_t *p_num_read)
+{
+    int rc;
+    ssize_t num_read;
+    uint32_t contiguous;
+    size_t num_bytes = 0;
+    struct fs_file_t file;
+    char path[HISTORY_LOG_PATH_LEN];
+
+    *p_num_read = 0;
+    chunk_path(p_history, chunk, path, sizeof(path));
+
+    fs_file_t_init(&file);
+    rc = fs_open(&file, path, FS_O_RDWR);
+    if (rc < 0) {
+        return rc;
+    }
+
+    do {
+        contiguous = p_history->max_samples - p_history->write_index;
+        num_read = fs_read(&file, (uint8_t *)p_history->samples + p_history->write_index * p_history->sample_size,
+                           contiguous * p_history->sample_size);
+        if (num_read < 0) {
+            LOG_ERR("Failed to read %s: %d", path, (int)num_read);
+            fs_close(&file);
+            return num_read;
+        }
+
+        num_bytes += num_read;
+        num_read /= p_history->sample_size;
+        p_history->write_index = (p_history->write_index + num_read) % p_history->max_samples;
+        p_history->num_samples = MIN(p_history->num_samples + num_read, p_history->max_samples);
+        *p_num_read += num_read;
+    } while (num_read == contiguous);
+
+    // A sample only partially written before a reset is dropped so following appends stay aligned.
+    if ((num_bytes % p_history->sample_size) != 0) {
+        LOG_WRN("Truncating partial sample in %s", path);
+        fs_truncate(&file, *p_num_read * p_history->sample_size);
+    }
+
+    return fs_close(&file);
+}
+
+static int append_chunk(const zsw_history_t *p_history, uint32_t chunk, const void *p_data, size_t len)
+{
+    int rc;
+    ssize_t written;
+    struct fs_file_t file;
+    char path[HISTORY_LOG_PATH_LEN];
+
+    chunk_path(p_history, chunk, path, sizeof(path));
+
+    fs_file_t_init(&file);
+    rc = fs_open(&file, path, FS_O_CREATE | FS_O_WRITE | FS_O_APPEND);
+    if (rc < 0) {
+        LOG_ERR("Failed to open %s: %d", path, rc);
+        return rc;
+    }
+
+    written = fs_write(&file, p_data, len);
+    rc = fs_close(&file);
+
+    if (written != len) {
+        LOG_ERR("Failed to append to %s: %d", path, (int)written);
+        return written < 0 ? (int)written : -EIO;
+    }
+
+    return rc;
+}
+
+static int start_new_chunk(zsw_history_t *p_history, zsw_history_log_state_t *p_state)
+{
+    int rc;
+    char path[HISTORY_LOG_PATH_LEN];
+
+    p_state->last_chunk++;
+    p_state->chunk_fill = 0;
+
+    while ((p_state->last_chunk - p_state->first_chunk + 1) > max_chunks(p_history)) {
+        chunk_path(p_history, p_state->first_chunk, path, sizeof(path));
+        rc = fs_unlink(path);
+        if ((rc < 0) && (rc != -ENOENT)) {
+            LOG_ERR("Failed to delete %s: %d", path, rc);
+            return rc;
+        }
+        p_state->first_chunk++;
+    }
+
+    return write_head(p_history, p_state);
+}
+
+static int import_from_settings(zsw_history_t *p_history, zsw_history_log_state_t *p_state)
+{
+    int rc;
+
+    rc = create_log(p_history, p_state);
+    if (rc < 0) {
+        return rc;
+    }
+
+#ifdef CONFIG_SETTINGS
+    if (settings_subsys_init() != 0) {
+        return -ENOENT;
+    }
+
+    rc = zsw_history_settings_load(p_history);
+    if (rc == -ENOENT) {
+        return rc;
+    }
+
+    if ((rc == 0) && (p_history->num_samples > 0)) {
+        LOG_INF("Importing %u samples of %s from settings", p_history->num_samples, p_history->key);
+        p_history->num_unsaved = p_history->num_samples;
+        rc = zsw_history_log_save(p_history);
+        if (rc < 0) {
+            // Keep the settings keys to import them again on the next load
+            return rc;
+        }
+    } else if (rc < 0) {
+        LOG_WRN("Dropping unreadable history %s in settings: %d", p_history->key, rc);
+    }
+
+    // Imported or unusable, either way the keys must not be left behind in settings
+    zsw_history_settings_del(p_history);
+
+    return rc == 0 ? 0 : -ENOENT;
+#else
+    return -ENOENT;
+#endif
+}
+
+int zsw_history_log_init(zsw_history_t *p_history)
+{
+    zsw_history_log_state_t *p_state;
+
+    __ASSERT(p_history->sample_size > 0, "Invalid sample size for zsw_history_log_init");
+
+    p_state = get_state(p_history);
+    if (p_state == NULL) {
+        p_state = get_state(NULL);
+        if (p_state == NULL) {
+            LOG_ERR("No free history log slot for %s, increase CONFIG_ZSW_HISTORY_LOG_MAX_HISTORIES",
+                    p_history->key);
+            return -ENOMEM;
+        }
+    }
+
+    memset(p_state, 0, sizeof(*p_state));
+    p_state->p_history = p_history;
+
+    return 0;
+}
+
+int zsw_history_log_load(zsw_history_t *p_history)
+{
+    int rc;
+    uint32_t num_read;
+    zsw_history_log_head_t head;
+    zsw_history_log_state_t *p_state = get_state(p_history);
+
+    if (p_state == NULL) {
+        return -ENODEV;
+    }
+
+    rc = read_head(p_history, &head);
+    if (rc == -ENOENT) {
+        return import_from_settings(p_history, p_state);
+    } else if (rc < 0) {
+        return rc;
+    }
+
+    if ((head.magic != HISTORY_LOG_MAGIC) || (head.version != HISTORY_LOG_VERSION)) {
+        LOG_ERR("Invalid history log header");
+        return -EINVAL;
+    } else if ((head.max_samples != p_history->max_samples) || (head.sample_size != p_history->sample_size) ||
+               (head.chunk_samples != chunk_samples(p_history))) {
+        LOG_ERR("History layout changed. Erasing history.");
+        return -EINVAL;
+    }
+
+    p_state->first_chunk = head.first_chunk;
+    p_state->last_chunk = head.last_chunk;
+    p_state->chunk_fill = 0;
+
+    for (uint32_t chunk = head.first_chunk; chunk != head.last_chunk + 1; chunk++) {
+        rc = read_chunk(p_history, chunk, &num_read);
+        if (rc == -ENOENT) {
+            // Chunk was deleted or not yet written when the power went away.
+            LOG_WRN("Missing history chunk %u", chunk);
+            continue;
+        } else if (rc < 0) {
+            return rc;
+        }
+
+        if (chunk == head.last_chunk) {
+            p_state->chunk_fill = num_read;
+        }
+    }
+
+    return 0;
+}
+
+int zsw_history_log_save(zsw_history_t *p_history)
+{
+    int rc;
+    uint32_t run;
+    uint32_t index;
+    uint32_t remaining;
+    uint32_t per_chunk;
+    zsw_history_log_state_t *p_state = get_state(p_history);
+
+    if (p_state == NULL) {
+        return -ENODEV;
+    }
+
+    per_chunk = chunk_samples(p_history);
+    remaining = p_history->num_unsaved;
+    index = (p_history->write_index + p_history->max_samples - remaining) % p_history->max_samples;
+
+    while (remaining > 0) {
+        if (p_state->chunk_fill >= per_chunk) {
+            rc = start_new_chunk(p_history, p_state);
+            if (rc < 0) {
+                p_history->num_unsaved = remaining;
+                return rc;
+            }
+        }
+
+        run = MIN(remaining, per_chunk - p_state->chunk_fill);
+        run = MIN(run, p_history->max_samples - index);
+
+        rc = append_chunk(p_history, p_state->last_chunk,
+                          (uint8_t *)p_history->samples + index * p_history->sample_size, run * p_history->sample_size);
+        if (rc < 0) {
+            p_history->num_unsaved = remaining;
+            return rc;
+        }
+
+        LOG_DBG("Appended %u samples to chunk %u", run, p_state->last_chunk);
+        p_state->chunk_fill += run;
+        remaining -= run;
+        index = (index + run) % p_history->max_samples;
+    }
+
+    return 0;
+}
+
+int zsw_history_log_del(zsw_history_t *p_history)
+{
+    int rc;
+    struct fs_dir_t dir;
+    static struct fs_dirent entry;
+    char path[HISTORY_LOG_PATH_LEN];
+    char file_path[HISTORY_LOG_PATH_LEN + sizeof(entry.name)];
+    zsw_history_log_state_t *p_state = get_state(p_history);
+
+    if (p_state == NULL) {
+        return -ENODEV;
+    }
+
+    dir_path(p_history, path, sizeof(path));
+
+    // Remove one file at a time, as the header might not describe all chunks on flash.
+    while (true) {
+        fs_dir_t_init(&dir);
+        rc = fs_opendir(&dir, path);
+        if (rc < 0) {
+            break;
+        }
+
+        rc = fs_readdir(&dir, &entry);
+        fs_closedir(&dir);
+        if ((rc < 0) || (entry.name[0] == '\0')) {
+            break;
+        }
+
+        snprintf(file_path, sizeof(file_path), "%s/%s", path, entry.name);
+        rc = fs_unlink(file_path);
+        if (rc < 0) {
+            LOG_ERR("Failed to delete %s: %d", file_path, rc);
+            return rc;
+        }
+    }
+
+    return create_log(p_history, p_state);
+}
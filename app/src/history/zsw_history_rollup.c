@@ -0,0 +1,273 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Hierarchical rollups for zsw_history.
+ *
+ * Every added sample is aggregated into the open hourly period. When a sample for a later hour
+ * arrives the open hour is closed, appended to the hourly tier and aggregated into the open day,
+ * and in the same way closed days are aggregated into the open week. Closed periods are stored as
+ * histories of their own, open periods are rebuilt from the tier below when loading.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "zsw_history.h"
+#include "zsw_history_store.h"
+
+#define SECONDS_PER_HOUR    (60 * 60)
+#define SECONDS_PER_DAY     (24 * SECONDS_PER_HOUR)
+#define SECONDS_PER_WEEK    (7 * SECONDS_PER_DAY)
+
+LOG_MODULE_DECLARE(zsw_history, CONFIG_ZSW_HISTORY_LOG_LEVEL);
+
+static const uint32_t tier_period[ZSW_HISTORY_ROLLUP_NUM_TIERS] = {
+    SECONDS_PER_HOUR,
+    SECONDS_PER_DAY,
+    SECONDS_PER_WEEK,
+};
+
+// 1970-01-01 was a Thursday, shift weeks to start on Monday.
+static const uint32_t tier_offset[ZSW_HISTORY_ROLLUP_NUM_TIERS] = {
+    0,
+    0,
+    3 * SECONDS_PER_DAY,
+};
+
+static const char *tier_suffix[ZSW_HISTORY_ROLLUP_NUM_TIERS] = {
+    "/h",
+    "/d",
+    "/w",
+};
+
+static uint32_t period_start(zsw_history_rollup_tier_t tier, uint32_t time)
+{
+    return time - ((time + tier_offset[tier]) % tier_period[tier]);
+}
+
+static void rollup_merge(zsw_history_rollup_t *p_dest, const zsw_history_rollup_t *p_src)
+{
+    p_dest->min = MIN(p_dest->min, p_src->min);
+    p_dest->max = MAX(p_dest->max, p_src->max);
+    p_dest->sum += p_src->sum;
+    p_dest->count += p_src->count;
+}
+
+static void rollup_push(zsw_history_rollups_t *p_rollups, zsw_history_rollup_tier_t tier,
+                        const zsw_history_rollup_t *p_rollup)
+{
+    uint32_t start = period_start(tier, p_rollup->start);
+    zsw_history_rollup_t *p_open = &p_rollups->open[tier];
+
+    // Samples older than the open period (clock set back) are counted in the open period.
+    if ((p_open->count > 0) && (start > p_open->start)) {
+        zsw_history_add(&p_rollups->tiers[tier], p_open);
+        if (tier + 1 < ZSW_HISTORY_ROLLUP_NUM_TIERS) {
+            rollup_push(p_rollups, tier + 1, p_open);
+        }
+        p_open->count = 0;
+    }
+
+    if (p_open->count == 0) {
+        *p_open = *p_rollup;
+        p_open->start = start;
+    } else {
+        rollup_merge(p_open, p_rollup);
+    }
+}
+
+// End of the newest closed period of a tier, everything from there on belongs to open periods.
+static uint32_t closed_end(const zsw_history_rollups_t *p_rollups, zsw_history_rollup_tier_t tier)
+{
+    zsw_history_rollup_t last;
+    uint32_t num_closed = p_rollups->tiers[tier].num_samples;
+
+    if ((num_closed == 0) ||
+        (zsw_history_get_range(&p_rollups->tiers[tier], &last, num_closed - 1, 1) != 1)) {
+        return 0;
+    }
+
+    return last.start + tier_period[tier];
+}
+
+int zsw_history_rollups_init(zsw_history_t *p_history, zsw_history_rollups_t *p_rollups,
+                             zsw_history_rollup_value_cb_t value_cb,
+                             zsw_history_rollup_t *const p_storage[ZSW_HISTORY_ROLLUP_NUM_TIERS],
+                             const uint32_t num_storage[ZSW_HISTORY_ROLLUP_NUM_TIERS])
+{
+    int rc;
+    char key[ZSW_HISTORY_MAX_KEY_LENGTH];
+
+    __ASSERT((p_history != NULL) && (p_rollups != NULL) && (value_cb != NULL) && (p_storage != NULL) &&
+             (num_storage != NULL), "Invalid parameters for zsw_history_rollups_init");
+    __ASSERT(strlen(p_history->key) + 2 < ZSW_HISTORY_MAX_KEY_LENGTH, "Key too long for rollups");
+
+    memset(p_rollups, 0, sizeof(zsw_history_rollups_t));
+    p_rollups->value_cb = value_cb;
+
+    for (int tier = 0; tier < ZSW_HISTORY_ROLLUP_NUM_TIERS; tier++) {
+        snprintf(key, sizeof(key), "%s%s", p_history->key, tier_suffix[tier]);
+        rc = zsw_history_init(&p_rollups->tiers[tier], num_storage[tier], sizeof(zsw_history_rollup_t),
+                              p_storage[tier], key);
+        if (rc) {
+            return rc;
+        }
+    }
+
+    p_history->rollups = p_rollups;
+
+    return 0;
+}
+
+const zsw_history_t *zsw_history_rollup_tier(const zsw_history_t *p_history, zsw_history_rollup_tier_t tier)
+{
+    __ASSERT((p_history != NULL) && (tier < ZSW_HISTORY_ROLLUP_NUM_TIERS),
+             "Invalid parameters for zsw_history_rollup_tier");
+
+    if (p_history->rollups == NULL) {
+        return NULL;
+    }
+
+    return &p_history->rollups->tiers[tier];
+}
+
+int zsw_history_rollup_get_current(const zsw_history_t *p_history, zsw_history_rollup_tier_t tier,
+                                   zsw_history_rollup_t *p_rollup)
+{
+    uint32_t start;
+    const zsw_history_rollups_t *p_rollups;
+
+    __ASSERT((p_history != NULL) && (tier < ZSW_HISTORY_ROLLUP_NUM_TIERS) && (p_rollup != NULL),
+             "Invalid parameters for zsw_history_rollup_get_current");
+
+    p_rollups = p_history->rollups;
+    if ((p_rollups == NULL) || (p_rollups->open[ZSW_HISTORY_ROLLUP_HOURLY].count == 0)) {
+        return -ENODATA;
+    }
+
+    // The open hour holds the newest sample, lower tiers not yet closed into this tier are part of it too.
+    start = period_start(tier, p_rollups->open[ZSW_HISTORY_ROLLUP_HOURLY].start);
+    *p_rollup = p_rollups->open[ZSW_HISTORY_ROLLUP_HOURLY];
+    p_rollup->start = start;
+
+    for (int i = ZSW_HISTORY_ROLLUP_HOURLY + 1; i <= tier; i++) {
+        if ((p_rollups->open[i].count > 0) && (period_start(tier, p_rollups->open[i].start) == start)) {
+            rollup_merge(p_rollup, &p_rollups->open[i]);
+        }
+    }
+
+    return 0;
+}
+
+void zsw_history_rollup_add(zsw_history_t *p_history, const void *p_sample)
+{
+    uint32_t time;
+    zsw_history_rollup_t rollup;
+
+    rollup.min = p_history->rollups->value_cb(p_sample, &time);
+    rollup.max = rollup.min;
+    rollup.sum = rollup.min;
+    rollup.count = 1;
+    rollup.start = time;
+
+    rollup_push(p_history->rollups, ZSW_HISTORY_ROLLUP_HOURLY, &rollup);
+}
+
+int zsw_history_rollup_load(zsw_history_t *p_history)
+{
+    uint32_t end;
+    uint32_t num_spans;
+    uint32_t time;
+    const uint8_t *p_sample;
+    const zsw_history_rollup_t *p_closed;
+    zsw_history_rollups_t *p_rollups = p_history->rollups;
+    zsw_history_span_t spans[ZSW_HISTORY_MAX_SPANS];
+
+    memset(p_rollups->open, 0, sizeof(p_rollups->open));
+
+    for (int tier = 0; tier < ZSW_HISTORY_ROLLUP_NUM_TIERS; tier++) {
+        zsw_history_load(&p_rollups->tiers[tier]);
+    }
+
+    // Rebuild the open periods top down, so periods closed while rebuilding a lower tier are not counted twice.
+    for (int tier = ZSW_HISTORY_ROLLUP_NUM_TIERS - 1; tier > 0; tier--) {
+        end = closed_end(p_rollups, tier);
+        num_spans = zsw_history_get_spans(&p_rollups->tiers[tier - 1], 0,
+                                          p_rollups->tiers[tier - 1].num_samples, spans);
+        for (uint32_t i = 0; i < num_spans; i++) {
+            p_closed = spans[i].samples;
+            for (uint32_t j = 0; j < spans[i].num_samples; j++) {
+                if (p_closed[j].start >= end) {
+                    rollup_push(p_rollups, tier, &p_closed[j]);
+                }
+            }
+        }
+    }
+
+    end = closed_end(p_rollups, ZSW_HISTORY_ROLLUP_HOURLY);
+    num_spans = zsw_history_get_spans(p_history, 0, p_history->num_samples, spans);
+    for (uint32_t i = 0; i < num_spans; i++) {
+        p_sample = spans[i].samples;
+        for (uint32_t j = 0; j < spans[i].num_samples; j++, p_sample += p_history->sample_size) {
+            p_rollups->value_cb(p_sample, &time);
+            if (time >= end) {
+                zsw_history_rollup_add(p_history, p_sample);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int zsw_history_rollup_save(zsw_history_t *p_history)
+{
+    int rc;
+    int result = 0;
+
+    for (int tier = 0; tier < ZSW_HISTORY_ROLLUP_NUM_TIERS; tier++) {
+        if (p_history->rollups->tiers[tier].num_unsaved == 0) {
+            continue;
+        }
+
+        rc = zsw_history_save(&p_history->rollups->tiers[tier]);
+        if (rc) {
+            LOG_ERR("Error during saving of rollup %s! Error: %i", p_history->rollups->tiers[tier].key, rc);
+            result = rc;
+        }
+    }
+
+    return result;
+}
+
+int zsw_history_rollup_del(zsw_history_t *p_history)
+{
+    int rc;
+    int result = 0;
+
+    memset(p_history->rollups->open, 0, sizeof(p_history->rollups->open));
+
+    for (int tier = 0; tier < ZSW_HISTORY_ROLLUP_NUM_TIERS; tier++) {
+        rc = zsw_history_del(&p_history->rollups->tiers[tier]);
+        if (rc) {
+            result = rc;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,230 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2025 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#ifdef CONFIG_SETTINGS_NVS
+#include <zephyr/fs/nvs.h>
+#endif
+#include "zsw_history_store.h"
+
+#define ZSW_HISTORY_HEADER_EXTENSION    "head"
+#define ZSW_HISTORY_DATA_EXTENSION      "data"
+
+// Text + 1 byte (_) + 6 byte extension (header) + 1 byte (\0)
+static char key_data[ZSW_HISTORY_MAX_KEY_LENGTH + 8];
+static char key_header[ZSW_HISTORY_MAX_KEY_LENGTH + 8];
+
+LOG_MODULE_DECLARE(zsw_history, CONFIG_ZSW_HISTORY_LOG_LEVEL);
+
+/* Header layout as it was stored before the storage backends were split out of zsw_history_t.
+ * Kept as is so already stored histories can still be loaded.
+ */
+typedef struct {
+    uint32_t write_index;
+    uint32_t max_samples;
+    uint8_t sample_size;
+    uint32_t num_samples;
+    char key[ZSW_HISTORY_MAX_KEY_LENGTH];
+    void *samples;
+} zsw_history_settings_header_t;
+
+typedef struct {
+    zsw_history_t *p_history;
+    bool found;
+    int result;
+} zsw_history_settings_load_t;
+
+static int zsw_history_load_header_cb(const char *p_key, size_t len, settings_read_cb read_cb, void *p_cb_arg,
+                                      void *p_param)
+{
+    zsw_history_settings_load_t *p_load;
+    zsw_history_settings_header_t temp_stored_history;
+    uint32_t num_bytes_header;
+
+    p_load = (zsw_history_settings_load_t *)p_param;
+    p_load->found = true;
+
+    num_bytes_header = read_cb(p_cb_arg, &temp_stored_history, sizeof(temp_stored_history));
+    LOG_DBG("Read %u header bytes, expecting: %d", num_bytes_header, sizeof(temp_stored_history));
+
+    // In case data structure or the user changed either sample size or number of max samples we need to handle that.
+    if ((num_bytes_header == 0) || (num_bytes_header != sizeof(temp_stored_history))) {
+        LOG_ERR("Invalid header. Struct size changed!");
+        p_load->result = -EINVAL;
+    } else if (temp_stored_history.max_samples != p_load->p_history->max_samples) {
+        LOG_ERR("max_samples does not match what's stored in settings. Erasing history: %d != %d",
+                temp_stored_history.max_samples, p_load->p_history->max_samples);
+        p_load->result = -EINVAL;
+    } else if (temp_stored_history.sample_size != p_load->p_history->sample_size) {
+        LOG_ERR("sample_size does not match what's stored in settings. Erasing history: %d != %d",
+                temp_stored_history.sample_size, p_load->p_history->sample_size);
+        p_load->result = -EINVAL;
+    } else {
+        // Everything is fine, we can load the history
+        p_load->p_history->write_index = temp_stored_history.write_index;
+        p_load->p_history->num_samples = temp_stored_history.num_samples;
+    }
+
+    return 0;
+}
+
+static int zsw_history_load_data_cb(const char *p_key, size_t len, settings_read_cb read_cb, void *p_cb_arg,
+                                    void *p_param)
+{
+    zsw_history_t *history;
+    uint32_t num_bytes_data;
+
+    history = (zsw_history_t *)p_param;
+
+    if (len > (history->max_samples * history->sample_size)) {
+        LOG_ERR("Stored data larger than sample storage!");
+        return -EFAULT;
+    }
+
+    num_bytes_data = read_cb(p_cb_arg, history->samples, len);
+    LOG_DBG("Read %u data bytes", num_bytes_data);
+
+    if ((num_bytes_data == 0) || (num_bytes_data != len) ||
+        (num_bytes_data % history->sample_size) != 0) {
+        LOG_ERR("Invalid data!");
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int zsw_history_settings_init(zsw_history_t *p_history)
+{
+    int32_t rc;
+
+    rc = settings_subsys_init();
+    if (rc) {
+        LOG_ERR("Error during settings initialization! Error: %i", rc);
+        return -EFAULT;
+    }
+
+#ifdef CONFIG_SETTINGS_NVS
+    struct nvs_fs *nvs_storage;
+
+    rc = settings_storage_get((void **)&nvs_storage);
+    __ASSERT(rc == 0, "Error during settings storage get! Error: %d", rc);
+
+    // As long as history is storing all samples as one key, we have a limit of NVS sector size for total size of samples
+#define NVS_ESTIMATED_OVERHEAD 100
+    __ASSERT(p_history->max_samples * p_history->sample_size < (nvs_storage->sector_size - NVS_ESTIMATED_OVERHEAD),
+             "NVS sector size too small! history of %d has to fit one NVS page of %d",
+             p_history->max_samples * p_history->sample_size, (nvs_storage->sector_size - NVS_ESTIMATED_OVERHEAD));
+#endif
+    return 0;
+}
+
+int zsw_history_settings_del(zsw_history_t *p_history)
+{
+    int32_t error;
+
+    // First: Delete the header
+    sprintf(key_header, "%s/%s", p_history->key, ZSW_HISTORY_HEADER_EXTENSION);
+    error = settings_delete(key_header);
+    if (error) {
+        LOG_ERR("Error during erasing the header! Error: %i", error);
+        return -EFAULT;
+    }
+
+    // Second: Delete the data
+    sprintf(key_data, "%s/%s", p_history->key, ZSW_HISTORY_DATA_EXTENSION);
+    error = settings_delete(key_data);
+    if (error) {
+        LOG_ERR("Error during erasing the data! Error: %i", error);
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int zsw_history_settings_load(zsw_history_t *p_history)
+{
+    int32_t error;
+    zsw_history_settings_load_t load = {
+        .p_history = p_history,
+        .found = false,
+        .result = 0,
+    };
+
+    sprintf(key_header, "%s/%s", p_history->key, ZSW_HISTORY_HEADER_EXTENSION);
+    error = settings_load_subtree_direct(key_header, zsw_history_load_header_cb, &load);
+    LOG_DBG("Load header with key %s", key_header);
+    if (error) {
+        LOG_ERR("Error during header loading! Error: %i", error);
+        return -EFAULT;
+    }
+
+    if (!load.found) {
+        return -ENOENT;
+    }
+
+    if (load.result) {
+        return load.result;
+    }
+
+    // Load the data
+    sprintf(key_data, "%s/%s", p_history->key, ZSW_HISTORY_DATA_EXTENSION);
+    error = settings_load_subtree_direct(key_data, zsw_history_load_data_cb, p_history);
+    LOG_DBG("Load data with key %s", key_data);
+    if (error) {
+        LOG_ERR("Error during data loading! Error: %i", error);
+        return -EFAULT;
+    }
+
+    return 0;
+}
+
+int zsw_history_settings_save(zsw_history_t *p_history)
+{
+    int32_t error;
+    zsw_history_settings_header_t header = {
+        .write_index = p_history->write_index,
+        .max_samples = p_history->max_samples,
+        .sample_size = p_history->sample_size,
+        .num_samples = p_history->num_samples,
+    };
+
+    strcpy(header.key, p_history->key);
+
+    // First: Store the header
+    sprintf(key_header, "%s/%s", p_history->key, ZSW_HISTORY_HEADER_EXTENSION);
+    LOG_DBG("Storing header with key %s", key_header);
+    error = settings_save_one(key_header, &header, sizeof(header));
+    if (error) {
+        LOG_ERR("Error during saving of history header! Error: %i", error);
+        return -EFAULT;
+    }
+
+    // Second: Save the data
+    sprintf(key_data, "%s/%s", p_history->key, ZSW_HISTORY_DATA_EXTENSION);
+    error = settings_save_one(key_data, p_history->samples, p_history->max_samples * p_history->sample_size);
+    if (error) {
+        LOG_ERR("Error during saving of history data! Error: %i", error);
+        return -EFAULT;
+    }
+
+    return 0;
+}
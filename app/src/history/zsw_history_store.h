@@ -0,0 +1,50 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "zsw_history.h"
+
+/* Storage backends used by zsw_history.c. The in RAM sample buffer is owned by
+ * zsw_history.c, the backends only move samples between it and the flash.
+ */
+
+int zsw_history_settings_init(zsw_history_t *p_history);
+
+int zsw_history_settings_load(zsw_history_t *p_history);
+
+int zsw_history_settings_save(zsw_history_t *p_history);
+
+int zsw_history_settings_del(zsw_history_t *p_history);
+
+int zsw_history_log_init(zsw_history_t *p_history);
+
+int zsw_history_log_load(zsw_history_t *p_history);
+
+int zsw_history_log_save(zsw_history_t *p_history);
+
+int zsw_history_log_del(zsw_history_t *p_history);
+
+/* Rollup handling used by zsw_history.c, see zsw_history_rollup.c. */
+
+void zsw_history_rollup_add(zsw_history_t *p_history, const void *p_sample);
+
+int zsw_history_rollup_load(zsw_history_t *p_history);
+
+int zsw_history_rollup_save(zsw_history_t *p_history);
+
+int zsw_history_rollup_del(zsw_history_t *p_history);
@@ -203,11 +203,13 @@ static void on_close_popup_notification(uint32_t id)
 
 static void open_notification_popup(void *data)
 {
-    zsw_not_mngr_notification_t *not = zsw_notification_manager_get_newest();
-    if (not != NULL) {
+    static char strings[ZSW_NOTIFICATION_MGR_MAX_STRINGS_LEN];
+    zsw_not_mngr_notification_t not;
+
+    if (zsw_notification_manager_get_newest(&not, strings, sizeof(strings)) == 0) {
         zsw_ui_controller_set_notification_mode();
         zsw_vibration_run_pattern(ZSW_VIBRATION_PATTERN_NOTIFICATION);
-        zsw_notification_popup_show(not->sender, not->body, not->src, not->id, on_close_popup_notification, 10);
+        zsw_notification_popup_show(not.sender, not.body, not.src, not.id, on_close_popup_notification, 10);
     }
     pending_not_open = false;
 }
@@ -16,11 +16,12 @@
  */
 
 #include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/dlist.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/logging/log.h>
 
 #include <time.h>
-#include <string.h>
 #include <stdio.h>
 
 #include "events/ble_event.h"
@@ -29,83 +30,202 @@
 
 LOG_MODULE_REGISTER(notification_mgr, LOG_LEVEL_DBG);
 
-#define ZSW_NOTIFICATION_MGR_INVALID_ID         0xFFFFFFFF
-#define NOTIFICATION_INVALID_INDEX              0xFFFFFFFF
+// Open addressing id -> slot table, kept at most half full so probe sequences stay short
+#define ID_TABLE_SIZE                           (2 * ZSW_NOTIFICATION_MGR_MAX_STORED)
+#define ID_TABLE_EMPTY                          0xFF
+
+BUILD_ASSERT(ZSW_NOTIFICATION_MGR_MAX_STORED < ID_TABLE_EMPTY);
+
+typedef struct {
+    const char *name;
+    zsw_notification_src_t src;
+} notification_source_t;
 
 static void notification_mgr_zbus_ble_comm_data_callback(const struct zbus_channel *chan);
 static void notification_mgr_update_worker(struct k_work *item);
 
-static uint8_t num_notifications;
+static const notification_source_t sources[] = {
+    // {"t":"notify","id":1700974318,"src":"WhatsApp","title":"Daniel Kampert","subject":"","body":"H","sender":""}
+    { "Messenger", NOTIFICATION_SRC_FB_MESSENGER },
+    { "WhatsApp", NOTIFICATION_SRC_WHATSAPP },
+    // TODO Subject is before first \n in body so extract that into title field.
+    { "Gmail", NOTIFICATION_SRC_GMAIL },
+    { "Home Assistant", NOTIFICATION_SRC_HOME_ASSISTANT },
+    { "Discord", NOTIFICATION_SRC_DISCORD },
+    { "LinkedIn", NOTIFICATION_SRC_LINKEDIN },
+    { "Reddit", NOTIFICATION_SRC_REDDIT },
+    { "YouTube", NOTIFICATION_SRC_YOUTUBE },
+    { "Messages", NOTIFICATION_SRC_COMMON_MESSENGER },
+    { "Calendar", NOTIFICATION_SRC_CALENDAR },
+    { "Kalender", NOTIFICATION_SRC_CALENDAR },
+};
+
 static zsw_not_mngr_notification_t notifications[ZSW_NOTIFICATION_MGR_MAX_STORED];
+static uint8_t id_table[ID_TABLE_SIZE];
+static sys_dlist_t age_list;    // Oldest first
+static sys_dlist_t free_list;
+static uint8_t num_notifications;
+
+// Holds the sender, title and body strings of each notification in one block
+K_HEAP_DEFINE(notification_heap, CONFIG_ZSW_NOTIFICATION_MGR_STORE_SIZE);
+K_MUTEX_DEFINE(notification_mutex);
 
 static K_WORK_DEFINE(notification_work, notification_mgr_update_worker);
 ZBUS_LISTENER_DEFINE(notification_mgr_ble_comm_lis, notification_mgr_zbus_ble_comm_data_callback);
 ZBUS_CHAN_DECLARE(zsw_notification_mgr_chan);
 ZBUS_CHAN_DECLARE(zsw_notification_mgr_remove_chan);
 
-/** @brief      Find a notification index by a given notification ID.
+static uint32_t id_hash(uint32_t id)
+{
+    return (id * 2654435761U) % ID_TABLE_SIZE;
+}
+
+/** @brief      Find the id table position of a notification.
  *  @param id   Notification ID
- *  @return     Notification array index of the notification
+ *  @return     Position in id_table, or -ENOENT
 */
-static uint32_t find_notification_idx(uint32_t id)
+static int id_table_find(uint32_t id)
 {
-    for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        if (notifications[i].id == id) {
-            return i;
+    uint32_t pos = id_hash(id);
+
+    for (int i = 0; i < ID_TABLE_SIZE; i++) {
+        if (id_table[pos] == ID_TABLE_EMPTY) {
+            return -ENOENT;
+        }
+        if (notifications[id_table[pos]].id == id) {
+            return pos;
         }
+        pos = (pos + 1) % ID_TABLE_SIZE;
     }
 
-    return NOTIFICATION_INVALID_INDEX;
+    return -ENOENT;
 }
 
-/** @brief  Get the next free notification index.
- *  @return Free notification array index
-*/
-static uint32_t find_free_notification_idx(void)
+static void id_table_insert(uint8_t slot)
 {
-    for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        if (notifications[i].id == ZSW_NOTIFICATION_MGR_INVALID_ID) {
-            return i;
-        }
+    uint32_t pos = id_hash(notifications[slot].id);
+
+    // There are always free positions, the table has room for twice the number of slots.
+    while (id_table[pos] != ID_TABLE_EMPTY) {
+        pos = (pos + 1) % ID_TABLE_SIZE;
     }
+    id_table[pos] = slot;
+}
 
-    return NOTIFICATION_INVALID_INDEX;
+static void id_table_remove(uint32_t pos)
+{
+    uint32_t next = pos;
+    uint32_t home;
+
+    id_table[pos] = ID_TABLE_EMPTY;
+
+    // Move later entries of the probe sequence back into the hole, so lookups don't stop early at it
+    for (;;) {
+        next = (next + 1) % ID_TABLE_SIZE;
+        if (id_table[next] == ID_TABLE_EMPTY) {
+            return;
+        }
+
+        home = id_hash(notifications[id_table[next]].id);
+        // The entry can only move if its home position is not cyclically between the hole and itself
+        if ((pos < next) ? (home <= pos || home > next) : (home <= pos && home > next)) {
+            id_table[pos] = id_table[next];
+            id_table[next] = ID_TABLE_EMPTY;
+            pos = next;
+        }
+    }
 }
 
-/** @brief  Find the oldest notification.
- *  @return Notification index of the oldest notification
+/** @brief          Length of a string cut to at most max_len bytes, without splitting a UTF-8 character.
+ *  @param str
+ *  @param len      Length of str
+ *  @param max_len
+ *  @return         Length to copy
 */
-static uint32_t find_oldest_notification_idx(void)
+static size_t utf8_truncate(const char *str, size_t len, size_t max_len)
 {
-    uint32_t oldest_idx = ZSW_NOTIFICATION_MGR_INVALID_ID;
-    uint32_t oldest_id = NOTIFICATION_INVALID_INDEX;
+    if (str == NULL) {
+        return 0;
+    }
 
-    for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        if ((notifications[i].id != ZSW_NOTIFICATION_MGR_INVALID_ID) && (notifications[i].id < oldest_id)) {
-            oldest_idx = i;
-            oldest_id = notifications[i].id;
-        }
+    len = strnlen(str, len);
+    if (len <= max_len) {
+        return len;
+    }
+
+    len = max_len;
+    // Continuation bytes are 10xxxxxx, back up to the start of the character that doesn't fit.
+    while (len > 0 && ((uint8_t)str[len] & 0xC0) == 0x80) {
+        len--;
     }
 
-    return oldest_idx;
+    return len;
 }
 
-/** @brief  Find the newest notification.
- *  @return Notification index of the newest notification
+/** @brief              Unlink a notification and free its strings. Must be called with the mutex held.
+ *  @param pos          Position of the notification in id_table
+ *  @param removed      Copy of the removed notification, without strings
 */
-static uint32_t find_newest_notification_idx(void)
+static void remove_locked(int pos, zsw_not_mngr_notification_t *removed)
 {
-    uint32_t newest_idx = ZSW_NOTIFICATION_MGR_INVALID_ID;
-    uint32_t newest_id = 0;
+    uint8_t slot = id_table[pos];
+    zsw_not_mngr_notification_t *not = &notifications[slot];
 
-    for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        if ((notifications[i].id != ZSW_NOTIFICATION_MGR_INVALID_ID) && (notifications[i].id > newest_id)) {
-            newest_idx = i;
-            newest_id = notifications[i].id;
-        }
+    LOG_DBG("Remove notification on place %u with ID: %u", slot, not->id);
+
+    *removed = *not;
+    removed->sender = NULL;
+    removed->title = NULL;
+    removed->body = NULL;
+
+    id_table_remove(pos);
+    sys_dlist_remove(&not->node);
+    sys_dlist_append(&free_list, &not->node);
+    k_heap_free(&notification_heap, (void *)not->sender);
+    not->sender = NULL;
+    not->title = NULL;
+    not->body = NULL;
+    num_notifications--;
+
+    LOG_DBG("Notifications: %u", num_notifications);
+}
+
+/** @brief              Copy a notification and its strings. Must be called with the mutex held.
+ *  @param not
+ *  @param copy
+ *  @param buf          Buffer for the strings
+ *  @param buf_size
+ *  @return             Bytes used in buf, or -ENOMEM
+*/
+static int copy_locked(const zsw_not_mngr_notification_t *not, zsw_not_mngr_notification_t *copy, char *buf,
+                       size_t buf_size)
+{
+    // The strings are stored one after the other in one block, starting with the sender
+    size_t sender_size = strlen(not->sender) + 1;
+    size_t title_size = strlen(not->title) + 1;
+    size_t size = sender_size + title_size + strlen(not->body) + 1;
+
+    if (size > buf_size) {
+        return -ENOMEM;
     }
 
-    return newest_idx;
+    memcpy(buf, not->sender, size);
+    *copy = *not;
+    copy->sender = buf;
+    copy->title = &buf[sender_size];
+    copy->body = &buf[sender_size + title_size];
+    sys_dnode_init(&copy->node);
+
+    return size;
+}
+
+static void publish_removed(zsw_not_mngr_notification_t *removed)
+{
+    struct zsw_notification_remove_event evt;
+
+    // Published without the mutex held, the listeners may call back into the notification manager.
+    evt.notification = *removed;
+    zbus_chan_pub(&zsw_notification_mgr_remove_chan, &evt, K_NO_WAIT);
 }
 
 /** @brief
@@ -121,8 +241,6 @@ static void notification_mgr_update_worker(struct k_work *item)
 */
 static void notification_mgr_zbus_ble_comm_data_callback(const struct zbus_channel *chan)
 {
-    zsw_not_mngr_notification_t *not;
-
     // Need to context switch to not get stack overflow.
     // We are here in host bluetooth thread.
     const struct ble_data_event *event = zbus_chan_const_msg(chan);
@@ -132,18 +250,10 @@ static void notification_mgr_zbus_ble_comm_data_callback(const struct zbus_chann
         if (event->data.data.notify.src_len == 0) {
             return;
         }
-        not = zsw_notification_manager_add(&event->data.data.notify);
-        if (!not) {
+        if (zsw_notification_manager_add(&event->data.data.notify) != 0) {
             return;
         }
 
-        LOG_DBG("ID: %u", not->id);
-        LOG_DBG("Source: %u", not->src);
-        LOG_DBG("Sender: %s", not->sender);
-        LOG_DBG("Title: %s", not->title);
-        LOG_DBG("Body: %s", not->body);
-        LOG_DBG("Time: %u", not->timestamp);
-
         k_work_submit(&notification_work);
     } else if (event->data.type == BLE_COMM_DATA_TYPE_NOTIFY_REMOVE) {
         LOG_DBG("Remove notification with ID %u", event->data.data.notify_remove.id);
@@ -156,162 +266,171 @@ static void notification_mgr_zbus_ble_comm_data_callback(const struct zbus_chann
 
 void zsw_notification_manager_init(void)
 {
+    k_mutex_lock(&notification_mutex, K_FOREVER);
+
     memset(notifications, 0, sizeof(notifications));
+    memset(id_table, ID_TABLE_EMPTY, sizeof(id_table));
+    sys_dlist_init(&age_list);
+    sys_dlist_init(&free_list);
     for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        notifications[i].id = ZSW_NOTIFICATION_MGR_INVALID_ID;
+        sys_dlist_append(&free_list, &notifications[i].node);
     }
     num_notifications = 0;
+
+    k_mutex_unlock(&notification_mutex);
 }
 
-zsw_not_mngr_notification_t *zsw_notification_manager_add(const ble_comm_notify_t *not)
+int32_t zsw_notification_manager_add(const ble_comm_notify_t *not)
 {
-    uint32_t idx;
-
-    // Prevent double notifications with the same ID.
-    for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        if (notifications[i].id == not->id) {
-            LOG_DBG("Duplicate notification ID %u, ignoring", not->id);
-            return NULL;
+    zsw_notification_src_t src = NOTIFICATION_SRC_NONE;
+    zsw_not_mngr_notification_t *new_not;
+    zsw_not_mngr_notification_t removed;
+    const char *sender = not->title;
+    const char *title = "";
+    size_t sender_len;
+    size_t title_len;
+    size_t body_len;
+    char *data;
+
+    for (int i = 0; i < ARRAY_SIZE(sources); i++) {
+        if (strncmp(not->src, sources[i].name, not->src_len) == 0) {
+            src = sources[i].src;
+            break;
         }
     }
 
-    idx = find_free_notification_idx();
-    // List full. We remove the oldest notification.
-    if (idx == NOTIFICATION_INVALID_INDEX) {
-        LOG_DBG("Notification buffer full");
-
-        idx = find_oldest_notification_idx();
-        zsw_notification_manager_remove(notifications[idx].id);
-
-        // No check needed because we have removed one notification.
-        idx = find_free_notification_idx();
-    }
-
-    memset(&notifications[idx], 0, sizeof(zsw_not_mngr_notification_t));
-
-    if (strncmp(not->src, "Messenger", not->src_len) == 0) {
-        notifications[idx].src = NOTIFICATION_SRC_FB_MESSENGER;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "WhatsApp", not->src_len) == 0) {
-        // {"t":"notify","id":1700974318,"src":"WhatsApp","title":"Daniel Kampert","subject":"","body":"H","sender":""}
-
-        notifications[idx].src = NOTIFICATION_SRC_WHATSAPP;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "Gmail", not->src_len) == 0) {
-        // {t:"notify",id:1670967782,src:"Gmail",title:"Jakob Krantz",body:"Nytt test\nDetta YR NÖTT"
-
-        // TODO Subject is before first \n in body so extract that into title field.
-        notifications[idx].src = NOTIFICATION_SRC_GMAIL;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "Home Assistant", not->src_len) == 0) {
-        // {"t":"notify","id":1701847200,"src":"Home Assistant","title":"Message.","subject":"","body":"Gute Nacht","sender":""}
-
-        notifications[idx].src = NOTIFICATION_SRC_HOME_ASSISTANT;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "Discord", not->src_len) == 0) {
-        // {"t":"notify","id":1701847200,"src":"Discord","title":"Message.","subject":"","body":"Gute Nacht","sender":""}
-
-        notifications[idx].src = NOTIFICATION_SRC_DISCORD;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "LinkedIn", not->src_len) == 0) {
-        // {"t":"notify","id":1701847200,"src":"LinkedIn","title":"Message.","subject":"","body":"Gute Nacht","sender":""}
-
-        notifications[idx].src = NOTIFICATION_SRC_LINKEDIN;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "Reddit", not->src_len) == 0) {
-        notifications[idx].src = NOTIFICATION_SRC_REDDIT;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "YouTube", not->src_len) == 0) {
-        notifications[idx].src = NOTIFICATION_SRC_YOUTUBE;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "Messages", not->src_len) == 0) {
-        notifications[idx].src = NOTIFICATION_SRC_COMMON_MESSENGER;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else if (strncmp(not->src, "Calendar", not->src_len) == 0 || strncmp(not->src, "Kalender", not->src_len) == 0) {
-        notifications[idx].src = NOTIFICATION_SRC_CALENDAR;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->title, MIN(not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-    } else {
+    if (src == NOTIFICATION_SRC_NONE) {
         // TODO add more
         // For example debug notfication
         // {t:"notify",id:1670967783,src:"Bangle.js Gadgetbridge",subject:"Testar",body:"Testar",sender:"Testar",tel:"Testar"}
-        notifications[idx].src = NOTIFICATION_SRC_NONE;
-        notifications[idx].id = not->id;
-        memcpy(notifications[idx].title, not->src, MIN(not->src_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].body, not->body, MIN(not->body_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
-        memcpy(notifications[idx].sender, not->sender, MIN(not->sender_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1));
+        sender = not->sender;
+        sender_len = utf8_truncate(not->sender, not->sender_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1);
+        title = not->src;
+        title_len = utf8_truncate(not->src, not->src_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1);
+    } else {
+        sender_len = utf8_truncate(not->title, not->title_len, ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN - 1);
+        title_len = 0;
     }
+    body_len = utf8_truncate(not->body, not->body_len, CONFIG_ZSW_NOTIFICATION_MGR_MAX_BODY_LEN);
 
-    notifications[idx].timestamp = time(NULL);
+    for (;;) {
+        k_mutex_lock(&notification_mutex, K_FOREVER);
 
-    if (num_notifications < ZSW_NOTIFICATION_MGR_MAX_STORED) {
-        num_notifications++;
+        // Prevent double notifications with the same ID.
+        if (id_table_find(not->id) >= 0) {
+            LOG_DBG("Duplicate notification ID %u, ignoring", not->id);
+            k_mutex_unlock(&notification_mutex);
+            return -EEXIST;
+        }
+
+        data = NULL;
+        if (!sys_dlist_is_empty(&free_list)) {
+            data = k_heap_alloc(&notification_heap, sender_len + title_len + body_len + 3, K_NO_WAIT);
+            if (data) {
+                break;
+            }
+        }
+
+        // Out of slots or string memory. We remove the oldest notification.
+        if (sys_dlist_is_empty(&age_list)) {
+            LOG_ERR("Notification of %zu bytes doesn't fit", sender_len + title_len + body_len + 3);
+            k_mutex_unlock(&notification_mutex);
+            return -ENOMEM;
+        }
+
+        LOG_DBG("Notification buffer full");
+        new_not = SYS_DLIST_PEEK_HEAD_CONTAINER(&age_list, new_not, node);
+        remove_locked(id_table_find(new_not->id), &removed);
+        k_mutex_unlock(&notification_mutex);
+        publish_removed(&removed);
     }
 
+    new_not = SYS_DLIST_CONTAINER(sys_dlist_get(&free_list), new_not, node);
+
+    new_not->id = not->id;
+    new_not->src = src;
+    new_not->timestamp = time(NULL);
+
+    new_not->sender = data;
+    memcpy(data, sender, sender_len);
+    data[sender_len] = '\0';
+    data += sender_len + 1;
+
+    new_not->title = data;
+    memcpy(data, title, title_len);
+    data[title_len] = '\0';
+    data += title_len + 1;
+
+    new_not->body = data;
+    memcpy(data, not->body, body_len);
+    data[body_len] = '\0';
+
+    sys_dlist_append(&age_list, &new_not->node);
+    id_table_insert(ARRAY_INDEX(notifications, new_not));
+    num_notifications++;
+
+    LOG_DBG("ID: %u", new_not->id);
+    LOG_DBG("Source: %u", new_not->src);
+    LOG_DBG("Sender: %s", new_not->sender);
+    LOG_DBG("Title: %s", new_not->title);
+    LOG_DBG("Body: %s", new_not->body);
+    LOG_DBG("Time: %u", new_not->timestamp);
     LOG_DBG("Notifications: %u", num_notifications);
 
-    return &notifications[idx];
+    k_mutex_unlock(&notification_mutex);
+
+    return 0;
 }
 
 int32_t zsw_notification_manager_remove(uint32_t id)
 {
-    uint32_t idx = find_notification_idx(id);
+    zsw_not_mngr_notification_t removed;
+    int pos;
 
-    if (idx != NOTIFICATION_INVALID_INDEX) {
-        struct zsw_notification_remove_event evt;
+    k_mutex_lock(&notification_mutex, K_FOREVER);
 
-        LOG_DBG("Remove notification on place %u with ID: %u", idx, notifications[idx].id);
+    pos = id_table_find(id);
+    if (pos < 0) {
+        k_mutex_unlock(&notification_mutex);
+        return -ENOENT;
+    }
 
-        // NOTE: We pass a copy of the notification into the ZBUS event. This help the listeners to
-        // handle the notification, because the data in the notification buffer can change before
-        // the listeners have ececuted their operations.
-        memcpy(&evt.notification, &notifications[idx], sizeof(zsw_not_mngr_notification_t));
-        zbus_chan_pub(&zsw_notification_mgr_remove_chan, &evt, K_NO_WAIT);
+    remove_locked(pos, &removed);
+    k_mutex_unlock(&notification_mutex);
 
-        notifications[idx].id = ZSW_NOTIFICATION_MGR_INVALID_ID;
+    publish_removed(&removed);
 
-        if (num_notifications > 0) {
-            num_notifications--;
-        }
+    return 0;
+}
 
-        LOG_DBG("Notifications: %u", num_notifications);
+int32_t zsw_notification_manager_get(uint32_t id, zsw_not_mngr_notification_t *notification, char *buf,
+                                     size_t buf_size)
+{
+    int ret;
 
-        return 0;
+    k_mutex_lock(&notification_mutex, K_FOREVER);
+
+    ret = id_table_find(id);
+    if (ret >= 0) {
+        ret = copy_locked(&notifications[id_table[ret]], notification, buf, buf_size);
     }
 
-    return -ENOENT;
+    k_mutex_unlock(&notification_mutex);
+
+    return ret < 0 ? ret : 0;
 }
 
-void zsw_notification_manager_get_all(zsw_not_mngr_notification_t *nots, uint32_t *num_notifications)
+void zsw_notification_manager_foreach(zsw_notification_manager_visit_cb_t visit_cb, void *user_data)
 {
-    uint32_t num_stored = 0;
-    for (uint32_t i = 0; i < ZSW_NOTIFICATION_MGR_MAX_STORED; i++) {
-        if (notifications[i].id != ZSW_NOTIFICATION_MGR_INVALID_ID) {
-            nots[num_stored] = notifications[i];
-            num_stored++;
-        }
+    zsw_not_mngr_notification_t *not;
+
+    k_mutex_lock(&notification_mutex, K_FOREVER);
+
+    SYS_DLIST_FOR_EACH_CONTAINER(&age_list, not, node) {
+        visit_cb(not, user_data);
     }
 
-    *num_notifications = num_stored;
+    k_mutex_unlock(&notification_mutex);
 }
 
 int32_t zsw_notification_manager_get_num(void)
@@ -319,12 +438,32 @@ int32_t zsw_notification_manager_get_num(void)
     return num_notifications;
 }
 
-zsw_not_mngr_notification_t *zsw_notification_manager_get_newest(void)
+int32_t zsw_notification_manager_get_newest(zsw_not_mngr_notification_t *notification, char *buf, size_t buf_size)
+{
+    zsw_not_mngr_notification_t *not;
+    int ret = -ENOENT;
+
+    k_mutex_lock(&notification_mutex, K_FOREVER);
+    not = SYS_DLIST_PEEK_TAIL_CONTAINER(&age_list, not, node);
+    if (not) {
+        ret = copy_locked(not, notification, buf, buf_size);
+    }
+    k_mutex_unlock(&notification_mutex);
+
+    return ret < 0 ? ret : 0;
+}
+
+int32_t zsw_notification_manager_get_oldest(zsw_not_mngr_notification_t *notification, char *buf, size_t buf_size)
 {
-    int idx = find_newest_notification_idx();
-    if (idx != ZSW_NOTIFICATION_MGR_INVALID_ID) {
-        return &notifications[idx];
+    zsw_not_mngr_notification_t *not;
+    int ret = -ENOENT;
+
+    k_mutex_lock(&notification_mutex, K_FOREVER);
+    not = SYS_DLIST_PEEK_HEAD_CONTAINER(&age_list, not, node);
+    if (not) {
+        ret = copy_locked(not, notification, buf, buf_size);
     }
+    k_mutex_unlock(&notification_mutex);
 
-    return NULL;
+    return ret < 0 ? ret : 0;
 }
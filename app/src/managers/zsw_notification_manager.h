@@ -18,16 +18,25 @@
 #pragma once
 
 #include <inttypes.h>
+#include <stddef.h>
+#include <zephyr/sys/dlist.h>
 
 #include "ble/ble_comm.h"
 
-/** @brief
+/** @brief Maximum length of the sender and title, including the terminator.
+ *         The body can be up to CONFIG_ZSW_NOTIFICATION_MGR_MAX_BODY_LEN bytes.
+*/
+#define ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN      64
+
+/** @brief Buffer size that holds the sender, title and body of any notification.
 */
-#define ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN      50
+#define ZSW_NOTIFICATION_MGR_MAX_STRINGS_LEN    (2 * ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN + \
+                                                 CONFIG_ZSW_NOTIFICATION_MGR_MAX_BODY_LEN + 1)
 
 /** @brief Maximum number of notification stored at a time.
+ *         Fewer are stored when their text doesn't fit in CONFIG_ZSW_NOTIFICATION_MGR_STORE_SIZE.
 */
-#define ZSW_NOTIFICATION_MGR_MAX_STORED         10
+#define ZSW_NOTIFICATION_MGR_MAX_STORED         CONFIG_ZSW_NOTIFICATION_MGR_MAX_STORED
 
 /** @brief Notification sources definitions.
 */
@@ -51,10 +60,11 @@ typedef enum {
 typedef struct not_mngr_notification {
     uint32_t id;                                                /**< Notification ID. */
     uint32_t timestamp;                                         /**< Active notification time in seconds. */
-    char sender[ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN];            /**< Contains the notification sender (e-mail address or name in WhatsApp). */
-    char title[ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN];             /**< */
-    char body[ZSW_NOTIFICATION_MGR_MAX_FIELD_LEN];              /**< */
+    const char *sender;                                         /**< Contains the notification sender (e-mail address or name in WhatsApp). */
+    const char *title;                                          /**< */
+    const char *body;                                           /**< */
     zsw_notification_src_t src;                                 /**< */
+    sys_dnode_t node;                                           /**< Used by the notification manager. */
 } zsw_not_mngr_notification_t;
 
 /** @brief
@@ -63,9 +73,9 @@ void zsw_notification_manager_init(void);
 
 /** @brief
  *  @param notification
- *  @return
+ *  @return             0 when successful, -EEXIST for a duplicate ID, -ENOMEM if it doesn't fit
 */
-zsw_not_mngr_notification_t *zsw_notification_manager_add(const ble_comm_notify_t *notification);
+int32_t zsw_notification_manager_add(const ble_comm_notify_t *notification);
 
 /** @brief
  *  @param id   Notification ID
@@ -73,25 +83,49 @@ zsw_not_mngr_notification_t *zsw_notification_manager_add(const ble_comm_notify_
 */
 int32_t zsw_notification_manager_remove(uint32_t id);
 
-/** @brief
+/** @brief                  Stored notifications are freed when removed, which can happen from another thread at
+ *                          any time. So they are copied, with their strings copied to buf.
  *  @param id               Notification ID
  *  @param notification
- *  @return
+ *  @param buf              Buffer for the strings, ZSW_NOTIFICATION_MGR_MAX_STRINGS_LEN bytes always fit them
+ *  @param buf_size
+ *  @return                 0 when successful, -ENOENT if not found, -ENOMEM if buf is too small
 */
-int32_t zsw_notification_manager_get(uint32_t id, zsw_not_mngr_notification_t *notifcation);
+int32_t zsw_notification_manager_get(uint32_t id, zsw_not_mngr_notification_t *notifcation, char *buf,
+                                     size_t buf_size);
 
-/** @brief
- *  @param notifications
- *  @param num_notifications
+/** @brief                  Called for every stored notification by zsw_notification_manager_foreach().
+ *  @param notification     Only valid during the call
+ *  @param user_data
 */
-void zsw_notification_manager_get_all(zsw_not_mngr_notification_t *notifcations, uint32_t *num_notifications);
+typedef void (*zsw_notification_manager_visit_cb_t)(const zsw_not_mngr_notification_t *notification,
+                                                    void *user_data);
+
+/** @brief                  Visit the stored notifications, oldest first, without copying them.
+ *                          The manager stays locked during the calls, so visit_cb must not call into it and should
+ *                          copy what it keeps.
+ *  @param visit_cb
+ *  @param user_data        Passed to visit_cb
+*/
+void zsw_notification_manager_foreach(zsw_notification_manager_visit_cb_t visit_cb, void *user_data);
 
 /** @brief
  *  @return
 */
 int32_t zsw_notification_manager_get_num(void);
 
-/** @brief
- *  @return
+/** @brief                  Copy the newest notification, see zsw_notification_manager_get().
+ *  @param notification
+ *  @param buf
+ *  @param buf_size
+ *  @return                 0 when successful, -ENOENT if there are none, -ENOMEM if buf is too small
+*/
+int32_t zsw_notification_manager_get_newest(zsw_not_mngr_notification_t *notification, char *buf, size_t buf_size);
+
+/** @brief                  Copy the oldest notification, see zsw_notification_manager_get().
+ *  @param notification
+ *  @param buf
+ *  @param buf_size
+ *  @return                 0 when successful, -ENOENT if there are none, -ENOMEM if buf is too small
 */
-zsw_not_mngr_notification_t *zsw_notification_manager_get_newest(void);
+int32_t zsw_notification_manager_get_oldest(zsw_not_mngr_notification_t *notification, char *buf, size_t buf_size);
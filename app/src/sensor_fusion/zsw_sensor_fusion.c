@@ -32,19 +32,38 @@
 #include "../sensors/zsw_magnetometer.h"
 #include "../ble/zsw_gatt_sensor_server.h"
 #include <string.h>
+#include <stdlib.h>
 
 #ifdef CONFIG_SEND_SENSOR_READING_OVER_RTT
 #include <SEGGER_RTT.h>
 #endif
 
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#ifdef CONFIG_ARCH_POSIX
+#include <time.h>
+#endif
+#endif
+
 #define SAMPLE_RATE_HZ  100
 #define SENSOR_GF       9.806650
 
+#define SNAPSHOT_PERIOD_US  (USEC_PER_SEC / SAMPLE_RATE_HZ)
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+#define BATCH_PERIOD_US     (CONFIG_ZSW_SENSOR_FUSION_FIFO_WATERMARK * USEC_PER_SEC / SAMPLE_RATE_HZ)
+#endif
+
 LOG_MODULE_REGISTER(sf, CONFIG_ZSW_SENSORS_FUSION_LOG_LEVEL);
 
-static void sensor_fusion_timeout(struct k_work *item);
-K_WORK_DELAYABLE_DEFINE(sensor_fusion_timer, sensor_fusion_timeout);
+static void sensor_fusion_thread(void *, void *, void *);
+static void sensor_fusion_timer_expired(struct k_timer *timer);
 
+K_SEM_DEFINE(sensor_fusion_sem, 0, 1);
+K_TIMER_DEFINE(sensor_fusion_timer, sensor_fusion_timer_expired, NULL);
+K_THREAD_DEFINE(sensor_fusion_tid, CONFIG_ZSW_SENSOR_FUSION_THREAD_STACK_SIZE, sensor_fusion_thread, NULL, NULL, NULL,
+                CONFIG_ZSW_SENSOR_FUSION_THREAD_PRIORITY, 0, 0);
+
+#ifdef CONFIG_ZSW_SENSOR_FUSION_CALIBRATION
 // Define calibration (replace with actual calibration data if available)
 static const FusionMatrix gyroscopeMisalignment = {.element.xx = 1.0f,
                                                    .element.xy = 0.0f,
@@ -83,104 +102,116 @@ static const FusionMatrix softIronMatrix = {.element.xx = 1.0f,
                                            };
 static const FusionVector hardIronOffset = {{0.0f, 0.0f, 0.0f}};
 #endif
+#endif
+
+// Set AHRS algorithm settings
+/// @todo may want to tune more.
+static const FusionAhrsSettings ahrs_settings = {
+    .convention = FusionConventionNwu,
+    .gain = 0.5f,
+    .gyroscopeRange = 2000.0f, /* app/drivers/sensor/bmi270/bosch_bmi270.c:426 */
+    .accelerationRejection = 10.0f,
+    .magneticRejection = 10.0f,
+    .recoveryTriggerPeriod = 5 * SAMPLE_RATE_HZ, /* 5 seconds */
+};
 
 // Initialise algorithms
 static FusionOffset offset;
 static FusionAhrs ahrs;
-static int32_t previousTimestamp;
-static sensor_fusion_t readings;
-static struct k_work_sync cancel_work_sync;
-static zsw_quat_t readings_quat;
-static float last_delta_time_s = 0.0f;
+static int64_t previous_timestamp_us;
+// Protects ahrs, outputs are calculated from it when requested
+static K_MUTEX_DEFINE(ahrs_mutex);
+static float last_delta_time_s = 1.0f / SAMPLE_RATE_HZ;
 static atomic_t sensor_fusion_users = ATOMIC_INIT(0);
+static atomic_t sensor_fusion_running = ATOMIC_INIT(0);
+static uint32_t wakeup_period_us = SNAPSHOT_PERIOD_US;
+
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+static zsw_imu_frame_t frames[CONFIG_ZSW_SENSOR_FUSION_FIFO_WATERMARK * 2];
+// False when another user, such as the GATT sensor stream, already owns the IMU FIFO
+static bool use_fifo;
+#endif
+
+// Wakeup timing and processing time, measured with the cycle counter
+static struct {
+    uint32_t wakeups;
+    uint32_t updates;
+    uint32_t last_wakeup_cycles;
+    uint32_t interval_min_us;
+    uint32_t interval_max_us;
+    uint64_t interval_sum_us;
+    uint32_t jitter_max_us;
+    uint64_t busy_cycles;
+    uint32_t start_cycles;
+} stats;
 
 #ifdef CONFIG_SEND_SENSOR_READING_OVER_RTT
 #define UP_BUFFER_SIZE 256
 static uint8_t up_buffer[UP_BUFFER_SIZE];
 #endif
 
-static void sensor_fusion_timeout(struct k_work *work)
+/*
+ * Update the AHRS, gyroscope in deg/s and accelerometer in g. Only what is needed for the orientation is
+ * calculated here, Euler angles and earth acceleration are calculated when requested.
+ */
+static void ahrs_step(FusionAhrs *p_ahrs, FusionOffset *p_offset, FusionVector gyroscope, FusionVector accelerometer,
+                      FusionVector magnetometer, float deltaTime)
 {
-    int ret = 0;
-
-    FusionVector gyroscope;
-    FusionVector accelerometer;
-#ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
-    FusionVector magnetometer;
-#endif
-
-    uint32_t start = k_uptime_get_32();
-    ret = zsw_imu_fetch_gyro_f(&gyroscope.axis.x, &gyroscope.axis.y, &gyroscope.axis.z);
-    if (ret != 0) {
-        LOG_ERR("zsw_imu_fetch_gyro_f err: %d", ret);
-    }
-    // Convert from rad/s to deg/s
-    gyroscope.axis.x = gyroscope.axis.x * (180.0F / M_PI);
-    gyroscope.axis.y = gyroscope.axis.y * (180.0F / M_PI);
-    gyroscope.axis.z = gyroscope.axis.z * (180.0F / M_PI);
-
-    ret = zsw_imu_fetch_accel_f(&accelerometer.axis.x, &accelerometer.axis.y, &accelerometer.axis.z);
-    if (ret != 0) {
-        LOG_ERR("zsw_imu_fetch_accel_f err: %d", ret);
-    }
-    // IMU driver converts to m/s2 by multiplying to 10, convert back to g-force
-    accelerometer.axis.x /= SENSOR_GF;
-    accelerometer.axis.y /= SENSOR_GF;
-    accelerometer.axis.z /= SENSOR_GF;
-
-#ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
-    ret = zsw_magnetometer_get_all(&magnetometer.axis.x, &magnetometer.axis.y, &magnetometer.axis.z);
-    if (ret != 0) {
-        LOG_ERR("zsw_magnetometer_get_all err: %d", ret);
-    }
-#endif
-
+#ifdef CONFIG_ZSW_SENSOR_FUSION_CALIBRATION
     // Apply calibration
     gyroscope = FusionCalibrationInertial(gyroscope, gyroscopeMisalignment, gyroscopeSensitivity, gyroscopeOffset);
     accelerometer = FusionCalibrationInertial(accelerometer, accelerometerMisalignment, accelerometerSensitivity,
                                               accelerometerOffset);
 #ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
     magnetometer = FusionCalibrationMagnetic(magnetometer, softIronMatrix, hardIronOffset);
+#endif
 #endif
 
     // Update gyroscope offset correction algorithm
-    gyroscope = FusionOffsetUpdate(&offset, gyroscope);
-
-    // Calculate delta time (in seconds) to account for gyroscope sample clock error
-    const float deltaTime = (start - previousTimestamp) / 1000.0f;
-    previousTimestamp = start;
-    last_delta_time_s = deltaTime > 0 ? deltaTime : last_delta_time_s;
+    gyroscope = FusionOffsetUpdate(p_offset, gyroscope);
 
     // Update gyroscope AHRS algorithm
 #ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
-    FusionAhrsUpdate(&ahrs, gyroscope, accelerometer, magnetometer, deltaTime);
+    FusionAhrsUpdate(p_ahrs, gyroscope, accelerometer, magnetometer, deltaTime);
 #else
-    FusionAhrsUpdateNoMagnetometer(&ahrs, gyroscope, accelerometer, deltaTime);
-#endif
-    // Print algorithm outputs
-    const FusionQuaternion q = FusionAhrsGetQuaternion(&ahrs);
-    const FusionEuler euler = FusionQuaternionToEuler(q);
-    const FusionVector earth = FusionAhrsGetEarthAcceleration(&ahrs);
-#ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
-    float heading = FusionCompassCalculateHeading(FusionConventionNwu, accelerometer, magnetometer);
+    FusionAhrsUpdateNoMagnetometer(p_ahrs, gyroscope, accelerometer, deltaTime);
 #endif
+}
+
+/*
+ * Run the AHRS with one IMU sample, accelerometer in m/s^2 and gyroscope in rad/s,
+ * with the time it was sampled.
+ */
+static void sensor_fusion_update(const zsw_imu_frame_t *sample, FusionVector magnetometer)
+{
+    FusionVector gyroscope = {{sample->gyro[0], sample->gyro[1], sample->gyro[2]}};
+    FusionVector accelerometer = {{sample->accel[0], sample->accel[1], sample->accel[2]}};
+
+    // Convert from rad/s to deg/s
+    gyroscope = FusionVectorMultiplyScalar(gyroscope, 180.0F / M_PI);
 
-    readings.pitch = euler.angle.pitch;
-    readings.roll = euler.angle.roll;
-    readings.yaw = euler.angle.yaw;
-    readings.x = earth.axis.x;
-    readings.y = earth.axis.y;
-    readings.z = earth.axis.z;
+    // IMU driver converts to m/s2 by multiplying to 10, convert back to g-force
+    accelerometer = FusionVectorMultiplyScalar(accelerometer, 1.0F / SENSOR_GF);
 
-    readings_quat.w = q.element.w;
-    readings_quat.x = q.element.x;
-    readings_quat.y = q.element.y;
-    readings_quat.z = q.element.z;
+    // Calculate delta time (in seconds) from the sample timestamps, the first sample uses the nominal period
+    if (previous_timestamp_us != 0 && sample->timestamp_us > previous_timestamp_us) {
+        last_delta_time_s = (sample->timestamp_us - previous_timestamp_us) / 1000000.0f;
+    }
+    previous_timestamp_us = sample->timestamp_us;
 
+    k_mutex_lock(&ahrs_mutex, K_FOREVER);
+    ahrs_step(&ahrs, &offset, gyroscope, accelerometer, magnetometer, last_delta_time_s);
+#if (CONFIG_ZSW_SENSORS_FUSION_LOG_LEVEL >= LOG_LEVEL_DBG) || defined(CONFIG_SEND_SENSOR_READING_OVER_RTT)
+    const FusionEuler euler = FusionQuaternionToEuler(FusionAhrsGetQuaternion(&ahrs));
+#endif
+    k_mutex_unlock(&ahrs_mutex);
+
+#if (CONFIG_ZSW_SENSORS_FUSION_LOG_LEVEL >= LOG_LEVEL_DBG) || defined(CONFIG_SEND_SENSOR_READING_OVER_RTT)
 #ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
     LOG_DBG("Roll %0.1f, Pitch %0.1f, Yaw %0.1f, Head: %01f, X %0.2f, Y %0.2f, Z %0.1f, X %0.1f, Y %0.1f, Z %0.1f, X %0.1f, Y %0.1f, Z %0.1f\n",
             euler.angle.roll, euler.angle.pitch,
-            euler.angle.yaw, heading, /*earth.axis.x, earth.axis.y, earth.axis.z*/ accelerometer.axis.x, accelerometer.axis.y,
+            euler.angle.yaw, FusionCompassCalculateHeading(FusionConventionNwu, accelerometer, magnetometer),
+            accelerometer.axis.x, accelerometer.axis.y,
             accelerometer.axis.z, gyroscope.axis.x, gyroscope.axis.y, gyroscope.axis.z, magnetometer.axis.x, magnetometer.axis.y,
             magnetometer.axis.z );
 #else
@@ -207,10 +238,121 @@ static void sensor_fusion_timeout(struct k_work *work)
 #endif
     len = SEGGER_RTT_Write(CONFIG_SENSOR_LOG_RTT_TRANSFER_CHANNEL, data_buf, len);
 #endif
+#endif
+
+    stats.updates++;
+}
+
+static void stats_reset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.interval_min_us = UINT32_MAX;
+    stats.start_cycles = k_cycle_get_32();
+}
+
+static void stats_wakeup(uint32_t now_cycles)
+{
+    uint32_t interval_us;
+    uint32_t jitter_us;
+
+    if (stats.wakeups > 0) {
+        interval_us = k_cyc_to_us_floor32(now_cycles - stats.last_wakeup_cycles);
+        jitter_us = interval_us > wakeup_period_us ? interval_us - wakeup_period_us : wakeup_period_us - interval_us;
+
+        stats.interval_min_us = MIN(stats.interval_min_us, interval_us);
+        stats.interval_max_us = MAX(stats.interval_max_us, interval_us);
+        stats.interval_sum_us += interval_us;
+        stats.jitter_max_us = MAX(stats.jitter_max_us, jitter_us);
+    }
+
+    stats.last_wakeup_cycles = now_cycles;
+    stats.wakeups++;
+}
+
+static void sensor_fusion_timer_expired(struct k_timer *timer)
+{
+    k_sem_give(&sensor_fusion_sem);
+}
+
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+static void imu_batch_ready(void)
+{
+    k_sem_give(&sensor_fusion_sem);
+}
+#endif
+
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+static void update_from_batch(FusionVector magnetometer)
+{
+    int ret;
+
+    ret = zsw_imu_read_batch(frames, ARRAY_SIZE(frames));
+    if (ret < 0) {
+        LOG_ERR("zsw_imu_read_batch err: %d", ret);
+    }
+
+    // Frames in a batch are spaced by the IMU sample period, use that across batches too
+    if (ret > 1 && previous_timestamp_us != 0) {
+        previous_timestamp_us = frames[0].timestamp_us - (frames[1].timestamp_us - frames[0].timestamp_us);
+    }
+
+    for (int i = 0; i < ret; i++) {
+        sensor_fusion_update(&frames[i], magnetometer);
+    }
+}
+#endif
+
+static void update_from_snapshot(FusionVector magnetometer)
+{
+    zsw_imu_frame_t sample;
+    int ret;
+
+    // Always a new sample, a reused one would integrate the same rotation twice
+    ret = zsw_imu_fetch_snapshot(&sample, 0);
+    if (ret != 0) {
+        LOG_ERR("zsw_imu_fetch_snapshot err: %d", ret);
+    } else {
+        sensor_fusion_update(&sample, magnetometer);
+    }
+}
+
+static void sensor_fusion_thread(void *arg1, void *arg2, void *arg3)
+{
+    FusionVector magnetometer = {{0.0f, 0.0f, 0.0f}};
+    uint32_t start;
+    int ret;
+
+    while (true) {
+        k_sem_take(&sensor_fusion_sem, K_FOREVER);
+        if (!atomic_get(&sensor_fusion_running)) {
+            continue;
+        }
+
+        start = k_cycle_get_32();
+        stats_wakeup(start);
+
+#ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
+        ret = zsw_magnetometer_get_all(&magnetometer.axis.x, &magnetometer.axis.y, &magnetometer.axis.z);
+        if (ret != 0) {
+            LOG_ERR("zsw_magnetometer_get_all err: %d", ret);
+        }
+#endif
+
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+        if (use_fifo) {
+            update_from_batch(magnetometer);
+        } else {
+            update_from_snapshot(magnetometer);
+        }
+#else
+        update_from_snapshot(magnetometer);
+#endif
 
-    k_work_schedule(&sensor_fusion_timer, K_MSEC((1000 / SAMPLE_RATE_HZ) - (k_uptime_get_32() - start)));
+        stats.busy_cycles += k_cycle_get_32() - start;
+    }
 }
 
+
 int zsw_sensor_fusion_init(void)
 {
 #if CONFIG_SEND_SENSOR_READING_OVER_RTT
@@ -241,25 +383,43 @@ int zsw_sensor_fusion_init(void)
     }
 #endif
 
+    k_mutex_lock(&ahrs_mutex, K_FOREVER);
     memset(&ahrs, 0, sizeof(ahrs));
+    previous_timestamp_us = 0;
+    last_delta_time_s = 1.0f / SAMPLE_RATE_HZ;
 
     FusionOffsetInitialise(&offset, SAMPLE_RATE_HZ);
     FusionAhrsInitialise(&ahrs);
+    FusionAhrsSetSettings(&ahrs, &ahrs_settings);
+    k_mutex_unlock(&ahrs_mutex);
+
+    stats_reset();
+    atomic_set(&sensor_fusion_running, 1);
+
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+    ret = zsw_imu_batch_start(CONFIG_ZSW_SENSOR_FUSION_FIFO_WATERMARK, imu_batch_ready);
+    use_fifo = ret == 0;
+    if (ret == -EBUSY) {
+        LOG_INF("IMU FIFO in use, reading the IMU every %d us", SNAPSHOT_PERIOD_US);
+    } else if (ret != 0) {
+        LOG_ERR("zsw_imu_batch_start err: %d", ret);
+        atomic_set(&sensor_fusion_running, 0);
+        zsw_imu_feature_disable(ZSW_IMU_FEATURE_GYRO);
+#ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
+        zsw_magnetometer_set_enable(false);
+#endif
+        atomic_dec(&sensor_fusion_users);
+        return ret;
+    }
 
-    // Set AHRS algorithm settings
-    /// @todo may want to tune more.
-    const FusionAhrsSettings settings = {
-        .convention = FusionConventionNwu,
-        .gain = 0.5f,
-        .gyroscopeRange = 2000.0f, /* app/drivers/sensor/bmi270/bosch_bmi270.c:426 */
-        .accelerationRejection = 10.0f,
-        .magneticRejection = 10.0f,
-        .recoveryTriggerPeriod = 5 * SAMPLE_RATE_HZ, /* 5 seconds */
-    };
-
-    FusionAhrsSetSettings(&ahrs, &settings);
+    if (use_fifo) {
+        wakeup_period_us = BATCH_PERIOD_US;
+        return 0;
+    }
+#endif
 
-    k_work_schedule(&sensor_fusion_timer, K_MSEC(1000 / SAMPLE_RATE_HZ));
+    wakeup_period_us = SNAPSHOT_PERIOD_US;
+    k_timer_start(&sensor_fusion_timer, K_USEC(wakeup_period_us), K_USEC(wakeup_period_us));
 
     return 0;
 }
@@ -277,7 +437,15 @@ void zsw_sensor_fusion_deinit(void)
         return;
     }
 
-    k_work_cancel_delayable_sync(&sensor_fusion_timer, &cancel_work_sync);
+    atomic_set(&sensor_fusion_running, 0);
+#ifdef CONFIG_ZSW_SENSOR_FUSION_USE_IMU_FIFO
+    // The FIFO of another user is left running
+    if (use_fifo) {
+        zsw_imu_batch_stop();
+        use_fifo = false;
+    }
+#endif
+    k_timer_stop(&sensor_fusion_timer);
     zsw_imu_feature_disable(ZSW_IMU_FEATURE_GYRO);
 #ifdef CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER
     zsw_magnetometer_set_enable(false);
@@ -286,22 +454,176 @@ void zsw_sensor_fusion_deinit(void)
 
 int zsw_sensor_fusion_fetch_all(sensor_fusion_t *p_readings)
 {
-    memcpy(p_readings, &readings, sizeof(sensor_fusion_t));
+    FusionEuler euler;
+    FusionVector earth;
+
+    k_mutex_lock(&ahrs_mutex, K_FOREVER);
+    euler = FusionQuaternionToEuler(FusionAhrsGetQuaternion(&ahrs));
+    earth = FusionAhrsGetEarthAcceleration(&ahrs);
+    k_mutex_unlock(&ahrs_mutex);
+
+    p_readings->pitch = euler.angle.pitch;
+    p_readings->roll = euler.angle.roll;
+    p_readings->yaw = euler.angle.yaw;
+    p_readings->x = earth.axis.x;
+    p_readings->y = earth.axis.y;
+    p_readings->z = earth.axis.z;
+
     return 0;
 }
 
 int zsw_sensor_fusion_get_heading(float *heading)
 {
+    FusionEuler euler;
+
     // @todo: implement, this is not correct magnetic heading. Use FusionCompassCalculateHeading
-    *heading = readings.yaw;
+    k_mutex_lock(&ahrs_mutex, K_FOREVER);
+    euler = FusionQuaternionToEuler(FusionAhrsGetQuaternion(&ahrs));
+    k_mutex_unlock(&ahrs_mutex);
+
+    *heading = euler.angle.yaw;
     return 0;
 }
 
 int zsw_sensor_fusion_get_quaternion(zsw_quat_t *q)
 {
+    FusionQuaternion quaternion;
+
     if (!q) {
         return -EINVAL;
     }
-    *q = readings_quat;
+
+    k_mutex_lock(&ahrs_mutex, K_FOREVER);
+    quaternion = FusionAhrsGetQuaternion(&ahrs);
+    k_mutex_unlock(&ahrs_mutex);
+
+    q->w = quaternion.element.w;
+    q->x = quaternion.element.x;
+    q->y = quaternion.element.y;
+    q->z = quaternion.element.z;
+    return 0;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_sensor_fusion_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t elapsed_cycles = k_cycle_get_32() - stats.start_cycles;
+    uint32_t intervals = stats.wakeups > 1 ? stats.wakeups - 1 : 0;
+
+    shell_print(sh, "Running:      %s", atomic_get(&sensor_fusion_running) ? "yes" : "no");
+    shell_print(sh, "Wakeups:      %u, expected every %u us", stats.wakeups, wakeup_period_us);
+    shell_print(sh, "Updates:      %u", stats.updates);
+    if (intervals > 0) {
+        shell_print(sh, "Interval:     min %u us, avg %u us, max %u us", stats.interval_min_us,
+                    (uint32_t)(stats.interval_sum_us / intervals), stats.interval_max_us);
+        shell_print(sh, "Max jitter:   %u us", stats.jitter_max_us);
+    }
+    shell_print(sh, "CPU load:     %u.%u%%",
+                elapsed_cycles ? (uint32_t)((stats.busy_cycles * 1000) / elapsed_cycles) / 10 : 0,
+                elapsed_cycles ? (uint32_t)((stats.busy_cycles * 1000) / elapsed_cycles) % 10 : 0);
+    shell_print(sh, "Last dt:      %u us", (uint32_t)(last_delta_time_s * 1000000.0f));
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        stats_reset();
+    }
+
+    return 0;
+}
+
+static uint64_t bench_time_ns(void)
+{
+#ifdef CONFIG_ARCH_POSIX
+    struct timespec ts;
+
+    // Simulated time doesn't advance while code runs, measure with the host clock
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+    return k_ticks_to_ns_floor64(k_uptime_ticks());
+#endif
+}
+
+/*
+ * Run updates on synthetic data, either the full pipeline the fusion used to run every update, or the
+ * specialized one. The full pipeline always calibrates, with identity parameters when
+ * CONFIG_ZSW_SENSOR_FUSION_CALIBRATION is off. Returns nanoseconds per update.
+ */
+static uint32_t bench_run(uint32_t updates, bool full)
+{
+    static FusionAhrs bench_ahrs;
+    static FusionOffset bench_offset;
+    const float deltaTime = 1.0f / SAMPLE_RATE_HZ;
+    FusionVector gyroscope;
+    FusionVector accelerometer;
+    FusionVector magnetometer = {{20.0f, 0.0f, -40.0f}};
+    volatile float sink = 0.0f;
+    uint64_t start;
+
+    FusionOffsetInitialise(&bench_offset, SAMPLE_RATE_HZ);
+    FusionAhrsInitialise(&bench_ahrs);
+    FusionAhrsSetSettings(&bench_ahrs, &ahrs_settings);
+
+    start = bench_time_ns();
+    for (uint32_t i = 0; i < updates; i++) {
+        // Slow rotation around z with some noise on the other axes
+        gyroscope = (FusionVector) {{(i % 7) * 0.1f, (i % 5) * -0.1f, 30.0f}};
+        accelerometer = (FusionVector) {{(i % 3) * 0.01f, 0.0f, 1.0f}};
+
+        // With calibration enabled ahrs_step() already calibrates, don't count it twice
+        if (full && !IS_ENABLED(CONFIG_ZSW_SENSOR_FUSION_CALIBRATION)) {
+            gyroscope = FusionCalibrationInertial(gyroscope, FUSION_IDENTITY_MATRIX, FUSION_VECTOR_ONES,
+                                                  FUSION_VECTOR_ZERO);
+            accelerometer = FusionCalibrationInertial(accelerometer, FUSION_IDENTITY_MATRIX, FUSION_VECTOR_ONES,
+                                                      FUSION_VECTOR_ZERO);
+            magnetometer = FusionCalibrationMagnetic(magnetometer, FUSION_IDENTITY_MATRIX, FUSION_VECTOR_ZERO);
+        }
+
+        ahrs_step(&bench_ahrs, &bench_offset, gyroscope, accelerometer, magnetometer, deltaTime);
+
+        if (full) {
+            sink += FusionQuaternionToEuler(FusionAhrsGetQuaternion(&bench_ahrs)).angle.yaw;
+            sink += FusionAhrsGetEarthAcceleration(&bench_ahrs).axis.z;
+        } else {
+            sink += FusionAhrsGetQuaternion(&bench_ahrs).element.w;
+        }
+    }
+
+    return (uint32_t)((bench_time_ns() - start) / updates);
+}
+
+static int cmd_sensor_fusion_bench(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t updates = 1000;
+    uint32_t full_ns;
+    uint32_t specialized_ns;
+
+    if (argc > 1) {
+        updates = strtoul(argv[1], NULL, 10);
+        if (updates == 0) {
+            shell_error(sh, "Invalid number of updates");
+            return -EINVAL;
+        }
+    }
+
+    full_ns = bench_run(updates, true);
+    specialized_ns = bench_run(updates, false);
+
+    shell_print(sh, "Updates:      %u, magnetometer %s, calibration %s", updates,
+                IS_ENABLED(CONFIG_SENSOR_FUSION_INCLUDE_MAGNETOMETER) ? "on" : "off",
+                IS_ENABLED(CONFIG_ZSW_SENSOR_FUSION_CALIBRATION) ? "on" : "off");
+    shell_print(sh, "Full:         %u.%03u us/update", full_ns / 1000, full_ns % 1000);
+    shell_print(sh, "Specialized:  %u.%03u us/update", specialized_ns / 1000, specialized_ns % 1000);
+
     return 0;
 }
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sensor_fusion,
+                               SHELL_CMD_ARG(stats, NULL, "Show sensor fusion timing: sensor_fusion stats [reset]",
+                                             cmd_sensor_fusion_stats, 1, 1),
+                               SHELL_CMD_ARG(bench, NULL, "Time AHRS updates: sensor_fusion bench [updates]",
+                                             cmd_sensor_fusion_bench, 1, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(sensor_fusion, &sub_sensor_fusion, "Sensor fusion commands", NULL);
+#endif
@@ -18,6 +18,10 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/sys/atomic.h>
+#include <string.h>
+#ifdef CONFIG_ZSW_IMU_STATS
+#include <zephyr/shell/shell.h>
+#endif
 
 #include "zsw_clock.h"
 
@@ -35,6 +39,63 @@ static int step_offset = 0;
 static zsw_imu_data_step_activity_t last_step_activity = ZSW_IMU_EVT_STEP_ACTIVITY_UNKNOWN;
 static atomic_t feature_refcount[BOSCH_BMI270_FEAT_WEAR_WAKE_UP + 1];
 
+K_MUTEX_DEFINE(snapshot_mutex);
+static zsw_imu_frame_t last_snapshot;
+static bool snapshot_valid;
+
+static const char *const activity_output[4] = { "BMI2_STILL", "BMI2_WALK", "BMI2_RUN", "BMI2_UNKNOWN" };
+static const char *const gesture_output[6] = { "unknown_gesture", "push_arm_down", "pivot_up", "wrist_shake_jiggle",
+                                               "flick_in", "flick_out"
+                                             };
+
+#ifdef CONFIG_ZSW_IMU_STATS
+// Events delivered by the driver, shown by the imu shell command.
+static struct {
+    uint32_t steps;
+    uint32_t step_events;
+    uint32_t activity_events;
+    uint32_t gestures;
+    zsw_imu_data_step_gesture_t last_gesture;
+    uint32_t wakeups;
+} stats;
+
+static void stats_count_event(const zsw_imu_evt_t *evt)
+{
+    switch (evt->type) {
+        case ZSW_IMU_EVT_TYPE_STEP:
+            stats.steps = evt->data.step.count;
+            stats.step_events++;
+            break;
+        case ZSW_IMU_EVT_TYPE_STEP_ACTIVITY:
+            stats.activity_events++;
+            break;
+        case ZSW_IMU_EVT_TYPE_WRIST_WAKEUP:
+            stats.wakeups++;
+            break;
+        case ZSW_IMU_EVT_TYPE_GESTURE:
+            stats.last_gesture = evt->data.gesture;
+            stats.gestures++;
+            break;
+        default:
+            break;
+    }
+}
+#endif
+
+#ifdef CONFIG_ZSW_BMI270_FIFO
+// Frames read from the driver at a time
+#define BATCH_READ_CHUNK 8
+
+static struct sensor_trigger fifo_trigger = {
+    .type = SENSOR_TRIG_FIFO_WATERMARK,
+    .chan = SENSOR_CHAN_ACCEL_XYZ,
+};
+static zsw_imu_batch_ready_cb_t batch_ready_cb;
+static bool batch_started;
+// Time of the newest frame returned by zsw_imu_read_batch, 0 before the first one
+static int64_t batch_last_us;
+#endif
+
 static void bmi270_trigger_handler(const struct device *dev, const struct sensor_trigger *trig)
 {
     zsw_imu_evt_t evt;
@@ -69,7 +130,6 @@ static void bmi270_trigger_handler(const struct device *dev, const struct sensor
                 evt.data.step_activity = sensor_val.val1;
                 last_step_activity = evt.data.step_activity;
 
-                const char *activity_output[4] = { "BMI2_STILL", "BMI2_WALK", "BMI2_RUN", "BMI2_UNKNOWN" };
                 LOG_DBG("Step activity: %s", activity_output[evt.data.step_activity]);
             }
 
@@ -88,7 +148,6 @@ static void bmi270_trigger_handler(const struct device *dev, const struct sensor
                 evt.type = ZSW_IMU_EVT_TYPE_GESTURE;
                 evt.data.gesture = sensor_val.val1;
 
-                const char *gesture_output[6] = { "unknown_gesture", "push_arm_down", "pivot_up", "wrist_shake_jiggle", "flick_in", "flick_out" };
                 LOG_DBG("Gesture detected: %s", gesture_output[evt.data.gesture]);
             }
 
@@ -109,6 +168,10 @@ static void bmi270_trigger_handler(const struct device *dev, const struct sensor
         }
     }
 
+#ifdef CONFIG_ZSW_IMU_STATS
+    stats_count_event(&evt);
+#endif
+
     zbus_chan_pub(&accel_data_chan, &evt, K_MSEC(250));
 }
 
@@ -130,110 +193,276 @@ int zsw_imu_init(void)
     return 0;
 }
 
-int zsw_imu_fetch_accel_f(float *x, float *y, float *z)
+int zsw_imu_fetch_snapshot(zsw_imu_frame_t *snapshot, uint32_t max_age_ms)
 {
-    struct sensor_value x_temp;
-    struct sensor_value y_temp;
-    struct sensor_value z_temp;
+    struct sensor_value accel[3];
+    struct sensor_value gyro[3];
+    int64_t now_us;
+    int ret = 0;
 
     if (!device_is_ready(bmi270)) {
         return -ENODEV;
     }
 
-    if (sensor_sample_fetch_chan(bmi270, SENSOR_CHAN_ALL) != 0) {
-        return -ENODATA;
+    k_mutex_lock(&snapshot_mutex, K_FOREVER);
+
+    now_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    if (snapshot_valid && (now_us - last_snapshot.timestamp_us) <= (int64_t)max_age_ms * USEC_PER_MSEC) {
+        goto out;
     }
 
-    if ((sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_X, &x_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_Y, &y_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_Z, &z_temp) != 0)) {
-        return -ENODATA;
+    // Accelerometer and gyroscope are read in one burst, the temperature is only read for SENSOR_CHAN_ALL.
+    if ((sensor_sample_fetch_chan(bmi270, SENSOR_CHAN_ACCEL_XYZ) != 0) ||
+        (sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_XYZ, accel) != 0) ||
+        (sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_XYZ, gyro) != 0)) {
+        ret = -ENODATA;
+        goto out;
     }
 
-    *x = sensor_value_to_float(&x_temp);
-    *y = sensor_value_to_float(&y_temp);
-    *z = sensor_value_to_float(&z_temp);
+    for (int i = 0; i < 3; i++) {
+        last_snapshot.accel[i] = sensor_value_to_float(&accel[i]);
+        last_snapshot.gyro[i] = sensor_value_to_float(&gyro[i]);
+    }
+    last_snapshot.timestamp_us = now_us;
+    snapshot_valid = true;
+
+out:
+    if (ret == 0) {
+        *snapshot = last_snapshot;
+    }
+    k_mutex_unlock(&snapshot_mutex);
+
+    return ret;
+}
+
+int zsw_imu_fetch_accel_f(float *x, float *y, float *z)
+{
+    zsw_imu_frame_t snapshot;
+    int ret;
+
+    ret = zsw_imu_fetch_snapshot(&snapshot, CONFIG_ZSW_IMU_SNAPSHOT_MAX_AGE_MS);
+    if (ret != 0) {
+        return ret;
+    }
+
+    *x = snapshot.accel[0];
+    *y = snapshot.accel[1];
+    *z = snapshot.accel[2];
 
     return 0;
 }
 
 int zsw_imu_fetch_gyro_f(float *x, float *y, float *z)
 {
-    struct sensor_value x_temp;
-    struct sensor_value y_temp;
-    struct sensor_value z_temp;
+    zsw_imu_frame_t snapshot;
+    int ret;
+
+    ret = zsw_imu_fetch_snapshot(&snapshot, CONFIG_ZSW_IMU_SNAPSHOT_MAX_AGE_MS);
+    if (ret != 0) {
+        return ret;
+    }
+
+    *x = snapshot.gyro[0];
+    *y = snapshot.gyro[1];
+    *z = snapshot.gyro[2];
+
+    return 0;
+}
+
+int zsw_imu_fetch_accel_gyro_f(float accel[3], float gyro[3])
+{
+    zsw_imu_frame_t snapshot;
+    int ret;
+
+    ret = zsw_imu_fetch_snapshot(&snapshot, CONFIG_ZSW_IMU_SNAPSHOT_MAX_AGE_MS);
+    if (ret != 0) {
+        return ret;
+    }
+
+    memcpy(accel, snapshot.accel, sizeof(snapshot.accel));
+    memcpy(gyro, snapshot.gyro, sizeof(snapshot.gyro));
+
+    return 0;
+}
+
+#ifdef CONFIG_ZSW_BMI270_FIFO
+static void fifo_watermark_handler(const struct device *dev, const struct sensor_trigger *trig)
+{
+    zsw_imu_batch_ready_cb_t cb = batch_ready_cb;
+
+    if (cb) {
+        cb();
+    }
+}
+
+int zsw_imu_batch_start(uint16_t watermark_frames, zsw_imu_batch_ready_cb_t cb)
+{
+    int ret;
 
     if (!device_is_ready(bmi270)) {
         return -ENODEV;
     }
 
-    if (sensor_sample_fetch_chan(bmi270, SENSOR_CHAN_ALL) != 0) {
-        return -ENODATA;
+    if ((watermark_frames == 0) || (cb == NULL)) {
+        return -EINVAL;
     }
 
-    if ((sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_X, &x_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_Y, &y_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_Z, &z_temp) != 0)) {
-        return -ENODATA;
+    if (batch_started) {
+        return -EBUSY;
     }
 
-    *x = sensor_value_to_float(&x_temp);
-    *y = sensor_value_to_float(&y_temp);
-    *z = sensor_value_to_float(&z_temp);
+    // Every FIFO frame holds both sensors, so the gyroscope stays on while batching
+    ret = zsw_imu_feature_enable(ZSW_IMU_FEATURE_GYRO, false);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = bosch_bmi270_fifo_configure(bmi270, watermark_frames);
+    if (ret != 0) {
+        LOG_ERR("Failed to configure FIFO: %d", ret);
+        zsw_imu_feature_disable(ZSW_IMU_FEATURE_GYRO);
+        return ret;
+    }
+
+    batch_ready_cb = cb;
+    batch_started = true;
+    batch_last_us = 0;
+
+    // Without the interrupt the FIFO is still filled, but the user has to poll it.
+    ret = sensor_trigger_set(bmi270, &fifo_trigger, fifo_watermark_handler);
+    if (ret != 0) {
+        LOG_WRN("No FIFO watermark interrupt: %d", ret);
+    }
 
     return 0;
 }
 
-int zsw_imu_fetch_accel(int16_t *x, int16_t *y, int16_t *z)
+int zsw_imu_batch_stop(void)
 {
-    struct sensor_value x_temp;
-    struct sensor_value y_temp;
-    struct sensor_value z_temp;
+    int ret;
 
     if (!device_is_ready(bmi270)) {
         return -ENODEV;
     }
 
-    if (sensor_sample_fetch_chan(bmi270, SENSOR_CHAN_ALL) != 0) {
-        return -ENODATA;
+    if (!batch_started) {
+        return 0;
     }
 
-    if ((sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_X, &x_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_Y, &y_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_ACCEL_Z, &z_temp) != 0)) {
-        return -ENODATA;
-    }
+    batch_ready_cb = NULL;
+    batch_started = false;
 
-    *x = x_temp.val1;
-    *y = y_temp.val1;
-    *z = z_temp.val1;
+    ret = bosch_bmi270_fifo_configure(bmi270, 0);
+    zsw_imu_feature_disable(ZSW_IMU_FEATURE_GYRO);
 
-    return 0;
+    return ret;
 }
 
-int zsw_imu_fetch_gyro(int16_t *x, int16_t *y, int16_t *z)
+int zsw_imu_read_batch(zsw_imu_frame_t *frames, size_t max_frames)
 {
-    struct sensor_value x_temp;
-    struct sensor_value y_temp;
-    struct sensor_value z_temp;
+    struct bosch_bmi270_fifo_frame raw[BATCH_READ_CHUNK];
+    uint32_t period_us = 0;
+    uint16_t remaining = 0;
+    int64_t now_us;
+    int64_t first_us;
+    size_t num_frames = 0;
+    int ret;
 
     if (!device_is_ready(bmi270)) {
         return -ENODEV;
     }
 
-    if (sensor_sample_fetch_chan(bmi270, SENSOR_CHAN_ALL) != 0) {
-        return -ENODATA;
+    if (!batch_started) {
+        return -EPERM;
     }
 
-    if ((sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_X, &x_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_Y, &y_temp) != 0) ||
-        (sensor_channel_get(bmi270, SENSOR_CHAN_GYRO_Z, &z_temp) != 0)) {
-        return -ENODATA;
+    while (num_frames < max_frames) {
+        ret = bosch_bmi270_fifo_read(bmi270, raw, MIN(max_frames - num_frames, ARRAY_SIZE(raw)), &period_us,
+                                     &remaining);
+        if (ret < 0) {
+            return ret;
+        }
+
+        for (int i = 0; i < ret; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                frames[num_frames + i].accel[axis] = raw[i].acc[axis] / 1000000.0f;
+                frames[num_frames + i].gyro[axis] = raw[i].gyr[axis] / 1000000.0f;
+            }
+        }
+        num_frames += ret;
+
+        if (ret < ARRAY_SIZE(raw)) {
+            break;
+        }
+    }
+
+    if (num_frames == 0) {
+        return 0;
+    }
+
+    // The FIFO has no timestamps in this mode, count back from the newest frame in the FIFO,
+    // which is newer than the frames read when max_frames didn't fit them all.
+    now_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    first_us = now_us - (int64_t)(remaining + num_frames - 1) * period_us;
+    // Read latency moves the estimate by less than a period, keep frames after the ones already returned
+    if ((batch_last_us != 0) && (first_us <= batch_last_us)) {
+        first_us = batch_last_us + period_us;
     }
 
-    *x = x_temp.val1;
-    *y = y_temp.val1;
-    *z = z_temp.val1;
+    for (size_t i = 0; i < num_frames; i++) {
+        frames[i].timestamp_us = first_us + (int64_t)i * period_us;
+    }
+    batch_last_us = frames[num_frames - 1].timestamp_us;
+
+    return num_frames;
+}
+#else
+int zsw_imu_batch_start(uint16_t watermark_frames, zsw_imu_batch_ready_cb_t cb)
+{
+    return -ENOTSUP;
+}
+
+int zsw_imu_batch_stop(void)
+{
+    return -ENOTSUP;
+}
+
+int zsw_imu_read_batch(zsw_imu_frame_t *frames, size_t max_frames)
+{
+    return -ENOTSUP;
+}
+#endif
+
+int zsw_imu_fetch_accel(int16_t *x, int16_t *y, int16_t *z)
+{
+    float accel[3];
+    int ret;
+
+    ret = zsw_imu_fetch_accel_f(&accel[0], &accel[1], &accel[2]);
+    if (ret != 0) {
+        return ret;
+    }
+
+    *x = accel[0];
+    *y = accel[1];
+    *z = accel[2];
+
+    return 0;
+}
+
+int zsw_imu_fetch_gyro(int16_t *x, int16_t *y, int16_t *z)
+{
+    float gyro[3];
+    int ret;
+
+    ret = zsw_imu_fetch_gyro_f(&gyro[0], &gyro[1], &gyro[2]);
+    if (ret != 0) {
+        return ret;
+    }
+
+    *x = gyro[0];
+    *y = gyro[1];
+    *z = gyro[2];
 
     return 0;
 }
@@ -373,3 +602,29 @@ int zsw_imu_feature_enable(zsw_imu_feature_t feature, bool int_en)
 
     return 0;
 }
+
+#ifdef CONFIG_ZSW_IMU_STATS
+static int cmd_imu_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    // Steps as reported by the step interrupts, without the offset of zsw_imu_fetch_num_steps().
+    shell_print(sh, "Steps:      %u (%u events)", stats.steps, stats.step_events);
+    shell_print(sh, "Activity:   %s (%u events)", activity_output[MIN(last_step_activity, 3)],
+                stats.activity_events);
+    shell_print(sh, "Gestures:   %u, last %s", stats.gestures, gesture_output[MIN(stats.last_gesture, 5)]);
+    shell_print(sh, "Wake-ups:   %u", stats.wakeups);
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_imu,
+                               SHELL_CMD_ARG(stats, NULL, "Show IMU events received: imu stats [reset]",
+                                             cmd_imu_stats, 1, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(imu, &sub_imu, "IMU commands", NULL);
+#endif
@@ -72,6 +72,14 @@ typedef struct zsw_imu_data_step_t {
     int16_t count;
 } zsw_imu_data_step_t;
 
+typedef struct zsw_imu_frame_t {
+    int64_t timestamp_us;
+    float accel[3];
+    float gyro[3];
+} zsw_imu_frame_t;
+
+typedef void (*zsw_imu_batch_ready_cb_t)(void);
+
 typedef struct zsw_imu_evt_t {
     zsw_imu_evt_type_t type;
     union {
@@ -84,6 +92,18 @@ typedef struct zsw_imu_evt_t {
 
 int zsw_imu_init(void);
 
+/*
+* Get the accelerometer data in m/s^2 and gyroscope data in rad/s from the same
+* sample, with its timestamp in k_uptime microseconds. A snapshot at most
+* max_age_ms old is returned without reading the sensor again, so consumers
+* running close together share one bus transaction.
+*/
+int zsw_imu_fetch_snapshot(zsw_imu_frame_t *snapshot, uint32_t max_age_ms);
+
+/*
+* The fetch functions below reuse snapshots up to CONFIG_ZSW_IMU_SNAPSHOT_MAX_AGE_MS old.
+*/
+
 /*
 * Get the accelerometer data in m/s^2.
 */
@@ -94,6 +114,33 @@ int zsw_imu_fetch_accel_f(float *x, float *y, float *z);
 */
 int zsw_imu_fetch_gyro_f(float *x, float *y, float *z);
 
+/*
+* Get the accelerometer data in m/s^2 and gyroscope data in rad/s
+* from the same sample, with a single read from the sensor.
+*/
+int zsw_imu_fetch_accel_gyro_f(float accel[3], float gyro[3]);
+
+/*
+* Start collecting accelerometer and gyroscope samples in the IMU FIFO.
+* cb is called, from the IMU interrupt context (workqueue or driver thread),
+* when watermark_frames are ready to be read with zsw_imu_read_batch.
+* At the default 100 Hz, 25 frames wake the CPU every 250 ms.
+* The gyroscope is kept enabled and runs at the accelerometer sampling frequency while batching.
+* Only one user can batch at a time.
+*/
+int zsw_imu_batch_start(uint16_t watermark_frames, zsw_imu_batch_ready_cb_t cb);
+
+int zsw_imu_batch_stop(void);
+
+/*
+* Read the collected frames, oldest first, accelerometer in m/s^2 and gyroscope in rad/s.
+* Timestamps are in k_uptime microseconds, the newest frame in the FIFO gets the time of the read,
+* so frames left in the FIFO when max_frames is reached are accounted for. Timestamps always increase
+* from one call to the next.
+* Returns the number of frames read or a negative error code.
+*/
+int zsw_imu_read_batch(zsw_imu_frame_t *frames, size_t max_frames);
+
 int zsw_imu_fetch_accel(int16_t *x, int16_t *y, int16_t *z);
 
 int zsw_imu_fetch_gyro(int16_t *x, int16_t *y, int16_t *z);
@@ -41,7 +41,7 @@ static notif_box_t notif_box;
 
 LV_FONT_DECLARE(lv_font_montserrat_14_full)
 
-void zsw_notification_popup_show(char *title, char *body, zsw_notification_src_t icon, uint32_t id,
+void zsw_notification_popup_show(const char *title, const char *body, zsw_notification_src_t icon, uint32_t id,
                                  on_close_notif_cb_t close_cb,
                                  uint32_t close_after_seconds)
 {
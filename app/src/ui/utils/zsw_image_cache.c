@@ -0,0 +1,249 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <lvgl.h>
+#include <misc/cache/instance/lv_image_cache.h>
+#include <misc/cache/instance/lv_image_header_cache.h>
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "zsw_image_cache.h"
+
+LOG_MODULE_REGISTER(zsw_image_cache, CONFIG_ZSW_IMAGE_CACHE_LOG_LEVEL);
+
+#define IMAGE_CACHE_MAX_PATH_LEN    48
+
+typedef struct {
+    char src[IMAGE_CACHE_MAX_PATH_LEN];
+    lv_image_dsc_t dsc;
+    uint8_t *data;
+} image_cache_entry_t;
+
+static int load_image(image_cache_entry_t *entry, const char *path);
+
+K_HEAP_DEFINE(image_cache_heap, CONFIG_ZSW_IMAGE_CACHE_SIZE);
+K_MUTEX_DEFINE(image_cache_mutex);
+
+static image_cache_entry_t entries[CONFIG_ZSW_IMAGE_CACHE_MAX_ENTRIES];
+static uint32_t num_entries;
+// Images that can't be cached until zsw_image_cache_release_all(), so their file isn't opened on every lookup.
+static char uncacheable[CONFIG_ZSW_IMAGE_CACHE_MAX_ENTRIES][IMAGE_CACHE_MAX_PATH_LEN];
+static uint32_t num_uncacheable;
+static uint32_t bytes_used;
+static uint32_t hits;
+static uint32_t misses;
+
+const void *zsw_image_cache_get(const void *src)
+{
+    const void *result = src;
+    int rc;
+
+    if ((src == NULL) || (lv_image_src_get_type(src) != LV_IMAGE_SRC_FILE)) {
+        return src;
+    }
+
+    k_mutex_lock(&image_cache_mutex, K_FOREVER);
+    for (int i = 0; i < num_entries; i++) {
+        if (strcmp(entries[i].src, src) == 0) {
+            hits++;
+            result = &entries[i].dsc;
+            goto out;
+        }
+    }
+
+    misses++;
+    for (int i = 0; i < num_uncacheable; i++) {
+        if (strcmp(uncacheable[i], src) == 0) {
+            goto out;
+        }
+    }
+
+    if ((num_entries >= ARRAY_SIZE(entries)) || (strlen(src) >= IMAGE_CACHE_MAX_PATH_LEN)) {
+        LOG_DBG("Can't cache %s", (const char *)src);
+        goto out;
+    }
+
+    // Only loaded images take a slot, images that can't be cached are read from the file as before.
+    rc = load_image(&entries[num_entries], src);
+    if (rc == 0) {
+        result = &entries[num_entries].dsc;
+        num_entries++;
+        goto out;
+    }
+
+    memset(&entries[num_entries], 0, sizeof(entries[num_entries]));
+    // Compressed images and images not fitting the budget stay so until the cache is released, I/O errors are retried.
+    if (((rc == -ENOTSUP) || (rc == -ENOMEM)) && (num_uncacheable < ARRAY_SIZE(uncacheable))) {
+        strcpy(uncacheable[num_uncacheable], src);
+        num_uncacheable++;
+    }
+
+out:
+    k_mutex_unlock(&image_cache_mutex);
+    return result;
+}
+
+void zsw_image_cache_warm(const void *const *srcs)
+{
+    if (srcs == NULL) {
+        return;
+    }
+
+    for (; *srcs != NULL; srcs++) {
+        zsw_image_cache_get(*srcs);
+    }
+}
+
+void zsw_image_cache_release_all(void)
+{
+    uint32_t lookups;
+
+    k_mutex_lock(&image_cache_mutex, K_FOREVER);
+    for (int i = 0; i < num_entries; i++) {
+        // LVGL keys its own caches on the descriptor address, which may be reused by the next entry.
+        lv_image_cache_drop(&entries[i].dsc);
+        lv_image_header_cache_drop(&entries[i].dsc);
+        k_heap_free(&image_cache_heap, entries[i].data);
+    }
+
+    lookups = hits + misses;
+    LOG_DBG("Released %d images (%u bytes), hit ratio %u%%", num_entries, bytes_used,
+            lookups ? (uint32_t)(((uint64_t)hits * 100) / lookups) : 0);
+
+    memset(entries, 0, sizeof(entries));
+    num_entries = 0;
+    memset(uncacheable, 0, sizeof(uncacheable));
+    num_uncacheable = 0;
+    bytes_used = 0;
+    k_mutex_unlock(&image_cache_mutex);
+}
+
+void zsw_image_cache_get_stats(zsw_image_cache_stats_t *stats)
+{
+    k_mutex_lock(&image_cache_mutex, K_FOREVER);
+    stats->hits = hits;
+    stats->misses = misses;
+    stats->num_entries = num_entries;
+    stats->num_uncacheable = num_uncacheable;
+    stats->bytes_used = bytes_used;
+    k_mutex_unlock(&image_cache_mutex);
+}
+
+static int load_image(image_cache_entry_t *entry, const char *path)
+{
+    lv_fs_file_t file;
+    lv_fs_res_t res;
+    lv_image_header_t header;
+    uint32_t file_size;
+    uint32_t data_size;
+    uint32_t br;
+    int rc = 0;
+
+    strcpy(entry->src, path);
+
+    res = lv_fs_open(&file, path, LV_FS_MODE_RD);
+    if (res != LV_FS_RES_OK) {
+        LOG_WRN("Failed to open %s: %d", path, res);
+        return -ENOENT;
+    }
+
+    res = lv_fs_seek(&file, 0, LV_FS_SEEK_END);
+    if (res == LV_FS_RES_OK) {
+        res = lv_fs_tell(&file, &file_size);
+    }
+    if (res == LV_FS_RES_OK) {
+        res = lv_fs_seek(&file, 0, LV_FS_SEEK_SET);
+    }
+    if (res == LV_FS_RES_OK) {
+        res = lv_fs_read(&file, &header, sizeof(header), &br);
+    }
+    if ((res != LV_FS_RES_OK) || (br != sizeof(header)) || (file_size <= sizeof(header))) {
+        rc = -EIO;
+        goto out;
+    }
+
+    // Compressed images are already cached decoded by LVGL, keeping the compressed data here gains nothing.
+    if ((header.magic != LV_IMAGE_HEADER_MAGIC) || (header.flags & LV_IMAGE_FLAGS_COMPRESSED)) {
+        rc = -ENOTSUP;
+        goto out;
+    }
+
+    data_size = file_size - sizeof(header);
+    entry->data = k_heap_aligned_alloc(&image_cache_heap, LV_DRAW_BUF_ALIGN, data_size, K_NO_WAIT);
+    if (entry->data == NULL) {
+        LOG_DBG("Cache full, not caching %s (%u bytes)", path, data_size);
+        rc = -ENOMEM;
+        goto out;
+    }
+
+    res = lv_fs_read(&file, entry->data, data_size, &br);
+    if ((res != LV_FS_RES_OK) || (br != data_size)) {
+        k_heap_free(&image_cache_heap, entry->data);
+        entry->data = NULL;
+        rc = -EIO;
+        goto out;
+    }
+
+    entry->dsc.header = header;
+    entry->dsc.data_size = data_size;
+    entry->dsc.data = entry->data;
+    bytes_used += data_size;
+    LOG_DBG("Cached %s (%u bytes)", path, data_size);
+
+out:
+    lv_fs_close(&file);
+    return rc;
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_imgcache_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    zsw_image_cache_stats_t stats;
+    uint32_t lookups;
+
+    zsw_image_cache_get_stats(&stats);
+    lookups = stats.hits + stats.misses;
+
+    shell_print(sh, "Entries:   %u / %d", stats.num_entries, CONFIG_ZSW_IMAGE_CACHE_MAX_ENTRIES);
+    shell_print(sh, "Uncached:  %u", stats.num_uncacheable);
+    shell_print(sh, "Memory:    %u / %d bytes", stats.bytes_used, CONFIG_ZSW_IMAGE_CACHE_SIZE);
+    shell_print(sh, "Hits:      %u", stats.hits);
+    shell_print(sh, "Misses:    %u", stats.misses);
+    shell_print(sh, "Hit ratio: %u%%", lookups ? (uint32_t)(((uint64_t)stats.hits * 100) / lookups) : 0);
+
+    if ((argc > 1) && (strcmp(argv[1], "reset") == 0)) {
+        k_mutex_lock(&image_cache_mutex, K_FOREVER);
+        hits = 0;
+        misses = 0;
+        k_mutex_unlock(&image_cache_mutex);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_imgcache,
+                               SHELL_CMD_ARG(stats, NULL, "Show image cache statistics: imgcache stats [reset]",
+                                             cmd_imgcache_stats, 1, 1),
+                               SHELL_SUBCMD_SET_END
+                              );
+
+SHELL_CMD_REGISTER(imgcache, &sub_imgcache, "Watchface image cache commands", NULL);
+#endif
@@ -0,0 +1,74 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t num_entries;
+    uint32_t num_uncacheable;
+    uint32_t bytes_used;
+} zsw_image_cache_stats_t;
+
+#ifdef CONFIG_ZSW_IMAGE_CACHE
+/**
+ * @brief Get an image source to use with lv_image_set_src().
+ *
+ * File based images (e.g. ZSW_LV_IMG_USE() when images are stored in external flash) are loaded into
+ * RAM the first time they are used and stay pinned until zsw_image_cache_release_all().
+ * If the image can't be cached the original source is returned, so the result can always be used.
+ * Images that are compressed or don't fit the memory budget are remembered as uncacheable until
+ * zsw_image_cache_release_all(), other failures are tried again on the next call.
+ *
+ * @param src Image source, a file path or an lv_image_dsc_t.
+ * @return Cached in-RAM image descriptor, or src.
+ */
+const void *zsw_image_cache_get(const void *src);
+
+/**
+ * @brief Load images into the cache ahead of use.
+ *
+ * @param srcs NULL terminated list of image sources.
+ */
+void zsw_image_cache_warm(const void *const *srcs);
+
+/**
+ * @brief Free all cached images.
+ *
+ * No LVGL object may use a source returned by zsw_image_cache_get() when this is called.
+ */
+void zsw_image_cache_release_all(void);
+
+void zsw_image_cache_get_stats(zsw_image_cache_stats_t *stats);
+#else
+static inline const void *zsw_image_cache_get(const void *src)
+{
+    return src;
+}
+
+static inline void zsw_image_cache_warm(const void *const *srcs)
+{
+    (void)srcs;
+}
+
+static inline void zsw_image_cache_release_all(void)
+{
+}
+#endif
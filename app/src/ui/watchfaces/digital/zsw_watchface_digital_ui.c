@@ -20,6 +20,7 @@
 #include <zephyr/logging/log.h>
 
 #include "ui/zsw_ui.h"
+#include "ui/utils/zsw_image_cache.h"
 #include "applications/watchface/watchface_app.h"
 #include "ui/watchfaces/zsw_ui_notification_area.h"
 
@@ -69,6 +70,16 @@ LV_FONT_DECLARE(ui_font_aliean_25);
 
 ZSW_LV_IMG_DECLARE(snoopy)
 
+// Icons drawn by this watchface, loaded into RAM when the watchface is opened
+static const void *const cached_images[] = {
+    ZSW_LV_IMG_USE(ui_img_pressure_png),
+    ZSW_LV_IMG_USE(ui_img_temperatures_png),
+    ZSW_LV_IMG_USE(ui_img_charging_png),
+    ZSW_LV_IMG_USE(ui_img_battery_png),
+    ZSW_LV_IMG_USE(ui_img_running_png),
+    NULL
+};
+
 // Remember last values as if no change then
 // no reason to waste resourses and redraw
 static int last_hour = -1;
@@ -125,7 +136,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
     lv_obj_set_style_bg_opa(ui_pressure_arc, 0, LV_PART_KNOB | LV_STATE_DEFAULT);
 
     ui_pressure_image = lv_image_create(ui_pressure_arc);
-    lv_image_set_src(ui_pressure_image, ZSW_LV_IMG_USE(ui_img_pressure_png));
+    lv_image_set_src(ui_pressure_image, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_pressure_png)));
     lv_obj_set_width(ui_pressure_image, LV_SIZE_CONTENT);
     lv_obj_set_height(ui_pressure_image, LV_SIZE_CONTENT);
     lv_obj_set_x(ui_pressure_image, -70);
@@ -161,7 +172,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
     lv_obj_set_style_bg_opa(ui_humidity_arc, 0, LV_PART_KNOB | LV_STATE_DEFAULT);
 
     ui_humidity_icon = lv_image_create(ui_humidity_arc);
-    lv_image_set_src(ui_humidity_icon, ZSW_LV_IMG_USE(ui_img_temperatures_png));
+    lv_image_set_src(ui_humidity_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_temperatures_png)));
     lv_obj_set_width(ui_humidity_icon, LV_SIZE_CONTENT);
     lv_obj_set_height(ui_humidity_icon, LV_SIZE_CONTENT);
     lv_obj_set_x(ui_humidity_icon, 70);
@@ -301,7 +312,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
     lv_obj_move_foreground(ui_battery_hitbox);
 
     ui_battery_arc_icon = lv_image_create(ui_battery_arc);
-    lv_image_set_src(ui_battery_arc_icon, ZSW_LV_IMG_USE(ui_img_battery_png));
+    lv_image_set_src(ui_battery_arc_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_battery_png)));
     lv_obj_set_width(ui_battery_arc_icon, LV_SIZE_CONTENT);
     lv_obj_set_height(ui_battery_arc_icon, LV_SIZE_CONTENT);
     lv_obj_set_align(ui_battery_arc_icon, LV_ALIGN_CENTER);
@@ -359,7 +370,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
     lv_obj_move_foreground(ui_step_hitbox);
 
     ui_step_arc_icon = lv_image_create(ui_step_arc);
-    lv_image_set_src(ui_step_arc_icon, ZSW_LV_IMG_USE(ui_img_running_png));
+    lv_image_set_src(ui_step_arc_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_running_png)));
     lv_obj_set_width(ui_step_arc_icon, LV_SIZE_CONTENT);
     lv_obj_set_height(ui_step_arc_icon, LV_SIZE_CONTENT);
     lv_obj_set_align(ui_step_arc_icon, LV_ALIGN_CENTER);
@@ -438,7 +449,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
 
     // Just use a default dummy image by default
     const lv_img_dsc_t *icon = zsw_ui_utils_icon_from_weather_code(802, &icon_color);
-    lv_image_set_src(ui_weather_icon, icon);
+    lv_image_set_src(ui_weather_icon, zsw_image_cache_get(icon));
     lv_obj_set_width(ui_weather_icon, LV_SIZE_CONTENT);
     lv_obj_set_height(ui_weather_icon, LV_SIZE_CONTENT);
     lv_obj_set_x(ui_weather_icon, -12);
@@ -532,7 +543,7 @@ static void watchface_set_weather(int8_t temperature, int weather_code, uint16_t
     ARG_UNUSED(humidity);
     lv_label_set_text_fmt(ui_weather_temperature_label, "%d°", temperature);
     icon = zsw_ui_utils_icon_from_weather_code(weather_code, &icon_color);
-    lv_image_set_src(ui_weather_icon, icon);
+    lv_image_set_src(ui_weather_icon, zsw_image_cache_get(icon));
 
     lv_obj_set_style_img_recolor_opa(ui_weather_icon, LV_OPA_COVER, 0);
     lv_obj_set_style_img_recolor(ui_weather_icon, icon_color, 0);
@@ -585,11 +596,11 @@ static void watchface_set_charging(bool is_charging)
     }
 
     if (is_charging) {
-        lv_image_set_src(ui_battery_arc_icon, ZSW_LV_IMG_USE(ui_img_charging_png));
+        lv_image_set_src(ui_battery_arc_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_charging_png)));
         lv_obj_set_style_img_recolor(ui_battery_arc_icon, lv_color_hex(0xFFD700), LV_PART_MAIN | LV_STATE_DEFAULT);
         lv_obj_set_style_arc_color(ui_battery_arc, lv_palette_main(LV_PALETTE_GREEN), LV_PART_INDICATOR | LV_STATE_DEFAULT);
     } else {
-        lv_image_set_src(ui_battery_arc_icon, ZSW_LV_IMG_USE(ui_img_battery_png));
+        lv_image_set_src(ui_battery_arc_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_battery_png)));
         lv_obj_set_style_img_recolor(ui_battery_arc_icon, lv_color_hex(0xFFFFFF), LV_PART_MAIN | LV_STATE_DEFAULT);
         lv_obj_set_style_arc_color(ui_battery_arc, lv_color_hex(0xFFB140), LV_PART_INDICATOR | LV_STATE_DEFAULT);
     }
@@ -643,6 +654,7 @@ static watchface_ui_api_t ui_api = {
     .ui_invalidate_cached = watchface_ui_invalidate_cached,
     .set_watchface_bg = watchface_set_bg,
     .get_preview_img = watchface_get_preview_img,
+    .cached_images = cached_images,
     .name = "ZSWatch Digital",
 };
 
@@ -22,6 +22,7 @@
 #include "ui/zsw_ui.h"
 #include "applications/watchface/watchface_app.h"
 #include "ui/utils/zsw_ui_utils.h"
+#include "ui/utils/zsw_image_cache.h"
 
 LOG_MODULE_REGISTER(watchface_digital_minimal, LOG_LEVEL_WRN);
 
@@ -97,6 +98,21 @@ static const void *face_goog_battery[] = {
     ZSW_LV_IMG_USE(face_goog_20_61728_6),
 };
 
+// Icons drawn by this watchface, loaded into RAM when the watchface is opened
+static const void *const cached_images[] = {
+    ZSW_LV_IMG_USE(ui_img_running_png),
+    ZSW_LV_IMG_USE(ui_img_chat_png),
+    ZSW_LV_IMG_USE(drop_icon),
+    ZSW_LV_IMG_USE(face_goog_20_61728_0),
+    ZSW_LV_IMG_USE(face_goog_20_61728_1),
+    ZSW_LV_IMG_USE(face_goog_20_61728_2),
+    ZSW_LV_IMG_USE(face_goog_20_61728_3),
+    ZSW_LV_IMG_USE(face_goog_20_61728_4),
+    ZSW_LV_IMG_USE(face_goog_20_61728_5),
+    ZSW_LV_IMG_USE(face_goog_20_61728_6),
+    NULL
+};
+
 LV_FONT_DECLARE(ui_font_aliean_47);
 LV_FONT_DECLARE(ui_font_aliean_25);
 
@@ -214,7 +230,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
     const lv_img_dsc_t *w_icon = zsw_ui_utils_icon_from_weather_code(802, &icon_color);
 
     ui_weather_icon = lv_image_create(weather_row);
-    lv_image_set_src(ui_weather_icon, w_icon);
+    lv_image_set_src(ui_weather_icon, zsw_image_cache_get(w_icon));
     lv_obj_set_style_img_recolor(ui_weather_icon, icon_color, LV_PART_MAIN);
     lv_obj_set_style_img_recolor_opa(ui_weather_icon, LV_OPA_COVER, LV_PART_MAIN);
     lv_image_set_scale(ui_weather_icon, 200);  /* 24→19 for weather row */
@@ -225,7 +241,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
     lv_obj_set_style_text_font(ui_weather_temp_label, &lv_font_montserrat_14, LV_PART_MAIN);
 
     lv_obj_t *humidity_icon = lv_image_create(weather_row);
-    lv_image_set_src(humidity_icon, ZSW_LV_IMG_USE(drop_icon));
+    lv_image_set_src(humidity_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(drop_icon)));
     lv_obj_set_style_img_recolor(humidity_icon, lv_color_hex(0x60AEF7), LV_PART_MAIN);
     lv_obj_set_style_img_recolor_opa(humidity_icon, LV_OPA_COVER, LV_PART_MAIN);
     lv_image_set_scale(humidity_icon, 200);  /* 24→19 */
@@ -261,7 +277,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
 
     /* Steps icon + label */
     lv_obj_t *steps_icon = lv_image_create(stats_row);
-    lv_image_set_src(steps_icon, ZSW_LV_IMG_USE(ui_img_running_png));
+    lv_image_set_src(steps_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_running_png)));
     lv_obj_set_style_img_recolor(steps_icon, lv_color_hex(0xb97cf5), LV_PART_MAIN);
     lv_obj_set_style_img_recolor_opa(steps_icon, LV_OPA_COVER, LV_PART_MAIN);
     /* Use native 24×24 size — no scaling in stats row */
@@ -283,7 +299,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
 
     /* Notification icon with count overlaid (hidden when 0) */
     ui_notif_icon = lv_image_create(stats_row);
-    lv_image_set_src(ui_notif_icon, ZSW_LV_IMG_USE(ui_img_chat_png));
+    lv_image_set_src(ui_notif_icon, zsw_image_cache_get(ZSW_LV_IMG_USE(ui_img_chat_png)));
     lv_obj_set_style_img_recolor(ui_notif_icon, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
     lv_obj_set_style_img_recolor_opa(ui_notif_icon, LV_OPA_COVER, LV_PART_MAIN);
 
@@ -299,7 +315,7 @@ static void watchface_show(lv_obj_t *parent, watchface_app_evt_listener evt_cb,
 
     /* Battery icon with dynamic fill level (26×20, tappable) */
     ui_batt_icon = lv_image_create(stats_row);
-    lv_image_set_src(ui_batt_icon, face_goog_battery[6]);
+    lv_image_set_src(ui_batt_icon, zsw_image_cache_get(face_goog_battery[6]));
     lv_obj_add_flag(ui_batt_icon, LV_OBJ_FLAG_CLICKABLE);
     lv_obj_clear_flag(ui_batt_icon, LV_OBJ_FLAG_EVENT_BUBBLE);
     lv_obj_add_event_cb(ui_batt_icon, on_tap, LV_EVENT_CLICKED,
@@ -379,7 +395,7 @@ static void update_battery_display(int32_t percent, int32_t battery)
         idx = 6;
     }
 
-    lv_image_set_src(ui_batt_icon, face_goog_battery[idx]);
+    lv_image_set_src(ui_batt_icon, zsw_image_cache_get(face_goog_battery[idx]));
 
     if (use_relative_battery) {
         lv_label_set_text_fmt(ui_batt_label, "%d%%", (int)percent);
@@ -457,7 +473,7 @@ static void watchface_set_weather(int8_t temperature, int weather_code, uint16_t
     lv_color_t color;
     const lv_img_dsc_t *icon = zsw_ui_utils_icon_from_weather_code(weather_code, &color);
 
-    lv_image_set_src(ui_weather_icon, icon);
+    lv_image_set_src(ui_weather_icon, zsw_image_cache_get(icon));
     lv_obj_set_style_img_recolor(ui_weather_icon, color, LV_PART_MAIN);
     lv_obj_set_style_img_recolor_opa(ui_weather_icon, LV_OPA_COVER, LV_PART_MAIN);
     lv_label_set_text_fmt(ui_weather_temp_label, "%d\xc2\xb0", (int)temperature);
@@ -600,6 +616,7 @@ static watchface_ui_api_t ui_api = {
     .set_watchface_bg     = watchface_set_bg,
     .get_preview_img      = watchface_get_preview_img,
     .set_music            = watchface_set_music,
+    .cached_images        = cached_images,
     .name                 = "Digital Minimal",
 };
 
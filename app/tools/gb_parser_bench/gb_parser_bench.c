@@ -0,0 +1,669 @@
+/*
+ * gb_parser_bench — host benchmark for the Gadgetbridge message parser.
+ *
+ * Runs captured Gadgetbridge frames (the JSON inside GB(...)) through the
+ * tokenizer used by ble_gadgetbridge.c, and through a copy of the previous
+ * strstr() based parser, checks that the decoded fields are as expected and
+ * prints the time per message for both.
+ *
+ * glibc's strstr() is vectorized, the libc on the watch compares byte by byte.
+ * The old parser is therefore timed with both, the byte wise column is closer
+ * to what runs on target.
+ *
+ * Build and run:
+ *     cmake -S app/tools/gb_parser_bench -B build_bench && cmake --build build_bench
+ *     ./build_bench/gb_parser_bench [iterations]
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gb_tokenizer.h"
+
+#define MAX_GB_PACKET_LENGTH    2000
+#define MESSAGE_TYPE_HASH_SIZE  32
+#define BENCH_BATCHES           20
+
+typedef struct {
+    const char *name;
+    const char *frame;
+    const char *key;        // String field checked after parsing
+    const char *expected;   // Expected UTF-8 value of key
+    const char *int_key;    // Integer field checked after parsing, optional
+    int32_t int_expected;
+} bench_frame_t;
+
+static const bench_frame_t frames[] = {
+    {
+        "notify",
+        "{\"t\":\"notify\",\"id\":1717002933,\"src\":\"Messenger\",\"title\":\"J\\xf6rgen\",\"subject\":\"\","
+        "\"body\":\"Hej! Ska vi ses p\xe5 "
+        "fredag? Jag har bokat bord p\\xe5 restaurangen vid torget klockan sju, s\\xe4g till om det inte passar.\","
+        "\"sender\":\"J\\xf6rgen\",\"tel\":\"\"}",
+        "body",
+        "Hej! Ska vi ses p\xc3\xa5 fredag? Jag har bokat bord p\xc3\xa5 restaurangen vid torget klockan sju, "
+        "s\xc3\xa4g till om det inte passar."
+    },
+    {
+        "notify (ascii)",
+        "{\"t\":\"notify\",\"id\":1717002934,\"src\":\"Gmail\",\"title\":\"Build #4711 passed\",\"subject\":\"CI\","
+        "\"body\":\"All 312 tests "
+        "passed on main. Artifacts are available for download for the next 30 days.\",\"sender\":\"ci@example.com\"}",
+        "title",
+        "Build #4711 passed"
+    },
+    {
+        "notify (atob)",
+        "{\"t\":\"notify\",\"id\":1717002935,\"src\":\"Signal\",\"title\":atob(\"RGluZXJvIPCfjZU=\"),"
+        "\"body\":atob(\"U2VlIHlvdSBhdCBzZXZlbg==\"),"
+        "\"sender\":\"Anna\"}",
+        "title",
+        "Dinero \xf0\x9f\x8d\x95"
+    },
+    {
+        "notify-",
+        "{\"t\":\"notify-\",\"id\":1717002933}",
+        "t",
+        "notify-"
+    },
+    {
+        "weather",
+        "{\"t\":\"weather\",\"temp\":268,\"hi\":271,\"lo\":263,\"hum\":97,\"rain\":20,\"uv\":0,\"code\":802,"
+        "\"txt\":\"slightly cloudy\",\"wind\":2.0,\"wdir\":14,"
+        "\"loc\":\"MALMO\"}",
+        "txt",
+        "slightly cloudy",
+        "temp",
+        268
+    },
+    {
+        "musicinfo",
+        "{\"t\":\"musicinfo\",\"artist\":\"Ava Max\",\"album\":\"Heaven & Hell\",\"track\":\"Sweet but Psycho\","
+        "\"dur\":187,\"c\":-1,\"n\":-1}",
+        "track",
+        "Sweet but Psycho",
+        "c",
+        -1
+    },
+    {
+        "musicstate",
+        "{\"t\":\"musicstate\",\"state\":\"play\",\"position\":42,\"shuffle\":1,\"repeat\":1}",
+        "state",
+        "play",
+        "position",
+        42
+    },
+    {
+        "http",
+        "{\"t\":\"http\",\"id\":\"3\",\"resp\":\"{\\\"response_code\\\":0,\\\"results\\\":[{\\\"type\\\":"
+        "\\\"boolean\\\",\\\"difficulty\\\":\\\"easy\\\",\\\"category\\\":\\\"Geography\\\","
+        "\\\"question\\\":\\\"Hungary is the only country in the world beginning with H.\\\","
+        "\\\"correct_answer\\\":\\\"False\\\",\\\"incorrect_answers\\\":"
+        "[\\\"True\\\"]}]}\"}",
+        "resp",
+        "{\"response_code\":0,\"results\":[{\"type\":\"boolean\",\"difficulty\":\"easy\",\"category\":\"Geography\","
+        "\"question\":\"Hungary is the only country in the world beginning with H.\",\"correct_answer\":\"False\","
+        "\"incorrect_answers\":[\"True\"]}]}"
+    },
+    {
+        "gps",
+        "{\"t\":\"gps\",\"lat\":55.6135542,\"lon\":12.9747185,\"alt\":41.900001525878906,\"speed\":0.1458607256412506,"
+        "\"time\":1717002933835,\"satellites\":0,\"hdop\":16.215999603271484,\"externalSource\":true,"
+        "\"gpsSource\":\"network\"}",
+        "gpsSource",
+        "network"
+    },
+    {
+        "find",
+        "{\"t\":\"find\",\"n\":true}",
+        "t",
+        "find"
+    },
+};
+
+static const char *const message_types[] = {
+    "notify", "notify-", "weather", "musicinfo", "musicstate", "http", "gps", "log", "ver", "voice_memo",
+    "watchface_bg", "smp", "reset", "find",
+};
+
+static volatile uint32_t sink;
+
+static char *bytewise_strstr(const char *haystack, const char *needle)
+{
+    for (; *haystack; haystack++) {
+        const char *h = haystack;
+        const char *n = needle;
+
+        while (*n && *h == *n) {
+            h++;
+            n++;
+        }
+        if (*n == '\0') {
+            return (char *)haystack;
+        }
+    }
+
+    return NULL;
+}
+
+static char *(*old_strstr)(const char *haystack, const char *needle) = strstr;
+
+/* ---- Previous parser, copied from ble_gadgetbridge.c ---- */
+
+static uint8_t base64_dec_map[128];
+
+/* Copy of base64_decode() from Zephyr's lib/utils/base64.c, which decoded atob() values */
+static int base64_decode(uint8_t *dst, size_t dlen, size_t *olen, const uint8_t *src, size_t slen)
+{
+    size_t i, n;
+    uint32_t j, x;
+    uint8_t *p;
+
+    /* First pass: check for validity and get output length */
+    for (i = n = j = 0U; i < slen; i++) {
+        /* Skip spaces before checking for EOL */
+        x = 0U;
+        while (i < slen && src[i] == ' ') {
+            ++i;
+            ++x;
+        }
+
+        /* Spaces at end of buffer are OK */
+        if (i == slen) {
+            break;
+        }
+
+        if ((slen - i) >= 2 && src[i] == '\r' && src[i + 1] == '\n') {
+            continue;
+        }
+
+        if (src[i] == '\n') {
+            continue;
+        }
+
+        /* Space inside a line is an error */
+        if (x != 0U) {
+            return -EINVAL;
+        }
+
+        if (src[i] == '=' && ++j > 2) {
+            return -EINVAL;
+        }
+
+        if (src[i] > 127 || base64_dec_map[src[i]] == 127U) {
+            return -EINVAL;
+        }
+
+        if (base64_dec_map[src[i]] < 64 && j != 0U) {
+            return -EINVAL;
+        }
+
+        n++;
+    }
+
+    if (n == 0) {
+        *olen = 0;
+        return 0;
+    }
+
+    n = (6 * (n >> 3)) + ((6 * (n & 0x7) + 7) >> 3);
+    n -= j;
+
+    if (dst == NULL || dlen < n) {
+        *olen = n;
+        return -ENOMEM;
+    }
+
+    for (j = 3U, n = x = 0U, p = dst; i > 0; i--, src++) {
+        if (*src == '\r' || *src == '\n' || *src == ' ') {
+            continue;
+        }
+
+        j -= (base64_dec_map[*src] == 64U);
+        x = (x << 6) | (base64_dec_map[*src] & 0x3F);
+
+        if (++n == 4) {
+            n = 0;
+            if (j > 0) {
+                *p++ = (unsigned char)(x >> 16);
+            }
+            if (j > 1) {
+                *p++ = (unsigned char)(x >> 8);
+            }
+            if (j > 2) {
+                *p++ = (unsigned char)(x);
+            }
+        }
+    }
+
+    *olen = p - dst;
+
+    return 0;
+}
+
+static char *extract_value_str(char *key, char *data, int *value_len)
+{
+    bool base64 = false;
+    char *start;
+    char *end;
+    char *str = old_strstr(data, key);
+    *value_len = 0;
+    if (str == NULL) {
+        return NULL;
+    }
+    str += strlen(key);
+
+    if (strncmp(str, "atob(", strlen("atob(")) == 0) {
+        str += strlen("atob(");
+        base64 = true;
+    }
+
+    if (*str != '\"') {
+        return NULL;
+    }
+    str++;
+    if (*str == '\0') {
+        return NULL;
+    }
+    end = old_strstr(str, "\"");
+    if (end == NULL) {
+        return NULL;
+    }
+
+    start = str;
+    if (base64) {
+        size_t msg_size = end - start;
+        size_t decoded_len = 0;
+        base64_decode((uint8_t *)str, msg_size, &decoded_len, (uint8_t *)str, msg_size);
+        *value_len = decoded_len;
+    } else {
+        *value_len = end - start;
+    }
+
+    return start;
+}
+
+static uint32_t extract_value_uint32(char *key, char *data)
+{
+    char *str = old_strstr(data, key);
+
+    if (str == NULL) {
+        return 0;
+    }
+    str += strlen(key);
+    if (*str < '0' || *str > '9') {
+        return 0;
+    }
+    return strtol(str, NULL, 10);
+}
+
+static bool is_valid_utf8(const char *data, int len)
+{
+    int i = 0;
+    while (i < len && data[i] != '\0') {
+        if (data[i] == '\\' && i + 3 < len && data[i + 1] == 'x') {
+            return false;
+        }
+
+        uint8_t byte = (uint8_t)data[i];
+        if (byte <= 0x7F) {
+            i++;
+        } else if ((byte & 0xE0) == 0xC0) {
+            if (i + 1 >= len || ((uint8_t)data[i + 1] & 0xC0) != 0x80) {
+                return false;
+            }
+            i += 2;
+        } else if ((byte & 0xF0) == 0xE0) {
+            if (i + 2 >= len || ((uint8_t)data[i + 1] & 0xC0) != 0x80 || ((uint8_t)data[i + 2] & 0xC0) != 0x80) {
+                return false;
+            }
+            i += 3;
+        } else if ((byte & 0xF8) == 0xF0) {
+            if (i + 3 >= len || ((uint8_t)data[i + 1] & 0xC0) != 0x80 || ((uint8_t)data[i + 2] & 0xC0) != 0x80 ||
+                ((uint8_t)data[i + 3] & 0xC0) != 0x80) {
+                return false;
+            }
+            i += 4;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t latin1_table[0x80][3];
+
+static void convert_to_encoded_text(char *data, int len, char *out_data, int out_buf_len)
+{
+    int i = 0, j = 0;
+    // The original table is a 384 byte initialized local array, copied to the stack on every call
+    uint8_t basic_latin_utf16_to_utf8_table[0x80][3];
+    memcpy(basic_latin_utf16_to_utf8_table, latin1_table, sizeof(basic_latin_utf16_to_utf8_table));
+
+    while (data[i] != '\0' && i < len - 3 && j < out_buf_len - 3) {
+        if (data[i] == '\\' && data[i + 1] == 'x') {
+            char hex[3] = {data[i + 2], data[i + 3], '\0'};
+            int value = strtol(hex, NULL, 16);
+            if (value < 0x80) {
+                out_data[j] = value;
+            } else {
+                out_data[j] = basic_latin_utf16_to_utf8_table[value - 0x80][1];
+                j++;
+                out_data[j] = basic_latin_utf16_to_utf8_table[value - 0x80][2];
+                j++;
+            }
+            i += 4;
+        } else if ((uint8_t)data[i] >= 0x80) {
+            out_data[j] = basic_latin_utf16_to_utf8_table[(uint8_t)data[i] - 0x80][1];
+            j++;
+            out_data[j] = basic_latin_utf16_to_utf8_table[(uint8_t)data[i] - 0x80][2];
+            j++;
+            i++;
+        } else {
+            out_data[j] = data[i];
+            i++;
+            j++;
+        }
+    }
+    for (; i < len; i++) {
+        out_data[j] = data[i];
+        j++;
+    }
+    out_data[j] = '\0';
+}
+
+static void old_extract_fields(char *data, const char *const *str_keys, const char *const *int_keys)
+{
+    int len;
+
+    for (; *str_keys; str_keys++) {
+        char *value = extract_value_str((char *)*str_keys, data, &len);
+        sink += value ? len : 0;
+    }
+    for (; *int_keys; int_keys++) {
+        sink += extract_value_uint32((char *)*int_keys, data);
+    }
+}
+
+static int old_parse_data(char *data, int len)
+{
+    static const char *const notify_str[] = {"\"src\":", "\"sender\":", "\"title\":", "\"subject\":", "\"body\":",
+                                             NULL
+                                            };
+    static const char *const notify_int[] = {"\"id\":", NULL};
+    static const char *const weather_str[] = {"\"txt\":", NULL};
+    static const char *const weather_int[] = {"\"temp\":", "\"hum\":", "\"code\":", "\"wind\":", "\"wdir\":", NULL};
+    static const char *const musicinfo_str[] = {"\"artist\":", "\"album\":", "\"track\":", NULL};
+    static const char *const musicinfo_int[] = {"\"dur\":", "\"c\":", "\"n\":", NULL};
+    static const char *const musicstate_str[] = {"\"state\":", NULL};
+    static const char *const musicstate_int[] = {"\"position\":", "\"shuffle\":", "\"repeat\":", NULL};
+    static const char *const http_str[] = {"\"id\":", "\"err\":", "\"resp\":", NULL};
+    static const char *const gps_dbl[] = {"\"lat\":", "\"lon\":", "\"alt\":", "\"speed\":", "\"time\":",
+                                          "\"satellites\":", "\"hdop\":"
+                                         };
+    static const char *const none[] = {NULL};
+    char *value;
+    char input_data_utf8[MAX_GB_PACKET_LENGTH];
+    int type_len;
+    char *type;
+
+    if (!is_valid_utf8(data, len)) {
+        memset(input_data_utf8, 0, sizeof(input_data_utf8));
+        convert_to_encoded_text(data, len, input_data_utf8, sizeof(input_data_utf8));
+        data = input_data_utf8;
+    }
+
+    type = extract_value_str("\"t\":", data, &type_len);
+    if (type == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < sizeof(message_types) / sizeof(message_types[0]); i++) {
+        if (strlen(message_types[i]) == type_len && strncmp(type, message_types[i], type_len) == 0) {
+            switch (i) {
+                case 0:
+                    old_extract_fields(data, notify_str, notify_int);
+                    break;
+                case 1:
+                    old_extract_fields(data, none, notify_int);
+                    break;
+                case 2:
+                    old_extract_fields(data, weather_str, weather_int);
+                    break;
+                case 3:
+                    old_extract_fields(data, musicinfo_str, musicinfo_int);
+                    break;
+                case 4:
+                    old_extract_fields(data, musicstate_str, musicstate_int);
+                    break;
+                case 5:
+                    old_extract_fields(data, http_str, none);
+                    break;
+                case 6:
+                    // gps and find went through cJSON_Parse(), which also allocates a node per key.
+                    // Only locating and converting the values is timed, a lower bound.
+                    for (int k = 0; k < sizeof(gps_dbl) / sizeof(gps_dbl[0]); k++) {
+                        value = old_strstr(data, gps_dbl[k]);
+                        sink += value ? (uint32_t)strtod(value + strlen(gps_dbl[k]), NULL) : 0;
+                    }
+                    break;
+                case 13:
+                    value = old_strstr(data, "\"n\":");
+                    sink += value && strncmp(value + 4, "true", 4) == 0;
+                    break;
+                default:
+                    break;
+            }
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* ---- Tokenizer, same dispatch and fields as ble_gadgetbridge.c ---- */
+
+static uint8_t message_type_table[MESSAGE_TYPE_HASH_SIZE];
+
+static inline uint8_t message_type_hash(const char *type, size_t len)
+{
+    return (((uint8_t)type[0] << 1) ^ (uint8_t)type[len - 1] ^ (len << 1)) & (MESSAGE_TYPE_HASH_SIZE - 1);
+}
+
+static void new_get_fields(const gb_message_t *msg, const char *const *str_keys, const char *const *int_keys)
+{
+    int len;
+
+    for (; *str_keys; str_keys++) {
+        char *value = gb_message_get_str(msg, *str_keys, &len);
+        sink += value ? len : 0;
+    }
+    for (; *int_keys; int_keys++) {
+        sink += gb_message_get_uint32(msg, *int_keys);
+    }
+}
+
+static int new_parse_data(char *data, int len, gb_message_t *msg)
+{
+    static const char *const notify_str[] = {"src", "sender", "title", "subject", "body", NULL};
+    static const char *const notify_int[] = {"id", NULL};
+    static const char *const weather_str[] = {"txt", NULL};
+    static const char *const weather_int[] = {"temp", "hum", "code", "wind", "wdir", NULL};
+    static const char *const musicinfo_str[] = {"artist", "album", "track", NULL};
+    static const char *const musicinfo_int[] = {"dur", "c", "n", NULL};
+    static const char *const musicstate_str[] = {"state", NULL};
+    static const char *const musicstate_int[] = {"position", "shuffle", "repeat", NULL};
+    static const char *const http_str[] = {"id", "err", "resp", NULL};
+    static const char *const gps_dbl[] = {"lat", "lon", "alt", "speed", "time", "satellites", "hdop"};
+    static const char *const none[] = {NULL};
+    int type_len;
+    char *type;
+    uint8_t index;
+    bool find;
+
+    if (gb_tokenize(data, len, MAX_GB_PACKET_LENGTH, msg) != 0) {
+        return -1;
+    }
+
+    type = gb_message_get_str(msg, "t", &type_len);
+    if (type == NULL || type_len == 0) {
+        return -1;
+    }
+
+    index = message_type_table[message_type_hash(type, type_len)];
+    if (index == 0 || strcmp(message_types[index - 1], type) != 0) {
+        return -1;
+    }
+
+    switch (index - 1) {
+        case 0:
+            new_get_fields(msg, notify_str, notify_int);
+            break;
+        case 1:
+            new_get_fields(msg, none, notify_int);
+            break;
+        case 2:
+            new_get_fields(msg, weather_str, weather_int);
+            break;
+        case 3:
+            new_get_fields(msg, musicinfo_str, musicinfo_int);
+            break;
+        case 4:
+            new_get_fields(msg, musicstate_str, musicstate_int);
+            break;
+        case 5:
+            new_get_fields(msg, http_str, none);
+            break;
+        case 6:
+            for (int i = 0; i < sizeof(gps_dbl) / sizeof(gps_dbl[0]); i++) {
+                sink += (uint32_t)gb_message_get_double(msg, gps_dbl[i], -1);
+            }
+            break;
+        case 13:
+            sink += gb_message_get_bool(msg, "n", &find);
+            break;
+        default:
+            break;
+    }
+
+    return index - 1;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best of a few batches, to filter out scheduling noise. */
+static double time_parser(const bench_frame_t *frame, bool tokenizer, int iterations)
+{
+    static char buf[MAX_GB_PACKET_LENGTH];
+    gb_message_t msg;
+    int len = strlen(frame->frame);
+    int batch = iterations / BENCH_BATCHES;
+    double best = 0;
+
+    for (int b = 0; b < BENCH_BATCHES; b++) {
+        double start = now_ns();
+        double ns;
+
+        // Both parsers modify or depend on a fresh copy of the frame, so copy it in both loops.
+        for (int i = 0; i < batch; i++) {
+            memcpy(buf, frame->frame, len + 1);
+            sink += tokenizer ? new_parse_data(buf, len, &msg) : old_parse_data(buf, len);
+        }
+        ns = (now_ns() - start) / batch;
+        if (b == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    static char buf[MAX_GB_PACKET_LENGTH];
+    gb_message_t msg;
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    double old_libc_total = 0;
+    double old_bytewise_total = 0;
+    double new_total = 0;
+    int failures = 0;
+
+    // Same values as Zephyr's table: 127 invalid, 64 padding
+    memset(base64_dec_map, 127, sizeof(base64_dec_map));
+    for (int i = 0; i < 64; i++) {
+        base64_dec_map[(uint8_t)"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[i]] = i;
+    }
+    base64_dec_map['='] = 64;
+
+    for (int i = 0; i < 0x80; i++) {
+        latin1_table[i][0] = 0x80 + i;
+        latin1_table[i][1] = 0xC2 + (i >= 0x40);
+        latin1_table[i][2] = 0x80 + (i & 0x3F);
+    }
+
+    for (int i = 0; i < sizeof(message_types) / sizeof(message_types[0]); i++) {
+        uint8_t hash = message_type_hash(message_types[i], strlen(message_types[i]));
+        if (message_type_table[hash] != 0) {
+            printf("Hash collision for %s\n", message_types[i]);
+            return 1;
+        }
+        message_type_table[hash] = i + 1;
+    }
+
+    printf("%-16s %6s %12s %12s %12s %8s %8s\n", "frame", "bytes", "old (libc)", "old (byte)", "new",
+           "vs libc", "vs byte");
+
+    for (int f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+        const bench_frame_t *frame = &frames[f];
+        int len = strlen(frame->frame);
+        const char *value;
+        int value_len;
+        double old_libc_ns;
+        double old_bytewise_ns;
+        double new_ns;
+
+        memcpy(buf, frame->frame, len + 1);
+        if (new_parse_data(buf, len, &msg) < 0) {
+            printf("%s: failed to parse\n", frame->name);
+            failures++;
+            continue;
+        }
+        value = gb_message_get_str(&msg, frame->key, &value_len);
+        if (value == NULL || strcmp(value, frame->expected) != 0 || value_len != strlen(frame->expected)) {
+            printf("%s: unexpected %s: %s\n", frame->name, frame->key, value ? value : "(null)");
+            failures++;
+        }
+        if (frame->int_key != NULL && gb_message_get_int32(&msg, frame->int_key) != frame->int_expected) {
+            printf("%s: unexpected %s: %d\n", frame->name, frame->int_key, gb_message_get_int32(&msg, frame->int_key));
+            failures++;
+        }
+
+        old_strstr = strstr;
+        old_libc_ns = time_parser(frame, false, iterations);
+        old_strstr = bytewise_strstr;
+        old_bytewise_ns = time_parser(frame, false, iterations);
+        new_ns = time_parser(frame, true, iterations);
+
+        old_libc_total += old_libc_ns;
+        old_bytewise_total += old_bytewise_ns;
+        new_total += new_ns;
+        printf("%-16s %6d %12.0f %12.0f %12.0f %7.1fx %7.1fx\n", frame->name, len, old_libc_ns, old_bytewise_ns,
+               new_ns, old_libc_ns / new_ns, old_bytewise_ns / new_ns);
+    }
+
+    printf("%-16s %6s %12.0f %12.0f %12.0f %7.1fx %7.1fx\n", "total", "", old_libc_total, old_bytewise_total,
+           new_total, old_libc_total / new_total, old_bytewise_total / new_total);
+
+    return failures ? 1 : 0;
+}
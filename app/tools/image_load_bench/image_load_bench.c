@@ -0,0 +1,357 @@
+/*
+ * image_load_bench — host benchmark for compressed /S image assets.
+ *
+ * Loads every LVGL .bin image of two raw filesystem images made by
+ * create_custom_resource_image.py, one packed with --compress none and one
+ * with --compress rle or lz4, the way LVGL's bin decoder loads them on the
+ * watch:
+ *
+ *   - uncompressed images are read from flash line by line,
+ *   - compressed images are read as a whole and decompressed to RAM, with the
+ *     same decoders as CONFIG_LV_USE_RLE (a copy of lv_rle_decompress()) and
+ *     CONFIG_LV_USE_LZ4_INTERNAL (liblz4, the library LVGL bundles).
+ *
+ * Each decompressed image is checked against the uncompressed one. Prints the
+ * bytes read from flash and the load time per pass over the images. "Flash"
+ * is the image file in host RAM here, so the time is the CPU cost of the load,
+ * add bytes read / flash read speed for the time on target.
+ *
+ * Build and run:
+ *     python app/scripts/create_custom_resource_image.py --img-filename none.img app/src/images/binaries/S
+ *     python app/scripts/create_custom_resource_image.py --compress lz4 --img-filename lz4.img app/src/images/binaries/S
+ *     cmake -S app/tools/image_load_bench -B build_bench && cmake --build build_bench
+ *     ./build_bench/image_load_bench none.img lz4.img [rounds]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_FILE_NAME               32
+#define FILE_ENTRY_SIZE             (MAX_FILE_NAME + 8)
+#define TABLE_HEADER_SIZE           16
+#define TABLE_MAGIC                 0x0A0A0A0A
+
+#define LV_IMAGE_HEADER_MAGIC       0x19
+#define LV_IMAGE_HEADER_SIZE        12
+#define LV_IMAGE_COMPRESSED_SIZE    12
+#define LV_IMAGE_FLAGS_COMPRESSED   0x0008
+#define LV_IMAGE_COMPRESS_RLE       1
+#define LV_IMAGE_COMPRESS_LZ4       2
+
+// From lz4.h, declared here as only the shared library may be installed
+int LZ4_decompress_safe(const char *src, char *dst, int compressed_size, int dst_capacity);
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    uint32_t header_len;
+    uint32_t num_files;
+} raw_fs_t;
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+} fs_file_t;
+
+typedef struct {
+    uint32_t files;
+    uint64_t flash_bytes;
+    uint64_t ram_bytes;     // Largest decode buffer
+    double ns;
+} load_stats_t;
+
+static int raw_fs_load(raw_fs_t *fs, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    uint32_t magic;
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    fs->len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    fs->data = malloc(fs->len);
+    if (fs->data == NULL || fread(fs->data, 1, fs->len, f) != fs->len) {
+        fclose(f);
+        printf("%s: read failed\n", path);
+        return -1;
+    }
+    fclose(f);
+
+    memcpy(&magic, fs->data, 4);
+    memcpy(&fs->header_len, fs->data + 4, 4);
+    memcpy(&fs->num_files, fs->data + 12, 4);
+    if (magic != TABLE_MAGIC || fs->header_len > fs->len) {
+        printf("%s: not a raw filesystem image\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static const char *raw_fs_name(const raw_fs_t *fs, uint32_t index)
+{
+    return (const char *)fs->data + TABLE_HEADER_SIZE + index * FILE_ENTRY_SIZE;
+}
+
+static bool raw_fs_find(const raw_fs_t *fs, const char *name, fs_file_t *file)
+{
+    for (uint32_t i = 0; i < fs->num_files; i++) {
+        const uint8_t *entry = fs->data + TABLE_HEADER_SIZE + i * FILE_ENTRY_SIZE;
+        uint32_t offset;
+
+        if (strncmp((const char *)entry, name, MAX_FILE_NAME) == 0) {
+            memcpy(&offset, entry + MAX_FILE_NAME, 4);
+            memcpy(&file->len, entry + MAX_FILE_NAME + 4, 4);
+            file->data = fs->data + fs->header_len + offset;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint8_t bytes_per_pixel(uint8_t cf)
+{
+    switch (cf) {
+        case 0x12:  // RGB565
+        case 0x14:  // RGB565A8
+            return 2;
+        case 0x0F:  // RGB888
+            return 3;
+        case 0x10:  // ARGB8888
+        case 0x11:  // XRGB8888
+            return 4;
+        default:    // L8, A8
+            return 1;
+    }
+}
+
+/* Copy of lv_rle_decompress() from LVGL v9 */
+static uint32_t rle_decompress(const uint8_t *input, uint32_t input_buff_len, uint8_t *output,
+                               uint32_t output_buff_len, uint8_t blk_size)
+{
+    uint32_t ctrl_byte;
+    uint32_t rd_len = 0;
+    uint32_t wr_len = 0;
+
+    while (rd_len < input_buff_len) {
+        ctrl_byte = input[0];
+        rd_len++;
+        input++;
+        if (rd_len > input_buff_len) {
+            return 0;
+        }
+
+        if (ctrl_byte & 0x80) {
+            uint32_t bytes = blk_size * (ctrl_byte & 0x7f);
+            rd_len += bytes;
+            if (rd_len > input_buff_len) {
+                return 0;
+            }
+
+            wr_len += bytes;
+            if (wr_len > output_buff_len) {
+                if (wr_len > output_buff_len + blk_size) {
+                    return 0;
+                }
+                memcpy(output, input, output_buff_len - (wr_len - bytes));
+                return output_buff_len;
+            }
+
+            memcpy(output, input, bytes);
+            output += bytes;
+            input += bytes;
+        } else {
+            rd_len += blk_size;
+            if (rd_len > input_buff_len) {
+                return 0;
+            }
+
+            wr_len += blk_size * ctrl_byte;
+            if (wr_len > output_buff_len) {
+                if (wr_len > output_buff_len + blk_size) {
+                    return 0;
+                }
+                ctrl_byte = (output_buff_len - (wr_len - blk_size * ctrl_byte)) / blk_size;
+                wr_len = output_buff_len;
+            }
+
+            if (blk_size == 1) {
+                memset(output, input[0], ctrl_byte);
+                output += ctrl_byte;
+            } else {
+                for (uint32_t i = 0; i < ctrl_byte; i++) {
+                    memcpy(output, input, blk_size);
+                    output += blk_size;
+                }
+            }
+            input += blk_size;
+        }
+    }
+
+    return wr_len;
+}
+
+/* Loads file like LVGL's bin decoder does, returns the decoded pixel data or NULL */
+static const uint8_t *image_load(const fs_file_t *file, uint8_t *buf, uint8_t *line, load_stats_t *stats)
+{
+    uint16_t flags;
+    uint16_t stride;
+    uint32_t method;
+    uint32_t compressed_size;
+    uint32_t decompressed_size;
+    uint32_t decoded;
+
+    memcpy(buf, file->data, LV_IMAGE_HEADER_SIZE);
+    stats->flash_bytes += LV_IMAGE_HEADER_SIZE;
+    memcpy(&flags, buf + 2, 2);
+    memcpy(&stride, buf + 8, 2);
+
+    if (!(flags & LV_IMAGE_FLAGS_COMPRESSED)) {
+        // Lines are read when drawn, only into a line sized buffer. RGB565A8 has its alpha plane after the pixels.
+        for (uint32_t pos = LV_IMAGE_HEADER_SIZE; pos < file->len; pos += stride) {
+            uint32_t len = file->len - pos < stride ? file->len - pos : stride;
+
+            memcpy(line, file->data + pos, len);
+            stats->flash_bytes += len;
+        }
+        stats->ram_bytes = stats->ram_bytes > stride ? stats->ram_bytes : stride;
+        return line;
+    }
+
+    memcpy(&method, file->data + LV_IMAGE_HEADER_SIZE, 4);
+    memcpy(&compressed_size, file->data + LV_IMAGE_HEADER_SIZE + 4, 4);
+    memcpy(&decompressed_size, file->data + LV_IMAGE_HEADER_SIZE + 8, 4);
+
+    // The compressed data is read as a whole, then decoded into a buffer for the whole image
+    uint8_t *compressed = malloc(compressed_size);
+    memcpy(compressed, file->data + LV_IMAGE_HEADER_SIZE + LV_IMAGE_COMPRESSED_SIZE, compressed_size);
+    stats->flash_bytes += LV_IMAGE_COMPRESSED_SIZE + compressed_size;
+
+    if (method == LV_IMAGE_COMPRESS_RLE) {
+        decoded = rle_decompress(compressed, compressed_size, buf, decompressed_size, bytes_per_pixel(buf[1]));
+    } else if (method == LV_IMAGE_COMPRESS_LZ4) {
+        int ret = LZ4_decompress_safe((const char *)compressed, (char *)buf, compressed_size, decompressed_size);
+        decoded = ret < 0 ? 0 : ret;
+    } else {
+        decoded = 0;
+    }
+    free(compressed);
+
+    stats->ram_bytes = stats->ram_bytes > decompressed_size ? stats->ram_bytes : decompressed_size;
+    return decoded == decompressed_size ? buf : NULL;
+}
+
+static double time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bool is_compressed(const fs_file_t *file)
+{
+    uint16_t flags;
+
+    memcpy(&flags, file->data + 2, 2);
+    return flags & LV_IMAGE_FLAGS_COMPRESSED;
+}
+
+static void print_stats(const char *name, const load_stats_t *stats, uint32_t rounds)
+{
+    printf("%-22s %6u %12llu %12.0f %10llu\n", name, stats->files,
+           (unsigned long long)(stats->flash_bytes / rounds), stats->ns / rounds / 1000,
+           (unsigned long long)stats->ram_bytes);
+}
+
+int main(int argc, char **argv)
+{
+    raw_fs_t raw_fs;
+    raw_fs_t compressed_fs;
+    uint32_t rounds = 20;
+    load_stats_t all[2] = { 0 };
+    load_stats_t only_compressed[2] = { 0 };
+    uint8_t *buf;
+    uint8_t *line;
+
+    if (argc < 3) {
+        printf("Usage: %s <uncompressed.img> <compressed.img> [rounds]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 3) {
+        rounds = atoi(argv[3]) > 0 ? atoi(argv[3]) : 1;
+    }
+    if (raw_fs_load(&raw_fs, argv[1]) != 0 || raw_fs_load(&compressed_fs, argv[2]) != 0) {
+        return 1;
+    }
+
+    buf = malloc(raw_fs.len);
+    line = malloc(UINT16_MAX);
+
+    for (uint32_t i = 0; i < compressed_fs.num_files; i++) {
+        char name[MAX_FILE_NAME + 1] = { 0 };
+        fs_file_t files[2];
+        bool compressed;
+
+        strncpy(name, raw_fs_name(&compressed_fs, i), MAX_FILE_NAME);
+        if (!raw_fs_find(&compressed_fs, name, &files[1]) || files[1].len <= LV_IMAGE_HEADER_SIZE ||
+            files[1].data[0] != LV_IMAGE_HEADER_MAGIC) {
+            continue;
+        }
+        if (!raw_fs_find(&raw_fs, name, &files[0])) {
+            printf("%s: missing from %s\n", name, argv[1]);
+            return 1;
+        }
+
+        compressed = is_compressed(&files[1]);
+        if (compressed) {
+            load_stats_t check = { 0 };
+            const uint8_t *pixels = image_load(&files[1], buf, line, &check);
+
+            if (pixels == NULL || memcmp(pixels, files[0].data + LV_IMAGE_HEADER_SIZE,
+                                         files[0].len - LV_IMAGE_HEADER_SIZE) != 0) {
+                printf("%s: decompressed image differs\n", name);
+                return 1;
+            }
+        }
+
+        for (int j = 0; j < 2; j++) {
+            load_stats_t stats = { 0 };
+            double start = time_ns();
+
+            for (uint32_t round = 0; round < rounds; round++) {
+                image_load(&files[j], buf, line, &stats);
+            }
+            stats.ns = time_ns() - start;
+
+            all[j].files++;
+            all[j].flash_bytes += stats.flash_bytes;
+            all[j].ns += stats.ns;
+            all[j].ram_bytes = all[j].ram_bytes > stats.ram_bytes ? all[j].ram_bytes : stats.ram_bytes;
+            if (compressed) {
+                only_compressed[j].files++;
+                only_compressed[j].flash_bytes += stats.flash_bytes;
+                only_compressed[j].ns += stats.ns;
+                only_compressed[j].ram_bytes = only_compressed[j].ram_bytes > stats.ram_bytes ?
+                                               only_compressed[j].ram_bytes : stats.ram_bytes;
+            }
+        }
+    }
+
+    printf("%-22s %6s %12s %12s %10s\n", "images", "files", "flash bytes", "load us", "max buf");
+    print_stats("all, uncompressed", &all[0], rounds);
+    print_stats("all, compressed", &all[1], rounds);
+    print_stats("packed, uncompressed", &only_compressed[0], rounds);
+    print_stats("packed, compressed", &only_compressed[1], rounds);
+    printf("Partition: %zu -> %zu bytes\n", raw_fs.len, compressed_fs.len);
+
+    return 0;
+}
@@ -0,0 +1,699 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs app/src/ble/ble_ancs.c on the host against a simulated iPhone, to check the attribute request
+ * queue and measure how long a burst of notifications takes to reach the app:
+ *
+ *   ancs_host [-n notifications] [-i interval_ms] [-m mtu] [-f fetch_ms] [-l lost_uid] [-v]
+ *
+ * Time is simulated. The iPhone sends its GATT notifications in connection events every interval_ms,
+ * at most PACKETS_PER_EVENT per event, and a Control Point write is answered one event after it is sent.
+ * Requests are answered in order, each after fetch_ms. Responses are split into notifications of mtu - 3
+ * bytes and parsed like the NCS ANCS client does: one parse state for all responses, and every Control
+ * Point write sets the number of attributes the parser expects.
+ *
+ * On reconnect, iOS sends all notifications at once, this is the burst of the given size. The response
+ * to the first request for lost_uid is never sent, so it has to time out and be requested again.
+ * Every notification published on ble_comm_data_chan is checked against the one the iPhone sent.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "zephyr_shim.h"
+#include "ble/ble_ancs.h"
+#include "events/ble_event.h"
+
+#define PACKETS_PER_EVENT   4
+#define MAX_EVENTS          1024
+#define MAX_NOTIFS          64
+#define MAX_WORKS           4
+#define SIM_TIME_LIMIT_MS   60000
+#define MAX_PAYLOAD_LEN     244
+
+typedef enum {
+    EVENT_NS_NOTIF,     // Notification Source notification
+    EVENT_DS_NOTIF,     // Data Source notification, part of a response
+    EVENT_CP_RECEIVED,  // The iPhone received a Control Point write
+    EVENT_CP_RESPONSE,  // The write response for a Control Point write
+} event_type_t;
+
+typedef struct {
+    uint32_t time_ms;
+    uint32_t seq;
+    event_type_t type;
+    uint16_t len;
+    uint8_t data[MAX_PAYLOAD_LEN];
+} sim_event_t;
+
+struct bt_conn {
+    bt_addr_le_t addr;
+};
+
+struct bt_gatt_dm {
+    struct bt_conn *conn;
+};
+
+const struct zbus_channel ble_comm_data_chan;
+const struct bt_uuid bt_uuid_gatt;
+const struct bt_uuid bt_uuid_ancs;
+extern const struct bt_conn_cb conn_callbacks;
+
+static const char *const app_ids[] = {"com.apple.MobileSMS", "net.whatsapp.WhatsApp", "com.facebook.Messenger"};
+static const char *const app_names[] = {"Messages", "WhatsApp", "Messenger"};
+
+static struct bt_conn conn;
+static struct bt_ancs_client *client;
+static uint32_t now_ms;
+static sim_event_t events[MAX_EVENTS];
+static uint32_t num_events;
+static uint32_t event_seq;
+static struct k_work *works[MAX_WORKS];
+
+static uint32_t interval_ms = 30;
+static uint32_t payload_len = 182;
+static uint32_t fetch_ms = 20;
+static uint32_t num_notifs = 10;
+static uint32_t lost_uid = UINT32_MAX;
+
+// The iPhone side: the next free slot for a GATT notification and the time it is done with the last request
+static uint32_t tx_event_ms;
+static uint32_t tx_in_event;
+static uint32_t ios_busy_ms;
+
+static uint32_t notif_sent_ms[MAX_NOTIFS];
+static uint32_t notif_delivered[MAX_NOTIFS];
+static uint32_t num_wrong;
+static uint32_t num_unknown;
+static uint32_t latency_sum_ms;
+static uint32_t latency_max_ms;
+
+uint32_t k_uptime_get_32(void)
+{
+    return now_ms;
+}
+
+int k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout)
+{
+    if (mutex->locked) {
+        fprintf(stderr, "Mutex locked twice\n");
+        abort();
+    }
+    mutex->locked = true;
+    return 0;
+}
+
+int k_mutex_unlock(struct k_mutex *mutex)
+{
+    mutex->locked = false;
+    return 0;
+}
+
+// Work items run on the simulated clock, after the event that submitted them
+static void work_add(struct k_work *work, uint32_t due_ms)
+{
+    for (int i = 0; i < MAX_WORKS; i++) {
+        if (works[i] == NULL) {
+            works[i] = work;
+        }
+        if (works[i] == work) {
+            work->pending = true;
+            work->due_ms = due_ms;
+            return;
+        }
+    }
+    abort();
+}
+
+int k_work_submit(struct k_work *work)
+{
+    if (work->pending) {
+        return 0;
+    }
+    work_add(work, now_ms);
+    return 1;
+}
+
+int k_work_schedule(struct k_work_delayable *dwork, k_timeout_t delay)
+{
+    if (dwork->work.pending) {
+        return 0;
+    }
+    return k_work_reschedule(dwork, delay);
+}
+
+int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay)
+{
+    work_add(&dwork->work, now_ms + delay);
+    return 1;
+}
+
+int k_work_cancel_delayable(struct k_work_delayable *dwork)
+{
+    dwork->work.pending = false;
+    return 0;
+}
+
+struct bt_conn *bt_conn_ref(struct bt_conn *c)
+{
+    return c;
+}
+
+void bt_conn_unref(struct bt_conn *c)
+{
+}
+
+const bt_addr_le_t *bt_conn_get_dst(const struct bt_conn *c)
+{
+    return &c->addr;
+}
+
+bt_security_t bt_conn_get_security(const struct bt_conn *c)
+{
+    return BT_SECURITY_L2;
+}
+
+int bt_addr_le_to_str(const bt_addr_le_t *addr, char *str, size_t len)
+{
+    return snprintf(str, len, "iPhone");
+}
+
+// Only ANCS is found, on the first try
+int bt_gatt_dm_start(struct bt_conn *c, const struct bt_uuid *svc_uuid, const struct bt_gatt_dm_cb *cb,
+                     void *context)
+{
+    struct bt_gatt_dm dm = {.conn = c};
+
+    if (svc_uuid == BT_UUID_ANCS) {
+        cb->completed(&dm, context);
+    } else {
+        cb->service_not_found(c, context);
+    }
+    return 0;
+}
+
+struct bt_conn *bt_gatt_dm_conn_get(struct bt_gatt_dm *dm)
+{
+    return dm->conn;
+}
+
+size_t bt_gatt_dm_attr_cnt(const struct bt_gatt_dm *dm)
+{
+    return 0;
+}
+
+int bt_gatt_dm_data_release(struct bt_gatt_dm *dm)
+{
+    return 0;
+}
+
+int bt_gattp_init(struct bt_gattp *gattp)
+{
+    return 0;
+}
+
+int bt_gattp_handles_assign(struct bt_gatt_dm *dm, struct bt_gattp *gattp)
+{
+    return 0;
+}
+
+int bt_gattp_subscribe_service_changed(struct bt_gattp *gattp, bt_gattp_indicate_cb func)
+{
+    return 0;
+}
+
+static void event_add(uint32_t time_ms, event_type_t type, const void *data, uint16_t len)
+{
+    sim_event_t *event;
+
+    if (num_events == MAX_EVENTS || len > sizeof(event->data)) {
+        fprintf(stderr, "Simulation event queue full\n");
+        abort();
+    }
+    event = &events[num_events++];
+    event->time_ms = time_ms;
+    event->seq = event_seq++;
+    event->type = type;
+    event->len = len;
+    memcpy(event->data, data, len);
+}
+
+// Next connection event after time_ms
+static uint32_t next_conn_event(uint32_t time_ms)
+{
+    return (time_ms / interval_ms + 1) * interval_ms;
+}
+
+// Send a GATT notification from the iPhone in the first connection event from time_ms with room for it
+static uint32_t ios_notify(uint32_t time_ms, event_type_t type, const void *data, uint16_t len)
+{
+    uint32_t event_ms = (time_ms + interval_ms - 1) / interval_ms * interval_ms;
+
+    if (event_ms > tx_event_ms) {
+        tx_event_ms = event_ms;
+        tx_in_event = 0;
+    } else if (tx_in_event == PACKETS_PER_EVENT) {
+        tx_event_ms += interval_ms;
+        tx_in_event = 0;
+    }
+    tx_in_event++;
+    event_add(tx_event_ms, type, data, len);
+    return tx_event_ms;
+}
+
+static void ios_notif_source(uint32_t time_ms, uint32_t uid)
+{
+    uint8_t data[8] = {BT_ANCS_EVENT_ID_NOTIFICATION_ADDED, 0, 0, 1};
+
+    sys_put_le32(uid, &data[4]);
+    notif_sent_ms[uid] = ios_notify(time_ms, EVENT_NS_NOTIF, data, sizeof(data));
+}
+
+static size_t put_attr(uint8_t *buf, uint8_t attr_id, const char *value)
+{
+    size_t len = MIN(strlen(value), BT_ANCS_ATTR_DATA_MAX);
+
+    buf[0] = attr_id;
+    buf[1] = len;
+    buf[2] = 0;
+    memcpy(&buf[3], value, len);
+    return 3 + len;
+}
+
+static void notif_title(uint32_t uid, char *title, size_t size)
+{
+    snprintf(title, size, "Title %u", uid);
+}
+
+// Send a response on the Data Source, split into notifications
+static void ios_data_source(uint32_t time_ms, const uint8_t *data, size_t len)
+{
+    uint32_t sent_ms = time_ms;
+
+    for (size_t offset = 0; offset < len; offset += payload_len) {
+        sent_ms = ios_notify(time_ms, EVENT_DS_NOTIF, &data[offset], MIN(payload_len, len - offset));
+    }
+    ios_busy_ms = sent_ms;
+}
+
+static void ios_control_point(const uint8_t *request, uint16_t len)
+{
+    static bool lost;
+    uint8_t response[512];
+    char value[BT_ANCS_ATTR_DATA_MAX + 1];
+    size_t pos = 0;
+    uint32_t done_ms = MAX(now_ms, ios_busy_ms) + fetch_ms;
+
+    event_add(now_ms + interval_ms, EVENT_CP_RESPONSE, NULL, 0);
+
+    response[pos++] = request[0];
+    if (request[0] == BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES) {
+        uint32_t uid = sys_get_le32(&request[1]);
+        const char *app_id = app_ids[uid % ARRAY_SIZE(app_ids)];
+
+        if (uid == lost_uid && !lost) {
+            lost = true;
+            return;
+        }
+
+        memcpy(&response[pos], &request[1], 4);
+        pos += 4;
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_APP_IDENTIFIER, app_id);
+        notif_title(uid, value, sizeof(value));
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_TITLE, value);
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_SUBTITLE, "");
+        snprintf(value, sizeof(value), "Message body of notification %u", uid);
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_MESSAGE, value);
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_MESSAGE_SIZE, "32");
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_DATE, "20261016T101500");
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_POSITIVE_ACTION_LABEL, "");
+        pos += put_attr(&response[pos], BT_ANCS_NOTIF_ATTR_ID_NEGATIVE_ACTION_LABEL, "Clear");
+    } else {
+        const char *app_id = (const char *)&request[1];
+
+        strcpy((char *)&response[pos], app_id);
+        pos += strlen(app_id) + 1;
+        for (int i = 0; i < ARRAY_SIZE(app_ids); i++) {
+            if (strcmp(app_ids[i], app_id) == 0) {
+                pos += put_attr(&response[pos], BT_ANCS_APP_ATTR_ID_DISPLAY_NAME, app_names[i]);
+            }
+        }
+    }
+
+    ios_data_source(done_ms, response, pos);
+}
+
+/* ANCS client model */
+
+int bt_ancs_client_init(struct bt_ancs_client *ancs_c)
+{
+    memset(ancs_c, 0, sizeof(*ancs_c));
+    client = ancs_c;
+    return 0;
+}
+
+int bt_ancs_handles_assign(struct bt_gatt_dm *dm, struct bt_ancs_client *ancs_c)
+{
+    return 0;
+}
+
+int bt_ancs_register_attr(struct bt_ancs_client *ancs_c, uint8_t id, uint8_t *data, uint16_t len)
+{
+    ancs_c->notif_attrs[id] = (struct bt_ancs_attr_list) {
+        .get = true, .attr_data = data, .attr_len = len
+    };
+    return 0;
+}
+
+int bt_ancs_register_app_attr(struct bt_ancs_client *ancs_c, uint8_t id, uint8_t *data, uint16_t len)
+{
+    ancs_c->app_attrs[id] = (struct bt_ancs_attr_list) {
+        .get = true, .attr_data = data, .attr_len = len
+    };
+    return 0;
+}
+
+int bt_ancs_subscribe_notification_source(struct bt_ancs_client *ancs_c, bt_ancs_ns_notif_cb func)
+{
+    ancs_c->ns_notif_cb = func;
+    return 0;
+}
+
+int bt_ancs_subscribe_data_source(struct bt_ancs_client *ancs_c, bt_ancs_ds_notif_cb func)
+{
+    ancs_c->ds_notif_cb = func;
+    return 0;
+}
+
+static uint8_t count_attrs(const struct bt_ancs_attr_list *list, size_t count)
+{
+    uint8_t num = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        num += list[i].get;
+    }
+    return num;
+}
+
+static int cp_write(struct bt_ancs_client *ancs_c, const uint8_t *data, uint16_t len, uint8_t expected_attrs,
+                    bt_ancs_write_cb func)
+{
+    if (ancs_c->cp_write_pending) {
+        return -EBUSY;
+    }
+    ancs_c->cp_write_pending = true;
+    ancs_c->write_cb = func;
+    // Like the NCS client, whatever response the parser is in
+    ancs_c->expected_attrs = expected_attrs;
+    event_add(next_conn_event(now_ms), EVENT_CP_RECEIVED, data, len);
+    return 0;
+}
+
+int bt_ancs_request_attrs(struct bt_ancs_client *ancs_c, const struct bt_ancs_evt_notif *notif,
+                          bt_ancs_write_cb func)
+{
+    uint8_t data[5] = {BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES};
+
+    sys_put_le32(notif->notif_uid, &data[1]);
+    return cp_write(ancs_c, data, sizeof(data), count_attrs(ancs_c->notif_attrs, BT_ANCS_NOTIF_ATTR_COUNT), func);
+}
+
+int bt_ancs_request_app_attr(struct bt_ancs_client *ancs_c, const uint8_t *app_id, uint32_t len,
+                             bt_ancs_write_cb func)
+{
+    uint8_t data[1 + BT_ANCS_ATTR_DATA_MAX + 1] = {BT_ANCS_COMMAND_ID_GET_APP_ATTRIBUTES};
+
+    memcpy(&data[1], app_id, MIN(len, BT_ANCS_ATTR_DATA_MAX));
+    return cp_write(ancs_c, data, 2 + MIN(len, BT_ANCS_ATTR_DATA_MAX),
+                    count_attrs(ancs_c->app_attrs, BT_ANCS_APP_ATTR_COUNT), func);
+}
+
+static void parse_attr_done(struct bt_ancs_client *ancs_c)
+{
+    ancs_c->ds_notif_cb(ancs_c, &ancs_c->response);
+    ancs_c->expected_attrs--;
+    ancs_c->parse_state = ancs_c->expected_attrs == 0 ? ANCS_PARSE_COMMAND_ID : ANCS_PARSE_ATTR_ID;
+}
+
+static void parse_data_source(struct bt_ancs_client *ancs_c, const uint8_t *data, uint16_t len)
+{
+    static uint8_t unused[BT_ANCS_ATTR_DATA_MAX];
+    struct bt_ancs_attr_response *response = &ancs_c->response;
+    const struct bt_ancs_attr_list *attr;
+
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+
+        switch (ancs_c->parse_state) {
+            case ANCS_PARSE_COMMAND_ID:
+                response->command_id = byte;
+                ancs_c->field_index = 0;
+                response->notif_uid = 0;
+                ancs_c->parse_state = byte == BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES ? ANCS_PARSE_NOTIF_UID :
+                                      ANCS_PARSE_APP_ID;
+                break;
+
+            case ANCS_PARSE_NOTIF_UID:
+                response->notif_uid |= (uint32_t)byte << (8 * ancs_c->field_index++);
+                if (ancs_c->field_index == 4) {
+                    ancs_c->parse_state = ANCS_PARSE_ATTR_ID;
+                }
+                break;
+
+            case ANCS_PARSE_APP_ID:
+                if (ancs_c->field_index < sizeof(response->app_id) - 1) {
+                    response->app_id[ancs_c->field_index++] = byte;
+                }
+                if (byte == '\0') {
+                    response->app_id[ancs_c->field_index] = '\0';
+                    ancs_c->parse_state = ANCS_PARSE_ATTR_ID;
+                }
+                break;
+
+            case ANCS_PARSE_ATTR_ID:
+                response->attr.attr_id = byte;
+                ancs_c->field_index = 0;
+                ancs_c->attr_len = 0;
+                ancs_c->parse_state = ANCS_PARSE_ATTR_LEN;
+                break;
+
+            case ANCS_PARSE_ATTR_LEN:
+                ancs_c->attr_len |= byte << (8 * ancs_c->field_index++);
+                if (ancs_c->field_index < 2) {
+                    break;
+                }
+                attr = response->command_id == BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES ?
+                       &ancs_c->notif_attrs[response->attr.attr_id % BT_ANCS_NOTIF_ATTR_COUNT] : &ancs_c->app_attrs[0];
+                response->attr.attr_data = attr->attr_data ? attr->attr_data : unused;
+                response->attr.attr_len = 0;
+                response->attr.attr_data[0] = '\0';
+                ancs_c->field_index = 0;
+                if (ancs_c->attr_len == 0) {
+                    parse_attr_done(ancs_c);
+                } else {
+                    ancs_c->parse_state = ANCS_PARSE_ATTR_DATA;
+                }
+                break;
+
+            case ANCS_PARSE_ATTR_DATA:
+                if (ancs_c->field_index < BT_ANCS_ATTR_DATA_MAX - 1) {
+                    response->attr.attr_data[ancs_c->field_index] = byte;
+                    response->attr.attr_data[ancs_c->field_index + 1] = '\0';
+                    response->attr.attr_len = ancs_c->field_index + 1;
+                }
+                if (++ancs_c->field_index == ancs_c->attr_len) {
+                    parse_attr_done(ancs_c);
+                }
+                break;
+        }
+    }
+}
+
+/* Checks every notification the ANCS client publishes */
+
+int zbus_chan_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout)
+{
+    const struct ble_data_event *evt = msg;
+    const ble_comm_notify_t *notify = &evt->data.data.notify;
+    char title[BT_ANCS_ATTR_DATA_MAX];
+    const char *app_id;
+    const char *name;
+    uint32_t latency_ms;
+    bool ok;
+
+    if (evt->data.type != BLE_COMM_DATA_TYPE_NOTIFY) {
+        return 0;
+    }
+
+    if (notify->id >= num_notifs) {
+        fprintf(stderr, "[%6u] Unknown notification %u\n", now_ms, notify->id);
+        num_unknown++;
+        return 0;
+    }
+
+    app_id = app_ids[notify->id % ARRAY_SIZE(app_ids)];
+    name = app_names[notify->id % ARRAY_SIZE(app_ids)];
+    notif_title(notify->id, title, sizeof(title));
+    ok = notify->title != NULL && notify->title_len == strlen(title) &&
+         memcmp(notify->title, title, notify->title_len) == 0 && notify->src != NULL &&
+         (strcmp(notify->src, name) == 0 || strcmp(notify->src, strrchr(app_id, '.') + 1) == 0);
+    if (!ok) {
+        fprintf(stderr, "[%6u] Wrong attributes for notification %u: title %.*s, source %s\n", now_ms, notify->id,
+                notify->title_len, notify->title ? notify->title : "", notify->src ? notify->src : "");
+        num_wrong++;
+        return 0;
+    }
+
+    if (notif_delivered[notify->id]++ == 0) {
+        latency_ms = now_ms - notif_sent_ms[notify->id];
+        latency_sum_ms += latency_ms;
+        latency_max_ms = MAX(latency_max_ms, latency_ms);
+        if (log_verbose) {
+            fprintf(stderr, "[%6u] Notification %u from %s after %u ms\n", now_ms, notify->id, notify->src, latency_ms);
+        }
+    }
+    return 0;
+}
+
+/* Simulation */
+
+static void event_run(const sim_event_t *event)
+{
+    struct bt_ancs_evt_notif notif;
+
+    switch (event->type) {
+        case EVENT_NS_NOTIF:
+            notif = (struct bt_ancs_evt_notif) {
+                .evt_id = event->data[0],
+                .category_count = event->data[3],
+                .notif_uid = sys_get_le32(&event->data[4]),
+            };
+            client->ns_notif_cb(client, 0, &notif);
+            break;
+
+        case EVENT_DS_NOTIF:
+            parse_data_source(client, event->data, event->len);
+            break;
+
+        case EVENT_CP_RECEIVED:
+            ios_control_point(event->data, event->len);
+            break;
+
+        case EVENT_CP_RESPONSE:
+            client->cp_write_pending = false;
+            client->write_cb(client, 0);
+            break;
+    }
+}
+
+// Run the next event or work item, false when there is nothing left
+static bool sim_step(void)
+{
+    sim_event_t event;
+    struct k_work *work = NULL;
+    int next = -1;
+
+    for (uint32_t i = 0; i < num_events; i++) {
+        if (next < 0 || events[i].time_ms < events[next].time_ms ||
+            (events[i].time_ms == events[next].time_ms && events[i].seq < events[next].seq)) {
+            next = i;
+        }
+    }
+    for (int i = 0; i < MAX_WORKS && works[i] != NULL; i++) {
+        if (works[i]->pending && (work == NULL || works[i]->due_ms < work->due_ms)) {
+            work = works[i];
+        }
+    }
+
+    if (work != NULL && (next < 0 || work->due_ms <= events[next].time_ms)) {
+        now_ms = MAX(now_ms, work->due_ms);
+        work->pending = false;
+        work->handler(work);
+        return true;
+    }
+    if (next < 0) {
+        return false;
+    }
+
+    event = events[next];
+    events[next] = events[--num_events];
+    now_ms = MAX(now_ms, event.time_ms);
+    event_run(&event);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t delivered = 0;
+    uint32_t duplicates = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:i:m:f:l:v")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_notifs = MIN(strtoul(optarg, NULL, 0), MAX_NOTIFS);
+                break;
+            case 'i':
+                interval_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                payload_len = MIN(MAX(strtoul(optarg, NULL, 0), 23) - 3, MAX_PAYLOAD_LEN);
+                break;
+            case 'f':
+                fetch_ms = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                lost_uid = strtoul(optarg, NULL, 0);
+                break;
+            case 'v':
+                log_verbose = true;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n notifications] [-i interval_ms] [-m mtu] [-f fetch_ms] "
+                        "[-l lost_uid] [-v]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if (ble_ancs_init() != 0) {
+        return 1;
+    }
+    conn_callbacks.connected(&conn, 0);
+    conn_callbacks.security_changed(&conn, BT_SECURITY_L2, BT_SECURITY_ERR_SUCCESS);
+
+    for (uint32_t uid = 0; uid < num_notifs; uid++) {
+        ios_notif_source(0, uid);
+    }
+
+    while (now_ms < SIM_TIME_LIMIT_MS && sim_step()) {
+    }
+
+    for (uint32_t uid = 0; uid < num_notifs; uid++) {
+        delivered += notif_delivered[uid] > 0;
+        duplicates += notif_delivered[uid] > 1 ? notif_delivered[uid] - 1 : 0;
+    }
+
+    printf("Delivered %u/%u notifications, %u wrong, %u unknown, %u duplicate\n", delivered, num_notifs, num_wrong,
+           num_unknown, duplicates);
+    printf("Latency avg %u ms, max %u ms, burst done after %u ms\n", delivered ? latency_sum_ms / delivered : 0,
+           latency_max_ms, now_ms);
+
+    return (delivered == num_notifs && num_wrong == 0 && num_unknown == 0 && duplicates == 0) ? 0 : 1;
+}
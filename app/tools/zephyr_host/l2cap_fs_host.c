@@ -0,0 +1,374 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs app/src/ble/zsw_l2cap_file_server.c on the host, so the protocol can be tested without a watch:
+ *
+ *   l2cap_fs_host <socket> <root>
+ *   python3 app/scripts/l2cap_file_transfer.py --unix <socket> test
+ *
+ * Each connection to the Unix SOCK_SEQPACKET socket is an L2CAP channel carrying one SDU per packet,
+ * with TX MTU CONFIG_ZSW_L2CAP_FILE_SERVER_MTU. A new SDU is only read when the server has a free RX
+ * buffer, like credits on a real channel. Paths are opened below root, e.g. <root>/user/file.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "zephyr_shim.h"
+#include "ble/ble_comm.h"
+#include "ble/zsw_l2cap_file_server.h"
+#include "drivers/zsw_display_control.h"
+
+struct bt_conn {
+    int fd;
+};
+
+static struct bt_conn conn = {.fd = -1};
+static pthread_mutex_t conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct bt_l2cap_server *registered_server;
+static const char *root_dir;
+
+// Signalled when any buffer is freed, the reader waits on it for RX buffers
+static pthread_mutex_t buf_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t buf_freed = PTHREAD_COND_INITIALIZER;
+static uint32_t bufs_freed;
+
+uint32_t k_uptime_get_32(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static void deadline_from_timeout(struct timespec *ts, k_timeout_t timeout)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout / 1000;
+    ts->tv_nsec += (timeout % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+void k_fifo_put(struct k_fifo *fifo, void *data)
+{
+    pthread_mutex_lock(&fifo->lock);
+    *(void **)data = NULL;
+    if (fifo->tail) {
+        *(void **)fifo->tail = data;
+    } else {
+        fifo->head = data;
+    }
+    fifo->tail = data;
+    pthread_cond_signal(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+}
+
+void *k_fifo_get(struct k_fifo *fifo, k_timeout_t timeout)
+{
+    void *data;
+
+    pthread_mutex_lock(&fifo->lock);
+    fifo->cancel = false;
+    while (fifo->head == NULL && timeout != K_NO_WAIT && !fifo->cancel) {
+        pthread_cond_wait(&fifo->cond, &fifo->lock);
+    }
+    fifo->cancel = false;
+
+    data = fifo->head;
+    if (data) {
+        fifo->head = *(void **)data;
+        if (fifo->head == NULL) {
+            fifo->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&fifo->lock);
+
+    return data;
+}
+
+void k_fifo_cancel_wait(struct k_fifo *fifo)
+{
+    pthread_mutex_lock(&fifo->lock);
+    fifo->cancel = true;
+    pthread_cond_broadcast(&fifo->cond);
+    pthread_mutex_unlock(&fifo->lock);
+}
+
+struct net_buf *net_buf_alloc(struct net_buf_pool *pool, k_timeout_t timeout)
+{
+    struct net_buf *buf = NULL;
+    struct timespec deadline;
+    int ret = 0;
+
+    deadline_from_timeout(&deadline, timeout);
+
+    pthread_mutex_lock(&buf_lock);
+    while (pool->free_count == 0 && timeout != K_NO_WAIT && ret == 0) {
+        if (timeout == K_FOREVER) {
+            pthread_cond_wait(&buf_freed, &buf_lock);
+        } else {
+            ret = pthread_cond_timedwait(&buf_freed, &buf_lock, &deadline);
+        }
+    }
+    if (pool->free_count > 0) {
+        pool->free_count--;
+        buf = calloc(1, sizeof(*buf) + pool->data_size);
+        buf->pool = pool;
+        buf->data = buf->__buf;
+        buf->size = pool->data_size;
+    }
+    pthread_mutex_unlock(&buf_lock);
+
+    return buf;
+}
+
+void net_buf_unref(struct net_buf *buf)
+{
+    pthread_mutex_lock(&buf_lock);
+    buf->pool->free_count++;
+    bufs_freed++;
+    free(buf);
+    pthread_cond_broadcast(&buf_freed);
+    pthread_mutex_unlock(&buf_lock);
+}
+
+int bt_l2cap_server_register(struct bt_l2cap_server *server)
+{
+    registered_server = server;
+    return 0;
+}
+
+int bt_l2cap_chan_send(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+    ssize_t sent = -1;
+
+    // Blocks while the client isn't reading, like waiting for credits
+    pthread_mutex_lock(&conn_lock);
+    if (conn.fd >= 0) {
+        sent = send(conn.fd, buf->data, buf->len, MSG_NOSIGNAL);
+    }
+    pthread_mutex_unlock(&conn_lock);
+
+    if (sent != buf->len) {
+        return -ENOTCONN;
+    }
+
+    net_buf_unref(buf);
+    return 0;
+}
+
+int bt_l2cap_chan_recv_complete(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+    net_buf_unref(buf);
+    return 0;
+}
+
+int ble_comm_set_short_connection_interval(void)
+{
+    return 0;
+}
+
+int ble_comm_set_default_connection_interval(void)
+{
+    return 0;
+}
+
+int zsw_display_control_block_render(void)
+{
+    return 0;
+}
+
+int zsw_display_control_unblock_render(void)
+{
+    return 0;
+}
+
+static void host_path(const char *path, char *out)
+{
+    snprintf(out, PATH_MAX, "%s%s", root_dir, path);
+}
+
+int fs_stat(const char *path, struct fs_dirent *entry)
+{
+    char full[PATH_MAX];
+    struct stat st;
+
+    host_path(path, full);
+    if (stat(full, &st) != 0) {
+        return -errno;
+    }
+    entry->size = st.st_size;
+
+    return 0;
+}
+
+int fs_open(struct fs_file_t *zfp, const char *path, int flags)
+{
+    char full[PATH_MAX];
+    int oflags = (flags & FS_O_WRITE) ? O_RDWR : O_RDONLY;
+
+    if (flags & FS_O_CREATE) {
+        oflags |= O_CREAT;
+    }
+
+    host_path(path, full);
+    zfp->fd = open(full, oflags, 0644);
+
+    return zfp->fd < 0 ? -errno : 0;
+}
+
+int fs_close(struct fs_file_t *zfp)
+{
+    int ret = close(zfp->fd);
+
+    zfp->fd = -1;
+    return ret < 0 ? -errno : 0;
+}
+
+int fs_seek(struct fs_file_t *zfp, off_t offset, int whence)
+{
+    return lseek(zfp->fd, offset, whence) < 0 ? -errno : 0;
+}
+
+int fs_truncate(struct fs_file_t *zfp, off_t length)
+{
+    return ftruncate(zfp->fd, length) < 0 ? -errno : 0;
+}
+
+ssize_t fs_read(struct fs_file_t *zfp, void *ptr, size_t size)
+{
+    ssize_t ret = read(zfp->fd, ptr, size);
+
+    return ret < 0 ? -errno : ret;
+}
+
+ssize_t fs_write(struct fs_file_t *zfp, const void *ptr, size_t size)
+{
+    ssize_t ret = write(zfp->fd, ptr, size);
+
+    return ret < 0 ? -errno : ret;
+}
+
+static void run_channel(int fd)
+{
+    struct bt_l2cap_chan *chan;
+    struct bt_l2cap_le_chan *le;
+    struct net_buf *buf;
+    uint32_t freed;
+    ssize_t len;
+
+    // The server refuses a channel until it has handled the last disconnect, retry like a phone would
+    for (int tries = 0; registered_server->accept(&conn, registered_server, &chan) != 0; tries++) {
+        if (tries == 100) {
+            fprintf(stderr, "Channel rejected\n");
+            close(fd);
+            return;
+        }
+        usleep(10000);
+    }
+
+    pthread_mutex_lock(&conn_lock);
+    conn.fd = fd;
+    pthread_mutex_unlock(&conn_lock);
+
+    le = (struct bt_l2cap_le_chan *)chan;
+    le->tx.mtu = CONFIG_ZSW_L2CAP_FILE_SERVER_MTU;
+    chan->conn = &conn;
+    chan->ops->connected(chan);
+
+    while (true) {
+        while (true) {
+            pthread_mutex_lock(&buf_lock);
+            freed = bufs_freed;
+            pthread_mutex_unlock(&buf_lock);
+
+            buf = chan->ops->alloc_buf(chan);
+            if (buf) {
+                break;
+            }
+
+            pthread_mutex_lock(&buf_lock);
+            while (freed == bufs_freed) {
+                pthread_cond_wait(&buf_freed, &buf_lock);
+            }
+            pthread_mutex_unlock(&buf_lock);
+        }
+
+        len = recv(fd, buf->data, buf->size, 0);
+        if (len <= 0) {
+            net_buf_unref(buf);
+            break;
+        }
+        buf->len = len;
+
+        if (chan->ops->recv(chan, buf) != -EINPROGRESS) {
+            net_buf_unref(buf);
+        }
+    }
+
+    pthread_mutex_lock(&conn_lock);
+    conn.fd = -1;
+    close(fd);
+    pthread_mutex_unlock(&conn_lock);
+    chan->ops->disconnected(chan);
+}
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    int listen_fd;
+    int fd;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <socket> <root>\n", argv[0]);
+        return 1;
+    }
+    root_dir = argv[2];
+
+    if (zsw_l2cap_file_server_init() != 0) {
+        return 1;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+    unlink(addr.sun_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 1) != 0) {
+        perror("socket");
+        return 1;
+    }
+
+    printf("Listening on %s\n", addr.sun_path);
+    fflush(stdout);
+
+    while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        run_channel(fd);
+    }
+
+    perror("accept");
+    return 1;
+}
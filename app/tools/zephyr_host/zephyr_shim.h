@@ -0,0 +1,535 @@
+/*
+ * This file is part of ZSWatch project <https://github.com/zswatch/>.
+ * Copyright (c) 2026 ZSWatch Project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * The parts of the Zephyr API used by the ZSWatch sources that run in the host programs of this directory.
+ * Every zephyr/ header in this directory includes this one.
+ *
+ * Kernel objects and the Bluetooth stack are implemented by each host program, the way its test needs them:
+ * l2cap_fs_host.c runs threads on the real clock, ancs_host.c runs everything in one thread on a simulated
+ * clock, so its mutex only checks it is never taken twice. Everything else is in zephyr_shim.c.
+ *
+ * This is not the Zephyr implementation, only the protocol logic of the sources is tested here. How they
+ * work with the real host stack needs a Bluetooth controller, see TestNativeSimBLE in test_native_app.py.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define ARG_UNUSED(x)       (void)(x)
+#define ARRAY_SIZE(array)   (sizeof(array) / sizeof((array)[0]))
+#define MIN(a, b)           (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)           (((a) > (b)) ? (a) : (b))
+
+/* Kernel */
+
+typedef int32_t k_timeout_t;
+
+#define K_NO_WAIT       0
+#define K_FOREVER       (-1)
+#define K_MSEC(ms)      (ms)
+
+#define K_LOWEST_APPLICATION_THREAD_PRIO    0
+
+uint32_t k_uptime_get_32(void);
+
+typedef atomic_long atomic_t;
+
+#define ATOMIC_INIT(i)  (i)
+
+static inline bool atomic_cas(atomic_t *target, long old_value, long new_value)
+{
+    return atomic_compare_exchange_strong(target, &old_value, new_value);
+}
+
+static inline long atomic_set(atomic_t *target, long value)
+{
+    return atomic_exchange(target, value);
+}
+
+static inline long atomic_get(atomic_t *target)
+{
+    return atomic_load(target);
+}
+
+static inline bool atomic_test_bit(const atomic_t *target, int bit)
+{
+    return (atomic_load(target) >> bit) & 1;
+}
+
+static inline bool atomic_test_and_set_bit(atomic_t *target, int bit)
+{
+    return (atomic_fetch_or(target, 1L << bit) >> bit) & 1;
+}
+
+static inline bool atomic_test_and_clear_bit(atomic_t *target, int bit)
+{
+    return (atomic_fetch_and(target, ~(1L << bit)) >> bit) & 1;
+}
+
+static inline void atomic_set_bit(atomic_t *target, int bit)
+{
+    atomic_fetch_or(target, 1L << bit);
+}
+
+static inline void atomic_clear_bit(atomic_t *target, int bit)
+{
+    atomic_fetch_and(target, ~(1L << bit));
+}
+
+struct k_fifo {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    void *head;
+    void *tail;
+    bool cancel;
+};
+
+#define K_FIFO_DEFINE(name)                                                                                     \
+    struct k_fifo name = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER}
+
+void k_fifo_put(struct k_fifo *fifo, void *data);
+void *k_fifo_get(struct k_fifo *fifo, k_timeout_t timeout);
+void k_fifo_cancel_wait(struct k_fifo *fifo);
+
+// Started when the program starts, like a thread with no delay
+#define K_THREAD_DEFINE(name, stack_size, entry, p1, p2, p3, prio, options, delay)                              \
+    static void *name##_start(void *arg)                                                                        \
+    {                                                                                                           \
+        entry(p1, p2, p3);                                                                                      \
+        return NULL;                                                                                            \
+    }                                                                                                           \
+    __attribute__((constructor)) static void name##_create(void)                                                \
+    {                                                                                                           \
+        pthread_t tid;                                                                                          \
+        pthread_create(&tid, NULL, name##_start, NULL);                                                         \
+    }                                                                                                           \
+    const int name = 0
+
+struct k_mutex {
+    bool locked;
+};
+
+#define K_MUTEX_DEFINE(name)    struct k_mutex name
+
+int k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout);
+int k_mutex_unlock(struct k_mutex *mutex);
+
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work *work);
+
+struct k_work {
+    k_work_handler_t handler;
+    bool pending;
+    uint32_t due_ms;
+};
+
+struct k_work_delayable {
+    struct k_work work;
+};
+
+#define K_WORK_DEFINE(name, work_handler)                                                                       \
+    struct k_work name = {.handler = (work_handler)}
+
+#define K_WORK_DELAYABLE_DEFINE(name, work_handler)                                                             \
+    struct k_work_delayable name = {.work = {.handler = (work_handler)}}
+
+int k_work_submit(struct k_work *work);
+int k_work_schedule(struct k_work_delayable *dwork, k_timeout_t delay);
+int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay);
+int k_work_cancel_delayable(struct k_work_delayable *dwork);
+
+static inline bool k_work_delayable_is_pending(const struct k_work_delayable *dwork)
+{
+    return dwork->work.pending;
+}
+
+/* Logging, debug messages are only printed when a host program sets log_verbose */
+
+#define LOG_MODULE_REGISTER(name, level)    static const char *log_module_name = #name
+
+extern bool log_verbose;
+
+#define LOG_PRINT(level, fmt, ...)                                                                              \
+    fprintf(stderr, "[%6u] <%s> %s: " fmt "\n", k_uptime_get_32(), level, log_module_name, ##__VA_ARGS__)
+#define LOG_ERR(fmt, ...)   LOG_PRINT("err", fmt, ##__VA_ARGS__)
+#define LOG_WRN(fmt, ...)   LOG_PRINT("wrn", fmt, ##__VA_ARGS__)
+#define LOG_INF(fmt, ...)   LOG_PRINT("inf", fmt, ##__VA_ARGS__)
+#define LOG_DBG(fmt, ...)                                                                                       \
+    do {                                                                                                        \
+        if (log_verbose) {                                                                                      \
+            LOG_PRINT("dbg", fmt, ##__VA_ARGS__);                                                               \
+        }                                                                                                       \
+    } while (0)
+
+/* Byte order and CRC */
+
+static inline void sys_put_le32(uint32_t val, uint8_t dst[4])
+{
+    dst[0] = val;
+    dst[1] = val >> 8;
+    dst[2] = val >> 16;
+    dst[3] = val >> 24;
+}
+
+static inline uint32_t sys_get_le32(const uint8_t src[4])
+{
+    return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+uint32_t crc32_ieee(const uint8_t *data, size_t len);
+
+/* zbus, publications are checked by the host program */
+
+struct zbus_channel {
+    int unused;
+};
+
+#define ZBUS_CHAN_DECLARE(name)     extern const struct zbus_channel name
+
+int zbus_chan_pub(const struct zbus_channel *chan, const void *msg, k_timeout_t timeout);
+
+/* Network buffers, one contiguous allocation per buffer */
+
+struct net_buf_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int free_count;
+    size_t data_size;
+};
+
+struct net_buf {
+    void *fifo_next;    // Link for k_fifo, like the reserved first word of a Zephyr net_buf
+    struct net_buf_pool *pool;
+    uint8_t *data;
+    uint16_t len;
+    uint16_t size;
+    uint8_t __buf[];
+};
+
+#define NET_BUF_POOL_DEFINE(name, count, data_size_, user_data_size, destroy)                                   \
+    struct net_buf_pool name = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER,           \
+                                .free_count = (count), .data_size = (data_size_)}
+
+struct net_buf *net_buf_alloc(struct net_buf_pool *pool, k_timeout_t timeout);
+void net_buf_unref(struct net_buf *buf);
+
+static inline void net_buf_reserve(struct net_buf *buf, size_t reserve)
+{
+    buf->data = buf->__buf + reserve;
+}
+
+static inline void *net_buf_add_mem(struct net_buf *buf, const void *mem, size_t len)
+{
+    uint8_t *tail = buf->data + buf->len;
+
+    __builtin_memcpy(tail, mem, len);
+    buf->len += len;
+    return tail;
+}
+
+static inline uint8_t net_buf_pull_u8(struct net_buf *buf)
+{
+    buf->len--;
+    return *buf->data++;
+}
+
+static inline uint32_t net_buf_pull_le32(struct net_buf *buf)
+{
+    uint32_t val = sys_get_le32(buf->data);
+
+    buf->data += 4;
+    buf->len -= 4;
+    return val;
+}
+
+/* Bluetooth connection */
+
+#define BT_ADDR_LE_STR_LEN  30
+#define BT_SECURITY_L1      1
+#define BT_SECURITY_L2      2
+
+typedef int bt_security_t;
+enum bt_security_err {
+    BT_SECURITY_ERR_SUCCESS,
+};
+
+struct bt_conn;
+typedef struct {
+    uint8_t val[7];
+} bt_addr_le_t;
+
+struct bt_conn *bt_conn_ref(struct bt_conn *conn);
+void bt_conn_unref(struct bt_conn *conn);
+const bt_addr_le_t *bt_conn_get_dst(const struct bt_conn *conn);
+bt_security_t bt_conn_get_security(const struct bt_conn *conn);
+int bt_addr_le_to_str(const bt_addr_le_t *addr, char *str, size_t len);
+
+struct bt_conn_cb {
+    void (*connected)(struct bt_conn *conn, uint8_t err);
+    void (*disconnected)(struct bt_conn *conn, uint8_t reason);
+    void (*security_changed)(struct bt_conn *conn, bt_security_t level, enum bt_security_err err);
+};
+
+#define BT_CONN_CB_DEFINE(name)     const struct bt_conn_cb name
+
+/* L2CAP, in l2cap_fs_host.c a channel is a SOCK_SEQPACKET connection with one SDU per packet */
+
+#define BT_L2CAP_SDU_HDR_SIZE           2
+#define BT_L2CAP_SDU_CHAN_SEND_RESERVE  8
+#define BT_L2CAP_SDU_BUF_SIZE(mtu)      (BT_L2CAP_SDU_CHAN_SEND_RESERVE + BT_L2CAP_SDU_HDR_SIZE + (mtu))
+
+#define BT_CONN_LE_PHY_PARAM_2M     NULL
+#define BT_LE_DATA_LEN_PARAM_MAX    NULL
+
+struct bt_l2cap_chan;
+
+struct bt_l2cap_chan_ops {
+    struct net_buf *(*alloc_buf)(struct bt_l2cap_chan *chan);
+    int (*recv)(struct bt_l2cap_chan *chan, struct net_buf *buf);
+    void (*connected)(struct bt_l2cap_chan *chan);
+    void (*disconnected)(struct bt_l2cap_chan *chan);
+};
+
+struct bt_l2cap_chan {
+    struct bt_conn *conn;
+    const struct bt_l2cap_chan_ops *ops;
+};
+
+struct bt_l2cap_le_endpoint {
+    uint16_t mtu;
+};
+
+struct bt_l2cap_le_chan {
+    struct bt_l2cap_chan chan;
+    struct bt_l2cap_le_endpoint rx;
+    struct bt_l2cap_le_endpoint tx;
+};
+
+struct bt_l2cap_server {
+    uint16_t psm;
+    int sec_level;
+    int (*accept)(struct bt_conn *conn, struct bt_l2cap_server *server, struct bt_l2cap_chan **chan);
+};
+
+int bt_l2cap_server_register(struct bt_l2cap_server *server);
+int bt_l2cap_chan_send(struct bt_l2cap_chan *chan, struct net_buf *buf);
+int bt_l2cap_chan_recv_complete(struct bt_l2cap_chan *chan, struct net_buf *buf);
+
+static inline int bt_conn_le_phy_update(struct bt_conn *conn, const void *param)
+{
+    return 0;
+}
+
+static inline int bt_conn_le_data_len_update(struct bt_conn *conn, const void *param)
+{
+    return 0;
+}
+
+/* GATT discovery, in ancs_host.c only ANCS is found */
+
+struct bt_uuid {
+    int unused;
+};
+
+extern const struct bt_uuid bt_uuid_gatt;
+extern const struct bt_uuid bt_uuid_ancs;
+#define BT_UUID_GATT    (&bt_uuid_gatt)
+#define BT_UUID_ANCS    (&bt_uuid_ancs)
+
+struct bt_gatt_dm;
+
+struct bt_gatt_dm_cb {
+    void (*completed)(struct bt_gatt_dm *dm, void *context);
+    void (*service_not_found)(struct bt_conn *conn, void *context);
+    void (*error_found)(struct bt_conn *conn, int err, void *context);
+};
+
+int bt_gatt_dm_start(struct bt_conn *conn, const struct bt_uuid *svc_uuid, const struct bt_gatt_dm_cb *cb,
+                     void *context);
+struct bt_conn *bt_gatt_dm_conn_get(struct bt_gatt_dm *dm);
+size_t bt_gatt_dm_attr_cnt(const struct bt_gatt_dm *dm);
+int bt_gatt_dm_data_release(struct bt_gatt_dm *dm);
+
+static inline void bt_gatt_dm_data_print(const struct bt_gatt_dm *dm)
+{
+    (void)dm;
+}
+
+struct bt_gattp_handle_range {
+    uint16_t start_handle;
+    uint16_t end_handle;
+};
+
+struct bt_gattp {
+    struct bt_conn *conn;
+};
+
+typedef void (*bt_gattp_indicate_cb)(struct bt_gattp *gattp, const struct bt_gattp_handle_range *handle_range,
+                                     int err);
+
+int bt_gattp_init(struct bt_gattp *gattp);
+int bt_gattp_handles_assign(struct bt_gatt_dm *dm, struct bt_gattp *gattp);
+int bt_gattp_subscribe_service_changed(struct bt_gattp *gattp, bt_gattp_indicate_cb func);
+
+/* File system, paths are mapped below the directory given to l2cap_fs_host */
+
+#define FS_O_READ       0x01
+#define FS_O_WRITE      0x02
+#define FS_O_RDWR       (FS_O_READ | FS_O_WRITE)
+#define FS_O_CREATE     0x10
+
+#define FS_SEEK_SET     0
+
+struct fs_file_t {
+    int fd;
+};
+
+struct fs_dirent {
+    size_t size;
+};
+
+static inline void fs_file_t_init(struct fs_file_t *zfp)
+{
+    zfp->fd = -1;
+}
+
+int fs_stat(const char *path, struct fs_dirent *entry);
+int fs_open(struct fs_file_t *zfp, const char *path, int flags);
+int fs_close(struct fs_file_t *zfp);
+int fs_seek(struct fs_file_t *zfp, off_t offset, int whence);
+int fs_truncate(struct fs_file_t *zfp, off_t length);
+ssize_t fs_read(struct fs_file_t *zfp, void *ptr, size_t size);
+ssize_t fs_write(struct fs_file_t *zfp, const void *ptr, size_t size);
+
+/*
+ * ANCS client, modelled by hand on the NCS client of the sdk-nrf revision in app/west.yml, v3.3.0-preview1
+ * (include/bluetooth/services/ancs_client.h and subsys/bluetooth/services/ancs_*.c): one parse state for
+ * all Data Source responses, which every Control Point write resets. Check it against them when west.yml
+ * moves to another NCS version.
+ */
+
+#define BT_ANCS_ATTR_DATA_MAX   32
+#define BT_ANCS_NOTIF_ATTR_COUNT    8
+#define BT_ANCS_APP_ATTR_COUNT      1
+
+#define BT_ATT_ERR_ANCS_NP_UNKNOWN_COMMAND      0xA0
+#define BT_ATT_ERR_ANCS_NP_INVALID_COMMAND      0xA1
+#define BT_ATT_ERR_ANCS_NP_INVALID_PARAMETER    0xA2
+#define BT_ATT_ERR_ANCS_NP_ACTION_FAILED        0xA3
+
+enum bt_ancs_evt_id_values {
+    BT_ANCS_EVENT_ID_NOTIFICATION_ADDED,
+    BT_ANCS_EVENT_ID_NOTIFICATION_MODIFIED,
+    BT_ANCS_EVENT_ID_NOTIFICATION_REMOVED,
+};
+
+enum bt_ancs_command_id_values {
+    BT_ANCS_COMMAND_ID_GET_NOTIF_ATTRIBUTES,
+    BT_ANCS_COMMAND_ID_GET_APP_ATTRIBUTES,
+    BT_ANCS_COMMAND_ID_GET_PERFORM_NOTIF_ACTION,
+};
+
+enum bt_ancs_notif_attr_id_val {
+    BT_ANCS_NOTIF_ATTR_ID_APP_IDENTIFIER,
+    BT_ANCS_NOTIF_ATTR_ID_TITLE,
+    BT_ANCS_NOTIF_ATTR_ID_SUBTITLE,
+    BT_ANCS_NOTIF_ATTR_ID_MESSAGE,
+    BT_ANCS_NOTIF_ATTR_ID_MESSAGE_SIZE,
+    BT_ANCS_NOTIF_ATTR_ID_DATE,
+    BT_ANCS_NOTIF_ATTR_ID_POSITIVE_ACTION_LABEL,
+    BT_ANCS_NOTIF_ATTR_ID_NEGATIVE_ACTION_LABEL,
+};
+
+enum bt_ancs_app_attr_id_val {
+    BT_ANCS_APP_ATTR_ID_DISPLAY_NAME,
+};
+
+struct bt_ancs_evt_notif {
+    uint32_t notif_uid;
+    uint8_t evt_id;
+    uint8_t category_id;
+    uint8_t category_count;
+};
+
+struct bt_ancs_attr {
+    uint32_t attr_id;
+    uint16_t attr_len;
+    uint8_t *attr_data;
+};
+
+struct bt_ancs_attr_response {
+    uint8_t command_id;
+    struct bt_ancs_attr attr;
+    uint32_t notif_uid;
+    uint8_t app_id[BT_ANCS_ATTR_DATA_MAX];
+};
+
+struct bt_ancs_client;
+
+typedef void (*bt_ancs_ns_notif_cb)(struct bt_ancs_client *ancs_c, int err, const struct bt_ancs_evt_notif *notif);
+typedef void (*bt_ancs_ds_notif_cb)(struct bt_ancs_client *ancs_c, const struct bt_ancs_attr_response *response);
+typedef void (*bt_ancs_write_cb)(struct bt_ancs_client *ancs_c, uint8_t err);
+
+struct bt_ancs_attr_list {
+    bool get;
+    uint8_t *attr_data;
+    uint16_t attr_len;
+};
+
+enum bt_ancs_parse_state {
+    ANCS_PARSE_COMMAND_ID,
+    ANCS_PARSE_NOTIF_UID,
+    ANCS_PARSE_APP_ID,
+    ANCS_PARSE_ATTR_ID,
+    ANCS_PARSE_ATTR_LEN,
+    ANCS_PARSE_ATTR_DATA,
+};
+
+struct bt_ancs_client {
+    struct bt_ancs_attr_list notif_attrs[BT_ANCS_NOTIF_ATTR_COUNT];
+    struct bt_ancs_attr_list app_attrs[BT_ANCS_APP_ATTR_COUNT];
+    bt_ancs_ns_notif_cb ns_notif_cb;
+    bt_ancs_ds_notif_cb ds_notif_cb;
+    bt_ancs_write_cb write_cb;
+    bool cp_write_pending;
+    /* Shared by all responses, a Control Point write sets expected_attrs */
+    enum bt_ancs_parse_state parse_state;
+    uint8_t expected_attrs;
+    uint8_t field_index;
+    uint16_t attr_len;
+    struct bt_ancs_attr_response response;
+};
+
+int bt_ancs_client_init(struct bt_ancs_client *ancs_c);
+int bt_ancs_handles_assign(struct bt_gatt_dm *dm, struct bt_ancs_client *ancs_c);
+int bt_ancs_register_attr(struct bt_ancs_client *ancs_c, uint8_t id, uint8_t *data, uint16_t len);
+int bt_ancs_register_app_attr(struct bt_ancs_client *ancs_c, uint8_t id, uint8_t *data, uint16_t len);
+int bt_ancs_subscribe_notification_source(struct bt_ancs_client *ancs_c, bt_ancs_ns_notif_cb func);
+int bt_ancs_subscribe_data_source(struct bt_ancs_client *ancs_c, bt_ancs_ds_notif_cb func);
+int bt_ancs_request_attrs(struct bt_ancs_client *ancs_c, const struct bt_ancs_evt_notif *notif,
+                          bt_ancs_write_cb func);
+int bt_ancs_request_app_attr(struct bt_ancs_client *ancs_c, const uint8_t *app_id, uint32_t len,
+                             bt_ancs_write_cb func);